@@ -0,0 +1,458 @@
+#include <memory>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>  // max(), min()
+#include <utility>    // move()
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "conjuncts.hpp"
+#include "inliner.hpp"
+#include "accel.hpp"
+
+using std::unique_ptr;
+using std::make_unique;
+using std::vector;
+using std::string;
+using std::unordered_map;
+using std::unordered_set;
+using std::max;
+using std::min;
+using std::move;
+
+namespace nts
+{
+
+namespace
+{
+
+using p_Term    = unique_ptr < Term    >;
+using p_Formula = unique_ptr < Formula >;
+
+const DataType & int_type()
+{
+	static const DataType t = DataType ( ScalarType::Integer() );
+	return t;
+}
+
+const VariableReference * variable_reference ( const Term & t )
+{
+	if ( t.term_type() != Term::TermType::Leaf ||
+			static_cast < const Leaf & > ( t ).leaf_type() !=
+				Leaf::LeafType::VariableReference )
+		return nullptr;
+
+	return & static_cast < const VariableReference & > ( t );
+}
+
+// Value of a constant term built from +, - and *
+bool constant ( const Term & t, int & value )
+{
+	switch ( t.term_type() )
+	{
+		case Term::TermType::Leaf:
+			if ( static_cast < const Leaf & > ( t ).leaf_type() != Leaf::LeafType::IntConstant )
+				return false;
+			value = static_cast < const IntConstant & > ( t ).value();
+			return true;
+
+		case Term::TermType::MinusTerm:
+			if ( !constant ( static_cast < const MinusTerm & > ( t ).term(), value ) )
+				return false;
+			value = -value;
+			return true;
+
+		case Term::TermType::ArithmeticOperation:
+		{
+			auto & aop = static_cast < const ArithmeticOperation & > ( t );
+			int v1, v2;
+			if ( !constant ( aop.term1(), v1 ) || !constant ( aop.term2(), v2 ) )
+				return false;
+
+			switch ( aop.operation() )
+			{
+				case ArithOp::Add: value = v1 + v2; return true;
+				case ArithOp::Sub: value = v1 - v2; return true;
+				case ArithOp::Mul: value = v1 * v2; return true;
+				default:           return false;
+			}
+		}
+
+		case Term::TermType::ArrayTerm:
+			return false;
+	}
+
+	return false;
+}
+
+// Is the term linear over unprimed Int variables?
+bool linear ( const Term & t )
+{
+	int c;
+	if ( constant ( t, c ) )
+		return true;
+
+	switch ( t.term_type() )
+	{
+		case Term::TermType::Leaf:
+		{
+			const VariableReference * vr = variable_reference ( t );
+			return vr && !vr->primed() && vr->variable()->type() == int_type();
+		}
+
+		case Term::TermType::MinusTerm:
+			return linear ( static_cast < const MinusTerm & > ( t ).term() );
+
+		case Term::TermType::ArithmeticOperation:
+		{
+			auto & aop = static_cast < const ArithmeticOperation & > ( t );
+			switch ( aop.operation() )
+			{
+				case ArithOp::Add:
+				case ArithOp::Sub:
+					return linear ( aop.term1() ) && linear ( aop.term2() );
+
+				case ArithOp::Mul:
+					return ( constant ( aop.term1(), c ) && linear ( aop.term2() ) ) ||
+						( constant ( aop.term2(), c ) && linear ( aop.term1() ) );
+
+				default:
+					return false;
+			}
+		}
+
+		case Term::TermType::ArrayTerm:
+			return false;
+	}
+
+	return false;
+}
+
+// Is the term x + c (or c + x, x - c, x)?
+bool offset ( const Term & t, const Variable & x, int & c )
+{
+	auto is_x = [&] ( const Term & u )
+	{
+		const VariableReference * vr = variable_reference ( u );
+		return vr && !vr->primed() && vr->variable().get() == &x;
+	};
+
+	if ( is_x ( t ) )
+	{
+		c = 0;
+		return true;
+	}
+
+	if ( t.term_type() != Term::TermType::ArithmeticOperation )
+		return false;
+
+	auto & aop = static_cast < const ArithmeticOperation & > ( t );
+	switch ( aop.operation() )
+	{
+		case ArithOp::Add:
+			return ( is_x ( aop.term1() ) && constant ( aop.term2(), c ) ) ||
+				( is_x ( aop.term2() ) && constant ( aop.term1(), c ) );
+
+		case ArithOp::Sub:
+			if ( !is_x ( aop.term1() ) || !constant ( aop.term2(), c ) )
+				return false;
+			c = -c;
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+RelationOp mirrored ( RelationOp op )
+{
+	switch ( op )
+	{
+		case RelationOp::lt:  return RelationOp::gt;
+		case RelationOp::leq: return RelationOp::geq;
+		case RelationOp::gt:  return RelationOp::lt;
+		case RelationOp::geq: return RelationOp::leq;
+		default:              return op;
+	}
+}
+
+// Bounds of x' - x in one iteration
+struct Increment
+{
+	bool has_lo = false;
+	bool has_hi = false;
+	int  lo = 0;
+	int  hi = 0;
+
+	bool exact() const { return has_lo && has_hi && lo == hi; }
+
+	void lower ( int c ) { lo = has_lo ? max ( lo, c ) : c; has_lo = true; }
+	void upper ( int c ) { hi = has_hi ? min ( hi, c ) : c; has_hi = true; }
+};
+
+p_Term ref ( Variable & v, bool primed = false )
+{
+	return make_unique < VariableReference > ( v, primed );
+}
+
+p_Term num ( int c )
+{
+	return make_unique < IntConstant > ( c );
+}
+
+// x + c * t
+p_Term shifted ( Variable & x, int c, p_Term t )
+{
+	if ( c == 0 )
+		return ref ( x );
+
+	if ( c == 1 )
+		return make_unique < ArithmeticOperation > ( ArithOp::Add, ref ( x ), move ( t ) );
+
+	return make_unique < ArithmeticOperation > ( ArithOp::Add, ref ( x ),
+			make_unique < ArithmeticOperation > ( ArithOp::Mul, num ( c ), move ( t ) ) );
+}
+
+// Replaces x by x + c_x * ( n - 1 )
+p_Term last_iteration ( p_Term t, const unordered_map < const Variable *, int > & step,
+		Variable & n )
+{
+	if ( const VariableReference * vr = variable_reference ( *t ) )
+	{
+		Variable & x = *vr->variable().get();
+		auto it = step.find ( &x );
+		if ( it == step.end() || it->second == 0 )
+			return t;
+
+		return shifted ( x, it->second, make_unique < ArithmeticOperation > (
+					ArithOp::Sub, ref ( n ), num ( 1 ) ) );
+	}
+
+	auto f = [&] ( p_Term u ) { return last_iteration ( move ( u ), step, n ); };
+	if ( t->term_type() == Term::TermType::ArithmeticOperation )
+		static_cast < ArithmeticOperation & > ( *t ).transform_terms ( f );
+	else if ( t->term_type() == Term::TermType::MinusTerm )
+		static_cast < MinusTerm & > ( *t ).transform_term ( f );
+
+	return t;
+}
+
+/**
+ * Transitive closure of the loop formula, or nullptr
+ * if the formula does not have the expected shape.
+ */
+p_Formula closure ( Formula & f, const string & name )
+{
+	vector < Formula * > parts;
+	conjuncts ( f, parts );
+
+	vector < Relation * > guards;
+	unordered_map < const Variable *, Increment > increments;
+	vector < Variable * > changed;
+	unordered_map < const Variable *, unsigned int > n_havocs;
+	unsigned int havocs = 0;
+
+	for ( Formula * p : parts )
+	{
+		if ( p->type() != Formula::Type::AtomicProposition )
+			return nullptr;
+
+		auto & ap = static_cast < AtomicProposition & > ( *p );
+		if ( ap.aptype() == AtomicProposition::APType::Havoc )
+		{
+			havocs++;
+			unordered_set < const Variable * > seen;
+			for ( const VariableUse & u : static_cast < Havoc & > ( ap ).variables )
+			{
+				if ( !seen.insert ( u.get() ).second )
+					continue;
+				if ( havocs == 1 )
+					changed.push_back ( u.get() );
+				n_havocs [ u.get() ]++;
+			}
+			continue;
+		}
+
+		if ( ap.aptype() != AtomicProposition::APType::Relation )
+			return nullptr;
+
+		auto & r = static_cast < Relation & > ( ap );
+		if ( r.operation() == RelationOp::neq )
+			return nullptr;
+
+		if ( !refers_next ( r ) )
+		{
+			if ( !linear ( r.term1() ) || !linear ( r.term2() ) )
+				return nullptr;
+			guards.push_back ( &r );
+			continue;
+		}
+
+		// x' ~ x + c
+		const VariableReference * next = variable_reference ( r.term1() );
+		const Term * other = &r.term2();
+		RelationOp op = r.operation();
+		if ( !next || !next->primed() )
+		{
+			next  = variable_reference ( r.term2() );
+			other = &r.term1();
+			op    = mirrored ( op );
+		}
+
+		int c;
+		if ( !next || !next->primed() || next->variable()->type() != int_type() ||
+				!offset ( *other, *next->variable(), c ) )
+			return nullptr;
+
+		Increment & inc = increments [ next->variable().get() ];
+		switch ( op )
+		{
+			case RelationOp::eq:  inc.lower ( c ); inc.upper ( c ); break;
+			case RelationOp::leq: inc.upper ( c );     break;
+			case RelationOp::lt:  inc.upper ( c - 1 ); break;
+			case RelationOp::geq: inc.lower ( c );     break;
+			case RelationOp::gt:  inc.lower ( c + 1 ); break;
+			default:              return nullptr;
+		}
+	}
+
+	if ( havocs == 0 )
+		return nullptr;
+
+	// Changed variables are in all havocs
+	unordered_set < const Variable * > frame;
+	vector < Variable * > in_all;
+	for ( Variable * v : changed )
+	{
+		if ( n_havocs [ v ] == havocs )
+		{
+			frame.insert ( v );
+			in_all.push_back ( v );
+		}
+	}
+
+	unordered_map < const Variable *, int > step;
+	for ( const auto & i : increments )
+	{
+		if ( !frame.count ( i.first ) )
+			return nullptr;
+		if ( i.second.has_lo && i.second.has_hi && i.second.lo > i.second.hi )
+			return nullptr;
+		if ( i.second.exact() )
+			step.emplace ( i.first, i.second.lo );
+	}
+
+	// Values of guard variables in each iteration are known
+	vector < bool > moving;
+	for ( Relation * g : guards )
+	{
+		bool ok = true;
+		moving.push_back ( false );
+		visit_variable_uses ( [&] ( VariableUse & u )
+		{
+			if ( !frame.count ( u.get() ) )
+				return;
+			auto it = step.find ( u.get() );
+			if ( it == step.end() )
+				ok = false;
+			else if ( it->second != 0 )
+				moving.back() = true;
+		} ).visit ( *g );
+
+		if ( !ok )
+			return nullptr;
+	}
+
+	// Fresh iteration count, inserted into the quantifier below
+	unique_ptr < Variable > n ( new Variable ( int_type(), name ) );
+
+	vector < p_Formula > inner;
+	inner.push_back ( make_unique < Relation > ( RelationOp::geq, ref ( *n ), num ( 1 ) ) );
+	for ( Variable * x : in_all )
+	{
+		auto it = increments.find ( x );
+		if ( it == increments.end() )
+			continue;
+
+		const Increment & inc = it->second;
+		if ( inc.exact() )
+		{
+			inner.push_back ( make_unique < Relation > ( RelationOp::eq,
+						ref ( *x, true ), shifted ( *x, inc.lo, ref ( *n ) ) ) );
+			continue;
+		}
+
+		if ( inc.has_hi )
+			inner.push_back ( make_unique < Relation > ( RelationOp::leq,
+						ref ( *x, true ), shifted ( *x, inc.hi, ref ( *n ) ) ) );
+		if ( inc.has_lo )
+			inner.push_back ( make_unique < Relation > ( RelationOp::geq,
+						ref ( *x, true ), shifted ( *x, inc.lo, ref ( *n ) ) ) );
+	}
+
+	vector < p_Formula > outer;
+	for ( unsigned int i = 0; i < guards.size(); i++ )
+	{
+		outer.push_back ( p_Formula ( guards[i]->clone() ) );
+		if ( !moving[i] )
+			continue;
+
+		unique_ptr < Relation > last ( guards[i]->clone() );
+		last->transform_terms ( [&] ( p_Term t )
+		{
+			return last_iteration ( move ( t ), step, *n );
+		} );
+		inner.push_back ( move ( last ) );
+	}
+
+	auto h = make_unique < Havoc > ();
+	for ( Variable * v : in_all )
+		h->variables.push_back ( v );
+	outer.push_back ( move ( h ) );
+
+	auto qf = make_unique < QuantifiedFormula > ( Quantifier::Exists,
+			QuantifiedType ( int_type() ), conjunction ( move ( inner ) ) );
+	n.release()->insert_to ( qf->list );
+	outer.push_back ( move ( qf ) );
+
+	return conjunction ( move ( outer ) );
+}
+
+} // anonymous namespace
+
+//------------------------------------//
+// Acceleration                       //
+//------------------------------------//
+
+unsigned int accelerate_loops ( BasicNts & bn )
+{
+	unsigned int n_accelerated = 0;
+	for ( Transition * t : bn.transitions() )
+	{
+		if ( &t->from() != &t->to() || t->rule().kind() != TransitionRule::Kind::Formula )
+			continue;
+
+		auto & rule = static_cast < FormulaTransitionRule & > ( t->rule() );
+		p_Formula f = closure ( rule.formula(), "iter_" + t->from().name );
+		if ( !f )
+			continue;
+
+		rule.transform_formula ( [&] ( p_Formula ) { return move ( f ); } );
+		n_accelerated++;
+	}
+
+	return n_accelerated;
+}
+
+unsigned int accelerate_loops ( Nts & nts )
+{
+	unsigned int n_accelerated = 0;
+	for ( BasicNts * bn : nts.basic_ntses() )
+		n_accelerated += accelerate_loops ( *bn );
+
+	return n_accelerated;
+}
+
+} // namespace nts
@@ -0,0 +1,34 @@
+#ifndef NTS_ACCEL_HPP_
+#define NTS_ACCEL_HPP_
+#pragma once
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Replaces self-loops by their transitive closure.
+ *
+ * A self-loop is accelerated, if its formula is a conjunction of
+ *  - top-level havocs (at least one),
+ *  - difference bounds x' - x ~ c on changed Int variables,
+ *    written as x' ~ x + c (~ is one of =, <, <=, >, >=),
+ *  - guards, which are relations ( other than != ) between linear terms
+ *    over unprimed Int variables, which are either kept by the loop,
+ *    or updated by x' = x + c.
+ * The formula of the loop is then replaced by
+ *    guards && havoc ( ... ) && exists iter_<state> : Int .
+ *        ( iter_<state> >= 1 && x' ~ x + c * iter_<state> && ... &&
+ *          guards after iter_<state> - 1 iterations )
+ * Guards are convex, so it is enough to check them in the first
+ * and the last iteration.
+ *
+ * @return number of accelerated loops
+ */
+unsigned int accelerate_loops ( BasicNts & bn );
+unsigned int accelerate_loops ( Nts & nts );
+
+} // namespace nts
+
+#endif // NTS_ACCEL_HPP_
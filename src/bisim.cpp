@@ -0,0 +1,228 @@
+#include <memory>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>  // sort(), unique(), min_element()
+#include <utility>    // pair, move()
+
+#include "nts.hpp"
+#include "dedup.hpp"
+#include "bisim.hpp"
+
+using std::unique_ptr;
+using std::vector;
+using std::map;
+using std::unordered_map;
+using std::unordered_set;
+using std::pair;
+using std::sort;
+using std::unique;
+using std::min_element;
+using std::move;
+
+namespace nts
+{
+
+namespace
+{
+
+// ( rule class, block of the target )
+using Signature = vector < pair < unsigned int, unsigned int > >;
+
+// Numbers structurally equal rules by the same class
+unordered_map < const Transition *, unsigned int > rule_classes ( const BasicNts & bn )
+{
+	unordered_map < std::size_t, vector < const TransitionRule * > > buckets;
+	unordered_map < const TransitionRule *, unsigned int > class_of;
+	unordered_map < const Transition *, unsigned int > result;
+
+	for ( const Transition * t : bn.transitions() )
+	{
+		const TransitionRule & r = t->rule();
+		auto & bucket = buckets [ r.hash() ];
+
+		const TransitionRule * same = nullptr;
+		for ( const TransitionRule * b : bucket )
+		{
+			if ( structurally_equal ( *b, r ) )
+			{
+				same = b;
+				break;
+			}
+		}
+
+		if ( !same )
+		{
+			bucket.push_back ( &r );
+			class_of.emplace ( &r, class_of.size() );
+			same = &r;
+		}
+
+		result.emplace ( t, class_of.at ( same ) );
+	}
+
+	return result;
+}
+
+} // anonymous namespace
+
+//------------------------------------//
+// Bisimulation                       //
+//------------------------------------//
+
+unsigned int merge_bisimilar_states ( BasicNts & bn )
+{
+	const vector < State * > states ( bn.states().begin(), bn.states().end() );
+	unordered_map < const State *, unsigned int > id;
+	for ( State * s : states )
+		id.emplace ( s, id.size() );
+
+	const auto rule_class = rule_classes ( bn );
+
+	// Initial partition by flags
+	vector < unsigned int > block ( states.size() );
+	vector < vector < unsigned int > > members;
+	{
+		map < unsigned int, unsigned int > by_flags;
+		for ( unsigned int i = 0; i < states.size(); i++ )
+		{
+			const State & s = *states[i];
+			unsigned int flags = s.is_initial() | s.is_final() << 1 | s.is_error() << 2;
+			auto it = by_flags.emplace ( flags, members.size() ).first;
+			if ( it->second == members.size() )
+				members.emplace_back();
+
+			block[i] = it->second;
+			members [ it->second ].push_back ( i );
+		}
+	}
+
+	auto signature = [&] ( unsigned int i )
+	{
+		Signature sig;
+		for ( const Transition * t : states[i]->outgoing() )
+			sig.emplace_back ( rule_class.at ( t ), block [ id.at ( &t->to() ) ] );
+
+		sort ( sig.begin(), sig.end() );
+		sig.erase ( unique ( sig.begin(), sig.end() ), sig.end() );
+		return sig;
+	};
+
+	vector < unsigned int > work;
+	vector < bool > queued ( members.size(), true );
+	for ( unsigned int b = 0; b < members.size(); b++ )
+		work.push_back ( b );
+
+	while ( !work.empty() )
+	{
+		const unsigned int b = work.back();
+		work.pop_back();
+		queued [ b ] = false;
+
+		map < Signature, vector < unsigned int > > groups;
+		for ( unsigned int i : members [ b ] )
+			groups [ signature ( i ) ].push_back ( i );
+
+		if ( groups.size() == 1 )
+			continue;
+
+		// The largest group keeps the block, others get new blocks
+		auto largest = groups.begin();
+		for ( auto it = groups.begin(); it != groups.end(); ++it )
+		{
+			if ( it->second.size() > largest->second.size() )
+				largest = it;
+		}
+
+		members [ b ] = move ( largest->second );
+		vector < unsigned int > moved;
+		for ( auto it = groups.begin(); it != groups.end(); ++it )
+		{
+			if ( it == largest )
+				continue;
+
+			const unsigned int nb = members.size();
+			for ( unsigned int i : it->second )
+			{
+				block[i] = nb;
+				moved.push_back ( i );
+			}
+			members.push_back ( move ( it->second ) );
+			queued.push_back ( false );
+		}
+
+		// Predecessors of moved states may have changed signatures
+		for ( unsigned int i : moved )
+		{
+			for ( const Transition * t : states[i]->incoming() )
+			{
+				const unsigned int p = block [ id.at ( &t->from() ) ];
+				if ( !queued [ p ] )
+				{
+					queued [ p ] = true;
+					work.push_back ( p );
+				}
+			}
+		}
+	}
+
+	// Replace each block by its first state
+	vector < State * > rep ( states.size() );
+	unsigned int n_removed = 0;
+	for ( const auto & m : members )
+	{
+		const unsigned int first = *min_element ( m.begin(), m.end() );
+		for ( unsigned int i : m )
+			rep[i] = states [ first ];
+		n_removed += m.size() - 1;
+	}
+
+	if ( n_removed == 0 )
+		return 0;
+
+	vector < Transition * > redirected;
+	for ( Transition * t : bn.transitions() )
+	{
+		if ( rep [ id.at ( &t->from() ) ] != &t->from() ||
+				rep [ id.at ( &t->to() ) ] != &t->to() )
+			redirected.push_back ( t );
+	}
+
+	for ( Transition * t : redirected )
+	{
+		// Representative of the source has an equivalent transition
+		State & from = t->from();
+		if ( rep [ id.at ( &from ) ] == &from )
+		{
+			auto * n = new Transition ( unique_ptr < TransitionRule > ( t->rule().clone() ),
+					from, *rep [ id.at ( &t->to() ) ] );
+			n->annotations = t->annotations;
+			n->insert_to ( bn );
+		}
+		delete t;
+	}
+
+	for ( unsigned int i = 0; i < states.size(); i++ )
+	{
+		if ( rep[i] != states[i] )
+		{
+			states[i]->remove_from_parent();
+			delete states[i];
+		}
+	}
+
+	remove_duplicate_transitions ( bn );
+	return n_removed;
+}
+
+unsigned int merge_bisimilar_states ( Nts & nts )
+{
+	unsigned int n_removed = 0;
+	for ( BasicNts * bn : nts.basic_ntses() )
+		n_removed += merge_bisimilar_states ( *bn );
+
+	return n_removed;
+}
+
+} // namespace nts
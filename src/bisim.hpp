@@ -0,0 +1,27 @@
+#ifndef NTS_BISIM_HPP_
+#define NTS_BISIM_HPP_
+#pragma once
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Merges bisimilar states: states with the same flags
+ * (initial, final, error), whose outgoing transitions have structurally
+ * equal rules (@see structurally_equal) leading to bisimilar states.
+ *
+ * The coarsest such partition is found by partition refinement:
+ * rules are bucketed by their hashes, and only blocks with a transition
+ * into a split block are refined again. Each block is replaced
+ * by its first state; transitions, which become duplicate, are removed.
+ *
+ * @return number of removed states
+ */
+unsigned int merge_bisimilar_states ( BasicNts & bn );
+unsigned int merge_bisimilar_states ( Nts & nts );
+
+} // namespace nts
+
+#endif // NTS_BISIM_HPP_
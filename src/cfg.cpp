@@ -0,0 +1,335 @@
+#include <vector>
+#include <list>
+#include <utility>    // pair, move()
+#include <algorithm>  // reverse(), min()
+#include <stdexcept>
+
+#include "nts.hpp"
+#include "cfg.hpp"
+
+using std::vector;
+using std::list;
+using std::pair;
+using std::move;
+using std::reverse;
+using std::min;
+using std::out_of_range;
+
+namespace nts
+{
+
+namespace
+{
+
+// ( state, remaining outgoing transitions )
+using Frame = pair < unsigned int, list < Transition * >::const_iterator >;
+
+} // anonymous namespace
+
+ControlFlow::ControlFlow ( const BasicNts & bn )
+{
+	for ( const State * s : bn.states() )
+	{
+		_id.emplace ( s, _states.size() );
+		_states.push_back ( s );
+	}
+
+	_info.assign ( _states.size(), Info { -1, 0, false, false, -1, 0, 0 } );
+
+	depth_first_search();
+	tarjan();
+	dominators();
+}
+
+const ControlFlow::Info & ControlFlow::info ( const State & s ) const
+{
+	auto it = _id.find ( &s );
+	if ( it == _id.end() )
+		throw out_of_range ( "State " + s.name + " is not analysed" );
+
+	return _info [ it->second ];
+}
+
+int ControlFlow::rpo_index ( const State & s ) const
+{
+	return info ( s ).rpo;
+}
+
+unsigned int ControlFlow::scc_index ( const State & s ) const
+{
+	return info ( s ).scc;
+}
+
+bool ControlFlow::on_cycle ( const State & s ) const
+{
+	return info ( s ).cycle;
+}
+
+bool ControlFlow::is_loop_head ( const State & s ) const
+{
+	return info ( s ).loop_head;
+}
+
+const State * ControlFlow::idom ( const State & s ) const
+{
+	const Info & i = info ( s );
+	if ( i.rpo < 0 || i.idom < 0 )
+		return nullptr;
+
+	return _rpo [ i.idom ];
+}
+
+bool ControlFlow::dominates ( const State & a, const State & b ) const
+{
+	const Info & ia = info ( a );
+	const Info & ib = info ( b );
+	if ( ia.rpo < 0 || ib.rpo < 0 )
+		return false;
+
+	return ia.dom_in <= ib.dom_in && ib.dom_out <= ia.dom_out;
+}
+
+//------------------------------------//
+// Depth-first search                 //
+//------------------------------------//
+
+void ControlFlow::depth_first_search()
+{
+	enum class Mark { New, Open, Done };
+	vector < Mark > mark ( _states.size(), Mark::New );
+	vector < unsigned int > postorder;
+
+	vector < Frame > stack;
+
+	auto search = [&] ( unsigned int root )
+	{
+		mark [ root ] = Mark::Open;
+		stack.emplace_back ( root, _states [ root ]->outgoing().begin() );
+
+		while ( !stack.empty() )
+		{
+			const unsigned int v = stack.back().first;
+			if ( stack.back().second == _states [ v ]->outgoing().end() )
+			{
+				mark [ v ] = Mark::Done;
+				postorder.push_back ( v );
+				stack.pop_back();
+				continue;
+			}
+
+			const unsigned int w = _id.at ( & ( *stack.back().second++ )->to() );
+			if ( mark [ w ] == Mark::New )
+			{
+				mark [ w ] = Mark::Open;
+				stack.emplace_back ( w, _states [ w ]->outgoing().begin() );
+			}
+			else if ( mark [ w ] == Mark::Open && !_info [ w ].loop_head )
+			{
+				_info [ w ].loop_head = true;
+				_loop_heads.push_back ( _states [ w ] );
+			}
+		}
+	};
+
+	for ( unsigned int i = 0; i < _states.size(); i++ )
+	{
+		if ( _states [ i ]->is_initial() && mark [ i ] == Mark::New )
+			search ( i );
+	}
+
+	for ( auto it = postorder.rbegin(); it != postorder.rend(); ++it )
+	{
+		_info [ *it ].rpo = _rpo.size();
+		_rpo.push_back ( _states [ *it ] );
+	}
+
+	// Loop heads of the unreachable part
+	for ( unsigned int i = 0; i < _states.size(); i++ )
+	{
+		if ( mark [ i ] == Mark::New )
+			search ( i );
+	}
+}
+
+//------------------------------------//
+// Strongly connected components      //
+//------------------------------------//
+
+void ControlFlow::tarjan()
+{
+	const unsigned int n = _states.size();
+	vector < int > index ( n, -1 );
+	vector < unsigned int > low ( n, 0 );
+	vector < bool > on_stack ( n, false );
+	vector < unsigned int > component;
+	unsigned int counter = 0;
+
+	vector < Frame > stack;
+
+	auto open = [&] ( unsigned int v )
+	{
+		index [ v ] = low [ v ] = counter++;
+		component.push_back ( v );
+		on_stack [ v ] = true;
+		stack.emplace_back ( v, _states [ v ]->outgoing().begin() );
+	};
+
+	for ( unsigned int root = 0; root < n; root++ )
+	{
+		if ( index [ root ] >= 0 )
+			continue;
+
+		open ( root );
+		while ( !stack.empty() )
+		{
+			const unsigned int v = stack.back().first;
+			if ( stack.back().second != _states [ v ]->outgoing().end() )
+			{
+				const Transition * t = *stack.back().second++;
+				const unsigned int w = _id.at ( &t->to() );
+				if ( w == v )
+					_info [ v ].cycle = true;
+
+				if ( index [ w ] < 0 )
+					open ( w );
+				else if ( on_stack [ w ] )
+					low [ v ] = min ( low [ v ], unsigned ( index [ w ] ) );
+				continue;
+			}
+
+			stack.pop_back();
+			if ( !stack.empty() )
+			{
+				const unsigned int u = stack.back().first;
+				low [ u ] = min ( low [ u ], low [ v ] );
+			}
+
+			if ( low [ v ] != unsigned ( index [ v ] ) )
+				continue;
+
+			// v is the root of a component
+			States scc;
+			unsigned int w;
+			do
+			{
+				w = component.back();
+				component.pop_back();
+				on_stack [ w ] = false;
+				scc.push_back ( _states [ w ] );
+			}
+			while ( w != v );
+
+			for ( const State * s : scc )
+			{
+				Info & i = _info [ _id.at ( s ) ];
+				i.scc = _sccs.size();
+				i.cycle = i.cycle || scc.size() > 1;
+			}
+			_sccs.push_back ( move ( scc ) );
+		}
+	}
+
+	// Tarjan finds components in reverse topological order
+	reverse ( _sccs.begin(), _sccs.end() );
+	for ( Info & i : _info )
+		i.scc = _sccs.size() - 1 - i.scc;
+}
+
+//------------------------------------//
+// Dominators                         //
+//------------------------------------//
+
+// Iterative algorithm of Cooper, Harvey and Kennedy over reverse postorder
+void ControlFlow::dominators()
+{
+	// Node 0 is a virtual root preceding all initial states,
+	// node k > 0 is _rpo [ k - 1 ]
+	const unsigned int m = _rpo.size() + 1;
+	vector < vector < unsigned int > > preds ( m );
+	for ( unsigned int k = 1; k < m; k++ )
+	{
+		const State * s = _rpo [ k - 1 ];
+		if ( s->is_initial() )
+			preds [ k ].push_back ( 0 );
+
+		for ( const Transition * t : s->incoming() )
+		{
+			const int p = _info [ _id.at ( &t->from() ) ].rpo;
+			if ( p >= 0 )
+				preds [ k ].push_back ( p + 1 );
+		}
+	}
+
+	vector < int > dom ( m, -1 );
+	dom [ 0 ] = 0;
+
+	auto intersect = [&] ( unsigned int a, unsigned int b )
+	{
+		while ( a != b )
+		{
+			while ( a > b )
+				a = dom [ a ];
+			while ( b > a )
+				b = dom [ b ];
+		}
+		return a;
+	};
+
+	bool changed = true;
+	while ( changed )
+	{
+		changed = false;
+		for ( unsigned int k = 1; k < m; k++ )
+		{
+			int d = -1;
+			for ( unsigned int p : preds [ k ] )
+			{
+				if ( dom [ p ] < 0 )
+					continue;
+				d = d < 0 ? p : intersect ( p, d );
+			}
+
+			if ( dom [ k ] != d )
+			{
+				dom [ k ] = d;
+				changed = true;
+			}
+		}
+	}
+
+	// Numbering of the dominator tree
+	vector < vector < unsigned int > > children ( m );
+	for ( unsigned int k = 1; k < m; k++ )
+		children [ dom [ k ] ].push_back ( k );
+
+	vector < unsigned int > dom_in ( m );
+	vector < unsigned int > dom_out ( m );
+	vector < pair < unsigned int, unsigned int > > stack { { 0, 0 } };
+	unsigned int counter = 0;
+	dom_in [ 0 ] = counter++;
+
+	while ( !stack.empty() )
+	{
+		auto & top = stack.back();
+		if ( top.second < children [ top.first ].size() )
+		{
+			const unsigned int c = children [ top.first ] [ top.second++ ];
+			dom_in [ c ] = counter++;
+			stack.emplace_back ( c, 0 );
+			continue;
+		}
+
+		dom_out [ top.first ] = counter++;
+		stack.pop_back();
+	}
+
+	for ( unsigned int k = 1; k < m; k++ )
+	{
+		Info & i = _info [ _id.at ( _rpo [ k - 1 ] ) ];
+		i.idom    = dom [ k ] - 1;
+		i.dom_in  = dom_in  [ k ];
+		i.dom_out = dom_out [ k ];
+	}
+}
+
+} // namespace nts
@@ -0,0 +1,100 @@
+#ifndef NTS_CFG_HPP_
+#define NTS_CFG_HPP_
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Analyses of the control graph of a BasicNts, given by
+ * incoming / outgoing transitions of its states.
+ * Usually obtained by BasicNts::cfg(), which caches them.
+ * All analyses are computed in the constructor, in near-linear time.
+ */
+class ControlFlow
+{
+	public:
+		using States = std::vector < const State * >;
+
+		explicit ControlFlow ( const BasicNts & bn );
+
+		ControlFlow ( const ControlFlow & ) = delete;
+		ControlFlow & operator= ( const ControlFlow & ) = delete;
+
+		/**
+		 * @brief States reachable from initial states,
+		 * in reverse postorder of a depth-first search.
+		 */
+		const States & reverse_postorder() const { return _rpo; }
+
+		// Position in reverse_postorder(), -1 if the state is not reachable
+		int rpo_index ( const State & s ) const;
+
+		/**
+		 * @brief Strongly connected components (Tarjan) of all states,
+		 * in topological order: transitions between components lead
+		 * from a component to some later one.
+		 */
+		const std::vector < States > & sccs() const { return _sccs; }
+
+		// Index of the component of the state in sccs()
+		unsigned int scc_index ( const State & s ) const;
+
+		// Is the state on a cycle (nontrivial component or self-loop)?
+		bool on_cycle ( const State & s ) const;
+
+		/**
+		 * @brief Targets of back edges of a depth-first search
+		 * started at initial states (and then at the remaining states).
+		 * Every cycle contains a loop head, hence they are cut points.
+		 */
+		const States & loop_heads() const { return _loop_heads; }
+		bool is_loop_head ( const State & s ) const;
+
+		/**
+		 * @brief Immediate dominator in the graph of reachable states.
+		 * Null for initial and unreachable states, and for states
+		 * dominated only by more than one initial state.
+		 */
+		const State * idom ( const State & s ) const;
+
+		// Is every path from initial states to 'b' going through 'a'?
+		// False if one of them is not reachable.
+		bool dominates ( const State & a, const State & b ) const;
+
+	private:
+		struct Info
+		{
+			int          rpo;
+			unsigned int scc;
+			bool         cycle;
+			bool         loop_head;
+			// Dominator tree: parent ( -1 is virtual root ), numbering
+			int          idom;
+			unsigned int dom_in;
+			unsigned int dom_out;
+		};
+
+		std::unordered_map < const State *, unsigned int > _id;
+		States _states;
+		std::vector < Info > _info;
+
+		States _rpo;
+		std::vector < States > _sccs;
+		States _loop_heads;
+
+		const Info & info ( const State & s ) const;
+
+		void depth_first_search();
+		void tarjan();
+		void dominators();
+};
+
+} // namespace nts
+
+#endif // NTS_CFG_HPP_
@@ -0,0 +1,936 @@
+#include <cstdint>
+#include <stdexcept>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "evaluator.hpp"
+#include "codegen.hpp"
+
+using std::ostream;
+using std::ostringstream;
+using std::string;
+using std::vector;
+using std::pair;
+using std::unordered_map;
+using std::unordered_set;
+using std::domain_error;
+using std::to_string;
+
+namespace nts
+{
+
+namespace
+{
+
+// Sort of a term is its bitwidth, 0 means Int (as in CompiledFormula)
+unsigned int sort_of ( const ScalarType & t, unsigned int ctx )
+{
+	if ( t.is_bitvector() )
+	{
+		if ( t.bitwidth() > 64 )
+			throw domain_error ( "Bitvectors wider than 64 bits are not supported" );
+		return t.bitwidth();
+	}
+
+	if ( t == ScalarType::Integral() )
+		return ctx;
+
+	if ( t == ScalarType::Real() )
+		throw domain_error ( "Real numbers are not supported" );
+
+	return 0;
+}
+
+Value mask ( unsigned int width )
+{
+	return width == 0 || width >= 64 ? ~ Value ( 0 ) : ( Value ( 1 ) << width ) - 1;
+}
+
+unsigned int width_of ( const Variable & v )
+{
+	return sort_of ( v.type().scalar_type(), 0 );
+}
+
+string literal ( Value v )
+{
+	if ( v == INT64_MIN )
+		return "( -9223372036854775807LL - 1 )";
+	return to_string ( v ) + "LL";
+}
+
+string identifier ( const string & name )
+{
+	string id;
+	for ( char c : name )
+	{
+		const bool ok = ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) ||
+			( c >= '0' && c <= '9' ) || c == '_';
+		id += ok ? c : '_';
+	}
+
+	if ( id.empty() || ( id[0] >= '0' && id[0] <= '9' ) )
+		id = "_" + id;
+	return id;
+}
+
+const unordered_set < string > reserved
+{
+	"auto", "break", "case", "char", "const", "continue", "default", "do",
+	"double", "else", "enum", "extern", "float", "for", "goto", "if", "inline",
+	"int", "long", "register", "restrict", "return", "short", "signed", "sizeof",
+	"static", "struct", "switch", "typedef", "union", "unsigned", "void",
+	"volatile", "while", "control"
+};
+
+const char * const helpers =
+	"static inline int64_t nts_add ( int64_t a, int64_t b ) { return (int64_t) ( (uint64_t) a + (uint64_t) b ); }\n"
+	"static inline int64_t nts_sub ( int64_t a, int64_t b ) { return (int64_t) ( (uint64_t) a - (uint64_t) b ); }\n"
+	"static inline int64_t nts_mul ( int64_t a, int64_t b ) { return (int64_t) ( (uint64_t) a * (uint64_t) b ); }\n"
+	"static inline int64_t nts_neg ( int64_t a ) { return (int64_t) ( - (uint64_t) a ); }\n"
+	"\n"
+	"/* Euclidean division, division by zero sets *err */\n"
+	"static inline int64_t nts_div ( int64_t a, int64_t b, int * err )\n"
+	"{\n"
+	"\tint64_t q;\n"
+	"\tif ( b == 0 ) { *err = 1; return 0; }\n"
+	"\tif ( b == -1 ) return nts_neg ( a );\n"
+	"\tq = a / b;\n"
+	"\tif ( a % b < 0 ) q = b > 0 ? q - 1 : q + 1;\n"
+	"\treturn q;\n"
+	"}\n"
+	"\n"
+	"static inline int64_t nts_mod ( int64_t a, int64_t b, int * err )\n"
+	"{\n"
+	"\tint64_t r;\n"
+	"\tif ( b == 0 ) { *err = 1; return 0; }\n"
+	"\tif ( b == -1 ) return 0;\n"
+	"\tr = a % b;\n"
+	"\tif ( r < 0 ) r += b > 0 ? b : -b;\n"
+	"\treturn r;\n"
+	"}\n"
+	"\n"
+	"/* Bitvector division as in SMT-LIB */\n"
+	"static inline int64_t nts_udiv ( int64_t a, int64_t b )\n"
+	"{\n"
+	"\treturn b == 0 ? -1 : (int64_t) ( (uint64_t) a / (uint64_t) b );\n"
+	"}\n"
+	"\n"
+	"static inline int64_t nts_urem ( int64_t a, int64_t b )\n"
+	"{\n"
+	"\treturn b == 0 ? a : (int64_t) ( (uint64_t) a % (uint64_t) b );\n"
+	"}\n"
+	"\n"
+	"/* Out of bounds index sets *err */\n"
+	"static inline int64_t nts_index ( int64_t i, int64_t size, int * err )\n"
+	"{\n"
+	"\tif ( i < 0 || i >= size ) { *err = 1; return 0; }\n"
+	"\treturn i;\n"
+	"}\n"
+	"\n"
+	"static inline int nts_equal ( const int64_t * a, const int64_t * b, int64_t size )\n"
+	"{\n"
+	"\tint64_t i;\n"
+	"\tfor ( i = 0; i < size; i++ )\n"
+	"\t\tif ( a[i] != b[i] ) return 0;\n"
+	"\treturn 1;\n"
+	"}\n";
+
+/**
+ * @brief Translates formulas and terms into C expressions.
+ * Quantifiers and array writes become auxiliary functions,
+ * which are written to 'aux'.
+ */
+class CTranslator
+{
+	private:
+		const ValuationLayout & _layout;
+		const unordered_map < const Variable *, string > & _fields;
+		const string & _prefix;
+		ostream & _aux;
+
+		unsigned int _n_aux;
+		unsigned int _n_locals;
+
+		// Quantified variables in scope
+		vector < pair < const Variable *, string > > _scope;
+
+		struct Address
+		{
+			string base;
+			string offset;
+			// Remaining dimensions
+			vector < unsigned int > dims;
+		};
+
+		static string wrap ( const string & e, unsigned int width );
+
+		Address address ( const Term & t );
+		const string * local ( const Variable * v ) const;
+
+		string aux_function ( const string & body );
+
+		string array_equality ( const Relation & r );
+		string relation ( const Relation & r );
+		string havoc ( const Havoc & h );
+		string array_write ( const ArrayWrite & aw );
+		string quantified ( const QuantifiedFormula & qf );
+
+	public:
+		CTranslator ( const ValuationLayout & layout,
+				const unordered_map < const Variable *, string > & fields,
+				const string & prefix, ostream & aux ) :
+			_layout   ( layout ),
+			_fields   ( fields ),
+			_prefix   ( prefix ),
+			_aux      ( aux    ),
+			_n_aux    ( 0      ),
+			_n_locals ( 0      )
+		{
+			;
+		}
+
+		string term ( const Term & t, unsigned int ctx );
+		string formula ( const Formula & f );
+
+		// Value of a term, which is stored to a variable of given width
+		string assigned ( const Term & t, unsigned int width );
+};
+
+string CTranslator::wrap ( const string & e, unsigned int width )
+{
+	if ( width == 0 || width >= 64 )
+		return e;
+	return "( " + e + " & " + literal ( mask ( width ) ) + " )";
+}
+
+const string * CTranslator::local ( const Variable * v ) const
+{
+	// Inner binding shadows outer one
+	for ( auto it = _scope.rbegin(); it != _scope.rend(); ++it )
+	{
+		if ( it->first == v )
+			return &it->second;
+	}
+	return nullptr;
+}
+
+string CTranslator::aux_function ( const string & body )
+{
+	const string name = _prefix + "_aux" + to_string ( _n_aux++ );
+
+	// Parameters, which the body may not use, are marked as used
+	string params;
+	string args;
+	string unused = "\t(void) c;\n\t(void) n;\n";
+	for ( const auto & l : _scope )
+	{
+		params += ", int64_t " + l.second;
+		args += ", " + l.second;
+		unused += "\t(void) " + l.second + ";\n";
+	}
+
+	_aux << "static int " << name << " ( const " << _prefix << "_state * c, const "
+		<< _prefix << "_state * n, int * err" << params << " )\n{\n" << unused << body << "}\n\n";
+
+	return name + " ( c, n, err" + args + " )";
+}
+
+CTranslator::Address CTranslator::address ( const Term & t )
+{
+	if ( t.term_type() == Term::TermType::ArrayTerm )
+	{
+		auto & at = static_cast < const ArrayTerm & > ( t );
+		Address a = address ( at.array() );
+		for ( const Term * i : at.indices() )
+		{
+			if ( a.dims.empty() )
+				throw domain_error ( "Too many indices of an array" );
+
+			const string d = to_string ( a.dims.front() );
+			a.offset = "( " + a.offset + " * " + d + " + nts_index ( " +
+				term ( *i, 0 ) + ", " + d + ", err ) )";
+			a.dims.erase ( a.dims.begin() );
+		}
+		return a;
+	}
+
+	if ( t.term_type() == Term::TermType::Leaf &&
+			static_cast < const Leaf & > ( t ).leaf_type() == Leaf::LeafType::VariableReference )
+	{
+		auto & vr = static_cast < const VariableReference & > ( t );
+		const auto & e = _layout.entry ( *vr.variable() );
+		if ( e.dims.empty() )
+			throw domain_error ( "Variable " + vr.variable()->name + " is not an array" );
+
+		return Address { ( vr.primed() ? "n->" : "c->" ) + _fields.at ( vr.variable().get() ),
+			"0", e.dims };
+	}
+
+	throw domain_error ( "Unsupported array term" );
+}
+
+string CTranslator::term ( const Term & t, unsigned int ctx )
+{
+	const unsigned int own = t.type().is_scalar() ?
+		sort_of ( t.type().scalar_type(), ctx ) : 0;
+
+	string r;
+	switch ( t.term_type() )
+	{
+		case Term::TermType::ArithmeticOperation:
+		{
+			auto & aop = static_cast < const ArithmeticOperation & > ( t );
+			const string a = term ( aop.term1(), own );
+			const string b = term ( aop.term2(), own );
+
+			const bool bv = own > 0;
+			switch ( aop.operation() )
+			{
+				case ArithOp::Add: r = "nts_add ( " + a + ", " + b + " )"; break;
+				case ArithOp::Sub: r = "nts_sub ( " + a + ", " + b + " )"; break;
+				case ArithOp::Mul: r = "nts_mul ( " + a + ", " + b + " )"; break;
+				case ArithOp::Div:
+					r = bv ? "nts_udiv ( " + a + ", " + b + " )" :
+						"nts_div ( " + a + ", " + b + ", err )";
+					break;
+				case ArithOp::Mod:
+					r = bv ? "nts_urem ( " + a + ", " + b + " )" :
+						"nts_mod ( " + a + ", " + b + ", err )";
+					break;
+			}
+			r = wrap ( r, own );
+			break;
+		}
+
+		case Term::TermType::MinusTerm:
+			r = wrap ( "nts_neg ( " + term ( static_cast < const MinusTerm & > ( t ).term(), own ) + " )", own );
+			break;
+
+		case Term::TermType::ArrayTerm:
+		{
+			Address a = address ( t );
+			if ( !a.dims.empty() )
+				throw domain_error ( "Array is used as a scalar" );
+
+			r = a.base + "[ " + a.offset + " ]";
+			break;
+		}
+
+		case Term::TermType::Leaf:
+		{
+			auto & l = static_cast < const Leaf & > ( t );
+			switch ( l.leaf_type() )
+			{
+				case Leaf::LeafType::IntConstant:
+				{
+					Value v = static_cast < const IntConstant & > ( l ).value();
+					r = literal ( own > 0 ? v & mask ( own ) : v );
+					break;
+				}
+
+				case Leaf::LeafType::BoolConstant:
+					r = static_cast < const BoolConstant & > ( l ).value() ? "1" : "0";
+					break;
+
+				case Leaf::LeafType::UserConstant:
+				{
+					const string & s = static_cast < const UserConstant & > ( l ).value();
+					std::size_t pos = 0;
+					Value v;
+					try
+					{
+						v = std::stoll ( s, &pos );
+					}
+					catch ( const std::exception & )
+					{
+						pos = 0;
+					}
+
+					if ( pos == 0 || pos != s.size() )
+						throw domain_error ( "Constant '" + s + "' is not a number" );
+
+					r = literal ( own > 0 ? v & mask ( own ) : v );
+					break;
+				}
+
+				case Leaf::LeafType::ThreadID:
+					r = "0";
+					break;
+
+				case Leaf::LeafType::VariableReference:
+				{
+					auto & vr = static_cast < const VariableReference & > ( l );
+					const Variable * v = vr.variable().get();
+
+					if ( const string * name = local ( v ) )
+					{
+						r = *name;
+						break;
+					}
+
+					if ( !_layout.entry ( *v ).dims.empty() )
+						throw domain_error ( "Array " + v->name + " is used as a scalar" );
+
+					r = ( vr.primed() ? "n->" : "c->" ) + _fields.at ( v );
+					break;
+				}
+			}
+			break;
+		}
+	}
+
+	// Coercion to a narrower context
+	if ( ctx > 0 && ( own == 0 || own > ctx ) )
+		r = wrap ( r, ctx );
+
+	return r;
+}
+
+string CTranslator::assigned ( const Term & t, unsigned int width )
+{
+	const DataType & type = t.type();
+	const unsigned int sort = type.is_scalar() ? sort_of ( type.scalar_type(), 0 ) : 0;
+
+	// Values of the same sort are in range already
+	return sort == width ? term ( t, sort ) : wrap ( term ( t, sort ), width );
+}
+
+string CTranslator::array_equality ( const Relation & r )
+{
+	if ( r.operation() != RelationOp::eq && r.operation() != RelationOp::neq )
+		throw domain_error ( "Arrays can be compared only for equality" );
+
+	Address a1 = address ( r.term1() );
+	Address a2 = address ( r.term2() );
+	if ( a1.dims != a2.dims )
+		throw domain_error ( "Compared arrays have different sizes" );
+
+	unsigned int size = 1;
+	for ( unsigned int d : a1.dims )
+		size *= d;
+
+	const string s = to_string ( size );
+	const string eq = "nts_equal ( " + a1.base + " + " + a1.offset + " * " + s + ", " +
+		a2.base + " + " + a2.offset + " * " + s + ", " + s + " )";
+	return r.operation() == RelationOp::eq ? eq : "!" + eq;
+}
+
+string CTranslator::relation ( const Relation & r )
+{
+	if ( !r.type().is_scalar() )
+		return array_equality ( r );
+
+	const unsigned int s = sort_of ( r.type().scalar_type(), 0 );
+	string a = term ( r.term1(), s );
+	string b = term ( r.term2(), s );
+
+	const char * op = "==";
+	switch ( r.operation() )
+	{
+		case RelationOp::eq:  op = "=="; break;
+		case RelationOp::neq: op = "!="; break;
+		case RelationOp::lt:  op = "<";  break;
+		case RelationOp::leq: op = "<="; break;
+		case RelationOp::gt:  op = ">";  break;
+		case RelationOp::geq: op = ">="; break;
+	}
+
+	// Bitvectors are unsigned
+	if ( s > 0 && r.operation() != RelationOp::eq && r.operation() != RelationOp::neq )
+	{
+		a = "(uint64_t) " + a;
+		b = "(uint64_t) " + b;
+	}
+
+	return "( " + a + " " + op + " " + b + " )";
+}
+
+string CTranslator::havoc ( const Havoc & h )
+{
+	string r;
+	for ( const Variable * v : _layout.variables() )
+	{
+		if ( h.havocs ( *v ) )
+			continue;
+
+		const auto & e = _layout.entry ( *v );
+		const string & f = _fields.at ( v );
+		if ( !r.empty() )
+			r += " && ";
+
+		if ( e.dims.empty() )
+			r += "c->" + f + " == n->" + f;
+		else
+			r += "nts_equal ( c->" + f + ", n->" + f + ", " + to_string ( e.size ) + " )";
+	}
+
+	return r.empty() ? "1" : "( " + r + " )";
+}
+
+string CTranslator::array_write ( const ArrayWrite & aw )
+{
+	const auto & e = _layout.entry ( *aw.array() );
+	const unsigned int n1 = aw.indices_1().size();
+
+	if ( n1 + 1 != e.dims.size() )
+		throw domain_error ( "Only writes of scalar values to arrays are supported" );
+
+	const string & f = _fields.at ( aw.array() );
+	const string block = to_string ( e.dims.back() );
+	const unsigned int elem = sort_of ( aw.array()->type().scalar_type(), 0 );
+
+	ostringstream body;
+	body << "\tint64_t k, base = 0;\n";
+	for ( unsigned int i = 0; i < n1; i++ )
+	{
+		const string d = to_string ( e.dims[i] );
+		body << "\tbase = base * " << d << " + nts_index ( "
+			<< term ( *aw.indices_1()[i], 0 ) << ", " << d << ", err );\n";
+	}
+	body << "\tbase *= " << block << ";\n";
+
+	const auto & idx = aw.indices_2();
+	const auto & val = aw.values();
+	for ( unsigned int j = 0; j < idx.size(); j++ )
+	{
+		body << "\tconst int64_t i" << j << " = nts_index ( " << term ( *idx[j], 0 )
+			<< ", " << block << ", err );\n";
+		body << "\tconst int64_t v" << j << " = " << term ( *val[j], elem ) << ";\n";
+	}
+
+	body << "\tif ( *err ) return 0;\n"
+		<< "\tfor ( k = 0; k < " << e.size << "; k++ )\n"
+		<< "\t{\n"
+		<< "\t\tint64_t expected = c->" << f << "[k];\n";
+	// Later writes win
+	for ( unsigned int j = 0; j < idx.size(); j++ )
+		body << "\t\tif ( k == base + i" << j << " ) expected = v" << j << ";\n";
+	body << "\t\tif ( n->" << f << "[k] != expected ) return 0;\n"
+		<< "\t}\n"
+		<< "\treturn 1;\n";
+
+	return aux_function ( body.str() );
+}
+
+string CTranslator::quantified ( const QuantifiedFormula & qf )
+{
+	const QuantifiedType & qt = qf.list.qtype();
+	const bool forall = qf.list.quantifier == Quantifier::Forall;
+
+	const unsigned int width = qt.type().is_scalar() ?
+		sort_of ( qt.type().scalar_type(), 0 ) : 0;
+
+	const std::size_t depth = _scope.size();
+	ostringstream body;
+	string indent = "\t";
+
+	for ( const Variable * v : qf.list.variables() )
+	{
+		if ( !qt.from() && ( width == 0 || width > 16 ) )
+			throw domain_error ( "Unbounded quantification over " + v->name );
+
+		// Bounds are evaluated before the variable is in scope
+		const string q = "q" + to_string ( _n_locals++ );
+		const string from = qt.from() ? term ( *qt.from(), width ) : "0";
+		const string to = qt.to() ? term ( *qt.to(), width ) : literal ( mask ( width ) );
+
+		body << indent << "const int64_t " << q << "_from = " << from
+			<< ", " << q << "_to = " << to << ";\n"
+			<< indent << "int64_t " << q << ";\n"
+			<< indent << "for ( " << q << " = " << q << "_from; " << q << " <= " << q << "_to; "
+			<< q << "++ )\n"
+			<< indent << "{\n";
+
+		indent += "\t";
+		_scope.emplace_back ( v, q );
+	}
+
+	const string f = formula ( qf.formula() );
+	if ( forall )
+		body << indent << "if ( !" << f << " ) return 0;\n";
+	else
+		body << indent << "if ( " << f << " ) return 1;\n";
+
+	while ( _scope.size() > depth )
+	{
+		body << indent << "if ( " << _scope.back().second << " == "
+			<< _scope.back().second << "_to ) break;\n";
+		indent.pop_back();
+		body << indent << "}\n";
+		_scope.pop_back();
+	}
+
+	body << "\treturn " << ( forall ? 1 : 0 ) << ";\n";
+	return aux_function ( body.str() );
+}
+
+string CTranslator::formula ( const Formula & f )
+{
+	switch ( f.type() )
+	{
+		case Formula::Type::FormulaBop:
+		{
+			auto & fb = static_cast < const FormulaBop & > ( f );
+			const string a = formula ( fb.formula_1() );
+			const string b = formula ( fb.formula_2() );
+			switch ( fb.op() )
+			{
+				case BoolOp::And:   return "( " + a + " && " + b + " )";
+				case BoolOp::Or:    return "( " + a + " || " + b + " )";
+				case BoolOp::Imply: return "( !" + a + " || " + b + " )";
+				case BoolOp::Equiv: return "( !" + a + " == !" + b + " )";
+			}
+			break;
+		}
+
+		case Formula::Type::FormulaNot:
+			return "!" + formula ( static_cast < const FormulaNot & > ( f ).formula() );
+
+		case Formula::Type::QuantifiedFormula:
+			return quantified ( static_cast < const QuantifiedFormula & > ( f ) );
+
+		case Formula::Type::AtomicProposition:
+		{
+			auto & ap = static_cast < const AtomicProposition & > ( f );
+			switch ( ap.aptype() )
+			{
+				case AtomicProposition::APType::Havoc:
+					return havoc ( static_cast < const Havoc & > ( ap ) );
+
+				case AtomicProposition::APType::BooleanTerm:
+				{
+					const Term & t = static_cast < const BooleanTerm & > ( ap ).term();
+					return "( " + term ( t, t.type().is_scalar() ?
+							sort_of ( t.type().scalar_type(), 0 ) : 0 ) + " != 0 )";
+				}
+
+				case AtomicProposition::APType::Relation:
+					return relation ( static_cast < const Relation & > ( ap ) );
+
+				case AtomicProposition::APType::ArrayWrite:
+					return array_write ( static_cast < const ArrayWrite & > ( ap ) );
+			}
+			break;
+		}
+	}
+
+	throw domain_error ( "Unknown formula" );
+}
+
+string quoted ( const string & s )
+{
+	string r = "\"";
+	for ( char c : s )
+	{
+		if ( c == '"' || c == '\\' )
+			r += '\\';
+		r += c;
+	}
+	return r + "\"";
+}
+
+} // anonymous namespace
+
+//------------------------------------//
+// CGenerator                         //
+//------------------------------------//
+
+CGenerator::CGenerator ( ostream & o ) :
+	_o ( o )
+{
+	;
+}
+
+void CGenerator::generate ( const BasicNts & bn )
+{
+	const string P = identifier ( prefix.empty() ? bn.name : prefix );
+	const ValuationLayout layout ( bn );
+
+	// Fields of the state
+	unordered_map < const Variable *, string > fields;
+	unordered_set < string > used;
+	for ( const Variable * v : layout.variables() )
+	{
+		string f = identifier ( v->name );
+		if ( reserved.count ( f ) )
+			f += "_";
+
+		string unique = f;
+		for ( unsigned int k = 1; used.count ( unique ); k++ )
+			unique = f + "_" + to_string ( k );
+
+		used.insert ( unique );
+		fields.emplace ( v, unique );
+	}
+
+	vector < const State * > states ( bn.states().begin(), bn.states().end() );
+	unordered_map < const State *, unsigned int > ids;
+	vector < unsigned int > initial;
+	for ( unsigned int i = 0; i < states.size(); i++ )
+	{
+		ids.emplace ( states[i], i );
+		if ( states[i]->is_initial() )
+			initial.push_back ( i );
+	}
+
+	if ( initial.empty() )
+		throw domain_error ( "BasicNts " + bn.name + " has no initial state" );
+
+	vector < const Transition * > transitions ( bn.transitions().begin(), bn.transitions().end() );
+
+	// Widths of slots
+	vector < unsigned int > widths;
+	for ( const Variable * v : layout.variables() )
+		widths.resize ( widths.size() + layout.entry ( *v ).size, width_of ( *v ) );
+
+	// Transition functions are generated first,
+	// since they produce auxiliary functions.
+	ostringstream aux;
+	ostringstream functions;
+	CTranslator tr ( layout, fields, P, aux );
+
+	for ( unsigned int k = 0; k < transitions.size(); k++ )
+	{
+		const Transition & t = *transitions[k];
+		const TransitionPlan plan ( t, layout );
+		unordered_set < const Formula * > guards ( plan.guards.begin(), plan.guards.end() );
+
+		functions << "/* " << t.from().name << " -> " << t.to().name << " */\n"
+			<< "static int " << P << "_t" << k << " ( const " << P << "_state * c, "
+			<< P << "_state * n, " << P << "_nondet_t nondet, void * ctx )\n"
+			<< "{\n"
+			<< "\tint e = 0;\n"
+			<< "\tint * err = &e;\n"
+			<< "\t(void) err;\n"
+			<< "\t(void) nondet;\n"
+			<< "\t(void) ctx;\n";
+
+		for ( const Formula * g : plan.guards )
+			functions << "\tif ( !" << tr.formula ( *g ) << " || e ) return 0;\n";
+
+		functions << "\t*n = *c;\n"
+			<< "\tn->control = " << ids.at ( &t.to() ) << ";\n";
+
+		for ( const TransitionPlan::Step & s : plan.steps )
+		{
+			const auto & e = layout.entry ( *s.variable );
+			const string & f = fields.at ( s.variable );
+			const unsigned int width = width_of ( *s.variable );
+
+			switch ( s.kind )
+			{
+				case TransitionPlan::Step::Kind::Choice:
+					for ( unsigned int i = 0; i < e.size; i++ )
+					{
+						const string lhs = e.dims.empty() ? f : f + "[" + to_string ( i ) + "]";
+						string value = "(int64_t) nondet ( ctx, " + to_string ( e.offset + i ) + " )";
+						if ( width > 0 && width < 64 )
+							value = "( " + value + " & " + literal ( mask ( width ) ) + " )";
+						functions << "\tn->" << lhs << " = " << value << ";\n";
+					}
+					break;
+
+				case TransitionPlan::Step::Kind::Update:
+					functions << "\tn->" << f << " = " << tr.assigned ( *s.term, width ) << ";\n";
+					break;
+
+				case TransitionPlan::Step::Kind::ArrayWrite:
+				{
+					const ArrayWrite & aw = *s.write;
+					const string block = to_string ( e.dims.back() );
+					functions << "\t{\n\t\tint64_t base = 0;\n";
+					for ( unsigned int i = 0; i < aw.indices_1().size(); i++ )
+					{
+						const string d = to_string ( e.dims[i] );
+						functions << "\t\tbase = base * " << d << " + nts_index ( "
+							<< tr.term ( *aw.indices_1()[i], 0 ) << ", " << d << ", err );\n";
+					}
+					functions << "\t\tbase *= " << block << ";\n";
+					for ( unsigned int j = 0; j < aw.indices_2().size(); j++ )
+					{
+						functions << "\t\tn->" << f << "[ base + nts_index ( "
+							<< tr.assigned ( *aw.indices_2()[j], 0 ) << ", " << block << ", err ) ] = "
+							<< tr.assigned ( *aw.values()[j], width ) << ";\n";
+					}
+					functions << "\t}\n";
+					break;
+				}
+			}
+		}
+
+		// Guards were checked already, top-level havocs hold by construction
+		string check;
+		for ( const Formula * c : plan.conjuncts )
+		{
+			if ( guards.count ( c ) || ( c->type() == Formula::Type::AtomicProposition &&
+					static_cast < const AtomicProposition * > ( c )->aptype() ==
+					AtomicProposition::APType::Havoc ) )
+				continue;
+
+			check += ( check.empty() ? "" : "\n\t\t&& " ) + tr.formula ( *c );
+		}
+
+		functions << "\tif ( e ) return 0;\n";
+		if ( check.empty() )
+			functions << "\treturn 1;\n";
+		else
+			functions << "\treturn " << check << " && !e;\n";
+		functions << "}\n\n";
+	}
+
+	_o << "/* Generated from BasicNts " << bn.name << " */\n\n"
+		<< "#include <stdint.h>\n\n"
+		<< "#define " << P << "_N_STATES " << states.size() << "\n"
+		<< "#define " << P << "_N_TRANSITIONS " << transitions.size() << "\n"
+		<< "#define " << P << "_N_SLOTS " << widths.size() << "\n\n";
+
+	_o << "typedef struct\n{\n\tint control;\n";
+	for ( const Variable * v : layout.variables() )
+	{
+		const auto & e = layout.entry ( *v );
+		_o << "\tint64_t " << fields.at ( v );
+		if ( !e.dims.empty() )
+			_o << "[" << e.size << "]";
+		_o << "; /* " << v->name << " */\n";
+	}
+	_o << "} " << P << "_state;\n\n";
+
+	_o << "/* Nondeterministic value of given slot of the valuation,\n"
+		<< "   or of a choice (slot -1) reduced modulo the number of options */\n"
+		<< "typedef uint64_t ( * " << P << "_nondet_t ) ( void * ctx, int slot );\n\n";
+
+	auto table = [&] ( const char * type, const string & name, unsigned int n, auto element )
+	{
+		// Empty initializers are not allowed
+		_o << "const " << type << " " << P << "_" << name << "[] = {";
+		for ( unsigned int i = 0; i < n; i++ )
+			_o << ( i ? ", " : " " ) << element ( i );
+		_o << ( n ? " };\n" : " 0 };\n" );
+	};
+
+	table ( "char * const", "state_names", states.size(),
+			[&] ( unsigned int i ) { return quoted ( states[i]->name ); } );
+	table ( "unsigned char", "initial", states.size(),
+			[&] ( unsigned int i ) { return states[i]->is_initial() ? "1" : "0"; } );
+	table ( "unsigned char", "error", states.size(),
+			[&] ( unsigned int i ) { return states[i]->is_error() ? "1" : "0"; } );
+	table ( "char * const", "transition_names", transitions.size(),
+			[&] ( unsigned int i ) { return quoted ( transitions[i]->from().name + " -> " +
+					transitions[i]->to().name ); } );
+	table ( "unsigned char", "slot_width", widths.size(),
+			[&] ( unsigned int i ) { return to_string ( widths[i] ); } );
+
+	_o << "\n" << helpers << "\n" << aux.str() << functions.str();
+
+	// Initial state
+	_o << "void " << P << "_init ( " << P << "_state * s, " << P << "_nondet_t nondet, void * ctx )\n"
+		<< "{\n";
+	_o << "\tstatic const int initial[] = {";
+	for ( unsigned int i = 0; i < initial.size(); i++ )
+		_o << ( i ? ", " : " " ) << initial[i];
+	_o << " };\n"
+		<< "\ts->control = initial [ nondet ( ctx, -1 ) % " << initial.size() << " ];\n";
+	for ( const Variable * v : layout.variables() )
+	{
+		const auto & e = layout.entry ( *v );
+		const unsigned int width = width_of ( *v );
+		for ( unsigned int i = 0; i < e.size; i++ )
+		{
+			string value = "(int64_t) nondet ( ctx, " + to_string ( e.offset + i ) + " )";
+			if ( width > 0 && width < 64 )
+				value = "( " + value + " & " + literal ( mask ( width ) ) + " )";
+			_o << "\ts->" << fields.at ( v );
+			if ( !e.dims.empty() )
+				_o << "[" << i << "]";
+			_o << " = " << value << ";\n";
+		}
+	}
+	_o << "}\n\n";
+
+	// One step, successors are chosen uniformly by reservoir sampling
+	_o << "int " << P << "_step ( const " << P << "_state * c, " << P << "_state * n, "
+		<< P << "_nondet_t nondet, void * ctx )\n"
+		<< "{\n"
+		<< "\t" << P << "_state t;\n"
+		<< "\tuint64_t n_ok = 0;\n"
+		<< "\tint taken = -1;\n"
+		<< "\tswitch ( c->control )\n"
+		<< "\t{\n";
+	for ( unsigned int s = 0; s < states.size(); s++ )
+	{
+		_o << "\t\tcase " << s << ": /* " << states[s]->name << " */\n";
+		for ( unsigned int k = 0; k < transitions.size(); k++ )
+		{
+			if ( &transitions[k]->from() != states[s] )
+				continue;
+
+			_o << "\t\t\tif ( " << P << "_t" << k << " ( c, &t, nondet, ctx ) && "
+				<< "nondet ( ctx, -1 ) % ++n_ok == 0 )\n"
+				<< "\t\t\t{\n"
+				<< "\t\t\t\t*n = t;\n"
+				<< "\t\t\t\ttaken = " << k << ";\n"
+				<< "\t\t\t}\n";
+		}
+		_o << "\t\t\tbreak;\n";
+	}
+	_o << "\t}\n"
+		<< "\treturn taken;\n"
+		<< "}\n\n";
+
+	// Standalone driver
+	_o << "#ifdef " << P << "_MAIN\n"
+		<< "#include <stdio.h>\n"
+		<< "#include <stdlib.h>\n\n"
+		<< "static uint64_t " << P << "_random_state = 0x9e3779b97f4a7c15ULL;\n\n"
+		<< "/* xorshift64*, integers are taken from [-1024, 1024] */\n"
+		<< "static uint64_t " << P << "_random ( void * ctx, int slot )\n"
+		<< "{\n"
+		<< "\tuint64_t x = " << P << "_random_state;\n"
+		<< "\t(void) ctx;\n"
+		<< "\tx ^= x >> 12;\n"
+		<< "\tx ^= x << 25;\n"
+		<< "\tx ^= x >> 27;\n"
+		<< "\t" << P << "_random_state = x;\n"
+		<< "\tx *= 0x2545f4914f6cdd1dULL;\n"
+		<< "\tif ( slot >= 0 && " << P << "_slot_width[slot] == 0 )\n"
+		<< "\t\treturn (uint64_t) ( (int64_t) ( x % 2049 ) - 1024 );\n"
+		<< "\treturn x;\n"
+		<< "}\n\n"
+		<< "int main ( int argc, char ** argv )\n"
+		<< "{\n"
+		<< "\tconst unsigned long runs = argc > 1 ? strtoul ( argv[1], 0, 10 ) : 1000;\n"
+		<< "\tconst unsigned long steps = argc > 2 ? strtoul ( argv[2], 0, 10 ) : 100;\n"
+		<< "\tstatic unsigned long coverage [ " << P << "_N_TRANSITIONS + 1 ];\n"
+		<< "\tstatic unsigned long errors [ " << P << "_N_STATES ];\n"
+		<< "\tunsigned long r, k;\n"
+		<< "\tint i;\n"
+		<< "\t" << P << "_state s, t;\n\n"
+		<< "\tfor ( r = 0; r < runs; r++ )\n"
+		<< "\t{\n"
+		<< "\t\t" << P << "_init ( &s, " << P << "_random, 0 );\n"
+		<< "\t\tfor ( k = 0; k < steps && !" << P << "_error[s.control]; k++ )\n"
+		<< "\t\t{\n"
+		<< "\t\t\ti = " << P << "_step ( &s, &t, " << P << "_random, 0 );\n"
+		<< "\t\t\tif ( i < 0 )\n"
+		<< "\t\t\t\tbreak;\n"
+		<< "\t\t\tcoverage[i]++;\n"
+		<< "\t\t\ts = t;\n"
+		<< "\t\t}\n"
+		<< "\t\tif ( " << P << "_error[s.control] )\n"
+		<< "\t\t\terrors[s.control]++;\n"
+		<< "\t}\n\n"
+		<< "\tfor ( i = 0; i < " << P << "_N_TRANSITIONS; i++ )\n"
+		<< "\t\tprintf ( \"%s: %lu\\n\", " << P << "_transition_names[i], coverage[i] );\n"
+		<< "\tfor ( i = 0; i < " << P << "_N_STATES; i++ )\n"
+		<< "\t\tif ( errors[i] )\n"
+		<< "\t\t\tprintf ( \"error %s reached %lu times\\n\", " << P << "_state_names[i], errors[i] );\n"
+		<< "\treturn 0;\n"
+		<< "}\n"
+		<< "#endif\n";
+}
+
+} // namespace nts
@@ -0,0 +1,55 @@
+#ifndef NTS_CODEGEN_HPP_
+#define NTS_CODEGEN_HPP_
+#pragma once
+
+#include <ostream>
+#include <string>
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Translates a BasicNts into a standalone C source for simulation.
+ *
+ * The generated code (for prefix P) consists of
+ *  - struct P_state with the control state and one int64_t field
+ *    (or flat array) per variable visible from the BasicNts,
+ *  - P_init(), which picks an initial state and initial values,
+ *  - P_step(), which takes one random enabled transition by a switch
+ *    over the control state and returns its index (-1 on deadlock),
+ *  - tables P_state_names, P_initial, P_error and P_transition_names.
+ *
+ * Each transition becomes a function with straight-line code: guards,
+ * then free choices, updates x' = t and array writes in dependency order
+ * (see TransitionPlan), and finally the check of the remaining conjuncts.
+ * All nondeterminism (havocked values, initial values and choice among
+ * enabled transitions) comes from a hook of type P_nondet_t, which gets
+ * the slot of the value in the valuation (see ValuationLayout) or -1.
+ *
+ * Values are represented as in CompiledFormula. Out of bounds array
+ * accesses and division by zero make the transition fail. Thread id is 0.
+ * Compiling with -DP_MAIN adds main(), which runs random simulations
+ * and prints coverage of transitions and reached error states.
+ */
+class CGenerator
+{
+	private:
+		std::ostream & _o;
+
+	public:
+		explicit CGenerator ( std::ostream & o );
+		CGenerator ( const CGenerator & ) = delete;
+
+		// Prefix of all generated names. If empty, name of the BasicNts is used.
+		std::string prefix;
+
+		// Throws std::domain_error on constructs, which can not be translated
+		// (calls, reals, unbounded quantifiers, arrays of non-constant size)
+		void generate ( const BasicNts & bn );
+};
+
+} // namespace nts
+
+#endif // NTS_CODEGEN_HPP_
@@ -0,0 +1,508 @@
+#include <memory>
+#include <vector>
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdexcept>
+#include <utility>    // move()
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "conjuncts.hpp"
+#include "compose.hpp"
+
+using std::unique_ptr;
+using std::make_unique;
+using std::vector;
+using std::string;
+using std::unordered_map;
+using std::unordered_set;
+using std::domain_error;
+using std::move;
+
+namespace nts
+{
+
+namespace
+{
+
+using p_Term    = unique_ptr < Term    >;
+using p_Formula = unique_ptr < Formula >;
+
+// Definitions at most this large are copied to every use
+const unsigned int max_copied_size = 16;
+
+//------------------------------------//
+// Substitution                       //
+//------------------------------------//
+
+/**
+ * @brief Replaces references to free variables in place.
+ * Map gives the replacement of a (primed) reference, or null to keep it.
+ * Arrays inside array accesses and writes can not be replaced.
+ */
+class Substitution
+{
+	public:
+		using Map = std::function < p_Term ( Variable & v, bool primed ) >;
+
+	private:
+		Map _map;
+		// Quantified variables are never replaced
+		unordered_set < const Variable * > _bound;
+
+		p_Term replacement ( Variable & v, bool primed );
+		void keep_array ( Variable & v, bool primed );
+
+	public:
+		explicit Substitution ( Map map ) :
+			_map ( move ( map ) )
+		{
+			;
+		}
+
+		p_Term term ( p_Term t );
+
+		// Throws std::domain_error on havoc
+		void formula ( Formula & f );
+};
+
+p_Term Substitution::replacement ( Variable & v, bool primed )
+{
+	if ( _bound.count ( &v ) )
+		return nullptr;
+
+	return _map ( v, primed );
+}
+
+void Substitution::keep_array ( Variable & v, bool primed )
+{
+	if ( replacement ( v, primed ) )
+		throw domain_error ( "Array " + v.name + " can not be substituted" );
+}
+
+p_Term Substitution::term ( p_Term t )
+{
+	auto rec = [ this ] ( p_Term s ) { return term ( move ( s ) ); };
+
+	switch ( t->term_type() )
+	{
+		case Term::TermType::ArithmeticOperation:
+			static_cast < ArithmeticOperation & > ( *t ).transform_terms ( rec );
+			break;
+
+		case Term::TermType::MinusTerm:
+			static_cast < MinusTerm & > ( *t ).transform_term ( rec );
+			break;
+
+		case Term::TermType::ArrayTerm:
+		{
+			auto & at = static_cast < ArrayTerm & > ( *t );
+			at.transform_indices ( rec );
+
+			const Term & a = at.array();
+			if ( a.term_type() != Term::TermType::Leaf ||
+					static_cast < const Leaf & > ( a ).leaf_type() !=
+						Leaf::LeafType::VariableReference )
+				throw domain_error ( "Unsupported array term" );
+
+			auto & vr = static_cast < const VariableReference & > ( a );
+			keep_array ( *vr.variable().get(), vr.primed() );
+			break;
+		}
+
+		case Term::TermType::Leaf:
+		{
+			auto & l = static_cast < Leaf & > ( *t );
+			if ( l.leaf_type() != Leaf::LeafType::VariableReference )
+				break;
+
+			auto & vr = static_cast < VariableReference & > ( l );
+			p_Term r = replacement ( *vr.variable().get(), vr.primed() );
+			if ( r )
+				return r;
+			break;
+		}
+	}
+
+	return t;
+}
+
+void Substitution::formula ( Formula & f )
+{
+	auto rec = [ this ] ( p_Term t ) { return term ( move ( t ) ); };
+
+	switch ( f.type() )
+	{
+		case Formula::Type::FormulaBop:
+		{
+			auto & fb = static_cast < FormulaBop & > ( f );
+			formula ( fb.formula_1() );
+			formula ( fb.formula_2() );
+			return;
+		}
+
+		case Formula::Type::FormulaNot:
+			formula ( static_cast < FormulaNot & > ( f ).formula() );
+			return;
+
+		case Formula::Type::QuantifiedFormula:
+		{
+			auto & qf = static_cast < QuantifiedFormula & > ( f );
+			for ( const Variable * v : qf.list.variables() )
+				_bound.insert ( v );
+
+			qf.list.qtype().transform_bounds ( rec );
+			formula ( qf.formula() );
+			return;
+		}
+
+		case Formula::Type::AtomicProposition:
+			break;
+	}
+
+	auto & ap = static_cast < AtomicProposition & > ( f );
+	switch ( ap.aptype() )
+	{
+		case AtomicProposition::APType::Relation:
+			static_cast < Relation & > ( ap ).transform_terms ( rec );
+			break;
+
+		case AtomicProposition::APType::BooleanTerm:
+			static_cast < BooleanTerm & > ( ap ).transform_term ( rec );
+			break;
+
+		case AtomicProposition::APType::ArrayWrite:
+		{
+			auto & aw = static_cast < ArrayWrite & > ( ap );
+			aw.transform_terms ( rec );
+
+			// a'[i] = v refers to both a and a'
+			keep_array ( *aw.array(), true );
+			keep_array ( *aw.array(), false );
+			break;
+		}
+
+		case AtomicProposition::APType::Havoc:
+			throw domain_error ( "Havoc is supported only as a top-level conjunct" );
+	}
+}
+
+//------------------------------------//
+// Composition helpers                //
+//------------------------------------//
+
+bool is_havoc ( const Formula & f )
+{
+	return f.type() == Formula::Type::AtomicProposition &&
+		static_cast < const AtomicProposition & > ( f ).aptype() ==
+			AtomicProposition::APType::Havoc;
+}
+
+const VariableReference * variable_reference ( const Term & t )
+{
+	if ( t.term_type() != Term::TermType::Leaf ||
+			static_cast < const Leaf & > ( t ).leaf_type() !=
+				Leaf::LeafType::VariableReference )
+		return nullptr;
+
+	return & static_cast < const VariableReference & > ( t );
+}
+
+// Variables which may be changed by a transition
+struct Frame
+{
+	// Intersection of all havocs, in order of the first one;
+	// null if there is no havoc
+	unique_ptr < Havoc > havoc;
+
+	bool all() const { return !havoc; }
+
+	bool contains ( const Variable * v ) const
+	{
+		return !havoc || havoc->havocs ( *v );
+	}
+};
+
+// Removes havocs from the conjuncts
+Frame extract_frame ( vector < p_Formula > & parts )
+{
+	Frame frame;
+	vector < p_Formula > rest;
+
+	for ( p_Formula & g : parts )
+	{
+		if ( !is_havoc ( *g ) )
+		{
+			rest.push_back ( move ( g ) );
+			continue;
+		}
+
+		if ( frame.havoc )
+		{
+			frame.havoc->restrict_to ( static_cast < const Havoc & > ( *g ).variable_set() );
+			continue;
+		}
+
+		// Drops duplicates
+		frame.havoc.reset ( static_cast < Havoc * > ( g.release() ) );
+		const VariableSet all = frame.havoc->variable_set();
+		frame.havoc->restrict_to ( all );
+	}
+
+	parts = move ( rest );
+	return frame;
+}
+
+/**
+ * Is the formula x' = t, where t has no primed variables
+ * and is of the same type as the scalar x?
+ * @return side of t (1 or 2), or 0 if not
+ */
+unsigned int definition ( const Formula & f, Variable * & v )
+{
+	if ( f.type() != Formula::Type::AtomicProposition ||
+			static_cast < const AtomicProposition & > ( f ).aptype() !=
+				AtomicProposition::APType::Relation )
+		return 0;
+
+	auto & r = static_cast < const Relation & > ( f );
+	if ( r.operation() != RelationOp::eq || !r.type().is_scalar() )
+		return 0;
+
+	const Term * sides[2] = { &r.term1(), &r.term2() };
+	for ( unsigned int i = 0; i < 2; i++ )
+	{
+		const VariableReference * vr = variable_reference ( *sides[i] );
+		const Term & t = *sides[1 - i];
+		if ( !vr || !vr->primed() || refers_next ( t ) )
+			continue;
+
+		Variable * x = vr->variable().get();
+		const DataType & xt = x->type();
+		if ( !xt.is_scalar() )
+			continue;
+
+		// Integral constants would take the sort of the context
+		const bool integral = t.type().is_scalar() &&
+			t.type().scalar_type() == ScalarType::Integral();
+		if ( t.type() != xt && !( integral && !xt.scalar_type().is_bitvector() ) )
+			continue;
+
+		v = x;
+		return 2 - i;
+	}
+
+	return 0;
+}
+
+// Has the term at most 'limit' nodes?
+bool small ( const Term & t, unsigned int & limit )
+{
+	if ( limit == 0 )
+		return false;
+	limit--;
+
+	switch ( t.term_type() )
+	{
+		case Term::TermType::ArithmeticOperation:
+		{
+			auto & aop = static_cast < const ArithmeticOperation & > ( t );
+			return small ( aop.term1(), limit ) && small ( aop.term2(), limit );
+		}
+
+		case Term::TermType::MinusTerm:
+			return small ( static_cast < const MinusTerm & > ( t ).term(), limit );
+
+		case Term::TermType::ArrayTerm:
+		{
+			auto & at = static_cast < const ArrayTerm & > ( t );
+			if ( !small ( at.array(), limit ) )
+				return false;
+
+			for ( const Term * i : at.indices() )
+			{
+				if ( !small ( *i, limit ) )
+					return false;
+			}
+			return true;
+		}
+
+		case Term::TermType::Leaf:
+			return true;
+	}
+
+	return true;
+}
+
+} // anonymous namespace
+
+//------------------------------------//
+// Composition                        //
+//------------------------------------//
+
+unique_ptr < Formula > compose ( unique_ptr < Formula > f1, unique_ptr < Formula > f2,
+		const string & suffix )
+{
+	vector < p_Formula > parts1;
+	vector < p_Formula > parts2;
+	split ( move ( f1 ), parts1 );
+	split ( move ( f2 ), parts2 );
+
+	const Frame c1 = extract_frame ( parts1 );
+	const Frame c2 = extract_frame ( parts2 );
+
+	unordered_map < const Variable *, p_Term > defined;
+	vector < p_Formula > rest1;
+	for ( p_Formula & g : parts1 )
+	{
+		Variable * v = nullptr;
+		const unsigned int side = definition ( *g, v );
+		if ( side > 0 && c1.contains ( v ) && c2.contains ( v ) && !defined.count ( v ) )
+		{
+			auto & r = static_cast < Relation & > ( *g );
+			defined.emplace ( v, side == 1 ? r.release_term1() : r.release_term2() );
+			continue;
+		}
+		rest1.push_back ( move ( g ) );
+	}
+
+	// The first pass over the formulas only counts uses of definitions
+	bool counting = true;
+	unordered_map < const Variable *, unsigned int > uses;
+	unordered_set < const Variable * > copied;
+
+	vector < unique_ptr < Variable > > fresh;
+	unordered_map < const Variable *, Variable * > fresh_of;
+	vector < p_Formula > equations;
+	bool uses_fresh = false;
+
+	auto ref = [] ( Variable & v, bool primed ) -> p_Term
+	{
+		return make_unique < VariableReference > ( v, primed );
+	};
+
+	// Value of v between the transitions
+	auto mid = [&] ( Variable & v ) -> p_Term
+	{
+		if ( counting )
+		{
+			if ( defined.count ( &v ) )
+				uses [ &v ]++;
+			return nullptr;
+		}
+
+		if ( !c1.contains ( &v ) )
+			return ref ( v, false );
+
+		if ( !c2.contains ( &v ) )
+			return ref ( v, true );
+
+		auto d = defined.find ( &v );
+		if ( copied.count ( &v ) )
+			return p_Term ( d->second->clone() );
+
+		Variable * & e = fresh_of [ &v ];
+		if ( !e )
+		{
+			if ( !v.type().is_scalar() )
+				throw domain_error ( "Array " + v.name + " is changed by both transitions" );
+
+			fresh.emplace_back ( new Variable ( v.type(), v.name + suffix ) );
+			e = fresh.back().get();
+
+			if ( d != defined.end() )
+			{
+				equations.push_back ( make_unique < Relation > ( RelationOp::eq,
+							ref ( *e, false ), move ( d->second ) ) );
+			}
+		}
+
+		uses_fresh = true;
+		return ref ( *e, false );
+	};
+
+	// First transition: v' is the intermediate value
+	Substitution first ( [&] ( Variable & v, bool primed ) -> p_Term
+	{
+		if ( !primed || ( c1.contains ( &v ) && !c2.contains ( &v ) ) )
+			return nullptr;
+		return mid ( v );
+	} );
+
+	// Second transition: v is the intermediate value,
+	// v' is v if neither transition changes v
+	Substitution second ( [&] ( Variable & v, bool primed ) -> p_Term
+	{
+		if ( !primed )
+			return c1.contains ( &v ) ? mid ( v ) : nullptr;
+		if ( counting || c1.contains ( &v ) || c2.contains ( &v ) )
+			return nullptr;
+		return ref ( v, false );
+	} );
+
+	for ( const p_Formula & g : rest1 )
+		first.formula ( *g );
+	for ( const p_Formula & g : parts2 )
+		second.formula ( *g );
+
+	counting = false;
+	for ( const auto & d : defined )
+	{
+		unsigned int limit = max_copied_size;
+		if ( uses [ d.first ] <= 1 || small ( *d.second, limit ) )
+			copied.insert ( d.first );
+	}
+
+	// Conjuncts with fresh variables go below the quantifiers
+	vector < p_Formula > outer;
+	vector < p_Formula > inner;
+	auto place = [&] ( p_Formula g, Substitution & s )
+	{
+		uses_fresh = false;
+		s.formula ( *g );
+		( uses_fresh ? inner : outer ).push_back ( move ( g ) );
+	};
+
+	for ( p_Formula & g : rest1 )
+		place ( move ( g ), first );
+	for ( p_Formula & g : parts2 )
+		place ( move ( g ), second );
+
+	for ( p_Formula & g : equations )
+		inner.push_back ( move ( g ) );
+
+	if ( !inner.empty() )
+	{
+		p_Formula body = conjunction ( move ( inner ) );
+		for ( auto it = fresh.rbegin(); it != fresh.rend(); ++it )
+		{
+			auto qf = make_unique < QuantifiedFormula > ( Quantifier::Exists,
+					QuantifiedType ( ( *it )->type() ), move ( body ) );
+			it->release()->insert_to ( qf->list );
+			body = move ( qf );
+		}
+		outer.push_back ( move ( body ) );
+	}
+
+	if ( !c1.all() && !c2.all() )
+	{
+		auto h = unique_ptr < Havoc > ( c1.havoc->clone() );
+		h->unite ( *c2.havoc );
+		outer.push_back ( move ( h ) );
+	}
+
+	return conjunction ( move ( outer ) );
+}
+
+unique_ptr < FormulaTransitionRule > compose ( const FormulaTransitionRule & r1,
+		const FormulaTransitionRule & r2, const string & suffix )
+{
+	p_Formula f = compose ( p_Formula ( r1.formula().clone() ),
+			p_Formula ( r2.formula().clone() ), suffix );
+
+	return make_unique < FormulaTransitionRule > ( move ( f ) );
+}
+
+} // namespace nts
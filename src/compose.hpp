@@ -0,0 +1,49 @@
+#ifndef NTS_COMPOSE_HPP_
+#define NTS_COMPOSE_HPP_
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Sequential composition ( f1 ; f2 ) of two formula transitions
+ * over the same variables.
+ *
+ * Havoc semantics is respected: if a transition has havocs, variables
+ * outside (intersection of) them keep their values. The composition havocs
+ * the union of both sets (there is no havoc, if one of the transitions
+ * has none). The value of a variable v between the transitions is
+ *  - v,  if the first transition does not change v,
+ *  - v', if the second transition does not change v,
+ *  - t,  if the first transition has a top-level conjunct v' = t,
+ *        where t has no primed variables and is of the type of v,
+ *  - a fresh existentially quantified variable <v><suffix> otherwise.
+ * Conjuncts without fresh variables are kept outside of the quantifiers.
+ *
+ * A definition t is copied to each use, unless it is large and used
+ * more than once; then a fresh variable equal to t is used instead.
+ * Hence the composition runs in time linear in the sizes of the formulas.
+ *
+ * Throws std::domain_error, if an array is changed by both transitions
+ * (or has to be replaced inside of an array access or write),
+ * or if a havoc is not a top-level conjunct.
+ */
+std::unique_ptr < Formula > compose (
+		std::unique_ptr < Formula > f1,
+		std::unique_ptr < Formula > f2,
+		const std::string & suffix = "_mid" );
+
+// Composes clones of the formulas, see above
+std::unique_ptr < FormulaTransitionRule > compose (
+		const FormulaTransitionRule & r1,
+		const FormulaTransitionRule & r2,
+		const std::string & suffix = "_mid" );
+
+} // namespace nts
+
+#endif // NTS_COMPOSE_HPP_
@@ -0,0 +1,231 @@
+#include <memory>
+#include <vector>
+#include <unordered_set>
+#include <utility>    // move()
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "conjuncts.hpp"
+
+using std::unique_ptr;
+using std::make_unique;
+using std::vector;
+using std::unordered_set;
+using std::move;
+
+namespace nts
+{
+
+using p_Formula = unique_ptr < Formula >;
+
+bool is_and ( const Formula & f )
+{
+	return f.type() == Formula::Type::FormulaBop &&
+		static_cast < const FormulaBop & > ( f ).op() == BoolOp::And;
+}
+
+const AtomicProposition * atomic ( const Formula & f, AtomicProposition::APType t )
+{
+	if ( f.type() != Formula::Type::AtomicProposition ||
+			static_cast < const AtomicProposition & > ( f ).aptype() != t )
+		return nullptr;
+
+	return & static_cast < const AtomicProposition & > ( f );
+}
+
+void conjuncts ( Formula & f, vector < Formula * > & out )
+{
+	if ( is_and ( f ) )
+	{
+		auto & fb = static_cast < FormulaBop & > ( f );
+		conjuncts ( fb.formula_1(), out );
+		conjuncts ( fb.formula_2(), out );
+		return;
+	}
+
+	out.push_back ( &f );
+}
+
+void conjuncts ( const Formula & f, vector < const Formula * > & out )
+{
+	if ( is_and ( f ) )
+	{
+		auto & fb = static_cast < const FormulaBop & > ( f );
+		conjuncts ( fb.formula_1(), out );
+		conjuncts ( fb.formula_2(), out );
+		return;
+	}
+
+	out.push_back ( &f );
+}
+
+void split ( p_Formula f, vector < p_Formula > & out )
+{
+	if ( is_and ( *f ) )
+	{
+		auto & fb = static_cast < FormulaBop & > ( *f );
+		split ( fb.release_formula_1(), out );
+		split ( fb.release_formula_2(), out );
+		return;
+	}
+
+	out.push_back ( move ( f ) );
+}
+
+p_Formula truth ( bool value )
+{
+	return make_unique < BooleanTerm > ( make_unique < BoolConstant > ( value ) );
+}
+
+p_Formula conjunction ( vector < p_Formula > parts )
+{
+	if ( parts.empty() )
+		return truth ( true );
+
+	p_Formula result = move ( parts[0] );
+	for ( unsigned int i = 1; i < parts.size(); i++ )
+		result = make_unique < FormulaBop > ( BoolOp::And, move ( result ), move ( parts[i] ) );
+
+	return result;
+}
+
+bool refers_next ( const Term & t )
+{
+	switch ( t.term_type() )
+	{
+		case Term::TermType::ArithmeticOperation:
+		{
+			auto & aop = static_cast < const ArithmeticOperation & > ( t );
+			return refers_next ( aop.term1() ) || refers_next ( aop.term2() );
+		}
+
+		case Term::TermType::MinusTerm:
+			return refers_next ( static_cast < const MinusTerm & > ( t ).term() );
+
+		case Term::TermType::ArrayTerm:
+		{
+			auto & at = static_cast < const ArrayTerm & > ( t );
+			if ( refers_next ( at.array() ) )
+				return true;
+
+			for ( const Term * i : at.indices() )
+			{
+				if ( refers_next ( *i ) )
+					return true;
+			}
+			return false;
+		}
+
+		case Term::TermType::Leaf:
+			if ( static_cast < const Leaf & > ( t ).leaf_type() != Leaf::LeafType::VariableReference )
+				return false;
+			return static_cast < const VariableReference & > ( t ).primed();
+	}
+
+	return false;
+}
+
+bool refers_next ( const Formula & f )
+{
+	switch ( f.type() )
+	{
+		case Formula::Type::FormulaBop:
+		{
+			auto & fb = static_cast < const FormulaBop & > ( f );
+			return refers_next ( fb.formula_1() ) || refers_next ( fb.formula_2() );
+		}
+
+		case Formula::Type::FormulaNot:
+			return refers_next ( static_cast < const FormulaNot & > ( f ).formula() );
+
+		case Formula::Type::QuantifiedFormula:
+		{
+			auto & qf = static_cast < const QuantifiedFormula & > ( f );
+			const QuantifiedType & qt = qf.list.qtype();
+			return ( qt.from() && refers_next ( *qt.from() ) ) ||
+				( qt.to() && refers_next ( *qt.to() ) ) ||
+				refers_next ( qf.formula() );
+		}
+
+		case Formula::Type::AtomicProposition:
+			break;
+	}
+
+	auto & ap = static_cast < const AtomicProposition & > ( f );
+	switch ( ap.aptype() )
+	{
+		case AtomicProposition::APType::Relation:
+		{
+			auto & r = static_cast < const Relation & > ( ap );
+			return refers_next ( r.term1() ) || refers_next ( r.term2() );
+		}
+
+		case AtomicProposition::APType::BooleanTerm:
+			return refers_next ( static_cast < const BooleanTerm & > ( ap ).term() );
+
+		case AtomicProposition::APType::ArrayWrite:
+		{
+			auto & aw = static_cast < const ArrayWrite & > ( ap );
+			for ( const auto * terms : { &aw.indices_1(), &aw.indices_2(), &aw.values() } )
+			{
+				for ( const Term * t : *terms )
+				{
+					if ( refers_next ( *t ) )
+						return true;
+				}
+			}
+			return false;
+		}
+
+		case AtomicProposition::APType::Havoc:
+			break;
+	}
+
+	return false;
+}
+
+Variable * defined_variable ( Formula & f )
+{
+	if ( atomic ( f, AtomicProposition::APType::ArrayWrite ) )
+	{
+		auto & aw = static_cast < ArrayWrite & > ( f );
+		return refers_next ( aw ) ? nullptr : aw.array();
+	}
+
+	if ( !atomic ( f, AtomicProposition::APType::Relation ) )
+		return nullptr;
+
+	auto & r = static_cast < Relation & > ( f );
+	if ( r.operation() != RelationOp::eq )
+		return nullptr;
+
+	Term * sides[] = { &r.term1(), &r.term2() };
+	for ( unsigned int i = 0; i < 2; i++ )
+	{
+		Term & t = *sides[i];
+		if ( t.term_type() != Term::TermType::Leaf ||
+				static_cast < Leaf & > ( t ).leaf_type() != Leaf::LeafType::VariableReference )
+			continue;
+
+		auto & vr = static_cast < VariableReference & > ( t );
+		if ( vr.primed() && !refers_next ( *sides[1 - i] ) )
+			return vr.variable().get();
+	}
+
+	return nullptr;
+}
+
+vector < Variable * > definitions ( const vector < Formula * > & conjuncts )
+{
+	vector < Variable * > result;
+	unordered_set < const Variable * > defined;
+	for ( Formula * f : conjuncts )
+	{
+		Variable * v = defined_variable ( *f );
+		result.push_back ( v && defined.insert ( v ).second ? v : nullptr );
+	}
+
+	return result;
+}
+
+} // namespace nts
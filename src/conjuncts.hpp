@@ -0,0 +1,55 @@
+#ifndef NTS_CONJUNCTS_HPP_
+#define NTS_CONJUNCTS_HPP_
+#pragma once
+
+// Helpers shared by passes, which work with top-level conjuncts
+// of transition formulas. Not installed.
+
+#include <memory>
+#include <vector>
+
+#include "nts.hpp"
+#include "logic.hpp"
+
+namespace nts
+{
+
+bool is_and ( const Formula & f );
+
+// The formula as an atomic proposition of type t, or nullptr
+const AtomicProposition * atomic ( const Formula & f, AtomicProposition::APType t );
+
+// Flattens top-level conjunction
+void conjuncts ( Formula & f, std::vector < Formula * > & out );
+void conjuncts ( const Formula & f, std::vector < const Formula * > & out );
+
+// Owning version of conjuncts()
+void split ( std::unique_ptr < Formula > f, std::vector < std::unique_ptr < Formula > > & out );
+
+// Formula true or false
+std::unique_ptr < Formula > truth ( bool value );
+
+// Left-nested conjunction, true if there are no parts
+std::unique_ptr < Formula > conjunction ( std::vector < std::unique_ptr < Formula > > parts );
+
+// Is a next value referenced in the term (or in terms of the formula)?
+bool refers_next ( const Term & t );
+bool refers_next ( const Formula & f );
+
+/**
+ * @brief Variable v of a definition 'v' = t' or 'a'[i] = t',
+ * where t (and i) refer to current values only; nullptr otherwise.
+ */
+Variable * defined_variable ( Formula & f );
+
+/**
+ * @brief Variables defined by the conjuncts of one transition
+ * (nullptr for conjuncts, which are no definitions). Only the first
+ * definition of a variable counts, further ones constrain it
+ * and are guards.
+ */
+std::vector < Variable * > definitions ( const std::vector < Formula * > & conjuncts );
+
+} // namespace nts
+
+#endif // NTS_CONJUNCTS_HPP_
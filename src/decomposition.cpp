@@ -0,0 +1,265 @@
+#include <vector>
+#include <unordered_map>
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "conjuncts.hpp"
+#include "decomposition.hpp"
+
+using std::vector;
+
+namespace nts
+{
+
+namespace
+{
+
+bool is_ap ( const Formula & f, AtomicProposition::APType t )
+{
+	return f.type() == Formula::Type::AtomicProposition &&
+		static_cast < const AtomicProposition & > ( f ).aptype() == t;
+}
+
+// Variables of quantifiers inside the formula
+void bound_variables ( const Formula & f, VariableSet & out )
+{
+	switch ( f.type() )
+	{
+		case Formula::Type::FormulaBop:
+		{
+			auto & fb = static_cast < const FormulaBop & > ( f );
+			bound_variables ( fb.formula_1(), out );
+			bound_variables ( fb.formula_2(), out );
+			break;
+		}
+
+		case Formula::Type::FormulaNot:
+			bound_variables ( static_cast < const FormulaNot & > ( f ).formula(), out );
+			break;
+
+		case Formula::Type::QuantifiedFormula:
+		{
+			auto & qf = static_cast < const QuantifiedFormula & > ( f );
+			for ( const Variable * v : qf.list.variables() )
+				out.insert ( *v );
+			bound_variables ( qf.formula(), out );
+			break;
+		}
+
+		case Formula::Type::AtomicProposition:
+			break;
+	}
+}
+
+const Variable * primed_variable ( const Term & t )
+{
+	if ( t.term_type() != Term::TermType::Leaf ||
+			static_cast < const Leaf & > ( t ).leaf_type() !=
+				Leaf::LeafType::VariableReference )
+		return nullptr;
+
+	auto & vr = static_cast < const VariableReference & > ( t );
+	return vr.primed() ? vr.variable().get() : nullptr;
+}
+
+// Variables referenced in current / next state, except for bound ones
+struct References
+{
+	const VariableSet & bound;
+	VariableSet curr;
+	VariableSet next;
+
+	explicit References ( const VariableSet & b ) : bound ( b ) { ; }
+
+	void add ( const Term & t );
+	void add ( const Formula & f );
+};
+
+void References::add ( const Term & t )
+{
+	switch ( t.term_type() )
+	{
+		case Term::TermType::ArithmeticOperation:
+		{
+			auto & aop = static_cast < const ArithmeticOperation & > ( t );
+			add ( aop.term1() );
+			add ( aop.term2() );
+			break;
+		}
+
+		case Term::TermType::MinusTerm:
+			add ( static_cast < const MinusTerm & > ( t ).term() );
+			break;
+
+		case Term::TermType::ArrayTerm:
+		{
+			auto & at = static_cast < const ArrayTerm & > ( t );
+			add ( at.array() );
+			for ( const Term * i : at.indices() )
+				add ( *i );
+			break;
+		}
+
+		case Term::TermType::Leaf:
+		{
+			auto & l = static_cast < const Leaf & > ( t );
+			if ( l.leaf_type() != Leaf::LeafType::VariableReference )
+				break;
+
+			auto & vr = static_cast < const VariableReference & > ( l );
+			const Variable & v = *vr.variable();
+			if ( !bound.contains ( v ) )
+				( vr.primed() ? next : curr ).insert ( v );
+			break;
+		}
+	}
+}
+
+void References::add ( const Formula & f )
+{
+	switch ( f.type() )
+	{
+		case Formula::Type::FormulaBop:
+		{
+			auto & fb = static_cast < const FormulaBop & > ( f );
+			add ( fb.formula_1() );
+			add ( fb.formula_2() );
+			break;
+		}
+
+		case Formula::Type::FormulaNot:
+			add ( static_cast < const FormulaNot & > ( f ).formula() );
+			break;
+
+		case Formula::Type::QuantifiedFormula:
+		{
+			auto & qf = static_cast < const QuantifiedFormula & > ( f );
+			for ( const Term * b : { qf.list.qtype().from(), qf.list.qtype().to() } )
+			{
+				if ( b )
+					add ( *b );
+			}
+			add ( qf.formula() );
+			break;
+		}
+
+		case Formula::Type::AtomicProposition:
+		{
+			auto & ap = static_cast < const AtomicProposition & > ( f );
+			switch ( ap.aptype() )
+			{
+				case AtomicProposition::APType::Relation:
+				{
+					auto & r = static_cast < const Relation & > ( ap );
+					add ( r.term1() );
+					add ( r.term2() );
+					break;
+				}
+
+				case AtomicProposition::APType::BooleanTerm:
+					add ( static_cast < const BooleanTerm & > ( ap ).term() );
+					break;
+
+				case AtomicProposition::APType::ArrayWrite:
+				{
+					auto & aw = static_cast < const ArrayWrite & > ( ap );
+					next.insert ( *aw.array() );
+					for ( const auto * terms : { &aw.indices_1(), &aw.indices_2(), &aw.values() } )
+					{
+						for ( const Term * i : *terms )
+							add ( *i );
+					}
+					break;
+				}
+
+				// Frame, not a reference
+				case AtomicProposition::APType::Havoc:
+					break;
+			}
+			break;
+		}
+	}
+}
+
+} // anonymous namespace
+
+//------------------------------------//
+// RuleDecomposition                  //
+//------------------------------------//
+
+RuleDecomposition::RuleDecomposition ( const FormulaTransitionRule & rule ) :
+	_framed ( false )
+{
+	vector < const Formula * > parts;
+	conjuncts ( rule.formula(), parts );
+
+	// Frame
+	for ( const Formula * c : parts )
+	{
+		if ( !is_ap ( *c, AtomicProposition::APType::Havoc ) )
+			continue;
+
+		const VariableSet & h = static_cast < const Havoc * > ( c )->variable_set();
+		if ( _framed )
+			_havocked &= h;
+		else
+			_havocked = h;
+		_framed = true;
+	}
+
+	VariableSet bound;
+	bound_variables ( rule.formula(), bound );
+
+	for ( const Formula * c : parts )
+	{
+		if ( is_ap ( *c, AtomicProposition::APType::Havoc ) )
+			continue;
+
+		References refs ( bound );
+		refs.add ( *c );
+		_reads  |= refs.curr;
+		_writes |= refs.next;
+
+		if ( refs.next.empty() )
+			_guards.push_back ( c );
+		else if ( !add_update ( *c, bound ) )
+			_others.push_back ( c );
+	}
+}
+
+bool RuleDecomposition::add_update ( const Formula & c, const VariableSet & bound )
+{
+	if ( !is_ap ( c, AtomicProposition::APType::Relation ) )
+		return false;
+
+	auto & r = static_cast < const Relation & > ( c );
+	if ( r.operation() != RelationOp::eq )
+		return false;
+
+	for ( unsigned int side = 0; side < 2; side++ )
+	{
+		const Variable * v = primed_variable ( side == 0 ? r.term1() : r.term2() );
+		const Term & rhs = side == 0 ? r.term2() : r.term1();
+		if ( !v || !changes ( *v ) || _update_of.count ( v ) )
+			continue;
+
+		References refs ( bound );
+		refs.add ( rhs );
+		if ( !refs.next.empty() )
+			continue;
+
+		_update_of.emplace ( v, _updates.size() );
+		_updates.push_back ( { v, &rhs, &c } );
+		return true;
+	}
+
+	return false;
+}
+
+const Term * RuleDecomposition::update ( const Variable & v ) const
+{
+	auto it = _update_of.find ( &v );
+	return it == _update_of.end() ? nullptr : _updates [ it->second ].term;
+}
+
+} // namespace nts
@@ -0,0 +1,84 @@
+#ifndef NTS_DECOMPOSITION_HPP_
+#define NTS_DECOMPOSITION_HPP_
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Top-level conjuncts of a formula transition rule, sorted
+ * into guards, updates and the frame.
+ * Usually obtained by FormulaTransitionRule::decomposition(), which caches it.
+ * Pointers refer to the rule's formula and are valid until it changes.
+ */
+class RuleDecomposition
+{
+	public:
+		// Conjunct x' = t (or t = x'), where t has no primed variables
+		struct Update
+		{
+			const Variable * variable;
+			const Term     * term;
+			const Formula  * conjunct;
+		};
+
+		using Formulas = std::vector < const Formula * >;
+
+		explicit RuleDecomposition ( const FormulaTransitionRule & rule );
+
+		RuleDecomposition ( const RuleDecomposition & ) = delete;
+		RuleDecomposition & operator= ( const RuleDecomposition & ) = delete;
+
+		// Conjuncts without primed variables, havocs and array writes
+		const Formulas & guards() const { return _guards; }
+
+		// At most one update of each changed variable, in order of conjuncts
+		const std::vector < Update > & updates() const { return _updates; }
+
+		// Right-hand side of the update of v, nullptr if there is none
+		const Term * update ( const Variable & v ) const;
+
+		// Remaining conjuncts, except for havocs
+		const Formulas & others() const { return _others; }
+
+		// Is there a top-level havoc?
+		bool framed() const { return _framed; }
+
+		// Intersection of top-level havocs, empty if not framed()
+		const VariableSet & havocked() const { return _havocked; }
+
+		// May the rule change v?
+		bool changes ( const Variable & v ) const
+		{
+			return !_framed || _havocked.contains ( v );
+		}
+
+		// Variables referenced in the current state, bound ones excluded
+		const VariableSet & reads() const { return _reads; }
+
+		// Variables referenced in the next state (primed or written arrays)
+		const VariableSet & writes() const { return _writes; }
+
+	private:
+		Formulas _guards;
+		Formulas _others;
+		std::vector < Update > _updates;
+		std::unordered_map < const Variable *, unsigned int > _update_of;
+
+		bool        _framed;
+		VariableSet _havocked;
+		VariableSet _reads;
+		VariableSet _writes;
+
+		// Records c as an update, if it is one
+		bool add_update ( const Formula & c, const VariableSet & bound );
+};
+
+} // namespace nts
+
+#endif // NTS_DECOMPOSITION_HPP_
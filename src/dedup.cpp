@@ -0,0 +1,146 @@
+#include <unordered_map>
+#include <vector>
+#include <utility>    // move()
+
+#include "logic.hpp"
+#include "dedup.hpp"
+
+using namespace nts;
+
+using std::unordered_map;
+using std::vector;
+using std::unique_ptr;
+using std::move;
+
+namespace
+{
+
+struct Bucket
+{
+	const State * from;
+	const State * to;
+	std::size_t   rule;
+
+	bool operator== ( const Bucket & b ) const
+	{
+		return from == b.from && to == b.to && rule == b.rule;
+	}
+};
+
+struct BucketHash
+{
+	std::size_t operator() ( const Bucket & b ) const
+	{
+		std::size_t h = hash_combine ( std::hash < const State * > () ( b.from ),
+				std::hash < const State * > () ( b.to ) );
+		return hash_combine ( h, b.rule );
+	}
+};
+
+unsigned int remove_duplicates ( BasicNts & bn )
+{
+	unordered_map < Bucket, vector < Transition * >, BucketHash > buckets;
+	unsigned int n_removed = 0;
+
+	// Deletion of transition unlinks it from the list
+	const auto & trs = bn.transitions();
+	for ( auto it = trs.begin(); it != trs.end(); )
+	{
+		Transition * t = *it++;
+		auto & same = buckets [ { &t->from(), &t->to(), t->rule().hash() } ];
+
+		bool duplicate = false;
+		for ( const Transition * s : same )
+		{
+			if ( structurally_equal ( s->rule(), t->rule() ) )
+			{
+				duplicate = true;
+				break;
+			}
+		}
+
+		if ( duplicate )
+		{
+			delete t;
+			n_removed++;
+		}
+		else
+		{
+			same.push_back ( t );
+		}
+	}
+
+	return n_removed;
+}
+
+unsigned int merge_parallel ( BasicNts & bn )
+{
+	// Keyed by ( from, to ), rule hash is not used
+	unordered_map < Bucket, vector < Transition * >, BucketHash > parallel;
+	vector < vector < Transition * > * > order;
+
+	for ( Transition * t : bn.transitions() )
+	{
+		if ( t->rule().kind() != TransitionRule::Kind::Formula )
+			continue;
+
+		auto & group = parallel [ { &t->from(), &t->to(), 0 } ];
+		if ( group.empty() )
+			order.push_back ( &group );
+		group.push_back ( t );
+	}
+
+	unsigned int n_removed = 0;
+	for ( auto * group : order )
+	{
+		if ( group->size() < 2 )
+			continue;
+
+		Transition * first = group->front();
+		unique_ptr < Formula > f;
+		for ( Transition * t : *group )
+		{
+			const auto & rule = static_cast < const FormulaTransitionRule & > ( t->rule() );
+			unique_ptr < Formula > g ( rule.formula().clone() );
+			if ( f )
+				f = unique_ptr < Formula > ( new FormulaBop ( BoolOp::Or, move ( f ), move ( g ) ) );
+			else
+				f = move ( g );
+		}
+
+		auto * merged = new Transition (
+				unique_ptr < TransitionRule > ( new FormulaTransitionRule ( move ( f ) ) ),
+				first->from(),
+				first->to()
+		);
+		merged->annotations = first->annotations;
+		merged->insert_to ( bn );
+
+		for ( Transition * t : *group )
+			delete t;
+
+		n_removed += group->size() - 1;
+	}
+
+	return n_removed;
+}
+
+} // anonymous namespace
+
+unsigned int nts::remove_duplicate_transitions ( BasicNts & bn, bool merge )
+{
+	unsigned int n_removed = remove_duplicates ( bn );
+	if ( merge )
+		n_removed += merge_parallel ( bn );
+
+	return n_removed;
+}
+
+unsigned int nts::remove_duplicate_transitions ( Nts & nts, bool merge )
+{
+	unsigned int n_removed = 0;
+	for ( BasicNts * bn : nts.basic_ntses() )
+		n_removed += remove_duplicate_transitions ( *bn, merge );
+
+	return n_removed;
+}
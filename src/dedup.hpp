@@ -0,0 +1,28 @@
+#ifndef NTS_DEDUP_HPP_
+#define NTS_DEDUP_HPP_
+#pragma once
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Removes transitions, which are structurally equal
+ * (@see structurally_equal) to some previous transition
+ * between the same pair of states.
+ * Transitions are bucketed by ( from, to, rule hash ),
+ * so the pass runs in expected linear time.
+ *
+ * If 'merge' is true, remaining parallel transitions with formula rules
+ * are merged into one transition, labelled by disjunction of their formulas.
+ * The merged transition keeps annotations of the first one.
+ *
+ * @return number of removed transitions
+ */
+unsigned int remove_duplicate_transitions ( BasicNts & bn, bool merge = false );
+unsigned int remove_duplicate_transitions ( Nts & nts, bool merge = false );
+
+}
+
+#endif // NTS_DEDUP_HPP_
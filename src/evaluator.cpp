@@ -0,0 +1,1577 @@
+#include <stdexcept>
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "conjuncts.hpp"
+#include "decomposition.hpp"
+#include "evaluator.hpp"
+
+using std::vector;
+using std::pair;
+using std::unordered_map;
+using std::unordered_set;
+using std::domain_error;
+using std::logic_error;
+using std::out_of_range;
+
+namespace nts
+{
+
+//------------------------------------//
+// ValuationLayout                    //
+//------------------------------------//
+
+ValuationLayout::ValuationLayout() :
+	_size ( 0 )
+{
+	;
+}
+
+ValuationLayout::ValuationLayout ( const BasicNts & bn ) :
+	_size ( 0 )
+{
+	if ( bn.parent() )
+	{
+		for ( const Variable * v : bn.parent()->variables() )
+			add ( *v );
+	}
+
+	for ( const auto * vars : { &bn.params_in(), &bn.params_out(), &bn.variables() } )
+	{
+		for ( const Variable * v : *vars )
+			add ( *v );
+	}
+}
+
+void ValuationLayout::add ( const Variable & v )
+{
+	if ( contains ( v ) )
+		throw logic_error ( "Variable " + v.name + " is already in the layout" );
+
+	const DataType & t = v.type();
+	if ( t.ref_dimension() > 0 )
+		throw domain_error ( "Array " + v.name + " does not have constant size" );
+
+	Entry e { _size, 1, {} };
+	for ( const Term * i : t.idx_terms() )
+	{
+		Value n = CompiledTerm ( *i, ValuationLayout() ).evaluate ( nullptr, nullptr );
+		if ( n <= 0 )
+			throw domain_error ( "Array " + v.name + " has nonpositive size" );
+
+		e.dims.push_back ( n );
+		e.size *= n;
+	}
+
+	_size += e.size;
+	_entries.emplace ( &v, std::move ( e ) );
+	_vars.push_back ( &v );
+}
+
+bool ValuationLayout::contains ( const Variable & v ) const
+{
+	return _entries.count ( &v ) > 0;
+}
+
+const ValuationLayout::Entry & ValuationLayout::entry ( const Variable & v ) const
+{
+	auto it = _entries.find ( &v );
+	if ( it == _entries.end() )
+		throw logic_error ( "Variable " + v.name + " is not in the layout" );
+
+	return it->second;
+}
+
+//------------------------------------//
+// Instructions                       //
+//------------------------------------//
+
+enum class CompiledExpression::Op : std::uint8_t
+{
+	Const,       // push b
+	LoadCurr,    // push curr[a]
+	LoadNext,    // push next[a]
+	LoadLocal,   // push locals[a]
+	LoadTid,     // push thread id
+	LoadCurrAt,  // pop i; push curr[a + i]
+	LoadNextAt,  // pop i; push next[a + i]
+	IndexStep,   // pop i, acc; check 0 <= i < a; push acc * a + i
+	Scale,       // pop x; push x * b
+
+	Add,
+	Sub,
+	Mul,
+	Div,         // Euclidean integer division
+	Mod,
+	DivU,        // Unsigned (bitvector) division
+	ModU,
+	Neg,
+	Wrap,        // pop x; push x & b
+
+	Eq,
+	Ne,
+	Lt,
+	Le,
+	Gt,
+	Ge,
+	LtU,
+	LeU,
+	GtU,
+	GeU,
+
+	Not,
+	Bool,        // pop x; push x != 0
+	And,         // Only in batch code, operands are 0 or 1
+	Or,
+	JumpIfFalse, // if top is 0 then jump to a, else pop
+	JumpIfTrue,  // if top is not 0 then jump to a, else pop
+
+	ArrEq,       // pop o2, o1; compare a slots of (b & 1 ? next : curr) at o1
+	             // with a slots of (b & 2 ? next : curr) at o2
+	Frame,       // push 1 if ranges _frames[a] are unchanged
+	ArrayWrite,  // see _array_writes[a]
+	Quant,       // see _quantifiers[a]
+	Ret
+};
+
+using Op = CompiledExpression::Op;
+
+namespace
+{
+
+// Values of bitvectors are kept in range [0, 2^width)
+Value width_mask ( unsigned int width )
+{
+	return width == 0 || width >= 64 ? ~ Value ( 0 ) : ( Value ( 1 ) << width ) - 1;
+}
+
+} // anonymous namespace
+
+//------------------------------------//
+// ExpressionCompiler                 //
+//------------------------------------//
+
+/**
+ * @brief Translates formulas and terms into instructions.
+ * Sort of a term is represented by its bitwidth, 0 means Int.
+ */
+class ExpressionCompiler
+{
+	private:
+		CompiledExpression    & _e;
+		const ValuationLayout & _layout;
+
+		// Quantified variables in scope
+		unordered_map < const Variable *, unsigned int > _locals;
+
+		unsigned int _depth;
+
+		// Generating branch-free code for batch evaluation
+		const bool _batch;
+
+		struct Address
+		{
+			bool primed;
+			unsigned int slot;
+			// Remaining dimensions
+			vector < unsigned int > dims;
+		};
+
+		static Value mask ( unsigned int width );
+
+		vector < CompiledExpression::Instruction > & code()
+		{
+			return _batch ? _e._batch_code : _e._code;
+		}
+
+		unsigned int emit ( Op op, int delta, std::int32_t a = 0, std::int64_t b = 0 );
+		unsigned int here() const { return _e._code.size(); }
+		void patch ( unsigned int jump ) { _e._code[jump].a = here(); }
+
+		void wrap ( unsigned int width );
+
+		Address address ( const Term & t );
+		void array_equality ( const Relation & r );
+
+		void quantified ( const QuantifiedFormula & qf, unsigned int var );
+		void havoc ( const Havoc & h );
+		void array_write ( const ArrayWrite & aw );
+		void relation ( const Relation & r );
+
+	public:
+		static unsigned int sort_of ( const ScalarType & t, unsigned int ctx );
+
+		ExpressionCompiler ( CompiledExpression & e, const ValuationLayout & layout,
+				bool batch = false ) :
+			_e      ( e      ),
+			_layout ( layout ),
+			_depth  ( 0      ),
+			_batch  ( batch  )
+		{
+			;
+		}
+
+		void term ( const Term & t, unsigned int ctx );
+		void formula ( const Formula & f );
+		void finish();
+};
+
+unsigned int ExpressionCompiler::sort_of ( const ScalarType & t, unsigned int ctx )
+{
+	if ( t.is_bitvector() )
+	{
+		if ( t.bitwidth() > 64 )
+			throw domain_error ( "Bitvectors wider than 64 bits are not supported" );
+		return t.bitwidth();
+	}
+
+	if ( t == ScalarType::Integral() )
+		return ctx;
+
+	if ( t == ScalarType::Real() )
+		throw domain_error ( "Real numbers are not supported" );
+
+	return 0;
+}
+
+Value ExpressionCompiler::mask ( unsigned int width )
+{
+	return width_mask ( width );
+}
+
+unsigned int ExpressionCompiler::emit ( Op op, int delta, std::int32_t a, std::int64_t b )
+{
+	code().push_back ( { op, a, b } );
+	_depth += delta;
+	unsigned int & max = _batch ? _e._batch_max_stack : _e._max_stack;
+	max = std::max ( max, _depth );
+	return code().size() - 1;
+}
+
+void ExpressionCompiler::wrap ( unsigned int width )
+{
+	if ( width > 0 && width < 64 )
+		emit ( Op::Wrap, 0, 0, mask ( width ) );
+}
+
+void ExpressionCompiler::finish()
+{
+	emit ( Op::Ret, -1 );
+	_e._n_locals = std::max < unsigned int > ( _e._n_locals, 1 );
+	_e._n_slots = _layout.size();
+}
+
+ExpressionCompiler::Address ExpressionCompiler::address ( const Term & t )
+{
+	if ( t.term_type() == Term::TermType::ArrayTerm )
+	{
+		auto & at = static_cast < const ArrayTerm & > ( t );
+		Address a = address ( at.array() );
+		for ( const Term * i : at.indices() )
+		{
+			if ( a.dims.empty() )
+				throw domain_error ( "Too many indices of an array" );
+
+			term ( *i, 0 );
+			emit ( Op::IndexStep, -1, a.dims.front() );
+			a.dims.erase ( a.dims.begin() );
+		}
+		return a;
+	}
+
+	if ( t.term_type() == Term::TermType::Leaf &&
+			static_cast < const Leaf & > ( t ).leaf_type() == Leaf::LeafType::VariableReference )
+	{
+		auto & vr = static_cast < const VariableReference & > ( t );
+		const auto & e = _layout.entry ( *vr.variable() );
+		if ( e.dims.empty() )
+			throw domain_error ( "Variable " + vr.variable()->name + " is not an array" );
+
+		emit ( Op::Const, 1, 0, 0 );
+		return Address { vr.primed(), e.offset, e.dims };
+	}
+
+	throw domain_error ( "Unsupported array term" );
+}
+
+void ExpressionCompiler::term ( const Term & t, unsigned int ctx )
+{
+	const unsigned int own = t.type().is_scalar() ?
+		sort_of ( t.type().scalar_type(), ctx ) : 0;
+
+	switch ( t.term_type() )
+	{
+		case Term::TermType::ArithmeticOperation:
+		{
+			auto & aop = static_cast < const ArithmeticOperation & > ( t );
+			term ( aop.term1(), own );
+			term ( aop.term2(), own );
+
+			const bool bv = own > 0;
+			switch ( aop.operation() )
+			{
+				case ArithOp::Add: emit ( Op::Add, -1 ); break;
+				case ArithOp::Sub: emit ( Op::Sub, -1 ); break;
+				case ArithOp::Mul: emit ( Op::Mul, -1 ); break;
+				case ArithOp::Div: emit ( bv ? Op::DivU : Op::Div, -1 ); break;
+				case ArithOp::Mod: emit ( bv ? Op::ModU : Op::Mod, -1 ); break;
+			}
+			wrap ( own );
+			break;
+		}
+
+		case Term::TermType::MinusTerm:
+			term ( static_cast < const MinusTerm & > ( t ).term(), own );
+			emit ( Op::Neg, 0 );
+			wrap ( own );
+			break;
+
+		case Term::TermType::ArrayTerm:
+		{
+			Address a = address ( t );
+			if ( !a.dims.empty() )
+				throw domain_error ( "Array is used as a scalar" );
+
+			emit ( a.primed ? Op::LoadNextAt : Op::LoadCurrAt, 0, a.slot );
+			break;
+		}
+
+		case Term::TermType::Leaf:
+		{
+			auto & l = static_cast < const Leaf & > ( t );
+			switch ( l.leaf_type() )
+			{
+				case Leaf::LeafType::IntConstant:
+				{
+					Value v = static_cast < const IntConstant & > ( l ).value();
+					emit ( Op::Const, 1, 0, own > 0 ? v & mask ( own ) : v );
+					break;
+				}
+
+				case Leaf::LeafType::BoolConstant:
+					emit ( Op::Const, 1, 0, static_cast < const BoolConstant & > ( l ).value() );
+					break;
+
+				case Leaf::LeafType::UserConstant:
+				{
+					const std::string & s = static_cast < const UserConstant & > ( l ).value();
+					std::size_t pos = 0;
+					Value v;
+					try
+					{
+						v = std::stoll ( s, &pos );
+					}
+					catch ( const std::exception & )
+					{
+						pos = 0;
+					}
+
+					if ( pos == 0 || pos != s.size() )
+						throw domain_error ( "Constant '" + s + "' is not a number" );
+
+					emit ( Op::Const, 1, 0, own > 0 ? v & mask ( own ) : v );
+					break;
+				}
+
+				case Leaf::LeafType::ThreadID:
+					emit ( Op::LoadTid, 1 );
+					break;
+
+				case Leaf::LeafType::VariableReference:
+				{
+					auto & vr = static_cast < const VariableReference & > ( l );
+					const Variable * v = vr.variable().get();
+
+					auto local = _locals.find ( v );
+					if ( local != _locals.end() )
+					{
+						emit ( Op::LoadLocal, 1, local->second );
+						break;
+					}
+
+					const auto & e = _layout.entry ( *v );
+					if ( !e.dims.empty() )
+						throw domain_error ( "Array " + v->name + " is used as a scalar" );
+
+					emit ( vr.primed() ? Op::LoadNext : Op::LoadCurr, 1, e.offset );
+					break;
+				}
+			}
+			break;
+		}
+	}
+
+	// Coercion to a narrower context
+	if ( ctx > 0 && ( own == 0 || own > ctx ) )
+		wrap ( ctx );
+}
+
+void ExpressionCompiler::array_equality ( const Relation & r )
+{
+	if ( r.operation() != RelationOp::eq && r.operation() != RelationOp::neq )
+		throw domain_error ( "Arrays can be compared only for equality" );
+
+	Address a1 = address ( r.term1() );
+	unsigned int size = 1;
+	for ( unsigned int d : a1.dims )
+		size *= d;
+	emit ( Op::Scale, 0, 0, size );
+	emit ( Op::Const, 1, 0, a1.slot );
+	emit ( Op::Add, -1 );
+
+	Address a2 = address ( r.term2() );
+	if ( a1.dims != a2.dims )
+		throw domain_error ( "Compared arrays have different sizes" );
+	emit ( Op::Scale, 0, 0, size );
+	emit ( Op::Const, 1, 0, a2.slot );
+	emit ( Op::Add, -1 );
+
+	emit ( Op::ArrEq, -1, size, a1.primed | a2.primed << 1 );
+	if ( r.operation() == RelationOp::neq )
+		emit ( Op::Not, 0 );
+}
+
+void ExpressionCompiler::relation ( const Relation & r )
+{
+	if ( !r.type().is_scalar() )
+	{
+		array_equality ( r );
+		return;
+	}
+
+	const unsigned int s = sort_of ( r.type().scalar_type(), 0 );
+	term ( r.term1(), s );
+	term ( r.term2(), s );
+
+	const bool bv = s > 0;
+	switch ( r.operation() )
+	{
+		case RelationOp::eq:  emit ( Op::Eq, -1 ); break;
+		case RelationOp::neq: emit ( Op::Ne, -1 ); break;
+		case RelationOp::lt:  emit ( bv ? Op::LtU : Op::Lt, -1 ); break;
+		case RelationOp::leq: emit ( bv ? Op::LeU : Op::Le, -1 ); break;
+		case RelationOp::gt:  emit ( bv ? Op::GtU : Op::Gt, -1 ); break;
+		case RelationOp::geq: emit ( bv ? Op::GeU : Op::Ge, -1 ); break;
+	}
+}
+
+void ExpressionCompiler::havoc ( const Havoc & h )
+{
+	// Adjacent ranges are merged
+	vector < pair < unsigned int, unsigned int > > ranges;
+	for ( const Variable * v : _layout.variables() )
+	{
+		if ( h.havocs ( *v ) )
+			continue;
+
+		const auto & e = _layout.entry ( *v );
+		if ( !ranges.empty() && ranges.back().first + ranges.back().second == e.offset )
+			ranges.back().second += e.size;
+		else
+			ranges.emplace_back ( e.offset, e.size );
+	}
+
+	_e._frames.push_back ( std::move ( ranges ) );
+	emit ( Op::Frame, 1, _e._frames.size() - 1 );
+}
+
+void ExpressionCompiler::array_write ( const ArrayWrite & aw )
+{
+	const auto & e = _layout.entry ( *aw.array() );
+	const unsigned int n1 = aw.indices_1().size();
+
+	if ( n1 + 1 != e.dims.size() )
+		throw domain_error ( "Only writes of scalar values to arrays are supported" );
+
+	emit ( Op::Const, 1, 0, 0 );
+	for ( unsigned int i = 0; i < n1; i++ )
+	{
+		term ( *aw.indices_1()[i], 0 );
+		emit ( Op::IndexStep, -1, e.dims[i] );
+	}
+
+	const unsigned int block = e.dims.back();
+	emit ( Op::Scale, 0, 0, block );
+
+	const unsigned int elem = sort_of ( aw.array()->type().scalar_type(), 0 );
+	const auto & idx = aw.indices_2();
+	const auto & val = aw.values();
+	for ( unsigned int j = 0; j < idx.size(); j++ )
+	{
+		term ( *idx[j], 0 );
+		term ( *val[j], elem );
+	}
+
+	_e._array_writes.push_back ( { e.offset, e.size, block, (unsigned int) idx.size() } );
+	emit ( Op::ArrayWrite, - 2 * (int) idx.size(), _e._array_writes.size() - 1 );
+}
+
+void ExpressionCompiler::quantified ( const QuantifiedFormula & qf, unsigned int var )
+{
+	const auto & vars = qf.list.variables();
+	if ( var == vars.size() )
+	{
+		formula ( qf.formula() );
+		return;
+	}
+
+	if ( _batch )
+		throw logic_error ( "Quantifiers are not supported in batch code" );
+
+	const Variable * v = *std::next ( vars.begin(), var );
+	const QuantifiedType & qt = qf.list.qtype();
+
+	unsigned int width = qt.type().is_scalar() ?
+		sort_of ( qt.type().scalar_type(), 0 ) : 0;
+
+	if ( !qt.from() && ( width == 0 || width > 16 ) )
+		throw domain_error ( "Unbounded quantification over " + v->name );
+
+	unsigned int local = _e._n_locals++;
+	_e._quantifiers.push_back ( { local, qf.list.quantifier == Quantifier::Forall, 0, 0, 0, 0 } );
+	unsigned int id = _e._quantifiers.size() - 1;
+
+	const unsigned int depth = _depth;
+	emit ( Op::Quant, 0, id );
+
+	// Bounds are evaluated before the variable is in scope
+	_e._quantifiers[id].from = here();
+	if ( qt.from() )
+		term ( *qt.from(), width );
+	else
+		emit ( Op::Const, 1, 0, 0 );
+	emit ( Op::Ret, -1 );
+
+	_e._quantifiers[id].to = here();
+	if ( qt.to() )
+		term ( *qt.to(), width );
+	else
+		emit ( Op::Const, 1, 0, mask ( width ) );
+	emit ( Op::Ret, -1 );
+
+	// Inner binding shadows outer one
+	auto shadowed = _locals.find ( v );
+	bool had = shadowed != _locals.end();
+	unsigned int old = had ? shadowed->second : 0;
+	_locals[v] = local;
+
+	_e._quantifiers[id].body = here();
+	quantified ( qf, var + 1 );
+	emit ( Op::Ret, -1 );
+
+	if ( had )
+		_locals[v] = old;
+	else
+		_locals.erase ( v );
+
+	_e._quantifiers[id].end = here();
+	_depth = depth + 1;
+}
+
+void ExpressionCompiler::formula ( const Formula & f )
+{
+	switch ( f.type() )
+	{
+		case Formula::Type::FormulaBop:
+		{
+			auto & fb = static_cast < const FormulaBop & > ( f );
+			formula ( fb.formula_1() );
+
+			// Both operands are always evaluated
+			if ( _batch && fb.op() != BoolOp::Equiv )
+			{
+				if ( fb.op() == BoolOp::Imply )
+					emit ( Op::Not, 0 );
+				formula ( fb.formula_2() );
+				emit ( fb.op() == BoolOp::And ? Op::And : Op::Or, -1 );
+				break;
+			}
+
+			switch ( fb.op() )
+			{
+				case BoolOp::And:
+				{
+					unsigned int j = emit ( Op::JumpIfFalse, -1 );
+					formula ( fb.formula_2() );
+					patch ( j );
+					break;
+				}
+
+				case BoolOp::Or:
+				{
+					unsigned int j = emit ( Op::JumpIfTrue, -1 );
+					formula ( fb.formula_2() );
+					patch ( j );
+					break;
+				}
+
+				case BoolOp::Imply:
+				{
+					emit ( Op::Not, 0 );
+					unsigned int j = emit ( Op::JumpIfTrue, -1 );
+					formula ( fb.formula_2() );
+					patch ( j );
+					break;
+				}
+
+				case BoolOp::Equiv:
+					formula ( fb.formula_2() );
+					emit ( Op::Eq, -1 );
+					break;
+			}
+			break;
+		}
+
+		case Formula::Type::FormulaNot:
+			formula ( static_cast < const FormulaNot & > ( f ).formula() );
+			emit ( Op::Not, 0 );
+			break;
+
+		case Formula::Type::QuantifiedFormula:
+			quantified ( static_cast < const QuantifiedFormula & > ( f ), 0 );
+			break;
+
+		case Formula::Type::AtomicProposition:
+		{
+			auto & ap = static_cast < const AtomicProposition & > ( f );
+			switch ( ap.aptype() )
+			{
+				case AtomicProposition::APType::Havoc:
+					havoc ( static_cast < const Havoc & > ( ap ) );
+					break;
+
+				case AtomicProposition::APType::BooleanTerm:
+				{
+					const Term & t = static_cast < const BooleanTerm & > ( ap ).term();
+					term ( t, t.type().is_scalar() ? sort_of ( t.type().scalar_type(), 0 ) : 0 );
+					emit ( Op::Bool, 0 );
+					break;
+				}
+
+				case AtomicProposition::APType::Relation:
+					relation ( static_cast < const Relation & > ( ap ) );
+					break;
+
+				case AtomicProposition::APType::ArrayWrite:
+					array_write ( static_cast < const ArrayWrite & > ( ap ) );
+					break;
+			}
+			break;
+		}
+	}
+}
+
+//------------------------------------//
+// CompiledExpression                 //
+//------------------------------------//
+
+CompiledExpression::CompiledExpression() :
+	_max_stack       ( 0 ),
+	_n_locals        ( 0 ),
+	_batch_max_stack ( 0 ),
+	_n_slots         ( 0 )
+{
+	;
+}
+
+Value CompiledExpression::run ( const Value * curr, const Value * next, Value tid ) const
+{
+	// Most expressions are small enough to not need the heap
+	const unsigned int small = 64;
+	Value stack [ small ];
+	Value locals [ small ];
+
+	if ( _max_stack <= small && _n_locals <= small )
+		return exec ( 0, stack, locals, curr, next, tid );
+
+	vector < Value > big_stack ( _max_stack );
+	vector < Value > big_locals ( _n_locals );
+	return exec ( 0, big_stack.data(), big_locals.data(), curr, next, tid );
+}
+
+namespace
+{
+
+// Arithmetic on two's complement without undefined behaviour
+inline Value wrapping ( std::uint64_t v ) { return (Value) v; }
+
+Value euclid_div ( Value a, Value b )
+{
+	if ( b == 0 )
+		throw domain_error ( "Division by zero" );
+	if ( b == -1 )
+		return wrapping ( - (std::uint64_t) a );
+
+	Value q = a / b;
+	if ( a % b < 0 )
+		q = b > 0 ? q - 1 : q + 1;
+	return q;
+}
+
+Value euclid_mod ( Value a, Value b )
+{
+	if ( b == 0 )
+		throw domain_error ( "Division by zero" );
+	if ( b == -1 )
+		return 0;
+
+	Value r = a % b;
+	if ( r < 0 )
+		r += b > 0 ? b : -b;
+	return r;
+}
+
+} // anonymous namespace
+
+Value CompiledExpression::exec ( unsigned int pc, Value * sp, Value * locals,
+		const Value * curr, const Value * next, Value tid ) const
+{
+	using U = std::uint64_t;
+
+	for ( ;; )
+	{
+		const Instruction & i = _code[pc++];
+		switch ( i.op )
+		{
+			case Op::Const:     *sp++ = i.b;         break;
+			case Op::LoadCurr:  *sp++ = curr[i.a];   break;
+			case Op::LoadNext:  *sp++ = next[i.a];   break;
+			case Op::LoadLocal: *sp++ = locals[i.a]; break;
+			case Op::LoadTid:   *sp++ = tid;         break;
+
+			case Op::LoadCurrAt: sp[-1] = curr [ i.a + sp[-1] ]; break;
+			case Op::LoadNextAt: sp[-1] = next [ i.a + sp[-1] ]; break;
+
+			case Op::IndexStep:
+			{
+				Value idx = *--sp;
+				if ( idx < 0 || idx >= i.a )
+					throw out_of_range ( "Array index out of bounds" );
+				sp[-1] = sp[-1] * i.a + idx;
+				break;
+			}
+
+			case Op::Scale: sp[-1] *= i.b; break;
+
+			case Op::Add: sp--; sp[-1] = wrapping ( (U) sp[-1] + (U) sp[0] ); break;
+			case Op::Sub: sp--; sp[-1] = wrapping ( (U) sp[-1] - (U) sp[0] ); break;
+			case Op::Mul: sp--; sp[-1] = wrapping ( (U) sp[-1] * (U) sp[0] ); break;
+			case Op::Div: sp--; sp[-1] = euclid_div ( sp[-1], sp[0] ); break;
+			case Op::Mod: sp--; sp[-1] = euclid_mod ( sp[-1], sp[0] ); break;
+
+			case Op::DivU:
+				sp--;
+				sp[-1] = sp[0] == 0 ? ~ Value ( 0 ) : wrapping ( (U) sp[-1] / (U) sp[0] );
+				break;
+
+			case Op::ModU:
+				sp--;
+				if ( sp[0] != 0 )
+					sp[-1] = wrapping ( (U) sp[-1] % (U) sp[0] );
+				break;
+
+			case Op::Neg:  sp[-1] = wrapping ( - (U) sp[-1] ); break;
+			case Op::Wrap: sp[-1] &= i.b; break;
+
+			case Op::Eq:  sp--; sp[-1] = sp[-1] == sp[0]; break;
+			case Op::Ne:  sp--; sp[-1] = sp[-1] != sp[0]; break;
+			case Op::Lt:  sp--; sp[-1] = sp[-1] <  sp[0]; break;
+			case Op::Le:  sp--; sp[-1] = sp[-1] <= sp[0]; break;
+			case Op::Gt:  sp--; sp[-1] = sp[-1] >  sp[0]; break;
+			case Op::Ge:  sp--; sp[-1] = sp[-1] >= sp[0]; break;
+			case Op::LtU: sp--; sp[-1] = (U) sp[-1] <  (U) sp[0]; break;
+			case Op::LeU: sp--; sp[-1] = (U) sp[-1] <= (U) sp[0]; break;
+			case Op::GtU: sp--; sp[-1] = (U) sp[-1] >  (U) sp[0]; break;
+			case Op::GeU: sp--; sp[-1] = (U) sp[-1] >= (U) sp[0]; break;
+
+			case Op::Not:  sp[-1] = sp[-1] == 0; break;
+			case Op::Bool: sp[-1] = sp[-1] != 0; break;
+			case Op::And:  sp--; sp[-1] &= sp[0]; break;
+			case Op::Or:   sp--; sp[-1] |= sp[0]; break;
+
+			case Op::JumpIfFalse:
+				if ( sp[-1] == 0 )
+					pc = i.a;
+				else
+					sp--;
+				break;
+
+			case Op::JumpIfTrue:
+				if ( sp[-1] != 0 )
+					pc = i.a;
+				else
+					sp--;
+				break;
+
+			case Op::ArrEq:
+			{
+				sp--;
+				const Value * v1 = ( i.b & 1 ? next : curr ) + sp[-1];
+				const Value * v2 = ( i.b & 2 ? next : curr ) + sp[0];
+				sp[-1] = std::equal ( v1, v1 + i.a, v2 );
+				break;
+			}
+
+			case Op::Frame:
+			{
+				bool same = true;
+				for ( const auto & r : _frames[i.a] )
+				{
+					if ( !std::equal ( curr + r.first, curr + r.first + r.second, next + r.first ) )
+					{
+						same = false;
+						break;
+					}
+				}
+				*sp++ = same;
+				break;
+			}
+
+			case Op::ArrayWrite:
+			{
+				const ArrayWriteInfo & w = _array_writes[i.a];
+				sp -= 2 * w.n_writes;
+				const Value * writes = sp;
+				const Value base = sp[-1];
+
+				for ( unsigned int j = 0; j < w.n_writes; j++ )
+				{
+					if ( writes[2*j] < 0 || writes[2*j] >= w.block )
+						throw out_of_range ( "Array index out of bounds" );
+				}
+
+				const Value * a  = curr + w.slot;
+				const Value * a2 = next + w.slot;
+				bool ok = std::equal ( a, a + base, a2 ) &&
+					std::equal ( a + base + w.block, a + w.size, a2 + base + w.block );
+
+				for ( unsigned int k = 0; ok && k < w.block; k++ )
+				{
+					Value expected = a [ base + k ];
+					// Later writes win
+					for ( unsigned int j = 0; j < w.n_writes; j++ )
+					{
+						if ( writes[2*j] == k )
+							expected = writes[2*j + 1];
+					}
+					ok = a2 [ base + k ] == expected;
+				}
+
+				sp[-1] = ok;
+				break;
+			}
+
+			case Op::Quant:
+			{
+				const QuantifierInfo & q = _quantifiers[i.a];
+				Value from = exec ( q.from, sp, locals, curr, next, tid );
+				Value to   = exec ( q.to,   sp, locals, curr, next, tid );
+
+				bool result = q.forall;
+				for ( Value v = from; v <= to; v++ )
+				{
+					locals[q.local] = v;
+					if ( ( exec ( q.body, sp, locals, curr, next, tid ) != 0 ) != q.forall )
+					{
+						result = !q.forall;
+						break;
+					}
+
+					if ( v == to )
+						break;
+				}
+
+				*sp++ = result;
+				pc = q.end;
+				break;
+			}
+
+			case Op::Ret:
+				return sp[-1];
+		}
+	}
+}
+
+//------------------------------------//
+// Batch evaluation                   //
+//------------------------------------//
+
+const unsigned int CompiledExpression::batch_size;
+
+void CompiledExpression::run_batch ( const Value * curr, const Value * next, Value tid,
+		Value * result, BatchMask & valid ) const
+{
+	const unsigned int B = batch_size;
+
+	if ( _batch_code.empty() )
+	{
+		vector < Value > c ( _n_slots );
+		vector < Value > n ( _n_slots );
+		for ( unsigned int l = 0; l < B; l++ )
+		{
+			result[l] = 0;
+			if ( ! ( valid >> l & 1 ) )
+				continue;
+
+			for ( unsigned int s = 0; s < _n_slots; s++ )
+			{
+				c[s] = curr [ s * B + l ];
+				n[s] = next [ s * B + l ];
+			}
+
+			try
+			{
+				result[l] = run ( c.data(), n.data(), tid );
+			}
+			catch ( const domain_error & )
+			{
+				valid &= ~ ( BatchMask ( 1 ) << l );
+			}
+			catch ( const out_of_range & )
+			{
+				valid &= ~ ( BatchMask ( 1 ) << l );
+			}
+		}
+		return;
+	}
+
+	const unsigned int small = 16;
+	alignas ( 64 ) Value stack [ small * B ];
+
+	if ( _batch_max_stack <= small )
+	{
+		exec_batch ( curr, next, tid, stack, result, valid );
+		return;
+	}
+
+	vector < Value > big_stack ( _batch_max_stack * B );
+	exec_batch ( curr, next, tid, big_stack.data(), result, valid );
+}
+
+/**
+ * Stack holds one row of batch_size values per entry, 'sp' points
+ * past the top row. Failing operations only mark the valuation
+ * as bad and continue with a harmless value.
+ */
+void CompiledExpression::exec_batch ( const Value * curr, const Value * next, Value tid,
+		Value * sp, Value * result, BatchMask & valid ) const
+{
+	using U = std::uint64_t;
+	const unsigned int B = batch_size;
+
+	BatchMask bad = 0;
+
+	auto unary = [&] ( auto f )
+	{
+		Value * x = sp - B;
+		for ( unsigned int l = 0; l < B; l++ )
+			x[l] = f ( x[l] );
+	};
+
+	auto binary = [&] ( auto f )
+	{
+		sp -= B;
+		Value * x = sp - B;
+		const Value * y = sp;
+		for ( unsigned int l = 0; l < B; l++ )
+			x[l] = f ( x[l], y[l] );
+	};
+
+	auto push_row = [&] ( const Value * row )
+	{
+		std::copy ( row, row + B, sp );
+		sp += B;
+	};
+
+	auto push_value = [&] ( Value v )
+	{
+		std::fill ( sp, sp + B, v );
+		sp += B;
+	};
+
+	for ( const Instruction & i : _batch_code )
+	{
+		switch ( i.op )
+		{
+			case Op::Const:    push_value ( i.b );                  break;
+			case Op::LoadCurr: push_row ( curr + (std::size_t) i.a * B ); break;
+			case Op::LoadNext: push_row ( next + (std::size_t) i.a * B ); break;
+			case Op::LoadTid:  push_value ( tid );                  break;
+
+			case Op::LoadCurrAt:
+			case Op::LoadNextAt:
+			{
+				const Value * v = i.op == Op::LoadCurrAt ? curr : next;
+				Value * x = sp - B;
+				for ( unsigned int l = 0; l < B; l++ )
+					x[l] = v [ ( i.a + x[l] ) * B + l ];
+				break;
+			}
+
+			case Op::IndexStep:
+			{
+				sp -= B;
+				Value * x = sp - B;
+				const Value * idx = sp;
+				for ( unsigned int l = 0; l < B; l++ )
+				{
+					const bool out = idx[l] < 0 || idx[l] >= i.a;
+					bad |= BatchMask ( out ) << l;
+					x[l] = x[l] * i.a + ( out ? 0 : idx[l] );
+				}
+				break;
+			}
+
+			case Op::Scale: unary ( [&] ( Value x ) { return x * i.b; } ); break;
+
+			case Op::Add: binary ( [] ( Value x, Value y ) { return wrapping ( (U) x + (U) y ); } ); break;
+			case Op::Sub: binary ( [] ( Value x, Value y ) { return wrapping ( (U) x - (U) y ); } ); break;
+			case Op::Mul: binary ( [] ( Value x, Value y ) { return wrapping ( (U) x * (U) y ); } ); break;
+
+			case Op::Div:
+			case Op::Mod:
+			{
+				sp -= B;
+				Value * x = sp - B;
+				const Value * y = sp;
+				for ( unsigned int l = 0; l < B; l++ )
+				{
+					if ( y[l] == 0 )
+					{
+						bad |= BatchMask ( 1 ) << l;
+						x[l] = 0;
+					}
+					else
+						x[l] = i.op == Op::Div ? euclid_div ( x[l], y[l] ) : euclid_mod ( x[l], y[l] );
+				}
+				break;
+			}
+
+			case Op::DivU:
+				binary ( [] ( Value x, Value y ) { return y == 0 ? ~ Value ( 0 ) : wrapping ( (U) x / (U) y ); } );
+				break;
+
+			case Op::ModU:
+				binary ( [] ( Value x, Value y ) { return y == 0 ? x : wrapping ( (U) x % (U) y ); } );
+				break;
+
+			case Op::Neg:  unary ( [] ( Value x ) { return wrapping ( - (U) x ); } ); break;
+			case Op::Wrap: unary ( [&] ( Value x ) { return x & i.b; } ); break;
+
+			case Op::Eq:  binary ( [] ( Value x, Value y ) -> Value { return x == y; } ); break;
+			case Op::Ne:  binary ( [] ( Value x, Value y ) -> Value { return x != y; } ); break;
+			case Op::Lt:  binary ( [] ( Value x, Value y ) -> Value { return x <  y; } ); break;
+			case Op::Le:  binary ( [] ( Value x, Value y ) -> Value { return x <= y; } ); break;
+			case Op::Gt:  binary ( [] ( Value x, Value y ) -> Value { return x >  y; } ); break;
+			case Op::Ge:  binary ( [] ( Value x, Value y ) -> Value { return x >= y; } ); break;
+			case Op::LtU: binary ( [] ( Value x, Value y ) -> Value { return (U) x <  (U) y; } ); break;
+			case Op::LeU: binary ( [] ( Value x, Value y ) -> Value { return (U) x <= (U) y; } ); break;
+			case Op::GtU: binary ( [] ( Value x, Value y ) -> Value { return (U) x >  (U) y; } ); break;
+			case Op::GeU: binary ( [] ( Value x, Value y ) -> Value { return (U) x >= (U) y; } ); break;
+
+			case Op::Not:  unary ( [] ( Value x ) -> Value { return x == 0; } ); break;
+			case Op::Bool: unary ( [] ( Value x ) -> Value { return x != 0; } ); break;
+			case Op::And:  binary ( [] ( Value x, Value y ) { return x & y; } ); break;
+			case Op::Or:   binary ( [] ( Value x, Value y ) { return x | y; } ); break;
+
+			case Op::ArrEq:
+			{
+				sp -= B;
+				Value * o1 = sp - B;
+				const Value * o2 = sp;
+				const Value * v1 = i.b & 1 ? next : curr;
+				const Value * v2 = i.b & 2 ? next : curr;
+				for ( unsigned int l = 0; l < B; l++ )
+				{
+					bool same = true;
+					for ( Value k = 0; same && k < i.a; k++ )
+						same = v1 [ ( o1[l] + k ) * B + l ] == v2 [ ( o2[l] + k ) * B + l ];
+					o1[l] = same;
+				}
+				break;
+			}
+
+			case Op::Frame:
+			{
+				Value * x = sp;
+				sp += B;
+				std::fill ( x, x + B, 1 );
+				for ( const auto & r : _frames[i.a] )
+				{
+					const std::size_t from = (std::size_t) r.first * B;
+					const std::size_t to   = (std::size_t) ( r.first + r.second ) * B;
+					for ( std::size_t s = from; s < to; s += B )
+					{
+						for ( unsigned int l = 0; l < B; l++ )
+							x[l] &= curr [ s + l ] == next [ s + l ];
+					}
+				}
+				break;
+			}
+
+			case Op::ArrayWrite:
+			{
+				const ArrayWriteInfo & w = _array_writes[i.a];
+				sp -= 2 * w.n_writes * B;
+				const Value * writes = sp;
+				Value * base = sp - B;
+
+				for ( unsigned int l = 0; l < B; l++ )
+				{
+					auto idx = [&] ( unsigned int j ) { return writes [ 2 * j * B + l ]; };
+					auto val = [&] ( unsigned int j ) { return writes [ ( 2 * j + 1 ) * B + l ]; };
+
+					bool ok = true;
+					for ( unsigned int j = 0; j < w.n_writes; j++ )
+					{
+						if ( idx ( j ) < 0 || idx ( j ) >= w.block )
+						{
+							bad |= BatchMask ( 1 ) << l;
+							ok = false;
+						}
+					}
+
+					for ( unsigned int k = 0; ok && k < w.size; k++ )
+					{
+						const std::size_t s = (std::size_t) ( w.slot + k ) * B + l;
+						Value expected = curr[s];
+						const Value pos = k - base[l];
+						if ( pos >= 0 && pos < w.block )
+						{
+							// Later writes win
+							for ( unsigned int j = 0; j < w.n_writes; j++ )
+							{
+								if ( idx ( j ) == pos )
+									expected = val ( j );
+							}
+						}
+						ok = next[s] == expected;
+					}
+
+					base[l] = ok;
+				}
+				break;
+			}
+
+			case Op::Ret:
+			{
+				const Value * x = sp - B;
+				for ( unsigned int l = 0; l < B; l++ )
+					result[l] = bad >> l & 1 ? 0 : x[l];
+				valid &= ~bad;
+				return;
+			}
+
+			default:
+				throw logic_error ( "Instruction is not supported in batch code" );
+		}
+	}
+}
+
+//------------------------------------//
+// CompiledFormula, CompiledTerm      //
+//------------------------------------//
+
+CompiledFormula::CompiledFormula ( const Formula & f, const ValuationLayout & layout )
+{
+	ExpressionCompiler c ( *this, layout );
+	c.formula ( f );
+	c.finish();
+
+	if ( _quantifiers.empty() )
+	{
+		ExpressionCompiler b ( *this, layout, true );
+		b.formula ( f );
+		b.finish();
+	}
+}
+
+CompiledExpression::BatchMask CompiledFormula::evaluate_batch ( const Value * curr,
+		const Value * next, Value tid ) const
+{
+	Value result [ batch_size ];
+	BatchMask valid = ~ BatchMask ( 0 );
+	run_batch ( curr, next, tid, result, valid );
+
+	BatchMask holds = 0;
+	for ( unsigned int l = 0; l < batch_size; l++ )
+		holds |= BatchMask ( result[l] != 0 ) << l;
+	return holds & valid;
+}
+
+CompiledTerm::CompiledTerm ( const Term & t, const ValuationLayout & layout )
+{
+	const DataType & type = t.type();
+	const unsigned int sort = type.is_scalar() ?
+		ExpressionCompiler::sort_of ( type.scalar_type(), 0 ) : 0;
+
+	ExpressionCompiler c ( *this, layout );
+	c.term ( t, sort );
+	c.finish();
+
+	ExpressionCompiler b ( *this, layout, true );
+	b.term ( t, sort );
+	b.finish();
+}
+
+//------------------------------------//
+// Transition analysis                //
+//------------------------------------//
+
+namespace
+{
+
+void primed_variables ( const Term & t, unordered_set < const Variable * > & out )
+{
+	switch ( t.term_type() )
+	{
+		case Term::TermType::ArithmeticOperation:
+		{
+			auto & aop = static_cast < const ArithmeticOperation & > ( t );
+			primed_variables ( aop.term1(), out );
+			primed_variables ( aop.term2(), out );
+			break;
+		}
+
+		case Term::TermType::MinusTerm:
+			primed_variables ( static_cast < const MinusTerm & > ( t ).term(), out );
+			break;
+
+		case Term::TermType::ArrayTerm:
+		{
+			auto & at = static_cast < const ArrayTerm & > ( t );
+			primed_variables ( at.array(), out );
+			for ( const Term * i : at.indices() )
+				primed_variables ( *i, out );
+			break;
+		}
+
+		case Term::TermType::Leaf:
+		{
+			auto & l = static_cast < const Leaf & > ( t );
+			if ( l.leaf_type() != Leaf::LeafType::VariableReference )
+				break;
+
+			auto & vr = static_cast < const VariableReference & > ( l );
+			if ( vr.primed() )
+				out.insert ( vr.variable().get() );
+			break;
+		}
+	}
+}
+
+bool is_primed_reference ( const Term & t, const Variable * & v )
+{
+	if ( t.term_type() != Term::TermType::Leaf )
+		return false;
+
+	auto & l = static_cast < const Leaf & > ( t );
+	if ( l.leaf_type() != Leaf::LeafType::VariableReference )
+		return false;
+
+	auto & vr = static_cast < const VariableReference & > ( l );
+	v = vr.variable().get();
+	return vr.primed();
+}
+
+bool subset ( const unordered_set < const Variable * > & s1,
+		const unordered_set < const Variable * > & s2 )
+{
+	for ( const Variable * v : s1 )
+	{
+		if ( !s2.count ( v ) )
+			return false;
+	}
+	return true;
+}
+
+unsigned int width_of ( const Variable & v )
+{
+	const ScalarType & st = v.type().scalar_type();
+	return st.is_bitvector() ? st.bitwidth() : 0;
+}
+
+} // anonymous namespace
+
+//------------------------------------//
+// TransitionPlan                     //
+//------------------------------------//
+
+TransitionPlan::TransitionPlan ( const Transition & t, const ValuationLayout & layout )
+{
+	if ( t.rule().kind() != TransitionRule::Kind::Formula )
+		throw domain_error ( "Call transitions are not supported" );
+
+	const Formula & f = static_cast < const FormulaTransitionRule & > ( t.rule() ).formula();
+	nts::conjuncts ( f, conjuncts );
+
+	const RuleDecomposition & d = static_cast < const FormulaTransitionRule & > ( t.rule() ).decomposition();
+	guards = d.guards();
+
+	// Variables which may change
+	for ( const Variable * v : layout.variables() )
+	{
+		if ( d.changes ( *v ) )
+			changing.push_back ( v );
+	}
+
+	unordered_set < const Variable * > is_changing ( changing.begin(), changing.end() );
+	unordered_set < const Variable * > determined;
+
+	// Adds updates, which depend only on determined variables
+	auto determine = [&] ()
+	{
+		bool progress = true;
+		while ( progress )
+		{
+			progress = false;
+			for ( const Formula * c : conjuncts )
+			{
+				if ( c->type() != Formula::Type::AtomicProposition )
+					continue;
+
+				auto * ap = static_cast < const AtomicProposition * > ( c );
+				if ( ap->aptype() == AtomicProposition::APType::Relation )
+				{
+					auto * r = static_cast < const Relation * > ( ap );
+					if ( r->operation() != RelationOp::eq || !r->type().is_scalar() )
+						continue;
+
+					for ( unsigned int side = 0; side < 2; side++ )
+					{
+						const Term & lhs = side == 0 ? r->term1() : r->term2();
+						const Term & rhs = side == 0 ? r->term2() : r->term1();
+
+						const Variable * v = nullptr;
+						if ( !is_primed_reference ( lhs, v ) || !is_changing.count ( v ) ||
+								determined.count ( v ) || !v->type().is_scalar() )
+							continue;
+
+						unordered_set < const Variable * > primed;
+						primed_variables ( rhs, primed );
+						if ( !subset ( primed, determined ) )
+							continue;
+
+						steps.push_back ( { Step::Kind::Update, v, &rhs, nullptr } );
+						determined.insert ( v );
+						progress = true;
+						break;
+					}
+				}
+				else if ( ap->aptype() == AtomicProposition::APType::ArrayWrite )
+				{
+					auto * aw = static_cast < const ArrayWrite * > ( ap );
+					const Variable * v = aw->array();
+					if ( !is_changing.count ( v ) || determined.count ( v ) )
+						continue;
+
+					const auto & e = layout.entry ( *v );
+					if ( aw->indices_1().size() + 1 != e.dims.size() )
+						throw domain_error ( "Only writes of scalar values to arrays are supported" );
+
+					unordered_set < const Variable * > primed;
+					for ( const auto * terms : { &aw->indices_1(), &aw->indices_2(), &aw->values() } )
+					{
+						for ( const Term * i : *terms )
+							primed_variables ( *i, primed );
+					}
+					if ( !subset ( primed, determined ) )
+						continue;
+
+					steps.push_back ( { Step::Kind::ArrayWrite, v, nullptr, aw } );
+					determined.insert ( v );
+					progress = true;
+				}
+			}
+		}
+	};
+
+	// Undetermined variables become choices one by one,
+	// so that equalities can depend on them.
+	determine();
+	for ( const Variable * v : changing )
+	{
+		if ( determined.count ( v ) )
+			continue;
+
+		steps.push_back ( { Step::Kind::Choice, v, nullptr, nullptr } );
+		determined.insert ( v );
+		determine();
+	}
+}
+
+//------------------------------------//
+// CompiledTransition                 //
+//------------------------------------//
+
+CompiledTransition::CompiledTransition ( const Transition & t, const ValuationLayout & layout ) :
+	CompiledTransition ( t, layout, TransitionPlan ( t, layout ) )
+{
+	;
+}
+
+CompiledTransition::CompiledTransition ( const Transition & t, const ValuationLayout & layout,
+		const TransitionPlan & plan ) :
+	_t     ( t ),
+	_size  ( layout.size() ),
+	_check ( static_cast < const FormulaTransitionRule & > ( t.rule() ).formula(), layout )
+{
+	for ( const Formula * g : plan.guards )
+		_guards.emplace_back ( *g, layout );
+
+	for ( const TransitionPlan::Step & s : plan.steps )
+	{
+		const auto & e = layout.entry ( *s.variable );
+		switch ( s.kind )
+		{
+			case TransitionPlan::Step::Kind::Choice:
+				for ( unsigned int i = 0; i < e.size; i++ )
+					_choices.push_back ( { e.offset + i, width_of ( *s.variable ) } );
+				break;
+
+			case TransitionPlan::Step::Kind::Update:
+				_updates.push_back ( { e.offset, width_mask ( width_of ( *s.variable ) ),
+						CompiledTerm ( *s.term, layout ) } );
+				break;
+
+			case TransitionPlan::Step::Kind::ArrayWrite:
+			{
+				ArrayUpdate u { e.offset, width_mask ( width_of ( *s.variable ) ), e.dims, {}, {}, {} };
+				for ( const Term * i : s.write->indices_1() )
+					u.indices_1.emplace_back ( *i, layout );
+				for ( const Term * i : s.write->indices_2() )
+					u.indices_2.emplace_back ( *i, layout );
+				for ( const Term * i : s.write->values() )
+					u.values.emplace_back ( *i, layout );
+
+				_array_updates.push_back ( std::move ( u ) );
+				break;
+			}
+		}
+	}
+}
+
+bool CompiledTransition::enabled ( const Value * curr, Value tid ) const
+{
+	for ( const CompiledFormula & g : _guards )
+	{
+		if ( !g.evaluate ( curr, curr, tid ) )
+			return false;
+	}
+	return true;
+}
+
+void CompiledTransition::candidate ( const Value * curr, Value * next,
+		const Value * choice, Value tid ) const
+{
+	std::copy ( curr, curr + _size, next );
+
+	for ( unsigned int i = 0; i < _choices.size(); i++ )
+		next [ _choices[i].slot ] = choice[i] & width_mask ( _choices[i].width );
+
+	// Order of updates respects their dependencies,
+	// array writes may depend on all of them.
+	for ( const Update & u : _updates )
+		next [ u.slot ] = u.term.evaluate ( curr, next, tid ) & u.mask;
+
+	for ( const ArrayUpdate & u : _array_updates )
+	{
+		Value offset = 0;
+		for ( unsigned int i = 0; i < u.indices_1.size(); i++ )
+		{
+			Value idx = u.indices_1[i].evaluate ( curr, next, tid );
+			if ( idx < 0 || idx >= u.dims[i] )
+				throw out_of_range ( "Array index out of bounds" );
+			offset = offset * u.dims[i] + idx;
+		}
+
+		const unsigned int block = u.dims.back();
+		offset *= block;
+		for ( unsigned int j = 0; j < u.indices_2.size(); j++ )
+		{
+			Value idx = u.indices_2[j].evaluate ( curr, next, tid );
+			if ( idx < 0 || idx >= block )
+				throw out_of_range ( "Array index out of bounds" );
+			next [ u.slot + offset + idx ] = u.values[j].evaluate ( curr, next, tid ) & u.mask;
+		}
+	}
+}
+
+CompiledTransition::BatchMask CompiledTransition::enabled_batch ( const Value * curr,
+		Value tid ) const
+{
+	BatchMask m = ~ BatchMask ( 0 );
+	for ( const CompiledFormula & g : _guards )
+	{
+		m &= g.evaluate_batch ( curr, curr, tid );
+		if ( m == 0 )
+			break;
+	}
+	return m;
+}
+
+void CompiledTransition::candidate_batch ( const Value * curr, Value * next,
+		const Value * choice, BatchMask & valid, Value tid ) const
+{
+	const unsigned int B = CompiledExpression::batch_size;
+	auto row = [B] ( Value * v, unsigned int slot ) { return v + (std::size_t) slot * B; };
+
+	std::copy ( curr, curr + (std::size_t) _size * B, next );
+
+	for ( unsigned int i = 0; i < _choices.size(); i++ )
+	{
+		const Value mask = width_mask ( _choices[i].width );
+		const Value * c = choice + (std::size_t) i * B;
+		Value * x = row ( next, _choices[i].slot );
+		for ( unsigned int l = 0; l < B; l++ )
+			x[l] = c[l] & mask;
+	}
+
+	Value tmp [ B ];
+	for ( const Update & u : _updates )
+	{
+		u.term.evaluate_batch ( curr, next, tmp, valid, tid );
+		Value * x = row ( next, u.slot );
+		for ( unsigned int l = 0; l < B; l++ )
+			x[l] = tmp[l] & u.mask;
+	}
+
+	Value offset [ B ];
+	Value val [ B ];
+	for ( const ArrayUpdate & u : _array_updates )
+	{
+		std::fill ( offset, offset + B, 0 );
+		for ( unsigned int i = 0; i < u.indices_1.size(); i++ )
+		{
+			u.indices_1[i].evaluate_batch ( curr, next, tmp, valid, tid );
+			for ( unsigned int l = 0; l < B; l++ )
+			{
+				const bool out = tmp[l] < 0 || tmp[l] >= u.dims[i];
+				if ( out )
+					valid &= ~ ( BatchMask ( 1 ) << l );
+				offset[l] = offset[l] * u.dims[i] + ( out ? 0 : tmp[l] );
+			}
+		}
+
+		const unsigned int block = u.dims.back();
+		for ( unsigned int j = 0; j < u.indices_2.size(); j++ )
+		{
+			u.indices_2[j].evaluate_batch ( curr, next, tmp, valid, tid );
+			u.values[j].evaluate_batch ( curr, next, val, valid, tid );
+			for ( unsigned int l = 0; l < B; l++ )
+			{
+				if ( tmp[l] < 0 || tmp[l] >= block )
+				{
+					valid &= ~ ( BatchMask ( 1 ) << l );
+					continue;
+				}
+				row ( next, u.slot + offset[l] * block + tmp[l] ) [l] = val[l] & u.mask;
+			}
+		}
+	}
+}
+
+} // namespace nts
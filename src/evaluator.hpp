@@ -0,0 +1,332 @@
+#ifndef NTS_EVALUATOR_HPP_
+#define NTS_EVALUATOR_HPP_
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+#include "data_types.hpp"
+#include "logic.hpp"
+#include "nts.hpp"
+
+namespace nts
+{
+
+using Value = std::int64_t;
+using Valuation = std::vector < Value >;
+
+/**
+ * @brief Assigns positions (slots) in a flat valuation to variables.
+ * Scalar variable takes one slot, array of constant size takes
+ * one slot per element (in row-major order).
+ *
+ * Int is represented by 64-bit signed integer. BitVector<N>
+ * (N <= 64) is represented by an unsigned number in range [0, 2^N),
+ * Bool is BitVector<1>.
+ */
+class ValuationLayout
+{
+	public:
+		struct Entry
+		{
+			unsigned int offset;
+			// Number of slots
+			unsigned int size;
+			// Sizes of array dimensions, empty for scalars
+			std::vector < unsigned int > dims;
+		};
+
+	private:
+		std::unordered_map < const Variable *, Entry > _entries;
+		std::vector < const Variable * > _vars;
+		unsigned int _size;
+
+	public:
+		ValuationLayout();
+
+		// Variables visible from given BasicNts
+		// (global variables, in/out parameters and local variables)
+		explicit ValuationLayout ( const BasicNts & bn );
+
+		// Throws std::domain_error, if array size is not constant
+		void add ( const Variable & v );
+
+		bool contains ( const Variable & v ) const;
+		// Throws std::logic_error, if variable is not in the layout
+		const Entry & entry ( const Variable & v ) const;
+
+		const std::vector < const Variable * > & variables() const { return _vars; }
+		unsigned int size() const { return _size; }
+};
+
+/**
+ * @brief Common part of compiled formulas and terms.
+ * Expression is compiled once into a compact bytecode for a stack machine,
+ * which is then interpreted. Compiled expression is immutable,
+ * so it can be evaluated from more threads at once.
+ *
+ * Batch evaluation interprets a branch-free variant of the code
+ * over batch_size valuations at once. Valuations of a batch are stored
+ * as structure of arrays: slot s of valuation l is at [s * batch_size + l].
+ * Each instruction is then a simple loop over the batch.
+ */
+class CompiledExpression
+{
+	public:
+		enum class Op : std::uint8_t;
+
+		static const unsigned int batch_size = 64;
+		// One bit per valuation of a batch
+		using BatchMask = std::uint64_t;
+
+		struct Instruction
+		{
+			Op           op;
+			std::int32_t a;
+			std::int64_t b;
+		};
+
+		// a'[i_1]..[i_k][j_1, .., j_m] = [v_1, .., v_m]
+		struct ArrayWriteInfo
+		{
+			unsigned int slot;
+			unsigned int size;
+			// Size of block addressed by i_1 .. i_k
+			unsigned int block;
+			unsigned int n_writes;
+		};
+
+		// Bounded quantification over one variable
+		struct QuantifierInfo
+		{
+			unsigned int local;
+			bool         forall;
+			unsigned int from;
+			unsigned int to;
+			unsigned int body;
+			unsigned int end;
+		};
+
+	protected:
+		std::vector < Instruction > _code;
+
+		// Ranges of slots, which should not change
+		std::vector < std::vector < std::pair < unsigned int, unsigned int > > > _frames;
+		std::vector < ArrayWriteInfo > _array_writes;
+		std::vector < QuantifierInfo > _quantifiers;
+
+		unsigned int _max_stack;
+		unsigned int _n_locals;
+
+		// Code without jumps for batch evaluation. Empty for quantified
+		// formulas, which are evaluated valuation by valuation.
+		std::vector < Instruction > _batch_code;
+		unsigned int _batch_max_stack;
+		unsigned int _n_slots;
+
+		friend class ExpressionCompiler;
+
+		CompiledExpression();
+
+		Value run ( const Value * curr, const Value * next, Value tid ) const;
+
+		// Results of valuations, whose evaluation fails, are cleared in 'valid'
+		void run_batch ( const Value * curr, const Value * next, Value tid,
+				Value * result, BatchMask & valid ) const;
+
+		void exec_batch ( const Value * curr, const Value * next, Value tid,
+				Value * sp, Value * result, BatchMask & valid ) const;
+
+		// Executes code starting at 'pc' until Ret, using stack above 'sp'
+		Value exec ( unsigned int pc, Value * sp, Value * locals,
+				const Value * curr, const Value * next, Value tid ) const;
+
+	public:
+		// Number of instructions
+		unsigned int size() const { return _code.size(); }
+};
+
+/**
+ * @brief Formula compiled for evaluation on concrete values.
+ *
+ * Formula is evaluated over two valuations (see ValuationLayout),
+ * one for unprimed and one for primed variables.
+ * Havoc requires variables of the layout, which are not havocked,
+ * to keep their values. Quantifiers must be bounded
+ * (or range over bitvectors of width at most 16).
+ *
+ * Evaluation throws std::out_of_range when an array is accessed
+ * out of its bounds and std::domain_error on integer division by zero.
+ * Integer division is Euclidean, division on bitvectors
+ * follows SMT-LIB (x / 0 = 2^N - 1, x % 0 = x).
+ */
+class CompiledFormula : public CompiledExpression
+{
+	public:
+		CompiledFormula ( const Formula & f, const ValuationLayout & layout );
+
+		bool evaluate ( const Value * curr, const Value * next, Value tid = 0 ) const
+		{
+			return run ( curr, next, tid ) != 0;
+		}
+
+		bool evaluate ( const Valuation & curr, const Valuation & next, Value tid = 0 ) const
+		{
+			return evaluate ( curr.data(), next.data(), tid );
+		}
+
+		// Valuations of the batch satisfying the formula. Failed evaluation
+		// (out of bounds access, division by zero) counts as false.
+		BatchMask evaluate_batch ( const Value * curr, const Value * next, Value tid = 0 ) const;
+};
+
+// Scalar term compiled for evaluation, see CompiledFormula
+class CompiledTerm : public CompiledExpression
+{
+	public:
+		CompiledTerm ( const Term & t, const ValuationLayout & layout );
+
+		Value evaluate ( const Value * curr, const Value * next, Value tid = 0 ) const
+		{
+			return run ( curr, next, tid );
+		}
+
+		Value evaluate ( const Valuation & curr, const Valuation & next, Value tid = 0 ) const
+		{
+			return evaluate ( curr.data(), next.data(), tid );
+		}
+
+		// Valuations of the batch, whose evaluation fails, are cleared in 'valid'
+		void evaluate_batch ( const Value * curr, const Value * next,
+				Value * result, BatchMask & valid, Value tid = 0 ) const
+		{
+			run_batch ( curr, next, tid, result, valid );
+		}
+};
+
+/**
+ * @brief Order in which successors of a formula transition are computed.
+ *
+ * Variables which may change (havocked ones, or all variables of the layout,
+ * if there is no havoc) are either computed from top-level equalities
+ * x' = t and array writes, or are free choices. Steps are ordered so that
+ * each one depends only on the current valuation and preceding steps.
+ */
+class TransitionPlan
+{
+	public:
+		struct Step
+		{
+			enum class Kind { Choice, Update, ArrayWrite };
+
+			Kind kind;
+			const Variable * variable;
+			// Right-hand side of x' = t
+			const Term * term;
+			const ArrayWrite * write;
+		};
+
+		// Top-level conjuncts of the formula
+		std::vector < const Formula * > conjuncts;
+		// Conjuncts without primed variables and havoc
+		std::vector < const Formula * > guards;
+		// Variables which may change
+		std::vector < const Variable * > changing;
+		std::vector < Step > steps;
+
+		// Throws std::domain_error for call transitions
+		TransitionPlan ( const Transition & t, const ValuationLayout & layout );
+};
+
+/**
+ * @brief Formula transition prepared for computing successors
+ * of concrete valuations (see TransitionPlan).
+ *
+ * A candidate successor is given by values of the choices;
+ * it is a real successor if it satisfies the formula (see check()).
+ */
+class CompiledTransition
+{
+	public:
+		struct Update
+		{
+			unsigned int slot;
+			Value        mask;
+			CompiledTerm term;
+		};
+
+		struct ArrayUpdate
+		{
+			unsigned int slot;
+			Value        mask;
+			std::vector < unsigned int > dims;
+			std::vector < CompiledTerm > indices_1;
+			std::vector < CompiledTerm > indices_2;
+			std::vector < CompiledTerm > values;
+		};
+
+		// Free value of one slot
+		struct Choice
+		{
+			unsigned int slot;
+			// 0 for Int
+			unsigned int width;
+		};
+
+	private:
+		const Transition & _t;
+		unsigned int _size;
+
+		// Conjuncts without primed variables
+		std::vector < CompiledFormula > _guards;
+		std::vector < Choice > _choices;
+		std::vector < Update > _updates;
+		std::vector < ArrayUpdate > _array_updates;
+		CompiledFormula _check;
+
+	public:
+		// Throws std::domain_error for call transitions
+		CompiledTransition ( const Transition & t, const ValuationLayout & layout );
+		CompiledTransition ( const Transition & t, const ValuationLayout & layout,
+				const TransitionPlan & plan );
+
+		const Transition & transition() const { return _t; }
+		const std::vector < Choice > & choices() const { return _choices; }
+
+		// Cheap necessary condition on the current valuation
+		bool enabled ( const Value * curr, Value tid = 0 ) const;
+
+		/**
+		 * @brief Fills 'next' with a candidate successor of 'curr'.
+		 * @param choice Value for each of choices()
+		 * Throws as CompiledFormula does on invalid operations.
+		 */
+		void candidate ( const Value * curr, Value * next,
+				const Value * choice, Value tid = 0 ) const;
+
+		// Is 'next' a successor of 'curr'?
+		bool check ( const Value * curr, const Value * next, Value tid = 0 ) const
+		{
+			return _check.evaluate ( curr, next, tid );
+		}
+
+		// Batch variants, see CompiledExpression. Choices are stored
+		// as structure of arrays too. Candidates, which can not be
+		// computed, are cleared in 'valid'.
+		using BatchMask = CompiledExpression::BatchMask;
+
+		BatchMask enabled_batch ( const Value * curr, Value tid = 0 ) const;
+
+		void candidate_batch ( const Value * curr, Value * next,
+				const Value * choice, BatchMask & valid, Value tid = 0 ) const;
+
+		BatchMask check_batch ( const Value * curr, const Value * next, Value tid = 0 ) const
+		{
+			return _check.evaluate_batch ( curr, next, tid );
+		}
+};
+
+} // namespace nts
+
+#endif // NTS_EVALUATOR_HPP_
@@ -219,8 +219,11 @@ void visit_variable_uses::visit ( QuantifiedFormula & qf ) const
 	Term * from = qf.list.qtype().from();
 	Term * to   = qf.list.qtype().to();
 
-	visit ( *from );
-	visit ( *to   );
+	if ( from )
+		visit ( *from );
+
+	if ( to )
+		visit ( *to );
 
 	for ( Term * t : qf.list.qtype().type().idx_terms() )
 	{
@@ -234,7 +237,6 @@ void visit_variable_uses::visit ( QuantifiedFormula & qf ) const
 			visit ( *t );
 		}
 	}
-	throw logic_error ( "Not implemented" );
 }
 
 /**
@@ -0,0 +1,767 @@
+#include <memory>
+#include <vector>
+#include <set>
+#include <string>
+#include <sstream>
+#include <limits>
+#include <algorithm>  // min(), max()
+#include <utility>    // move()
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "conjuncts.hpp"
+#include "cfg.hpp"
+#include "decomposition.hpp"
+#include "intervals.hpp"
+
+using std::unique_ptr;
+using std::make_unique;
+using std::vector;
+using std::set;
+using std::string;
+using std::ostream;
+using std::ostringstream;
+using std::numeric_limits;
+using std::min;
+using std::max;
+using std::move;
+
+namespace nts
+{
+
+const long long Interval::minus_inf = numeric_limits < long long >::min();
+const long long Interval::plus_inf  = numeric_limits < long long >::max();
+
+ostream & operator<< ( ostream & o, const Interval & i )
+{
+	if ( i.empty() )
+		return o << "[]";
+
+	o << "[";
+	if ( i.lo == Interval::minus_inf )
+		o << "-inf";
+	else
+		o << i.lo;
+	o << ", ";
+	if ( i.hi == Interval::plus_inf )
+		o << "+inf";
+	else
+		o << i.hi;
+	return o << "]";
+}
+
+namespace
+{
+
+using p_Formula = unique_ptr < Formula >;
+using Bound = long long;
+
+const Bound NEG = Interval::minus_inf;
+const Bound POS = Interval::plus_inf;
+
+const Interval empty_interval { POS, NEG };
+
+// Saturating arithmetic of bounds
+
+Bound neg ( Bound a )
+{
+	if ( a == NEG ) return POS;
+	if ( a == POS ) return NEG;
+	return -a;
+}
+
+Bound add ( Bound a, Bound b )
+{
+	if ( a == NEG || b == NEG ) return NEG;
+	if ( a == POS || b == POS ) return POS;
+
+	Bound r;
+	if ( __builtin_add_overflow ( a, b, &r ) )
+		return a > 0 ? POS : NEG;
+	return r;
+}
+
+Bound mul ( Bound a, Bound b )
+{
+	if ( a == 0 || b == 0 )
+		return 0;
+
+	const bool negative = ( a < 0 ) != ( b < 0 );
+	if ( a == NEG || a == POS || b == NEG || b == POS )
+		return negative ? NEG : POS;
+
+	Bound r;
+	if ( __builtin_mul_overflow ( a, b, &r ) )
+		return negative ? NEG : POS;
+	return r;
+}
+
+// Euclidean division (the remainder is never negative), b != 0
+Bound div ( Bound a, Bound b )
+{
+	const bool negative = ( a < 0 ) != ( b < 0 );
+	if ( a == NEG || a == POS )
+		return negative ? NEG : POS;
+
+	// Quotient tends to -0 or +0, rounded down for b > 0 and up for b < 0
+	if ( b == NEG || b == POS )
+		return a >= 0 ? 0 : ( b == POS ? -1 : 1 );
+
+	Bound q = a / b;
+	if ( a % b < 0 )
+		q = b > 0 ? q - 1 : q + 1;
+	return q;
+}
+
+Interval join ( const Interval & a, const Interval & b )
+{
+	if ( a.empty() ) return b;
+	if ( b.empty() ) return a;
+	return Interval { min ( a.lo, b.lo ), max ( a.hi, b.hi ) };
+}
+
+Interval meet ( const Interval & a, const Interval & b )
+{
+	return Interval { max ( a.lo, b.lo ), min ( a.hi, b.hi ) };
+}
+
+Interval widen ( const Interval & a, const Interval & b )
+{
+	if ( a.empty() ) return b;
+	if ( b.empty() ) return a;
+	return Interval { b.lo < a.lo ? NEG : a.lo, b.hi > a.hi ? POS : a.hi };
+}
+
+Interval operator+ ( const Interval & a, const Interval & b )
+{
+	return Interval { add ( a.lo, b.lo ), add ( a.hi, b.hi ) };
+}
+
+Interval operator- ( const Interval & a )
+{
+	return Interval { neg ( a.hi ), neg ( a.lo ) };
+}
+
+template < typename Op >
+Interval corners ( const Interval & a, const Interval & b, Op op )
+{
+	const Bound c[] = { op ( a.lo, b.lo ), op ( a.lo, b.hi ), op ( a.hi, b.lo ), op ( a.hi, b.hi ) };
+	return Interval { *std::min_element ( c, c + 4 ), *std::max_element ( c, c + 4 ) };
+}
+
+bool contains ( const Interval & i, Bound b )
+{
+	return i.lo <= b && b <= i.hi;
+}
+
+Interval arithmetic ( ArithOp op, const Interval & a, const Interval & b )
+{
+	switch ( op )
+	{
+		case ArithOp::Add:
+			return a + b;
+
+		case ArithOp::Sub:
+			return a + ( -b );
+
+		case ArithOp::Mul:
+			return corners ( a, b, mul );
+
+		case ArithOp::Div:
+			if ( contains ( b, 0 ) )
+				return Interval::top();
+			return corners ( a, b, div );
+
+		case ArithOp::Mod:
+		{
+			// Euclidean remainder is in [0, |b| - 1]
+			if ( contains ( b, 0 ) )
+				return Interval::top();
+
+			const Bound m = b.lo > 0 ? b.hi : neg ( b.lo );
+			const Bound hi = m == POS ? POS : m - 1;
+			if ( a.lo >= 0 )
+				return Interval { 0, min ( a.hi, hi ) };
+			return Interval { 0, hi };
+		}
+	}
+
+	return Interval::top();
+}
+
+RelationOp negated ( RelationOp op )
+{
+	switch ( op )
+	{
+		case RelationOp::eq:  return RelationOp::neq;
+		case RelationOp::neq: return RelationOp::eq;
+		case RelationOp::lt:  return RelationOp::geq;
+		case RelationOp::leq: return RelationOp::gt;
+		case RelationOp::gt:  return RelationOp::leq;
+		case RelationOp::geq: return RelationOp::lt;
+	}
+
+	return op;
+}
+
+RelationOp mirrored ( RelationOp op )
+{
+	switch ( op )
+	{
+		case RelationOp::lt:  return RelationOp::gt;
+		case RelationOp::leq: return RelationOp::geq;
+		case RelationOp::gt:  return RelationOp::lt;
+		case RelationOp::geq: return RelationOp::leq;
+		default:              return op;
+	}
+}
+
+// Values of x satisfying x op b, for some value of b
+Interval satisfying ( RelationOp op, const Interval & b )
+{
+	switch ( op )
+	{
+		case RelationOp::eq:  return b;
+		case RelationOp::neq: return Interval::top();
+		case RelationOp::lt:  return Interval { NEG, add ( b.hi, -1 ) };
+		case RelationOp::leq: return Interval { NEG, b.hi };
+		case RelationOp::gt:  return Interval { add ( b.lo, 1 ), POS };
+		case RelationOp::geq: return Interval { b.lo, POS };
+	}
+
+	return Interval::top();
+}
+
+const VariableReference * variable_reference ( const Term & t )
+{
+	if ( t.term_type() != Term::TermType::Leaf ||
+			static_cast < const Leaf & > ( t ).leaf_type() !=
+				Leaf::LeafType::VariableReference )
+		return nullptr;
+
+	return & static_cast < const VariableReference & > ( t );
+}
+
+} // anonymous namespace
+
+//------------------------------------//
+// Refiner                            //
+//------------------------------------//
+
+/**
+ * Intervals of current and next values of tracked variables
+ * during interpretation of one transition. Next values of variables,
+ * which are not changed by the transition, are the current ones.
+ */
+class IntervalAnalysis::Refiner
+{
+	private:
+		const IntervalAnalysis & _a;
+
+	public:
+		vector < Interval > curr;
+		vector < Interval > next;
+		vector < bool >     changed;
+
+		Refiner ( const IntervalAnalysis & a, const Values & pre ) :
+			_a      ( a                                   ),
+			curr    ( pre.of                              ),
+			next    ( pre.of                              ),
+			changed ( pre.of.size(), false                )
+		{ ; }
+
+		Interval * slot ( const VariableReference & vr )
+		{
+			auto it = _a._var_id.find ( vr.variable().get() );
+			if ( it == _a._var_id.end() )
+				return nullptr;
+
+			const unsigned int v = it->second;
+			return vr.primed() && changed[v] ? &next[v] : &curr[v];
+		}
+
+		// ctx is the range of the sort, in which the term is evaluated
+		Interval eval ( const Term & t, const Interval & ctx );
+		bool relation ( RelationOp op, const Term & t1, const Term & t2 );
+		bool formula ( const Formula & f );
+};
+
+Interval IntervalAnalysis::Refiner::eval ( const Term & t, const Interval & ctx )
+{
+	Interval result = Interval::top();
+
+	switch ( t.term_type() )
+	{
+		case Term::TermType::Leaf:
+		{
+			auto & l = static_cast < const Leaf & > ( t );
+			if ( l.leaf_type() == Leaf::LeafType::IntConstant )
+			{
+				const int c = static_cast < const IntConstant & > ( l ).value();
+				result = Interval { c, c };
+				break;
+			}
+
+			if ( l.leaf_type() == Leaf::LeafType::BoolConstant )
+			{
+				const int c = static_cast < const BoolConstant & > ( l ).value();
+				return Interval { c, c };
+			}
+
+			if ( const VariableReference * vr = variable_reference ( t ) )
+			{
+				if ( Interval * i = slot ( *vr ) )
+					return *i;
+			}
+
+			result = _a.range ( t.type() );
+			break;
+		}
+
+		case Term::TermType::MinusTerm:
+			result = - eval ( static_cast < const MinusTerm & > ( t ).term(), ctx );
+			break;
+
+		case Term::TermType::ArithmeticOperation:
+		{
+			auto & aop = static_cast < const ArithmeticOperation & > ( t );
+			const Interval a = eval ( aop.term1(), ctx );
+			const Interval b = eval ( aop.term2(), ctx );
+			if ( a.empty() || b.empty() )
+				return empty_interval;
+
+			result = arithmetic ( aop.operation(), a, b );
+			break;
+		}
+
+		case Term::TermType::ArrayTerm:
+			return _a.range ( t.type() );
+	}
+
+	// Bitvectors wrap around. Integral terms (like constants) take
+	// the sort of their context.
+	Interval r = _a.range ( t.type() );
+	if ( r.lo == NEG && r.hi == POS )
+		r = ctx;
+
+	if ( result.lo < r.lo || result.hi > r.hi )
+		return r;
+
+	return result;
+}
+
+bool IntervalAnalysis::Refiner::relation ( RelationOp op, const Term & t1, const Term & t2 )
+{
+	DataType sort;
+	const Interval ctx = coerce ( t1.type(), t2.type(), sort ) ? _a.range ( sort ) : Interval::top();
+	const Interval a = eval ( t1, ctx );
+	const Interval b = eval ( t2, ctx );
+	if ( a.empty() || b.empty() )
+		return false;
+
+	// Is there a pair of values satisfying the relation?
+	if ( op == RelationOp::neq )
+	{
+		if ( a.lo == a.hi && b.lo == b.hi && a.lo == b.lo )
+			return false;
+	}
+	else if ( meet ( a, satisfying ( op, b ) ).empty() )
+	{
+		return false;
+	}
+
+	const VariableReference * v1 = variable_reference ( t1 );
+	const VariableReference * v2 = variable_reference ( t2 );
+	Interval * s1 = v1 ? slot ( *v1 ) : nullptr;
+	Interval * s2 = v2 ? slot ( *v2 ) : nullptr;
+
+	if ( s1 )
+		*s1 = meet ( *s1, satisfying ( op, b ) );
+	if ( s2 )
+		*s2 = meet ( *s2, satisfying ( mirrored ( op ), a ) );
+
+	// Excluded constant at a bound
+	if ( op == RelationOp::neq )
+	{
+		if ( s1 && b.lo == b.hi && !s1->empty() )
+		{
+			if ( s1->lo == b.lo ) s1->lo++;
+			else if ( s1->hi == b.lo ) s1->hi--;
+		}
+		if ( s2 && a.lo == a.hi && !s2->empty() )
+		{
+			if ( s2->lo == a.lo ) s2->lo++;
+			else if ( s2->hi == a.lo ) s2->hi--;
+		}
+	}
+
+	return !( s1 && s1->empty() ) && !( s2 && s2->empty() );
+}
+
+bool IntervalAnalysis::Refiner::formula ( const Formula & f )
+{
+	switch ( f.type() )
+	{
+		case Formula::Type::FormulaBop:
+		{
+			auto & fb = static_cast < const FormulaBop & > ( f );
+			if ( fb.op() == BoolOp::And )
+				return formula ( fb.formula_1() ) && formula ( fb.formula_2() );
+
+			if ( fb.op() != BoolOp::Or )
+				return true;
+
+			// Join of both branches
+			Refiner left ( *this );
+			Refiner right ( *this );
+			const bool l = left.formula ( fb.formula_1() );
+			const bool r = right.formula ( fb.formula_2() );
+			if ( !l && !r )
+				return false;
+
+			for ( unsigned int v = 0; v < curr.size(); v++ )
+			{
+				curr[v] = join ( l ? left.curr[v] : empty_interval, r ? right.curr[v] : empty_interval );
+				next[v] = join ( l ? left.next[v] : empty_interval, r ? right.next[v] : empty_interval );
+			}
+			return true;
+		}
+
+		case Formula::Type::FormulaNot:
+		{
+			const Formula & g = static_cast < const FormulaNot & > ( f ).formula();
+			if ( g.type() == Formula::Type::FormulaNot )
+				return formula ( static_cast < const FormulaNot & > ( g ).formula() );
+
+			if ( g.type() == Formula::Type::AtomicProposition &&
+					static_cast < const AtomicProposition & > ( g ).aptype() ==
+						AtomicProposition::APType::Relation )
+			{
+				auto & r = static_cast < const Relation & > ( g );
+				return relation ( negated ( r.operation() ), r.term1(), r.term2() );
+			}
+			return true;
+		}
+
+		case Formula::Type::AtomicProposition:
+		{
+			auto & ap = static_cast < const AtomicProposition & > ( f );
+			if ( ap.aptype() == AtomicProposition::APType::Relation )
+			{
+				auto & r = static_cast < const Relation & > ( ap );
+				return relation ( r.operation(), r.term1(), r.term2() );
+			}
+
+			if ( ap.aptype() == AtomicProposition::APType::BooleanTerm )
+			{
+				const Interval i = eval ( static_cast < const BooleanTerm & > ( ap ).term(),
+						Interval::top() );
+				return i.hi != 0;
+			}
+			return true;
+		}
+
+		case Formula::Type::QuantifiedFormula:
+			return true;
+	}
+
+	return true;
+}
+
+//------------------------------------//
+// IntervalAnalysis                   //
+//------------------------------------//
+
+IntervalAnalysis::IntervalAnalysis ( const BasicNts & bn, unsigned int widening_delay )
+{
+	for ( const VariableContainer * c : { &bn.params_in(), &bn.params_out(), &bn.variables() } )
+	{
+		for ( const Variable * v : *c )
+		{
+			const DataType & t = v->type();
+			if ( !t.is_scalar() || !( t.scalar_type() == ScalarType::Integer() ||
+						t.scalar_type().is_bitvector() ) )
+				continue;
+
+			_var_id.emplace ( v, _vars.size() );
+			_vars.push_back ( v );
+			_range.push_back ( range ( t ) );
+		}
+	}
+
+	solve ( bn, widening_delay );
+}
+
+Interval IntervalAnalysis::range ( const DataType & t ) const
+{
+	if ( !t.is_scalar() || !t.scalar_type().is_bitvector() )
+		return Interval::top();
+
+	const unsigned int w = t.scalar_type().bitwidth();
+	if ( w >= 63 )
+		return Interval { 0, POS };
+	return Interval { 0, ( 1LL << w ) - 1 };
+}
+
+IntervalAnalysis::Values IntervalAnalysis::top() const
+{
+	return Values { true, _range };
+}
+
+IntervalAnalysis::Values IntervalAnalysis::post ( const Transition & t, const Values & pre ) const
+{
+	if ( !pre.reachable )
+		return pre;
+
+	Refiner r ( *this, pre );
+
+	if ( t.rule().kind() == TransitionRule::Kind::Call )
+	{
+		for ( const VariableUse & u : static_cast < const CallTransitionRule & > ( t.rule() ).variables_out() )
+		{
+			auto it = _var_id.find ( u.get() );
+			if ( it != _var_id.end() )
+				r.curr [ it->second ] = _range [ it->second ];
+		}
+		return Values { true, move ( r.curr ) };
+	}
+
+	auto & rule = static_cast < const FormulaTransitionRule & > ( t.rule() );
+	const Formula & f = rule.formula();
+	const RuleDecomposition & d = rule.decomposition();
+
+	for ( unsigned int v = 0; v < _vars.size(); v++ )
+	{
+		r.changed[v] = d.changes ( *_vars[v] );
+		if ( r.changed[v] )
+			r.next[v] = _range[v];
+	}
+
+	// Refinements propagate between conjuncts
+	for ( unsigned int i = 0; i < 2; i++ )
+	{
+		if ( !r.formula ( f ) )
+			return Values { false, { } };
+	}
+
+	Values result { true, move ( r.curr ) };
+	for ( unsigned int v = 0; v < _vars.size(); v++ )
+	{
+		if ( r.changed[v] )
+			result.of[v] = r.next[v];
+		if ( result.of[v].empty() )
+			return Values { false, { } };
+	}
+
+	return result;
+}
+
+// Join of posts of incoming transitions (and top, if the state is initial)
+IntervalAnalysis::Values IntervalAnalysis::incoming ( const State & s ) const
+{
+	Values result = s.is_initial() ? top() :
+		Values { false, vector < Interval > ( _vars.size(), empty_interval ) };
+
+	for ( const Transition * t : s.incoming() )
+	{
+		auto it = _values.find ( &t->from() );
+		if ( it == _values.end() || !it->second.reachable )
+			continue;
+
+		Values p = post ( *t, it->second );
+		if ( !p.reachable )
+			continue;
+
+		result.reachable = true;
+		for ( unsigned int v = 0; v < _vars.size(); v++ )
+			result.of[v] = join ( result.of[v], p.of[v] );
+	}
+
+	return result;
+}
+
+void IntervalAnalysis::solve ( const BasicNts & bn, unsigned int widening_delay )
+{
+	const ControlFlow & cfg = bn.cfg();
+	const auto & order = cfg.reverse_postorder();
+
+	for ( const State * s : bn.states() )
+		_values [ s ] = Values { false, vector < Interval > ( _vars.size(), empty_interval ) };
+
+	// Ascending iteration, states in reverse postorder
+	set < int > work;
+	vector < unsigned int > updates ( order.size(), 0 );
+	for ( const State * s : order )
+	{
+		if ( s->is_initial() )
+			work.insert ( cfg.rpo_index ( *s ) );
+	}
+
+	while ( !work.empty() )
+	{
+		const int i = *work.begin();
+		work.erase ( work.begin() );
+		const State & s = *order [ i ];
+
+		Values & old = _values [ &s ];
+		Values now = incoming ( s );
+		if ( cfg.is_loop_head ( s ) && updates [ i ]++ >= widening_delay )
+		{
+			for ( unsigned int v = 0; v < _vars.size(); v++ )
+				now.of[v] = widen ( old.of[v], join ( old.of[v], now.of[v] ) );
+		}
+
+		if ( now.reachable == old.reachable && now.of == old.of )
+			continue;
+
+		old = move ( now );
+		for ( const Transition * t : s.outgoing() )
+			work.insert ( cfg.rpo_index ( t->to() ) );
+	}
+
+	// Descending iterations keep a post-fixpoint
+	for ( unsigned int round = 0; round < 2; round++ )
+	{
+		for ( const State * s : order )
+			_values [ s ] = incoming ( *s );
+	}
+}
+
+bool IntervalAnalysis::reachable ( const State & s ) const
+{
+	auto it = _values.find ( &s );
+	return it != _values.end() && it->second.reachable;
+}
+
+Interval IntervalAnalysis::bounds ( const State & s, const Variable & v ) const
+{
+	if ( !reachable ( s ) )
+		return empty_interval;
+
+	auto it = _var_id.find ( &v );
+	if ( it == _var_id.end() )
+		return range ( v.type() );
+
+	return _values.at ( &s ).of [ it->second ];
+}
+
+unique_ptr < Formula > IntervalAnalysis::invariant ( const State & s ) const
+{
+	if ( !reachable ( s ) )
+		return truth ( false );
+
+	auto ref = [] ( const Variable & v )
+	{
+		return make_unique < VariableReference > ( const_cast < Variable & > ( v ), false );
+	};
+
+	auto representable = [] ( Bound b )
+	{
+		return b >= numeric_limits < int >::min() && b <= numeric_limits < int >::max();
+	};
+
+	vector < p_Formula > parts;
+	const Values & values = _values.at ( &s );
+	for ( unsigned int v = 0; v < _vars.size(); v++ )
+	{
+		const Interval & i = values.of[v];
+		const Interval & r = _range[v];
+		const Variable & var = *_vars[v];
+
+		if ( i.lo == i.hi && representable ( i.lo ) )
+		{
+			parts.push_back ( make_unique < Relation > ( RelationOp::eq,
+						ref ( var ), make_unique < IntConstant > ( i.lo ) ) );
+			continue;
+		}
+
+		if ( i.lo != r.lo && representable ( i.lo ) )
+			parts.push_back ( make_unique < Relation > ( RelationOp::geq,
+						ref ( var ), make_unique < IntConstant > ( i.lo ) ) );
+		if ( i.hi != r.hi && representable ( i.hi ) )
+			parts.push_back ( make_unique < Relation > ( RelationOp::leq,
+						ref ( var ), make_unique < IntConstant > ( i.hi ) ) );
+	}
+
+	if ( parts.empty() )
+		return truth ( true );
+
+	p_Formula result = move ( parts[0] );
+	for ( unsigned int i = 1; i < parts.size(); i++ )
+		result = make_unique < FormulaBop > ( BoolOp::And, move ( result ), move ( parts[i] ) );
+
+	return result;
+}
+
+bool IntervalAnalysis::feasible ( const Transition & t ) const
+{
+	auto it = _values.find ( &t.from() );
+	return it != _values.end() && post ( t, it->second ).reachable;
+}
+
+//------------------------------------//
+// Export                             //
+//------------------------------------//
+
+void annotate_invariants ( BasicNts & bn )
+{
+	IntervalAnalysis a ( bn );
+	for ( State * s : bn.states() )
+	{
+		ostringstream o;
+		o << *a.invariant ( *s );
+
+		AnnotString * as = nullptr;
+		for ( Annotation * an : s->annotations )
+		{
+			if ( an->type() == Annotation::Type::String && an->name == "invariant" )
+				as = static_cast < AnnotString * > ( an );
+		}
+
+		if ( as )
+		{
+			as->value = o.str();
+			continue;
+		}
+
+		as = new AnnotString ( "invariant", o.str() );
+		as->insert_to ( s->annotations );
+	}
+}
+
+unsigned int strengthen_guards ( BasicNts & bn )
+{
+	IntervalAnalysis a ( bn );
+
+	vector < Transition * > infeasible;
+	for ( Transition * t : bn.transitions() )
+	{
+		if ( !a.feasible ( *t ) )
+		{
+			infeasible.push_back ( t );
+			continue;
+		}
+
+		if ( t->rule().kind() != TransitionRule::Kind::Formula )
+			continue;
+
+		p_Formula inv = a.invariant ( t->from() );
+		if ( inv->type() == Formula::Type::AtomicProposition &&
+				static_cast < const AtomicProposition & > ( *inv ).aptype() ==
+					AtomicProposition::APType::BooleanTerm )
+			continue;
+
+		static_cast < FormulaTransitionRule & > ( t->rule() ).transform_formula (
+				[&] ( p_Formula f )
+		{
+			return make_unique < FormulaBop > ( BoolOp::And, move ( inv ), move ( f ) );
+		} );
+	}
+
+	for ( Transition * t : infeasible )
+		delete t;
+
+	return infeasible.size();
+}
+
+} // namespace nts
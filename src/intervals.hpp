@@ -0,0 +1,107 @@
+#ifndef NTS_INTERVALS_HPP_
+#define NTS_INTERVALS_HPP_
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <ostream>
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Set of integers between two bounds.
+ * Infinite bounds are represented by the extreme values of long long.
+ * The interval is empty, if lo > hi.
+ */
+struct Interval
+{
+	long long lo;
+	long long hi;
+
+	static const long long minus_inf;
+	static const long long plus_inf;
+
+	static Interval top() { return Interval { minus_inf, plus_inf }; }
+
+	bool empty() const { return lo > hi; }
+
+	bool operator== ( const Interval & i ) const { return lo == i.lo && hi == i.hi; }
+	bool operator!= ( const Interval & i ) const { return ! ( *this == i ); }
+};
+
+std::ostream & operator<< ( std::ostream & o, const Interval & i );
+
+/**
+ * @brief Abstract interpretation of a BasicNts in the domain of intervals.
+ *
+ * Scalar Int and BitVector variables and parameters of the BasicNts
+ * are tracked; other variables are unbounded (within their type).
+ * States are processed in reverse postorder (see BasicNts::cfg()),
+ * loop heads are widened after 'widening_delay' updates,
+ * and the fixpoint is then improved by two descending iterations.
+ *
+ * Transitions are interpreted by their top-level havocs (frame),
+ * relations and arithmetic operations. Guards refine intervals
+ * of variables compared to other terms, other formulas (quantifiers,
+ * array writes, ...) are over-approximated by true.
+ */
+class IntervalAnalysis
+{
+	public:
+		explicit IntervalAnalysis ( const BasicNts & bn, unsigned int widening_delay = 2 );
+
+		bool reachable ( const State & s ) const;
+
+		// Bounds of the variable at the state (empty, if the state is not reachable)
+		Interval bounds ( const State & s, const Variable & v ) const;
+
+		/**
+		 * @brief Bounds at the state as a conjunction of relations
+		 * ( true if there are none, false if the state is not reachable ).
+		 */
+		std::unique_ptr < Formula > invariant ( const State & s ) const;
+
+		// Can the transition be taken from the invariant of its source?
+		bool feasible ( const Transition & t ) const;
+
+	private:
+		struct Values
+		{
+			bool reachable;
+			std::vector < Interval > of;
+		};
+
+		std::vector < const Variable * > _vars;
+		std::unordered_map < const Variable *, unsigned int > _var_id;
+		std::unordered_map < const State *, Values > _values;
+		std::vector < Interval > _range;
+
+		Interval range ( const DataType & t ) const;
+		Values top() const;
+		Values post ( const Transition & t, const Values & pre ) const;
+		Values incoming ( const State & s ) const;
+		void solve ( const BasicNts & bn, unsigned int widening_delay );
+
+		// Interpretation of a formula
+		class Refiner;
+};
+
+// Annotates each state by its invariant ( annotation "invariant" )
+void annotate_invariants ( BasicNts & bn );
+
+/**
+ * @brief Deletes transitions, which are infeasible from the invariant
+ * of their source, and conjoins the invariant of the source
+ * to formulas of the other transitions.
+ *
+ * @return number of deleted transitions
+ */
+unsigned int strengthen_guards ( BasicNts & bn );
+
+} // namespace nts
+
+#endif // NTS_INTERVALS_HPP_
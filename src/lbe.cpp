@@ -0,0 +1,88 @@
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include <utility>    // move()
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "compose.hpp"
+#include "lbe.hpp"
+
+using std::unique_ptr;
+using std::vector;
+using std::domain_error;
+using std::move;
+
+namespace nts
+{
+
+namespace
+{
+
+const FormulaTransitionRule & rule_of ( const Transition & t )
+{
+	return static_cast < const FormulaTransitionRule & > ( t.rule() );
+}
+
+bool is_formula ( const Transition & t )
+{
+	return t.rule().kind() == TransitionRule::Kind::Formula;
+}
+
+} // anonymous namespace
+
+//------------------------------------//
+// Large-block encoding               //
+//------------------------------------//
+
+unsigned int collapse_chains ( BasicNts & bn )
+{
+	// Removed states are not visited again
+	const vector < State * > states ( bn.states().begin(), bn.states().end() );
+	unsigned int n_removed = 0;
+
+	for ( State * s : states )
+	{
+		if ( s->is_initial() || s->is_final() || s->is_error() ||
+				s->incoming().size() != 1 || s->outgoing().size() != 1 )
+			continue;
+
+		Transition * in  = s->incoming().front();
+		Transition * out = s->outgoing().front();
+		if ( in == out || !is_formula ( *in ) || !is_formula ( *out ) )
+			continue;
+
+		unique_ptr < FormulaTransitionRule > rule;
+		try
+		{
+			rule = compose ( rule_of ( *in ), rule_of ( *out ), "_" + s->name );
+		}
+		catch ( const domain_error & )
+		{
+			continue;
+		}
+
+		auto * t = new Transition ( move ( rule ), in->from(), out->to() );
+		t->annotations = in->annotations;
+		t->insert_to ( bn );
+
+		delete in;
+		delete out;
+		s->remove_from_parent();
+		delete s;
+		n_removed++;
+	}
+
+	return n_removed;
+}
+
+unsigned int collapse_chains ( Nts & nts )
+{
+	unsigned int n_removed = 0;
+	for ( BasicNts * bn : nts.basic_ntses() )
+		n_removed += collapse_chains ( *bn );
+
+	return n_removed;
+}
+
+} // namespace nts
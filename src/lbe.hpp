@@ -0,0 +1,32 @@
+#ifndef NTS_LBE_HPP_
+#define NTS_LBE_HPP_
+#pragma once
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Large-block encoding: collapses chains of formula transitions.
+ *
+ * A state, which is neither initial, final nor error and whose only
+ * incoming and only outgoing transitions are formula transitions
+ * (other than a self-loop), is removed together with both transitions,
+ * which are replaced by their sequential composition. The composed
+ * transition keeps annotations of the incoming one.
+ *
+ * The composition is computed by compose(), fresh quantified
+ * variables are named <variable>_<state>.
+ *
+ * States, whose transitions can not be composed (array changed by both
+ * transitions, havoc below top-level conjunction), are kept.
+ *
+ * @return number of removed states
+ */
+unsigned int collapse_chains ( BasicNts & bn );
+unsigned int collapse_chains ( Nts & nts );
+
+} // namespace nts
+
+#endif // NTS_LBE_HPP_
@@ -0,0 +1,562 @@
+#include <memory>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>    // move()
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "inliner.hpp"
+#include "conjuncts.hpp"
+#include "liveness.hpp"
+
+using std::unique_ptr;
+using std::vector;
+using std::deque;
+using std::unordered_map;
+using std::unordered_set;
+using std::move;
+
+namespace nts
+{
+
+namespace
+{
+
+using p_Formula = unique_ptr < Formula >;
+using Bits = vector < bool >;
+
+// A top-level conjunct of a formula transition, or arguments of a call
+struct Part
+{
+	Formula * formula;
+	bool      havoc;
+	// Variable defined by the conjunct, or -1
+	int       defines;
+	vector < unsigned int > reads;
+	vector < unsigned int > writes;
+};
+
+struct Step
+{
+	Transition * transition;
+	unsigned int from;
+	unsigned int to;
+	// Variables not in 'changed' keep their values
+	bool         framed;
+	Bits         changed;
+	// Next values constrained by guards, so their definitions are kept
+	Bits         pinned;
+	vector < Part > parts;
+};
+
+/**
+ * Backward may-analysis over dense identifiers of variables and states.
+ * Variables used outside of transitions do not get an identifier.
+ */
+class Liveness
+{
+	public:
+		explicit Liveness ( BasicNts & bn );
+
+		vector < Variable * > vars;
+		vector < State    * > states;
+		vector < Step > steps;
+
+		// live [ state ] [ variable ]
+		vector < Bits > live;
+
+		int id ( const Variable * v ) const;
+
+		bool may_change ( const Step & s, unsigned int v ) const
+		{
+			return !s.framed || s.changed[v];
+		}
+
+		// Is the part needed, given the live variables after the step?
+		bool kept ( const Step & s, const Part & p ) const
+		{
+			return !p.havoc && ( p.defines < 0 || live [ s.to ] [ p.defines ] ||
+					s.pinned [ p.defines ] );
+		}
+
+	private:
+		unordered_map < const Variable *, unsigned int > _var_id;
+		unordered_map < const State    *, unsigned int > _state_id;
+
+		void add_step ( Transition & t );
+		Bits transfer ( const Step & s ) const;
+		void solve();
+};
+
+int Liveness::id ( const Variable * v ) const
+{
+	auto it = _var_id.find ( v );
+	return it == _var_id.end() ? -1 : int ( it->second );
+}
+
+Liveness::Liveness ( BasicNts & bn )
+{
+	// Uses within transitions
+	unordered_map < const Variable *, unsigned int > n_uses;
+	for ( Transition * t : bn.transitions() )
+	{
+		visit_variable_uses ( [&] ( VariableUse & u )
+		{
+			n_uses [ u.get() ]++;
+		} ).visit ( t->rule() );
+
+		if ( t->rule().kind() != TransitionRule::Kind::Formula )
+			continue;
+
+		vector < Formula * > parts;
+		conjuncts ( static_cast < FormulaTransitionRule & > ( t->rule() ).formula(), parts );
+		for ( Formula * f : parts )
+		{
+			if ( atomic ( *f, AtomicProposition::APType::ArrayWrite ) )
+				n_uses [ static_cast < ArrayWrite & > ( *f ).array() ]++;
+		}
+	}
+
+	for ( Variable * v : bn.variables() )
+	{
+		if ( n_uses [ v ] == v->uses().size() )
+		{
+			_var_id.emplace ( v, vars.size() );
+			vars.push_back ( v );
+		}
+	}
+
+	for ( State * s : bn.states() )
+	{
+		_state_id.emplace ( s, states.size() );
+		states.push_back ( s );
+	}
+
+	for ( Transition * t : bn.transitions() )
+		add_step ( *t );
+
+	solve();
+}
+
+void Liveness::add_step ( Transition & t )
+{
+	Step s { &t, _state_id.at ( &t.from() ), _state_id.at ( &t.to() ),
+		false, Bits ( vars.size(), false ), Bits ( vars.size(), false ), { } };
+
+	if ( t.rule().kind() == TransitionRule::Kind::Call )
+	{
+		auto & cr = static_cast < CallTransitionRule & > ( t.rule() );
+		Part p { nullptr, false, -1, { }, { } };
+		visit_variable_uses ( [&] ( VariableUse & u )
+		{
+			int v = id ( u.get() );
+			if ( v < 0 )
+				return;
+
+			if ( u.user_type == VariableUse::UserType::CallTransitionRule )
+			{
+				p.writes.push_back ( v );
+				s.changed [ v ] = true;
+			}
+			else
+			{
+				p.reads.push_back ( v );
+			}
+		} ).visit ( cr );
+
+		s.framed = true;
+		s.parts.push_back ( move ( p ) );
+		steps.push_back ( move ( s ) );
+		return;
+	}
+
+	vector < Formula * > formulas;
+	conjuncts ( static_cast < FormulaTransitionRule & > ( t.rule() ).formula(), formulas );
+
+	vector < unsigned int > n_havocs ( vars.size(), 0 );
+	unsigned int havocs = 0;
+
+	// Further definitions of a variable are guards
+	const vector < Variable * > defs = definitions ( formulas );
+
+	for ( unsigned int k = 0; k < formulas.size(); k++ )
+	{
+		Formula * f = formulas[k];
+		Part p { f, atomic ( *f, AtomicProposition::APType::Havoc ) != nullptr, -1, { }, { } };
+		visit_variable_uses ( [&] ( VariableUse & u )
+		{
+			int v = id ( u.get() );
+			if ( v < 0 )
+				return;
+
+			if ( u.user_type == VariableUse::UserType::VariableReference && !u.modifying )
+				p.reads.push_back ( v );
+			else
+				p.writes.push_back ( v );
+		} ).visit ( *f );
+
+		// Other elements of the array are kept
+		if ( atomic ( *f, AtomicProposition::APType::ArrayWrite ) )
+		{
+			int v = id ( static_cast < ArrayWrite & > ( *f ).array() );
+			if ( v >= 0 )
+			{
+				p.reads.push_back ( v );
+				p.writes.push_back ( v );
+			}
+		}
+
+		if ( p.havoc )
+		{
+			havocs++;
+			for ( unsigned int v : unordered_set < unsigned int > (
+						p.writes.begin(), p.writes.end() ) )
+				n_havocs [ v ]++;
+		}
+		else
+		{
+			p.defines = id ( defs[k] );
+		}
+
+		s.parts.push_back ( move ( p ) );
+	}
+
+	if ( havocs > 0 )
+	{
+		s.framed = true;
+		for ( unsigned int v = 0; v < vars.size(); v++ )
+			s.changed [ v ] = n_havocs [ v ] == havocs;
+	}
+
+	// If v keeps its value, v' = t is a guard v = t
+	for ( Part & p : s.parts )
+	{
+		if ( p.defines >= 0 && !may_change ( s, p.defines ) )
+			p.defines = -1;
+	}
+
+	for ( const Part & p : s.parts )
+	{
+		if ( p.havoc || p.defines >= 0 )
+			continue;
+
+		for ( unsigned int v : p.writes )
+			s.pinned [ v ] = true;
+	}
+
+	steps.push_back ( move ( s ) );
+}
+
+// Variables live before the step
+Bits Liveness::transfer ( const Step & s ) const
+{
+	Bits result ( vars.size(), false );
+	const Bits & after = live [ s.to ];
+
+	for ( unsigned int v = 0; v < vars.size(); v++ )
+	{
+		if ( after[v] && !may_change ( s, v ) )
+			result[v] = true;
+	}
+
+	for ( const Part & p : s.parts )
+	{
+		if ( !kept ( s, p ) )
+			continue;
+
+		for ( unsigned int v : p.reads )
+			result[v] = true;
+	}
+
+	return result;
+}
+
+void Liveness::solve()
+{
+	live.assign ( states.size(), Bits ( vars.size(), false ) );
+
+	vector < vector < const Step * > > outgoing ( states.size() );
+	vector < vector < unsigned int > > predecessors ( states.size() );
+	for ( const Step & s : steps )
+	{
+		outgoing [ s.from ].push_back ( &s );
+		predecessors [ s.to ].push_back ( s.from );
+	}
+
+	deque < unsigned int > work;
+	Bits queued ( states.size(), true );
+	for ( unsigned int i = states.size(); i > 0; i-- )
+		work.push_back ( i - 1 );
+
+	while ( !work.empty() )
+	{
+		unsigned int q = work.front();
+		work.pop_front();
+		queued [ q ] = false;
+
+		Bits in = live [ q ];
+		for ( const Step * s : outgoing [ q ] )
+		{
+			Bits b = transfer ( *s );
+			for ( unsigned int v = 0; v < vars.size(); v++ )
+			{
+				if ( b[v] )
+					in[v] = true;
+			}
+		}
+
+		if ( in == live [ q ] )
+			continue;
+
+		live [ q ] = move ( in );
+		for ( unsigned int p : predecessors [ q ] )
+		{
+			if ( !queued [ p ] )
+			{
+				queued [ p ] = true;
+				work.push_back ( p );
+			}
+		}
+	}
+}
+
+// Keeps the first occurrence of each havocked variable
+void remove_duplicates ( Havoc & h )
+{
+	unordered_set < const Variable * > seen;
+	for ( auto it = h.variables.begin(); it != h.variables.end(); )
+	{
+		if ( seen.insert ( it->get() ).second )
+			++it;
+		else
+			it = h.variables.erase ( it );
+	}
+}
+
+} // anonymous namespace
+
+//------------------------------------//
+// Liveness                           //
+//------------------------------------//
+
+unordered_map < const State *, vector < Variable * > > live_variables ( BasicNts & bn )
+{
+	Liveness l ( bn );
+
+	unordered_map < const State *, vector < Variable * > > result;
+	for ( unsigned int s = 0; s < l.states.size(); s++ )
+	{
+		vector < Variable * > & vs = result [ l.states[s] ];
+		for ( unsigned int v = 0; v < l.vars.size(); v++ )
+		{
+			if ( l.live[s][v] )
+				vs.push_back ( l.vars[v] );
+		}
+	}
+
+	return result;
+}
+
+unsigned int eliminate_dead_variables ( BasicNts & bn, bool share_slots )
+{
+	Liveness l ( bn );
+	const unsigned int n = l.vars.size();
+
+	// Interference of variables, and variables needed by the kept parts
+	vector < unordered_set < unsigned int > > interferes ( n );
+	Bits used ( n, false );
+	auto add = [&] ( unsigned int u, unsigned int v )
+	{
+		if ( u != v )
+		{
+			interferes [ u ].insert ( v );
+			interferes [ v ].insert ( u );
+		}
+	};
+
+	for ( const Bits & live : l.live )
+	{
+		vector < unsigned int > vs;
+		for ( unsigned int v = 0; v < n; v++ )
+		{
+			if ( live[v] )
+			{
+				for ( unsigned int u : vs )
+					add ( u, v );
+				vs.push_back ( v );
+				used[v] = true;
+			}
+		}
+	}
+
+	unordered_set < const Formula * > dropped;
+	unordered_set < Transition * > changed;
+	for ( const Step & s : l.steps )
+	{
+		const Bits & after = l.live [ s.to ];
+		vector < unsigned int > writes;
+		for ( const Part & p : s.parts )
+		{
+			if ( p.havoc )
+				continue;
+
+			if ( !l.kept ( s, p ) )
+			{
+				dropped.insert ( p.formula );
+				changed.insert ( s.transition );
+				continue;
+			}
+
+			for ( unsigned int v : p.reads )
+				used[v] = true;
+			for ( unsigned int v : p.writes )
+			{
+				used[v] = true;
+				writes.push_back ( v );
+			}
+		}
+
+		vector < unsigned int > live_after;
+		vector < unsigned int > havocked;
+		for ( unsigned int v = 0; v < n; v++ )
+		{
+			if ( after[v] )
+				live_after.push_back ( v );
+			if ( s.framed && s.changed[v] )
+				havocked.push_back ( v );
+		}
+
+		// Written variables must not share a slot with each other
+		// nor with variables live after the step
+		for ( unsigned int w : writes )
+		{
+			for ( unsigned int u : writes )
+				add ( u, w );
+			for ( unsigned int v : live_after )
+				add ( v, w );
+		}
+
+		// Changing one of them would change the other
+		for ( unsigned int c : havocked )
+		{
+			for ( unsigned int v : live_after )
+			{
+				if ( !s.changed[v] )
+					add ( c, v );
+			}
+		}
+	}
+
+	for ( Transition * t : changed )
+	{
+		static_cast < FormulaTransitionRule & > ( t->rule() ).transform_formula (
+				[&] ( p_Formula f )
+		{
+			vector < p_Formula > parts;
+			vector < p_Formula > kept;
+			split ( move ( f ), parts );
+			for ( p_Formula & g : parts )
+			{
+				if ( !dropped.count ( g.get() ) )
+					kept.push_back ( move ( g ) );
+			}
+			return conjunction ( move ( kept ) );
+		} );
+	}
+
+	// Unused variables may only remain in havocs
+	vector < Variable * > removed;
+	Bits gone ( n, false );
+	for ( unsigned int v = 0; v < n; v++ )
+	{
+		if ( !used[v] )
+		{
+			gone[v] = true;
+			removed.push_back ( l.vars[v] );
+		}
+	}
+
+	// Greedy assignment of slots in order of declaration
+	vector < vector < unsigned int > > slots;
+	for ( unsigned int v = 0; share_slots && v < n; v++ )
+	{
+		if ( gone[v] )
+			continue;
+
+		bool placed = false;
+		for ( vector < unsigned int > & slot : slots )
+		{
+			if ( !( l.vars [ slot[0] ]->type() == l.vars[v]->type() ) )
+				continue;
+
+			bool free = true;
+			for ( unsigned int u : slot )
+			{
+				if ( interferes [ u ].count ( v ) )
+				{
+					free = false;
+					break;
+				}
+			}
+
+			if ( free )
+			{
+				l.vars[v]->replace_all_uses_with ( *l.vars [ slot[0] ] );
+				removed.push_back ( l.vars[v] );
+				slot.push_back ( v );
+				placed = true;
+				break;
+			}
+		}
+
+		if ( !placed )
+			slots.push_back ( { v } );
+	}
+
+	// Clean up havocs
+	for ( Transition * t : bn.transitions() )
+	{
+		if ( t->rule().kind() != TransitionRule::Kind::Formula )
+			continue;
+
+		vector < Formula * > parts;
+		conjuncts ( static_cast < FormulaTransitionRule & > ( t->rule() ).formula(), parts );
+		for ( Formula * f : parts )
+		{
+			if ( !atomic ( *f, AtomicProposition::APType::Havoc ) )
+				continue;
+
+			auto & h = static_cast < Havoc & > ( *f );
+			for ( auto it = h.variables.begin(); it != h.variables.end(); )
+			{
+				int v = l.id ( it->get() );
+				if ( v >= 0 && gone[v] )
+					it = h.variables.erase ( it );
+				else
+					++it;
+			}
+			remove_duplicates ( h );
+		}
+	}
+
+	for ( Variable * v : removed )
+	{
+		v->remove_from_parent();
+		delete v;
+	}
+
+	return removed.size();
+}
+
+unsigned int eliminate_dead_variables ( Nts & nts, bool share_slots )
+{
+	unsigned int n_removed = 0;
+	for ( BasicNts * bn : nts.basic_ntses() )
+		n_removed += eliminate_dead_variables ( *bn, share_slots );
+
+	return n_removed;
+}
+
+} // namespace nts
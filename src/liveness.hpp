@@ -0,0 +1,42 @@
+#ifndef NTS_LIVENESS_HPP_
+#define NTS_LIVENESS_HPP_
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Live local variables at each state of the BasicNts.
+ *
+ * A variable is live at a state, if its value there may be read
+ * by some later transition, either directly (unprimed reference,
+ * argument of a call), or through a transition, which keeps its value
+ * (it is not in a top-level havoc, or not returned by a call).
+ * A definition v' = t (or a write to array v) of a transition changing v
+ * does not read t, if v is not live after the transition.
+ *
+ * Only variables of the BasicNts, which are not used outside
+ * of transitions, are analysed. Nothing is live at final states.
+ */
+std::unordered_map < const State *, std::vector < Variable * > >
+live_variables ( BasicNts & bn );
+
+/**
+ * @brief Drops definitions of variables, which are not live after them,
+ * and removes variables, which are never live nor used.
+ * If 'share_slots' is true, variables of the same type, whose live ranges
+ * do not interfere, are replaced by one of them.
+ *
+ * @return number of removed variables
+ */
+unsigned int eliminate_dead_variables ( BasicNts & bn, bool share_slots = true );
+unsigned int eliminate_dead_variables ( Nts & nts, bool share_slots = true );
+
+} // namespace nts
+
+#endif // NTS_LIVENESS_HPP_
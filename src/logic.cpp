@@ -1,9 +1,13 @@
 #include <algorithm>
 #include <utility>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "nts.hpp"
 #include "logic.hpp"
 #include "to_csv.hpp"
+#include "evaluator.hpp"
 
 using namespace nts;
 using std::unique_ptr;
@@ -12,6 +16,8 @@ using std::ostream;
 using std::string;
 using std::vector;
 using std::transform;
+using std::unordered_map;
+using std::unordered_set;
 
 const char * to_str ( BoolOp op )
 {
@@ -130,7 +136,7 @@ bool array_type_aply_terms ( const DataType & a_type, unsigned int n, DataType &
 	return true;
 }
 
-DataType array_type_apply_terms ( const DataType & a_type, unsigned int n )
+DataType nts::array_type_apply_terms ( const DataType & a_type, unsigned int n )
 {
 	DataType t;
 	if ( array_type_aply_terms ( a_type, n, t ) )
@@ -139,6 +145,26 @@ DataType array_type_apply_terms ( const DataType & a_type, unsigned int n )
 	throw TypeError();
 }
 
+std::size_t nts::hash_combine ( std::size_t seed, std::size_t value )
+{
+	return seed ^ ( value + 0x9e3779b97f4a7c15ULL + ( seed << 6 ) + ( seed >> 2 ) );
+}
+
+std::size_t nts::hash_data_type ( const DataType & t )
+{
+	const ScalarType & st = t.scalar_type();
+
+	std::size_t h = hash_combine ( st.is_bitvector(), st.bitwidth() );
+	h = hash_combine ( h, st == ScalarType::Integer() );
+	h = hash_combine ( h, st == ScalarType::Integral() );
+	h = hash_combine ( h, t.ref_dimension() );
+	h = hash_combine ( h, t.arr_dimension() );
+	for ( const Term * i : t.idx_terms() )
+		h = hash_combine ( h, i->hash() );
+
+	return h;
+}
+
 
 //------------------------------------//
 // Term                               //
@@ -146,19 +172,78 @@ DataType array_type_apply_terms ( const DataType & a_type, unsigned int n )
 
 Term::Term ( DataType t, TermType tt ) :
 	_type  ( move ( t ) ),
-	_term_type ( tt )
+	_term_type ( tt ),
+	_hash ( 0 ),
+	_hash_valid ( false )
 {
 	_parent_type = Term::ParentType::None;
 	_parent_ptr.raw = nullptr;
 }
 
 Term::Term ( const Term & orig ) :
-	_type  ( orig._type  )
+	_type  ( orig._type  ),
+	_term_type ( orig._term_type ),
+	_hash ( 0 ),
+	_hash_valid ( false )
 {
 	_parent_type = Term::ParentType::None;
 	_parent_ptr.raw = nullptr;
 }
 
+std::size_t Term::hash() const
+{
+	if ( !_hash_valid )
+	{
+		_hash = compute_hash();
+		_hash_valid = true;
+	}
+
+	return _hash;
+}
+
+void Term::invalidate_hash()
+{
+	// Valid hash of a parent implies valid hash of the child,
+	// so ancestors of invalid term are already invalid.
+	if ( !_hash_valid )
+		return;
+
+	_hash_valid = false;
+
+	switch ( _parent_type )
+	{
+		case ParentType::Term:
+			_parent_ptr.term->invalidate_hash();
+			break;
+
+		case ParentType::Formula:
+			_parent_ptr.formula->invalidate_hash();
+			break;
+
+		case ParentType::QuantifiedType:
+		{
+			QuantifiedVariableList * l = _parent_ptr.qtype->parent();
+			if ( l && l->parent() )
+				l->parent()->invalidate_hash();
+			break;
+		}
+
+		case ParentType::CallTransitionRule:
+			_parent_ptr.crule->invalidate_hash();
+			break;
+
+		// Owner of a DataType is not known
+		case ParentType::DataType:
+		case ParentType::None:
+			break;
+	}
+}
+
+int Term::evaluate() const
+{
+	return CompiledTerm ( *this, ValuationLayout() ).evaluate ( nullptr, nullptr );
+}
+
 ostream & nts::operator<< ( ostream & o, const Term & t )
 {
 	t.print ( o );
@@ -170,12 +255,49 @@ ostream & nts::operator<< ( ostream & o, const Term & t )
 //------------------------------------//
 
 Formula::Formula ( Type t ) :
-	_type ( t )
+	_type       ( t     ),
+	_hash       ( 0     ),
+	_hash_valid ( false )
 {
 	_parent_type    = ParentType::None;
 	_parent_ptr.raw = nullptr;
 }
 
+std::size_t Formula::hash() const
+{
+	if ( !_hash_valid )
+	{
+		_hash = compute_hash();
+		_hash_valid = true;
+	}
+
+	return _hash;
+}
+
+void Formula::invalidate_hash()
+{
+	// See Term::invalidate_hash()
+	if ( !_hash_valid )
+		return;
+
+	_hash_valid = false;
+
+	switch ( _parent_type )
+	{
+		case ParentType::Formula:
+			_parent_ptr.formula->invalidate_hash();
+			break;
+
+		case ParentType::FormulaTransitionRule:
+			_parent_ptr.ftr->invalidate_hash();
+			break;
+
+		case ParentType::NtsInitialFormula:
+		case ParentType::None:
+			break;
+	}
+}
+
 ostream & nts::operator<< ( ostream & o, const Formula & f )
 {
 	f.print ( o );
@@ -233,6 +355,27 @@ Formula & FormulaBop::formula_2() const
 	return *_f[1];
 }
 
+void FormulaBop::transform_formulas ( TransFunc f )
+{
+	for ( unsigned int i = 0; i < 2; i++ )
+		_f[i] = f ( move ( _f[i] ) );
+
+	set_formulas_parent();
+	invalidate_hash();
+}
+
+unique_ptr < Formula > FormulaBop::release_formula_1()
+{
+	_f[0]->_parent_type = Formula::ParentType::None;
+	return move ( _f[0] );
+}
+
+unique_ptr < Formula > FormulaBop::release_formula_2()
+{
+	_f[1]->_parent_type = Formula::ParentType::None;
+	return move ( _f[1] );
+}
+
 FormulaBop * FormulaBop::clone() const
 {
 	return new FormulaBop ( *this );
@@ -243,6 +386,13 @@ void FormulaBop::print ( ostream & o ) const
 	o << "( " << *_f[0] << " " << to_str ( _op ) << " " << *_f[1] << " )";
 }
 
+std::size_t FormulaBop::compute_hash() const
+{
+	std::size_t h = hash_combine ( (std::size_t) type(), (std::size_t) _op );
+	h = hash_combine ( h, _f[0]->hash() );
+	return hash_combine ( h, _f[1]->hash() );
+}
+
 //------------------------------------//
 // FormulaNot                         //
 //------------------------------------//
@@ -284,11 +434,29 @@ void FormulaNot::set_formula_parent()
 	_f->_parent_type = Formula::ParentType::Formula;
 }
 
+void FormulaNot::transform_formula ( TransFunc f )
+{
+	_f = f ( move ( _f ) );
+	set_formula_parent();
+	invalidate_hash();
+}
+
+unique_ptr < Formula > FormulaNot::release_formula()
+{
+	_f->_parent_type = Formula::ParentType::None;
+	return move ( _f );
+}
+
 void FormulaNot::print ( ostream & o ) const
 {
 	o << "not " << *_f;
 }
 
+std::size_t FormulaNot::compute_hash() const
+{
+	return hash_combine ( (std::size_t) type(), _f->hash() );
+}
+
 //------------------------------------//
 // QuantifiedType                     //
 //------------------------------------//
@@ -363,6 +531,18 @@ void QuantifiedType::set_terms_parent()
 	}
 }
 
+void QuantifiedType::transform_bounds ( Term::TransFunc f )
+{
+	if ( _from )
+		_from = f ( move ( _from ) );
+	if ( _to )
+		_to = f ( move ( _to ) );
+
+	set_terms_parent();
+	if ( _parent && _parent->parent() )
+		_parent->parent()->invalidate_hash();
+}
+
 ostream & nts::operator<< ( ostream & o, const QuantifiedType & qt )
 {
 	// we have only scalar types
@@ -475,6 +655,13 @@ void QuantifiedFormula::set_formula_parent()
 	_f->_parent_type = Formula::ParentType::Formula;
 }
 
+void QuantifiedFormula::transform_formula ( TransFunc f )
+{
+	_f = f ( move ( _f ) );
+	set_formula_parent();
+	invalidate_hash();
+}
+
 QuantifiedFormula * QuantifiedFormula::clone() const
 {
 	return new QuantifiedFormula ( *this );
@@ -485,6 +672,24 @@ void QuantifiedFormula::print ( ostream & o ) const
 	o << list << " . " << *_f;
 }
 
+std::size_t QuantifiedFormula::compute_hash() const
+{
+	const QuantifiedType & qt = list.qtype();
+
+	std::size_t h = hash_combine ( (std::size_t) type(), (std::size_t) list.quantifier );
+	h = hash_combine ( h, hash_data_type ( qt.type() ) );
+	if ( qt.from() )
+	{
+		h = hash_combine ( h, qt.from()->hash() );
+		h = hash_combine ( h, qt.to()->hash() );
+	}
+
+	for ( const Variable * v : list.variables() )
+		h = hash_combine ( h, std::hash < string > () ( v->name ) );
+
+	return hash_combine ( h, _f->hash() );
+}
+
 //------------------------------------//
 // AtomicProposition                  //
 //------------------------------------//
@@ -502,6 +707,7 @@ AtomicProposition::AtomicProposition ( APType t ) :
 // TODO: Varible users
 Havoc::Havoc () :
 	AtomicProposition ( APType::Havoc ),
+	_set_valid ( false ),
 	variables ( *this )
 {
 	;
@@ -509,6 +715,7 @@ Havoc::Havoc () :
 
 Havoc::Havoc ( const std::initializer_list < Variable * > & l ) :
 	AtomicProposition ( APType::Havoc ),
+	_set_valid ( false ),
 	variables ( *this )
 {
 	for ( Variable * v : l )
@@ -517,6 +724,7 @@ Havoc::Havoc ( const std::initializer_list < Variable * > & l ) :
 
 Havoc::Havoc ( const Havoc & orig ) :
 	AtomicProposition ( APType::Havoc ),
+	_set_valid ( false ),
 	variables ( *this )
 {
 	variables = orig.variables;
@@ -524,6 +732,7 @@ Havoc::Havoc ( const Havoc & orig ) :
 
 Havoc::Havoc ( Havoc && old ) :
 	AtomicProposition ( APType::Havoc ),
+	_set_valid ( false ),
 	variables ( *this )
 {
 	variables = move ( old.variables );
@@ -534,6 +743,73 @@ Havoc * Havoc::clone() const
 	return new Havoc ( *this );
 }
 
+const VariableSet & Havoc::variable_set() const
+{
+	if ( !_set_valid )
+	{
+		_set.clear();
+		for ( const VariableUse & u : variables )
+			_set.insert ( *u );
+		_set_valid = true;
+	}
+
+	return _set;
+}
+
+void Havoc::restrict_to ( const VariableSet & s )
+{
+	VariableSet kept = variable_set();
+	kept &= s;
+	if ( kept == variable_set() && kept.size() == variables.size() )
+		return;
+
+	// Erases uses outside s and repeated uses in place
+	VariableSet left = kept;
+	for ( auto it = variables.begin(); it != variables.end(); )
+	{
+		if ( left.contains ( **it ) )
+		{
+			left.erase ( **it );
+			++it;
+		}
+		else
+		{
+			it = variables.erase ( it );
+		}
+	}
+
+	_set = move ( kept );
+	_set_valid = true;
+}
+
+void Havoc::unite ( const Havoc & other )
+{
+	VariableSet added = other.variable_set();
+	added -= variable_set();
+	if ( added.empty() )
+		return;
+
+	VariableSet united = variable_set();
+	united |= added;
+	for ( const VariableUse & u : other.variables )
+	{
+		if ( added.contains ( *u ) )
+		{
+			added.erase ( *u );
+			variables.push_back ( u.get() );
+		}
+	}
+
+	_set = move ( united );
+	_set_valid = true;
+}
+
+void Havoc::variables_changed()
+{
+	_set_valid = false;
+	invalidate_hash();
+}
+
 void Havoc::print ( ostream & o ) const
 {
 	o << "havoc ( ";
@@ -544,6 +820,24 @@ void Havoc::print ( ostream & o ) const
 	o << " )";
 }
 
+std::size_t Havoc::compute_hash() const
+{
+	// Order of variables does not matter
+	vector < std::size_t > names;
+	names.reserve ( variables.size() );
+	for ( const VariableUse & u : variables )
+		names.push_back ( std::hash < string > () ( u->name ) );
+
+	std::sort ( names.begin(), names.end() );
+	names.erase ( std::unique ( names.begin(), names.end() ), names.end() );
+
+	std::size_t h = hash_combine ( (std::size_t) type(), (std::size_t) aptype() );
+	for ( std::size_t n : names )
+		h = hash_combine ( h, n );
+
+	return h;
+}
+
 //------------------------------------//
 // BooleanTerm                        //
 //------------------------------------//
@@ -580,6 +874,13 @@ void BooleanTerm::set_term_parent()
 	_t->_parent_ptr.formula = this;
 }
 
+void BooleanTerm::transform_term ( Term::TransFunc f )
+{
+	_t = f ( move ( _t ) );
+	set_term_parent();
+	invalidate_hash();
+}
+
 BooleanTerm * BooleanTerm::clone() const
 {
 	return new BooleanTerm ( *this );
@@ -590,6 +891,12 @@ void BooleanTerm::print ( std::ostream & o ) const
 	o << *_t;
 }
 
+std::size_t BooleanTerm::compute_hash() const
+{
+	std::size_t h = hash_combine ( (std::size_t) type(), (std::size_t) aptype() );
+	return hash_combine ( h, _t->hash() );
+}
+
 //------------------------------------//
 // Relation                           //
 //------------------------------------//
@@ -636,6 +943,14 @@ void Relation::print ( std::ostream & o ) const
 	o << "( " << *_t1 << " " << to_str ( _op ) << " " << *_t2 << " )";
 }
 
+std::size_t Relation::compute_hash() const
+{
+	std::size_t h = hash_combine ( (std::size_t) Formula::type(), (std::size_t) aptype() );
+	h = hash_combine ( h, (std::size_t) _op );
+	h = hash_combine ( h, _t1->hash() );
+	return hash_combine ( h, _t2->hash() );
+}
+
 void Relation::set_terms_parent()
 {
 	_t1->_parent_type = Term::ParentType::Formula;
@@ -644,6 +959,26 @@ void Relation::set_terms_parent()
 	_t2->_parent_ptr.formula = this;
 }
 
+void Relation::transform_terms ( Term::TransFunc f )
+{
+	_t1 = f ( move ( _t1 ) );
+	_t2 = f ( move ( _t2 ) );
+	set_terms_parent();
+	invalidate_hash();
+}
+
+unique_ptr < Term > Relation::release_term1()
+{
+	_t1->_parent_type = Term::ParentType::None;
+	return move ( _t1 );
+}
+
+unique_ptr < Term > Relation::release_term2()
+{
+	_t2->_parent_type = Term::ParentType::None;
+	return move ( _t2 );
+}
+
 //------------------------------------//
 // ArrayWrite                         //
 //------------------------------------//
@@ -760,6 +1095,21 @@ void ArrayWrite::print ( ostream & o ) const
 	o << "]";
 }
 
+std::size_t ArrayWrite::compute_hash() const
+{
+	std::size_t h = hash_combine ( (std::size_t) type(), (std::size_t) aptype() );
+	h = hash_combine ( h, std::hash < string > () ( _arr->name ) );
+
+	for ( const Terms * terms : { &_indices_1, &_indices_2, &_values } )
+	{
+		h = hash_combine ( h, terms->size() );
+		for ( const Term * t : *terms )
+			h = hash_combine ( h, t->hash() );
+	}
+
+	return h;
+}
+
 void ArrayWrite::set_terms_parent()
 {
 	for ( Term * t : _values )
@@ -781,6 +1131,18 @@ void ArrayWrite::set_terms_parent()
 	}
 }
 
+void ArrayWrite::transform_terms ( Term::TransFunc f )
+{
+	for ( Terms * terms : { &_indices_1, &_indices_2, &_values } )
+	{
+		for ( Term * & t : *terms )
+			t = f ( unique_ptr < Term > ( t ) ).release();
+	}
+
+	set_terms_parent();
+	invalidate_hash();
+}
+
 //------------------------------------//
 // ArithmeticOperation                //
 //------------------------------------//
@@ -825,12 +1187,41 @@ void ArithmeticOperation::print ( ostream & o ) const
 	o << "( " << *_t1 << " " << to_str ( _op ) << " " << *_t2 << " )";
 }
 
+std::size_t ArithmeticOperation::compute_hash() const
+{
+	std::size_t h = hash_combine ( (std::size_t) term_type(), (std::size_t) _op );
+	h = hash_combine ( h, _t1->hash() );
+	return hash_combine ( h, _t2->hash() );
+}
+
 void ArithmeticOperation::set_terms_parent()
 {
 	_t1->_parent_type = Term::ParentType::Term;
+	_t1->_parent_ptr.term = this;
+	_t2->_parent_type = Term::ParentType::Term;
 	_t2->_parent_ptr.term = this;
 }
 
+void ArithmeticOperation::transform_terms ( TransFunc f )
+{
+	_t1 = f ( move ( _t1 ) );
+	_t2 = f ( move ( _t2 ) );
+	set_terms_parent();
+	invalidate_hash();
+}
+
+unique_ptr < Term > ArithmeticOperation::release_term1()
+{
+	_t1->_parent_type = Term::ParentType::None;
+	return move ( _t1 );
+}
+
+unique_ptr < Term > ArithmeticOperation::release_term2()
+{
+	_t2->_parent_type = Term::ParentType::None;
+	return move ( _t2 );
+}
+
 
 //------------------------------------//
 // ArrayTerm                          //
@@ -935,6 +1326,16 @@ void ArrayTerm::print ( ostream & o ) const
 	}
 }
 
+std::size_t ArrayTerm::compute_hash() const
+{
+	std::size_t h = hash_combine ( (std::size_t) term_type(), _array->hash() );
+	h = hash_combine ( h, _indices.size() );
+	for ( const Term * t : _indices )
+		h = hash_combine ( h, t->hash() );
+
+	return h;
+}
+
 ArrayTerm * ArrayTerm::clone() const
 {
 	return new ArrayTerm ( *this );
@@ -954,6 +1355,7 @@ void ArrayTerm::transform_indices ( IdxTransFunc f )
 	);
 
 	set_indices_parent();
+	invalidate_hash();
 }
 
 //------------------------------------//
@@ -980,11 +1382,29 @@ void MinusTerm::set_term_parent()
 	_term->_parent_ptr.term = this;
 }
 
+void MinusTerm::transform_term ( TransFunc f )
+{
+	_term = f ( move ( _term ) );
+	set_term_parent();
+	invalidate_hash();
+}
+
+unique_ptr < Term > MinusTerm::release_term()
+{
+	_term->_parent_type = Term::ParentType::None;
+	return move ( _term );
+}
+
 void MinusTerm::print ( ostream & o ) const
 {
 	o << "-" << *_term;
 }
 
+std::size_t MinusTerm::compute_hash() const
+{
+	return hash_combine ( (std::size_t) term_type(), _term->hash() );
+}
+
 MinusTerm * MinusTerm::clone() const
 {
 	return new MinusTerm ( *this );
@@ -1034,6 +1454,11 @@ void ThreadID::print ( ostream & o ) const
 	o << "tid";
 }
 
+std::size_t ThreadID::compute_hash() const
+{
+	return hash_combine ( (std::size_t) term_type(), (std::size_t) leaf_type() );
+}
+
 //------------------------------------//
 // Constant                           //
 //------------------------------------//
@@ -1091,6 +1516,12 @@ void IntConstant::print ( ostream & o ) const
 	o << _value;
 }
 
+std::size_t IntConstant::compute_hash() const
+{
+	std::size_t h = hash_combine ( (std::size_t) term_type(), (std::size_t) leaf_type() );
+	return hash_combine ( h, std::hash < int > () ( _value ) );
+}
+
 //------------------------------------//
 // BoolConstant                       //
 //------------------------------------//
@@ -1129,6 +1560,12 @@ void BoolConstant::print ( ostream & o ) const
 		o << "false";
 }
 
+std::size_t BoolConstant::compute_hash() const
+{
+	std::size_t h = hash_combine ( (std::size_t) term_type(), (std::size_t) leaf_type() );
+	return hash_combine ( h, _value );
+}
+
 //------------------------------------//
 // UserConstant                       //
 //------------------------------------//
@@ -1160,6 +1597,13 @@ void UserConstant::print ( ostream & o ) const
 	o << _value;
 }
 
+std::size_t UserConstant::compute_hash() const
+{
+	std::size_t h = hash_combine ( (std::size_t) term_type(), (std::size_t) leaf_type() );
+	h = hash_combine ( h, hash_data_type ( type() ) );
+	return hash_combine ( h, std::hash < string > () ( _value ) );
+}
+
 UserConstant * UserConstant::clone() const
 {
 	return new UserConstant ( *this );
@@ -1189,6 +1633,13 @@ void VariableReference::print ( ostream & o ) const
 		o << "'";
 }
 
+std::size_t VariableReference::compute_hash() const
+{
+	std::size_t h = hash_combine ( (std::size_t) term_type(), (std::size_t) leaf_type() );
+	h = hash_combine ( h, std::hash < string > () ( _var->name ) );
+	return hash_combine ( h, _primed );
+}
+
 void VariableReference::substitute ( Variable & var )
 {
 	// It is enough for var to be coercible to _var
@@ -1198,3 +1649,291 @@ void VariableReference::substitute ( Variable & var )
 	_var = &var;
 }
 
+
+//------------------------------------//
+// Structural equality                //
+//------------------------------------//
+
+namespace
+{
+
+class StructuralEquality
+{
+	private:
+		// Quantified variables of the first formula
+		// mapped to those of the second one
+		unordered_map < const Variable *, const Variable * > _bound;
+
+		bool same_variable ( const Variable * v1, const Variable * v2 ) const
+		{
+			auto it = _bound.find ( v1 );
+			if ( it != _bound.end() )
+				return it->second == v2;
+
+			return v1 == v2;
+		}
+
+		bool equal ( const vector < Term * > & ts1, const vector < Term * > & ts2 )
+		{
+			if ( ts1.size() != ts2.size() )
+				return false;
+
+			for ( unsigned int i = 0; i < ts1.size(); i++ )
+			{
+				if ( ! equal ( *ts1[i], *ts2[i] ) )
+					return false;
+			}
+
+			return true;
+		}
+
+		bool equal ( const DataType & t1, const DataType & t2 )
+		{
+			return t1.scalar_type()   == t2.scalar_type()   &&
+			       t1.ref_dimension() == t2.ref_dimension() &&
+			       equal ( t1.idx_terms(), t2.idx_terms() );
+		}
+
+		bool equal_leaves ( const Leaf & l1, const Leaf & l2 );
+		bool equal_atomic ( const AtomicProposition & a1, const AtomicProposition & a2 );
+		bool equal_quantified ( const QuantifiedFormula & q1, const QuantifiedFormula & q2 );
+
+	public:
+		bool equal ( const Term & t1, const Term & t2 );
+		bool equal ( const Formula & f1, const Formula & f2 );
+};
+
+bool StructuralEquality::equal_leaves ( const Leaf & l1, const Leaf & l2 )
+{
+	if ( l1.leaf_type() != l2.leaf_type() )
+		return false;
+
+	switch ( l1.leaf_type() )
+	{
+		case Leaf::LeafType::ThreadID:
+			return true;
+
+		case Leaf::LeafType::IntConstant:
+			return static_cast < const IntConstant & > ( l1 ).value() ==
+			       static_cast < const IntConstant & > ( l2 ).value();
+
+		case Leaf::LeafType::BoolConstant:
+			return static_cast < const BoolConstant & > ( l1 ).value() ==
+			       static_cast < const BoolConstant & > ( l2 ).value();
+
+		case Leaf::LeafType::UserConstant:
+			return equal ( l1.type(), l2.type() ) &&
+				static_cast < const UserConstant & > ( l1 ).value() ==
+				static_cast < const UserConstant & > ( l2 ).value();
+
+		case Leaf::LeafType::VariableReference:
+		{
+			auto & r1 = static_cast < const VariableReference & > ( l1 );
+			auto & r2 = static_cast < const VariableReference & > ( l2 );
+			return r1.primed() == r2.primed() &&
+				same_variable ( r1.variable().get(), r2.variable().get() );
+		}
+	}
+
+	throw std::logic_error ( "Unknown LeafType" );
+}
+
+bool StructuralEquality::equal ( const Term & t1, const Term & t2 )
+{
+	if ( _bound.empty() && &t1 == &t2 )
+		return true;
+
+	if ( t1.hash() != t2.hash() || t1.term_type() != t2.term_type() )
+		return false;
+
+	switch ( t1.term_type() )
+	{
+		case Term::TermType::ArithmeticOperation:
+		{
+			auto & a1 = static_cast < const ArithmeticOperation & > ( t1 );
+			auto & a2 = static_cast < const ArithmeticOperation & > ( t2 );
+			return a1.operation() == a2.operation() &&
+				equal ( a1.term1(), a2.term1() ) &&
+				equal ( a1.term2(), a2.term2() );
+		}
+
+		case Term::TermType::ArrayTerm:
+		{
+			auto & a1 = static_cast < const ArrayTerm & > ( t1 );
+			auto & a2 = static_cast < const ArrayTerm & > ( t2 );
+			return equal ( a1.array(), a2.array() ) &&
+				equal ( a1.indices(), a2.indices() );
+		}
+
+		case Term::TermType::MinusTerm:
+			return equal (
+				static_cast < const MinusTerm & > ( t1 ).term(),
+				static_cast < const MinusTerm & > ( t2 ).term() );
+
+		case Term::TermType::Leaf:
+			return equal_leaves (
+				static_cast < const Leaf & > ( t1 ),
+				static_cast < const Leaf & > ( t2 ) );
+	}
+
+	throw std::logic_error ( "Unknown TermType" );
+}
+
+bool StructuralEquality::equal_atomic (
+		const AtomicProposition & a1,
+		const AtomicProposition & a2 )
+{
+	if ( a1.aptype() != a2.aptype() )
+		return false;
+
+	switch ( a1.aptype() )
+	{
+		case AtomicProposition::APType::Havoc:
+		{
+			// Havocked variables are compared as sets
+			auto & h1 = static_cast < const Havoc & > ( a1 );
+			auto & h2 = static_cast < const Havoc & > ( a2 );
+
+			unordered_set < const Variable * > s1;
+			unordered_set < const Variable * > s2;
+			for ( const VariableUse & u : h1.variables )
+			{
+				auto it = _bound.find ( u.get() );
+				s1.insert ( it == _bound.end() ? u.get() : it->second );
+			}
+
+			for ( const VariableUse & u : h2.variables )
+				s2.insert ( u.get() );
+
+			return s1 == s2;
+		}
+
+		case AtomicProposition::APType::BooleanTerm:
+			return equal (
+				static_cast < const BooleanTerm & > ( a1 ).term(),
+				static_cast < const BooleanTerm & > ( a2 ).term() );
+
+		case AtomicProposition::APType::Relation:
+		{
+			auto & r1 = static_cast < const Relation & > ( a1 );
+			auto & r2 = static_cast < const Relation & > ( a2 );
+			return r1.operation() == r2.operation() &&
+				equal ( r1.term1(), r2.term1() ) &&
+				equal ( r1.term2(), r2.term2() );
+		}
+
+		case AtomicProposition::APType::ArrayWrite:
+		{
+			auto & w1 = static_cast < const ArrayWrite & > ( a1 );
+			auto & w2 = static_cast < const ArrayWrite & > ( a2 );
+			return same_variable ( w1.array(), w2.array() ) &&
+				equal ( w1.indices_1(), w2.indices_1() ) &&
+				equal ( w1.indices_2(), w2.indices_2() ) &&
+				equal ( w1.values(), w2.values() );
+		}
+	}
+
+	throw std::logic_error ( "Unknown APType" );
+}
+
+bool StructuralEquality::equal_quantified (
+		const QuantifiedFormula & q1,
+		const QuantifiedFormula & q2 )
+{
+	const QuantifiedType & qt1 = q1.list.qtype();
+	const QuantifiedType & qt2 = q2.list.qtype();
+
+	if ( q1.list.quantifier != q2.list.quantifier )
+		return false;
+
+	if ( ! equal ( qt1.type(), qt2.type() ) )
+		return false;
+
+	if ( ( qt1.from() == nullptr ) != ( qt2.from() == nullptr ) )
+		return false;
+
+	if ( qt1.from() )
+	{
+		if ( ! equal ( *qt1.from(), *qt2.from() ) || ! equal ( *qt1.to(), *qt2.to() ) )
+			return false;
+	}
+
+	const VariableContainer & vs1 = q1.list.variables();
+	const VariableContainer & vs2 = q2.list.variables();
+	if ( vs1.size() != vs2.size() )
+		return false;
+
+	// Bind variables of q1 to variables of q2, remembering shadowed bindings
+	vector < std::pair < const Variable *, const Variable * > > shadowed;
+	bool names_equal = true;
+	for ( auto i1 = vs1.cbegin(), i2 = vs2.cbegin(); i1 != vs1.cend(); ++i1, ++i2 )
+	{
+		names_equal = names_equal && (*i1)->name == (*i2)->name;
+
+		auto it = _bound.find ( *i1 );
+		shadowed.emplace_back ( *i1, it == _bound.end() ? nullptr : it->second );
+		_bound[*i1] = *i2;
+	}
+
+	bool eq = names_equal && equal ( q1.formula(), q2.formula() );
+
+	for ( const auto & s : shadowed )
+	{
+		if ( s.second )
+			_bound[s.first] = s.second;
+		else
+			_bound.erase ( s.first );
+	}
+
+	return eq;
+}
+
+bool StructuralEquality::equal ( const Formula & f1, const Formula & f2 )
+{
+	if ( _bound.empty() && &f1 == &f2 )
+		return true;
+
+	if ( f1.hash() != f2.hash() || f1.type() != f2.type() )
+		return false;
+
+	switch ( f1.type() )
+	{
+		case Formula::Type::FormulaBop:
+		{
+			auto & b1 = static_cast < const FormulaBop & > ( f1 );
+			auto & b2 = static_cast < const FormulaBop & > ( f2 );
+			return b1.op() == b2.op() &&
+				equal ( b1.formula_1(), b2.formula_1() ) &&
+				equal ( b1.formula_2(), b2.formula_2() );
+		}
+
+		case Formula::Type::FormulaNot:
+			return equal (
+				static_cast < const FormulaNot & > ( f1 ).formula(),
+				static_cast < const FormulaNot & > ( f2 ).formula() );
+
+		case Formula::Type::QuantifiedFormula:
+			return equal_quantified (
+				static_cast < const QuantifiedFormula & > ( f1 ),
+				static_cast < const QuantifiedFormula & > ( f2 ) );
+
+		case Formula::Type::AtomicProposition:
+			return equal_atomic (
+				static_cast < const AtomicProposition & > ( f1 ),
+				static_cast < const AtomicProposition & > ( f2 ) );
+	}
+
+	throw std::logic_error ( "Unknown formula type" );
+}
+
+} // anonymous namespace
+
+bool nts::structurally_equal ( const Term & t1, const Term & t2 )
+{
+	return StructuralEquality().equal ( t1, t2 );
+}
+
+bool nts::structurally_equal ( const Formula & f1, const Formula & f2 )
+{
+	return StructuralEquality().equal ( f1, f2 );
+}
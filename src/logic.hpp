@@ -66,6 +66,12 @@ enum class Quantifier
 	Exists
 };
 
+// Type of an array term after application of 'n' indices
+DataType array_type_apply_terms ( const DataType & a_type, unsigned int n );
+
+std::size_t hash_combine ( std::size_t seed, std::size_t value );
+std::size_t hash_data_type ( const DataType & t );
+
 
 class Term
 {
@@ -82,9 +88,13 @@ class Term
 		DataType _type;
 		TermType _term_type;
 
+		mutable std::size_t _hash;
+		mutable bool        _hash_valid;
+
 	protected:
 		using p_Term = std::unique_ptr < Term >;
 		virtual void print ( std::ostream & o ) const = 0;
+		virtual std::size_t compute_hash() const = 0;
 
 	public:
 		// type can be whatever type
@@ -103,7 +113,26 @@ class Term
 		virtual Term * clone() const = 0;
 
 		friend std::ostream & operator<< ( std::ostream & o, const Term & t );
-  int evaluate() { return 0; }
+
+		// Value of a closed term (without variables), see CompiledTerm
+		int evaluate() const;
+
+		/**
+		 * @brief Structural hash of this term.
+		 * Variables are hashed by name and primedness, so the hash
+		 * is stable among clones and runs. Hashes of subterms are cached.
+		 * Cache is invalidated automatically when a variable use
+		 * inside the term is changed. If a variable is renamed,
+		 * the caller should call invalidate_hash() on its users.
+		 */
+		std::size_t hash() const;
+
+		// Drops cached hash of this term and of all its ancestors
+		void invalidate_hash();
+
+		// A function which becomes an owner of given term
+		// and gives caller a new term to use
+		using TransFunc = std::function < std::unique_ptr < Term > ( std::unique_ptr < Term > ) >;
 
 		enum class ParentType
 		{
@@ -151,8 +180,12 @@ class Formula
 	private:
 		Type _type;
 
+		mutable std::size_t _hash;
+		mutable bool        _hash_valid;
+
 	protected:
 		virtual void print ( std::ostream & o ) const = 0;
+		virtual std::size_t compute_hash() const = 0;
 
 	public:
 		Formula ( Type t );
@@ -164,6 +197,15 @@ class Formula
 
 		friend std::ostream & operator<< ( std::ostream &, const Formula & );
 
+		// Structural hash, see Term::hash()
+		std::size_t hash() const;
+
+		// Drops cached hash of this formula and of all its ancestors
+		void invalidate_hash();
+
+		// See Term::TransFunc
+		using TransFunc = std::function < std::unique_ptr < Formula > ( std::unique_ptr < Formula > ) >;
+
 		// Who is owner of this formula?
 		enum class ParentType
 		{
@@ -205,6 +247,7 @@ class FormulaBop : public Formula
 
 	protected:
 		virtual void print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 	public:
 		FormulaBop ( BoolOp op,
@@ -219,6 +262,14 @@ class FormulaBop : public Formula
 		Formula & formula_2 () const;
 		BoolOp op () const { return _op; }
 
+		// Replaces each subformula g by f ( g )
+		void transform_formulas ( TransFunc f );
+
+		// Caller becomes an owner of the subformula.
+		// This formula can only be destroyed afterwards.
+		std::unique_ptr<Formula> release_formula_1();
+		std::unique_ptr<Formula> release_formula_2();
+
 		virtual FormulaBop * clone() const override;
 };
 
@@ -231,6 +282,7 @@ class FormulaNot : public Formula
 		
 	protected:
 		virtual void print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 	public:
 		explicit FormulaNot ( std::unique_ptr<Formula> f );
@@ -240,6 +292,10 @@ class FormulaNot : public Formula
 
 		Formula & formula() const;
 
+		void transform_formula ( TransFunc f );
+		// See FormulaBop::release_formula_1()
+		std::unique_ptr<Formula> release_formula();
+
 		virtual FormulaNot * clone() const override;
 };
 
@@ -270,6 +326,9 @@ class QuantifiedType
 		Term * from() const { return _from.get(); }
 		Term * to() const  { return _to.get();   }
 
+		// Transforms both bounds (if any), see Term::TransFunc
+		void transform_bounds ( Term::TransFunc f );
+
 		QuantifiedVariableList * parent() const { return _parent; }
 
 		friend std::ostream & operator<< ( std::ostream & o, const QuantifiedType & qt );
@@ -303,6 +362,7 @@ class QuantifiedVariableList
 		QuantifiedFormula * parent() const { return _parent; }
 
 		const QuantifiedType    & qtype()      const { return _qtype; }
+		      QuantifiedType    & qtype()            { return _qtype; }
 		const VariableContainer & variables()  const { return _vars; }
 		      VariableContainer & variables()        { return _vars; }
 
@@ -330,6 +390,7 @@ class QuantifiedFormula : public Formula
 
 	protected:
 		virtual void print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 	public:
 		QuantifiedFormula (
@@ -344,6 +405,8 @@ class QuantifiedFormula : public Formula
 
 		Formula & formula() const { return *_f; }
 
+		void transform_formula ( TransFunc f );
+
 		virtual QuantifiedFormula * clone() const override;
 };
 
@@ -376,8 +439,14 @@ class AtomicProposition : public Formula
 
 class Havoc : public AtomicProposition
 {
+	private:
+		// Bitset of 'variables', rebuilt on first query after a change
+		mutable VariableSet _set;
+		mutable bool        _set_valid;
+
 	protected:
 		virtual void print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 	public:
 		Havoc ();
@@ -388,6 +457,23 @@ class Havoc : public AtomicProposition
 
 		VariableUseContainer variables;
 
+		/**
+		 * @brief Havocked variables as a bitset (see VariableSet),
+		 * for constant-time membership and word-parallel set operations.
+		 * 'variables' remain the primary representation.
+		 */
+		const VariableSet & variable_set() const;
+		bool havocs ( const Variable & v ) const { return variable_set().contains ( v ); }
+
+		// Keeps the first use of each variable in s, in order
+		void restrict_to ( const VariableSet & s );
+
+		// Appends variables of other, which are not havocked yet
+		void unite ( const Havoc & other );
+
+		// Called by 'variables' whenever they change
+		void variables_changed();
+
 		virtual Havoc * clone() const override;
 };
 
@@ -400,6 +486,7 @@ class BooleanTerm : public AtomicProposition
 
 	protected:
 		virtual void print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 	public:
 		explicit BooleanTerm ( std::unique_ptr<Term> t);
@@ -409,6 +496,8 @@ class BooleanTerm : public AtomicProposition
 
 		Term & term () const { return *_t; }
 
+		void transform_term ( Term::TransFunc f );
+
 		virtual BooleanTerm * clone() const override;
 };
 
@@ -425,6 +514,7 @@ class Relation : public AtomicProposition
 
 	protected:
 		virtual void print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 	public:
 		Relation ( RelationOp op,
@@ -441,6 +531,13 @@ class Relation : public AtomicProposition
 
 		const DataType & type() const { return _type; }
 
+		// Type of the relation is kept
+		void transform_terms ( Term::TransFunc f );
+
+		// See FormulaBop::release_formula_1()
+		std::unique_ptr<Term> release_term1();
+		std::unique_ptr<Term> release_term2();
+
 		virtual Relation * clone() const override;
 };
 
@@ -468,6 +565,7 @@ class ArrayWrite : public AtomicProposition
 	
 	protected:
 		virtual void print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 	public:
 		ArrayWrite ( Variable & arr, Terms idxs_1, Terms idxs_2, Terms values );
@@ -482,6 +580,9 @@ class ArrayWrite : public AtomicProposition
 		const Terms & values()    const { return _values;    }
 		const VariableUse & array_use() const { return _arr; }
 		Variable * array() const { return _arr.get(); }
+
+		// Transforms all indices and values
+		void transform_terms ( Term::TransFunc f );
 };
 
 class ArithmeticOperation : public Term
@@ -496,6 +597,7 @@ class ArithmeticOperation : public Term
 
 	protected:
 		virtual void print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 	public:
 
@@ -511,6 +613,13 @@ class ArithmeticOperation : public Term
 		Term & term1() const { return *_t1; }
 		Term & term2() const { return *_t2; }
 
+		// Type of the operation is kept
+		void transform_terms ( TransFunc f );
+
+		// See FormulaBop::release_formula_1()
+		std::unique_ptr < Term > release_term1();
+		std::unique_ptr < Term > release_term2();
+
 		virtual ArithmeticOperation * clone() const override;
 };
 
@@ -528,6 +637,7 @@ class ArrayTerm : public Term
 
 	protected:
 		virtual void print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 	public:
 		ArrayTerm ( p_Term arr, std::vector < Term * > indices );
@@ -562,6 +672,7 @@ class ArraySize : public Term
 
 	protected:
 		virtual void print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 	public:
 		explicit ArraySize ( p_Term arr );
@@ -582,6 +693,7 @@ class MinusTerm : public Term
 
 	protected:
 		virtual void print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 	public:
 		MinusTerm ( std::unique_ptr < Term > term );
@@ -589,6 +701,10 @@ class MinusTerm : public Term
 
 		Term & term() const { return *_term; }
 
+		void transform_term ( TransFunc f );
+		// See FormulaBop::release_formula_1()
+		std::unique_ptr < Term > release_term();
+
 		virtual MinusTerm * clone() const override;
 };
 
@@ -630,6 +746,7 @@ class ThreadID : public Constant
 {
 	protected:
 		virtual void print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 	public:
 		ThreadID();
@@ -645,6 +762,7 @@ class IntConstant : public Constant
 
 	protected:
 		virtual void print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 	public:
 		explicit IntConstant ( int value );
@@ -654,7 +772,7 @@ class IntConstant : public Constant
 		virtual ~IntConstant() = default;
 
 		virtual IntConstant * clone() const override;
-  int evaluate() { return _value; }
+		int value() const { return _value; }
 };
 
 class BoolConstant : public Constant
@@ -664,6 +782,7 @@ class BoolConstant : public Constant
 
 	protected:
 		virtual void print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 	public:
 		explicit BoolConstant ( bool value );
@@ -673,6 +792,7 @@ class BoolConstant : public Constant
 		virtual ~BoolConstant() = default;
 
 		virtual BoolConstant * clone() const override;
+		bool value() const { return _value; }
 };
 
 
@@ -684,6 +804,7 @@ class UserConstant : public Constant
 
 	protected:
 		virtual void print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 	public:
 		UserConstant ( DataType type, std::string value );
@@ -692,7 +813,7 @@ class UserConstant : public Constant
 		virtual ~UserConstant() = default;
 
 		virtual UserConstant * clone() const override;
-  int evaluate() { return std::stoi( _value.c_str() ); }
+		const std::string & value() const { return _value; }
 };
 
 class VariableReference : public Leaf
@@ -703,6 +824,7 @@ class VariableReference : public Leaf
 
 	protected:
 		virtual void print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 	public:
 		VariableReference ( Variable & var, bool primed );
@@ -720,6 +842,15 @@ class VariableReference : public Leaf
 		virtual VariableReference * clone() const override;
 };
 
+/**
+ * @brief Are the two terms (formulas) the same up to renaming of
+ * quantified variables (which must keep their names)?
+ * Free variables must be the same objects, with the same primedness.
+ * Runs in time linear in size of the terms.
+ */
+bool structurally_equal ( const Term    & t1, const Term    & t2 );
+bool structurally_equal ( const Formula & f1, const Formula & f2 );
+
 }
 
 #endif // NTS_LOGIC_HPP_
@@ -5,8 +5,12 @@
 #include <limits>     // numeric_limits::max<T>()
 #include <utility>    // move()
 #include <iterator>   // distance()
+#include <numeric>    // accumulate()
+#include <mutex>
 
 #include "logic.hpp"
+#include "cfg.hpp"
+#include "decomposition.hpp"
 #include "to_csv.hpp"
 #include "FilterIterator.hpp"
 #include "TransformIterator.hpp"
@@ -25,6 +29,18 @@ using std::function;
 using std::pair;
 using std::transform;
 
+// Hash of variable declarations, in order
+static std::size_t hash_declarations ( const VariableContainer & vars )
+{
+	std::size_t h = vars.size();
+	for ( const Variable * v : vars )
+	{
+		h = hash_combine ( h, std::hash < string > () ( v->name ) );
+		h = hash_combine ( h, hash_data_type ( v->type() ) );
+	}
+	return h;
+}
+
 //------------------------------------//
 // Annotations                        //
 //------------------------------------//
@@ -77,10 +93,13 @@ void Annotations::print ( ostream & o ) const
 //------------------------------------//
 
 Nts::Nts ( string  name ) :
+	_hash           ( 0       ),
+	_hash_valid     ( false   ),
 	initial_formula ( nullptr ),
 	name  ( move ( name ) )
 {
-	;
+	_pars.set_owner ( *this );
+	_vars.set_owner ( *this );
 }
 
 Nts::~Nts()
@@ -123,6 +142,16 @@ void Nts::initial_add_conjunct ( unique_ptr < Formula > f )
 	initial_formula->_parent_type = Formula::ParentType::NtsInitialFormula;
 }
 
+void Nts::transform_initial_formula ( FormulaTransFunc f )
+{
+	if ( !initial_formula )
+		return;
+
+	initial_formula = f ( move ( initial_formula ) );
+	initial_formula->_parent_ptr.nts = this;
+	initial_formula->_parent_type = Formula::ParentType::NtsInitialFormula;
+}
+
 unsigned int Nts::n_threads() const
 {
 	return std::accumulate (
@@ -134,36 +163,70 @@ unsigned int Nts::n_threads() const
 	);
 }
 
-ostream & nts::operator<< ( ostream & o , const Nts & nts )
+std::size_t Nts::hash() const
 {
-	o << "nts " << nts.name << ";\n";
+	if ( !_hash_valid )
+	{
+		_hash = hash_combine ( hash_declarations ( _pars ), hash_declarations ( _vars ) );
+		for ( const BasicNts * bn : _basics )
+			_hash = hash_combine ( _hash, bn->hash() );
+		_hash_valid = true;
+	}
+
+	// These are public or not tracked
+	std::size_t h = hash_combine ( _hash, std::hash < string > () ( name ) );
+	if ( initial_formula )
+		h = hash_combine ( h, initial_formula->hash() );
+
+	for ( const Instance * i : _instances )
+	{
+		h = hash_combine ( h, std::hash < string > () ( i->basic_nts().name ) );
+		h = hash_combine ( h, i->num().hash() );
+	}
+
+	return h;
+}
+
+void Nts::invalidate_hash()
+{
+	_hash_valid = false;
+}
+
+void Nts::print_header ( ostream & o ) const
+{
+	o << "nts " << name << ";\n";
 
 #if 0
-	if ( nts._pars.size() > 0 )
+	if ( _pars.size() > 0 )
 	{
 		o << "par ";
-		to_csv ( o, nts._pars.cbegin(), nts._pars.cend(),
+		to_csv ( o, _pars.cbegin(), _pars.cend(),
 				ptr_print_function<Variable>, "\n" ) << "\n";
 	}
 #endif
 
-	if ( nts._vars.size() > 0 )
+	if ( _vars.size() > 0 )
 	{
-		to_csv ( o, nts._vars.cbegin(), nts._vars.cend(),
+		to_csv ( o, _vars.cbegin(), _vars.cend(),
 				ptr_print_function<Variable>, "\n" ) << "\n";
 	}
 
-	if ( nts.initial_formula )
+	if ( initial_formula )
 	{
-		o << "init\t" << *nts.initial_formula << ";\n";
+		o << "init\t" << *initial_formula << ";\n";
 	}
 
-	if ( nts._instances.size() > 0 )
+	if ( _instances.size() > 0 )
 	{
 		o << "instances ";
-		to_csv ( o, nts._instances.cbegin(), nts._instances.cend(),
+		to_csv ( o, _instances.cbegin(), _instances.cend(),
 				ptr_print_function<Instance>, ", " ) << ";\n";
 	}
+}
+
+ostream & nts::operator<< ( ostream & o , const Nts & nts )
+{
+	nts.print_header ( o );
 
 	if ( nts._basics.size() > 0 )
 	{
@@ -250,6 +313,8 @@ void State::insert_to ( BasicNts &n )
 
 	_parent = &n;
 	_pos = n._states.insert ( n._states.cend(), this );
+	_parent->invalidate_hash();
+	_parent->invalidate_cfg();
 }
 
 void State::insert_after ( const State & s )
@@ -261,6 +326,8 @@ void State::insert_after ( const State & s )
 	auto where = s._pos;
 	++where;
 	_pos = _parent->_states.insert ( where, this );
+	_parent->invalidate_hash();
+	_parent->invalidate_cfg();
 }
 
 void State::remove_from_parent ()
@@ -269,6 +336,8 @@ void State::remove_from_parent ()
 		throw std::logic_error ( "State does not belong to any BasicNts" );
 
 	_parent->_states.erase ( _pos );
+	_parent->invalidate_hash();
+	_parent->invalidate_cfg();
 	_parent = nullptr;
 }
 
@@ -283,11 +352,16 @@ ostream & nts::operator<< ( ostream &o , const State &s )
 // BasicNts                           //
 //------------------------------------//
 BasicNts::BasicNts ( string name ) :
-	_parent   ( nullptr       ),
-	name      ( move ( name ) ),
-	user_data ( nullptr       )
+	_parent     ( nullptr       ),
+	_hash       ( 0             ),
+	_hash_valid ( false         ),
+	name        ( move ( name ) ),
+	user_data   ( nullptr       )
 {
-	;
+	_pars.set_owner       ( *this );
+	_params_in.set_owner  ( *this );
+	_params_out.set_owner ( *this );
+	_variables.set_owner  ( *this );
 }
 
 BasicNts::~BasicNts()
@@ -311,6 +385,7 @@ void BasicNts::insert_to ( Nts & parent )
 {
 	_parent = & parent;
 	_pos = _parent->_basics.insert ( _parent->_basics.end(), this );
+	_parent->invalidate_hash();
 }
 
 void BasicNts::remove_from_parent()
@@ -318,10 +393,63 @@ void BasicNts::remove_from_parent()
 	if ( _parent ) 
 	{
 		_parent->_basics.erase ( _pos );
+		_parent->invalidate_hash();
 		_parent = nullptr;
 	}
 }
 
+std::size_t BasicNts::hash() const
+{
+	if ( !_hash_valid )
+	{
+		std::size_t h = std::hash < string > () ( name );
+		h = hash_combine ( h, hash_declarations ( _pars       ) );
+		h = hash_combine ( h, hash_declarations ( _params_in  ) );
+		h = hash_combine ( h, hash_declarations ( _params_out ) );
+		h = hash_combine ( h, hash_declarations ( _variables  ) );
+
+		for ( const State * s : _states )
+		{
+			h = hash_combine ( h, std::hash < string > () ( s->name ) );
+			h = hash_combine ( h, s->is_initial() | s->is_final() << 1 | s->is_error() << 2 );
+		}
+
+		// Sum does not depend on order of transitions
+		std::size_t tr = 0;
+		for ( const Transition * t : _transitions )
+			tr += hash_combine ( 0, t->hash() );
+
+		_hash = hash_combine ( h, tr );
+		_hash_valid = true;
+	}
+
+	return _hash;
+}
+
+void BasicNts::invalidate_hash()
+{
+	// Valid hash of a parent implies valid hash of the child
+	if ( !_hash_valid )
+		return;
+
+	_hash_valid = false;
+	if ( _parent )
+		_parent->invalidate_hash();
+}
+
+const ControlFlow & BasicNts::cfg() const
+{
+	if ( !_cfg )
+		_cfg.reset ( new ControlFlow ( *this ) );
+
+	return *_cfg;
+}
+
+void BasicNts::invalidate_cfg()
+{
+	_cfg.reset();
+}
+
 void BasicNts::print_params_in ( std::ostream & o ) const
 {
 	if ( _params_in.size() > 0 )
@@ -647,26 +775,40 @@ bool BasicNts::Callers::iterator::operator!= ( const iterator &rhs) const
 //------------------------------------//
 
 Transition::Transition ( unique_ptr<TransitionRule> rule, State &s1, State &s2 ) :
-	_parent   ( nullptr ),
-	_from     ( s1      ),
-	_to       ( s2      ),
-	user_data ( nullptr )
+	_parent     ( nullptr ),
+	_from       ( s1      ),
+	_to         ( s2      ),
+	_hash       ( 0       ),
+	_hash_valid ( false   ),
+	user_data   ( nullptr )
 {
 	_rule = move ( rule );
 	_rule->_t = this;
 
 	_st_from_pos = _from._outgoing_tr.insert ( _from._outgoing_tr.cend(), this );
 	_st_to_pos   = _to._incoming_tr.insert ( _to._incoming_tr.cend(), this );
+	invalidate_states_cfg();
+}
+
+// The control graph is given by lists of transitions of the states
+void Transition::invalidate_states_cfg()
+{
+	if ( _from._parent )
+		_from._parent->invalidate_cfg();
+	if ( _to._parent )
+		_to._parent->invalidate_cfg();
 }
 
 Transition::~Transition()
 {
 	_from._outgoing_tr.erase ( _st_from_pos );
 	_to._incoming_tr.erase ( _st_to_pos );
+	invalidate_states_cfg();
 
 	if ( _parent )
 	{
 		_parent->_transitions.erase ( _pos );
+		_parent->invalidate_hash();
 		_parent = nullptr;
 	}
 }
@@ -681,6 +823,7 @@ void Transition::insert_to ( BasicNts & bn )
 
 	_parent = & bn;
 	_pos    = _parent->_transitions.insert ( _parent->_transitions.cend(), this );
+	_parent->invalidate_hash();
 }
 
 void Transition::remove_from_parent ()
@@ -689,9 +832,32 @@ void Transition::remove_from_parent ()
 		throw std::logic_error ( "Transition does not have a parent" );
 
 	_parent->_transitions.erase ( _pos );
+	_parent->invalidate_hash();
 	_parent = nullptr;
 }
 
+std::size_t Transition::hash() const
+{
+	if ( !_hash_valid )
+	{
+		_hash = hash_combine ( std::hash < string > () ( _from.name ), std::hash < string > () ( _to.name ) );
+		_hash = hash_combine ( _hash, _rule->hash() );
+		_hash_valid = true;
+	}
+
+	return _hash;
+}
+
+void Transition::invalidate_hash()
+{
+	if ( !_hash_valid )
+		return;
+
+	_hash_valid = false;
+	if ( _parent )
+		_parent->invalidate_hash();
+}
+
 ostream & nts::operator<< ( ostream &o, const Transition &t )
 {
 	t.annotations.print ( o );
@@ -709,6 +875,67 @@ ostream & nts::operator<< ( ostream &o, const TransitionRule &tr )
 	return o;
 }
 
+std::size_t TransitionRule::hash() const
+{
+	if ( !_hash_valid )
+	{
+		_hash = compute_hash();
+		_hash_valid = true;
+	}
+
+	return _hash;
+}
+
+void TransitionRule::invalidate_hash()
+{
+	if ( !_hash_valid )
+		return;
+
+	_hash_valid = false;
+	invalidate_caches();
+	if ( _t )
+		_t->invalidate_hash();
+}
+
+bool nts::structurally_equal ( const TransitionRule & r1, const TransitionRule & r2 )
+{
+	if ( r1.kind() != r2.kind() || r1.hash() != r2.hash() )
+		return false;
+
+	if ( r1.kind() == TransitionRule::Kind::Formula )
+	{
+		return structurally_equal (
+				static_cast < const FormulaTransitionRule & > ( r1 ).formula(),
+				static_cast < const FormulaTransitionRule & > ( r2 ).formula() );
+	}
+
+	auto & c1 = static_cast < const CallTransitionRule & > ( r1 );
+	auto & c2 = static_cast < const CallTransitionRule & > ( r2 );
+
+	if ( & c1.dest() != & c2.dest() )
+		return false;
+
+	if ( c1.terms_in().size() != c2.terms_in().size() )
+		return false;
+
+	for ( unsigned int i = 0; i < c1.terms_in().size(); i++ )
+	{
+		if ( ! structurally_equal ( *c1.terms_in()[i], *c2.terms_in()[i] ) )
+			return false;
+	}
+
+	if ( c1.variables_out().size() != c2.variables_out().size() )
+		return false;
+
+	for ( unsigned int i = 0; i < c1.variables_out().size(); i++ )
+	{
+		if ( c1.variables_out()[i].get() != c2.variables_out()[i].get() )
+			return false;
+	}
+
+	return true;
+}
+
 //------------------------------------//
 // FormulaTransitionRule              //
 //------------------------------------//
@@ -727,12 +954,40 @@ FormulaTransitionRule::FormulaTransitionRule ( const FormulaTransitionRule & ori
 	set_formula_parent();
 }
 
+FormulaTransitionRule::~FormulaTransitionRule() = default;
+
+const RuleDecomposition & FormulaTransitionRule::decomposition() const
+{
+	if ( !_decomposition )
+	{
+		// Changes of the formula are reported by invalidate_hash(),
+		// which stops at a rule without a valid hash.
+		hash();
+		_decomposition.reset ( new RuleDecomposition ( *this ) );
+	}
+
+	return *_decomposition;
+}
+
+void FormulaTransitionRule::invalidate_caches()
+{
+	_decomposition.reset();
+}
+
 void FormulaTransitionRule::set_formula_parent()
 {
 	_f->_parent_ptr.ftr = this;
 	_f->_parent_type = Formula::ParentType::FormulaTransitionRule;
 }
 
+void FormulaTransitionRule::transform_formula ( FormulaTransFunc f )
+{
+	_f = f ( move ( _f ) );
+	set_formula_parent();
+	invalidate_hash();
+	invalidate_caches();
+}
+
 ostream & FormulaTransitionRule::print ( std::ostream & o ) const
 {
 	o << "{ " << *this->_f << " }";
@@ -744,6 +999,11 @@ FormulaTransitionRule * FormulaTransitionRule::clone() const
 	return new FormulaTransitionRule ( *this );
 }
 
+std::size_t FormulaTransitionRule::compute_hash() const
+{
+	return hash_combine ( (std::size_t) kind(), _f->hash() );
+}
+
 //------------------------------------//
 // CallTransitionRule                 //
 //------------------------------------//
@@ -861,6 +1121,19 @@ CallTransitionRule * CallTransitionRule::clone() const
 	return new CallTransitionRule ( *this );
 }
 
+std::size_t CallTransitionRule::compute_hash() const
+{
+	std::size_t h = hash_combine ( (std::size_t) kind(), std::hash < string > () ( _dest.name ) );
+
+	for ( const Term * t : _term_in )
+		h = hash_combine ( h, t->hash() );
+
+	for ( const VariableUse & u : _var_out )
+		h = hash_combine ( h, std::hash < string > () ( u->name ) );
+
+	return h;
+}
+
 void CallTransitionRule::transform_return_variables ( VarTransFunc f )
 {
 	transform (
@@ -884,6 +1157,15 @@ void CallTransitionRule::set_terms_parent()
 	}
 }
 
+void CallTransitionRule::transform_terms_in ( TermTransFunc f )
+{
+	for ( Term * & t : _term_in )
+		t = f ( unique_ptr < Term > ( t ) ).release();
+
+	set_terms_parent();
+	invalidate_hash();
+}
+
 namespace
 {
 	ostream & print_variable_name ( ostream &o, const VariableUse & v )
@@ -924,9 +1206,48 @@ ostream & CallTransitionRule::print ( std::ostream & o ) const
 // Variable                           //
 //------------------------------------//
 
+// Identifiers of living variables, released ones are reused first
+namespace
+{
+
+struct VariableIds
+{
+	std::mutex m;
+	std::vector < unsigned int > released;
+	unsigned int bound = 0;
+};
+
+VariableIds & variable_ids()
+{
+	static VariableIds ids;
+	return ids;
+}
+
+unsigned int acquire_id()
+{
+	VariableIds & ids = variable_ids();
+	std::lock_guard < std::mutex > lock ( ids.m );
+	if ( ids.released.empty() )
+		return ids.bound++;
+
+	unsigned int id = ids.released.back();
+	ids.released.pop_back();
+	return id;
+}
+
+void release_id ( unsigned int id )
+{
+	VariableIds & ids = variable_ids();
+	std::lock_guard < std::mutex > lock ( ids.m );
+	ids.released.push_back ( id );
+}
+
+} // anonymous namespace
+
 Variable::Variable ( DataType t, string name ) :
 	_type      ( move ( t    ) ),
 	_container ( nullptr       ),
+	_id        ( acquire_id()  ),
 	name       ( move ( name ) ),
 	user_data  ( nullptr       )
 {
@@ -936,6 +1257,7 @@ Variable::Variable ( DataType t, string name ) :
 Variable::Variable ( const Variable & orig ) :
 	_type       ( orig._type       ),
 	_container  ( nullptr          ),
+	_id         ( acquire_id()     ),
 	annotations ( orig.annotations ),
 	name        ( orig.name        ),
 	user_data   ( nullptr          )
@@ -946,6 +1268,7 @@ Variable::Variable ( const Variable & orig ) :
 Variable::Variable ( const Variable && old ) :
 	_type       ( move ( old._type       ) ),
 	_container  ( move ( old._container  ) ),
+	_id         ( acquire_id()             ),
 	annotations ( move ( old.annotations ) ),
 	name        ( move ( old.name        ) ),
 	user_data   ( move ( old.user_data   ) )
@@ -957,6 +1280,35 @@ Variable::Variable ( const Variable && old ) :
 	}
 }
 
+Variable::~Variable()
+{
+	release_id ( _id );
+}
+
+void Variable::replace_all_uses_with ( Variable & v )
+{
+	if ( &v == this )
+		return;
+
+	if ( v._type != _type )
+		throw TypeError();
+
+	// Positions in the list stay valid after splicing
+	for ( VariableUse * u : _uses )
+	{
+		u->_var = &v;
+		u->notify_user();
+	}
+	v._uses.splice ( v._uses.end(), _uses );
+}
+
+unsigned int Variable::id_bound()
+{
+	VariableIds & ids = variable_ids();
+	std::lock_guard < std::mutex > lock ( ids.m );
+	return ids.bound;
+}
+
 void Variable::insert_to (
 		VariableContainer                 & container,
 		const VariableContainer::iterator & before    )
@@ -966,6 +1318,7 @@ void Variable::insert_to (
 
 	_container = & container;
 	_pos = _container->insert ( before, this );
+	_container->invalidate_owner_hash();
 }
 
 void Variable::remove_from_parent()
@@ -974,6 +1327,7 @@ void Variable::remove_from_parent()
 		throw std::logic_error ( "Variable does not have a parent" );
 
 	_container->erase ( _pos );
+	_container->invalidate_owner_hash();
 	_container = nullptr;
 }
 
@@ -8,6 +8,7 @@
 #include <iterator>
 #include <ostream>
 #include <memory>
+#include <functional>
 
 #include "variables.hpp"
 #include "data_types.hpp"
@@ -47,8 +48,13 @@ namespace nts
 class BasicNts;
 class Instance;
 class Variable;
+class Term;
 class Formula;
 
+// Same as Term::TransFunc and Formula::TransFunc
+using TermTransFunc    = std::function < std::unique_ptr < Term    > ( std::unique_ptr < Term    > ) >;
+using FormulaTransFunc = std::function < std::unique_ptr < Formula > ( std::unique_ptr < Formula > ) >;
+
 class Annotation;
 
 class Annotations : public std::list < Annotation * >
@@ -97,6 +103,10 @@ class Nts
 		BasicNtses _basics;
 		Instances _instances;
 
+		// Cached hash of variables and BasicNtses
+		mutable std::size_t _hash;
+		mutable bool        _hash_valid;
+
 	public:
 		explicit Nts ( std::string name );
 
@@ -129,13 +139,33 @@ class Nts
 
 		friend std::ostream & operator<< ( std::ostream &, const Nts & );
 
+		// Prints everything but BasicNtses
+		// (name, global variables, initial formula and instances)
+		void print_header ( std::ostream & o ) const;
+
 		// Gets number of threads in this nts
 		unsigned int n_threads() const;
 
+		/**
+		 * @brief Content hash of the whole model.
+		 * It is combined from cached hashes of BasicNtses (see BasicNts::hash())
+		 * and of declared variables, which are updated when something
+		 * is inserted or removed, or when a formula is modified.
+		 * Name, initial formula and instances are combined on each call.
+		 * Unchanged BasicNtses keep their hash.
+		 */
+		std::size_t hash() const;
+
+		// Drops cached hash (called automatically by children)
+		void invalidate_hash();
+
 		std::unique_ptr < Formula > initial_formula;
 
 		void initial_add_conjunct (std::unique_ptr < Formula > f );
 
+		// Replaces initial formula (if any) by f ( initial_formula )
+		void transform_initial_formula ( FormulaTransFunc f );
+
 		// FIXME: annotations are not printed
 		Annotations annotations;
 		std::string name;
@@ -173,6 +203,8 @@ class Instance
 
 class Transition;
 class State;
+class ControlFlow;
+class RuleDecomposition;
 
 /**
  * @brief Represents <nts-basic> 
@@ -230,6 +262,13 @@ class BasicNts
 
 		void print_transitions ( std::ostream & o ) const;
 
+		// Cached hash of declarations, states and transitions
+		mutable std::size_t _hash;
+		mutable bool        _hash_valid;
+
+		// Cached analyses of the control graph
+		mutable std::unique_ptr < ControlFlow > _cfg;
+
 	public:
 		class Callers;
 		class Callees;
@@ -261,6 +300,27 @@ class BasicNts
 
 		friend std::ostream & operator<< ( std::ostream &, const BasicNts &);
 
+		/**
+		 * @brief Content hash of this BasicNts (see Nts::hash()).
+		 * Transitions are combined regardless of their order.
+		 * Renaming a variable or state, or changing flags of a state
+		 * is not tracked; call invalidate_hash() afterwards.
+		 */
+		std::size_t hash() const;
+
+		// Drops cached hash of this BasicNts and of the parent Nts
+		void invalidate_hash();
+
+		/**
+		 * @brief Analyses of the control graph (see ControlFlow),
+		 * computed on first use. They are dropped, when a state
+		 * or a transition is created, inserted or removed.
+		 * Changing the initial flag of a state is not tracked;
+		 * call invalidate_cfg() afterwards.
+		 */
+		const ControlFlow & cfg() const;
+		void invalidate_cfg();
+
 		Annotations annotations;
 		std::string name;
 		void * user_data;
@@ -336,6 +396,8 @@ class Variable
 		friend class VariableUse;
 		VariableUsesList _uses;
 
+		unsigned int _id;
+
 		// If variable is inserted into a parent, default move of variable
 		// or parent would break this relation.
 		void insert_to (
@@ -347,7 +409,7 @@ class Variable
 		Variable ( const Variable & orig );
 		Variable ( const Variable && old );
 
-		virtual ~Variable() = default;
+		virtual ~Variable();
 
 		// Insert it as normal variable
 		void insert_to ( Nts & n );
@@ -368,11 +430,28 @@ class Variable
 		void remove_from_parent();
 
 		const VariableUsesList & uses () const { return _uses; }
+
+		/**
+		 * @brief Makes all uses of this variable (references, array writes,
+		 * havocs, return variables of calls) use v instead, in time linear
+		 * in the number of uses. The use list is moved without allocation.
+		 * Throws TypeError, if types of the variables differ.
+		 */
+		void replace_all_uses_with ( Variable & v );
 	
 		const DataType & type() const { return _type; }
 
 		const VariableContainer * container() const { return _container; }
 
+		/**
+		 * @brief Dense identifier, unique among living variables.
+		 * Identifiers of destroyed variables are reused, so they stay
+		 * below id_bound(), which is the peak number of living variables.
+		 * Clones get new identifiers.
+		 */
+		unsigned int id() const { return _id; }
+		static unsigned int id_bound();
+
 		Variable * clone() const;
 
 		friend std::ostream & operator<< ( std::ostream &, const Variable & );
@@ -415,6 +494,11 @@ class Transition
 		// Position in _to._incoming_tr
 		State::Transitions::iterator _st_to_pos;
 
+		mutable std::size_t _hash;
+		mutable bool        _hash_valid;
+
+		void invalidate_states_cfg();
+
 	public:
 		// Both states should belong to the same BasicNts (not checked)
 		// Transition becomes the owner of 'rule'
@@ -431,6 +515,12 @@ class Transition
 		void insert_to ( BasicNts & bn );
 		void remove_from_parent ();
 
+		// Content hash given by names of states and by the rule
+		std::size_t hash() const;
+
+		// Drops cached hash of this transition and of its ancestors
+		void invalidate_hash();
+
 		Annotations annotations;
 
 		friend std::ostream & operator<< ( std::ostream & o, const Transition & );
@@ -452,9 +542,19 @@ class TransitionRule
 		friend class Transition;
 		Transition * _t;
 
+		mutable std::size_t _hash;
+		mutable bool        _hash_valid;
+
 		virtual std::ostream & print ( std::ostream & o ) const = 0;
+		virtual std::size_t compute_hash() const = 0;
+
+		// Drops analyses of the rule, called with invalidate_hash()
+		virtual void invalidate_caches() { ; }
+
 	public:
-		TransitionRule ( Kind k ) : _kind ( k ), _t ( nullptr ) { ; }
+		TransitionRule ( Kind k ) :
+			_kind ( k ), _t ( nullptr ), _hash ( 0 ), _hash_valid ( false )
+		{ ; }
 
 		virtual ~TransitionRule() = default;
 
@@ -464,8 +564,18 @@ class TransitionRule
 		friend std::ostream & operator<< ( std::ostream & o, const TransitionRule &);
 
 		virtual TransitionRule * clone() const = 0;
+
+		// Structural hash, see Term::hash()
+		std::size_t hash() const;
+		void invalidate_hash();
 };
 
+/**
+ * @brief Are the two rules the same (see structurally_equal ( Formula ) )?
+ * Call rules must call the same BasicNts.
+ */
+bool structurally_equal ( const TransitionRule & r1, const TransitionRule & r2 );
+
 class CallTransitionRule : public TransitionRule
 {
 	public:
@@ -478,6 +588,7 @@ class CallTransitionRule : public TransitionRule
 		VariableUseContainer _var_out;
 
 		virtual std::ostream & print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
 
 		template < typename It_1, typename It_2 >
 		static bool coercible (
@@ -513,6 +624,9 @@ class CallTransitionRule : public TransitionRule
 
 		using VarTransFunc = std::function < Variable * ( Variable * ) >;
 		void transform_return_variables ( VarTransFunc f );
+
+		// Types of the arguments are not checked again
+		void transform_terms_in ( TermTransFunc f );
 };
 
 class FormulaTransitionRule : public TransitionRule
@@ -520,17 +634,31 @@ class FormulaTransitionRule : public TransitionRule
 	private:
 		std::unique_ptr<Formula> _f;
 
+		mutable std::unique_ptr < RuleDecomposition > _decomposition;
+
 		virtual std::ostream & print ( std::ostream & o ) const override;
+		virtual std::size_t compute_hash() const override;
+		virtual void invalidate_caches() override;
 		void set_formula_parent();
 
 	public:
 		explicit FormulaTransitionRule ( std::unique_ptr<Formula> f );
 		FormulaTransitionRule ( const FormulaTransitionRule & orig );
 
-		virtual ~FormulaTransitionRule () = default;
+		virtual ~FormulaTransitionRule ();
 
 		Formula & formula() const { return *_f; }
 
+		/**
+		 * @brief Guards, updates and frame of the formula
+		 * (see RuleDecomposition), computed on first use.
+		 * The result is dropped whenever the formula changes.
+		 */
+		const RuleDecomposition & decomposition() const;
+
+		// See Term::TransFunc
+		void transform_formula ( FormulaTransFunc f );
+
 		virtual FormulaTransitionRule * clone() const override;
 };
 
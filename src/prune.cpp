@@ -0,0 +1,93 @@
+#include <vector>
+#include <unordered_set>
+
+#include "nts.hpp"
+#include "prune.hpp"
+
+using std::vector;
+using std::unordered_set;
+
+namespace nts
+{
+
+namespace
+{
+
+// States reachable from the roots, following 'from' -> 'to' if forward
+unordered_set < const State * > reachable ( const vector < const State * > & roots,
+		bool forward )
+{
+	unordered_set < const State * > seen ( roots.begin(), roots.end() );
+	vector < const State * > stack ( roots );
+
+	while ( !stack.empty() )
+	{
+		const State * s = stack.back();
+		stack.pop_back();
+
+		for ( const Transition * t : forward ? s->outgoing() : s->incoming() )
+		{
+			const State * n = forward ? &t->to() : &t->from();
+			if ( seen.insert ( n ).second )
+				stack.push_back ( n );
+		}
+	}
+
+	return seen;
+}
+
+} // anonymous namespace
+
+//------------------------------------//
+// Pruning                            //
+//------------------------------------//
+
+unsigned int prune_states ( BasicNts & bn )
+{
+	vector < const State * > initial;
+	vector < const State * > targets;
+	for ( const State * s : bn.states() )
+	{
+		if ( s->is_initial() )
+			initial.push_back ( s );
+		if ( s->is_final() || s->is_error() )
+			targets.push_back ( s );
+	}
+
+	const auto forward  = reachable ( initial, true  );
+	const auto backward = reachable ( targets, false );
+
+	vector < State * > removed;
+	unordered_set < Transition * > dead;
+	for ( State * s : bn.states() )
+	{
+		if ( forward.count ( s ) && backward.count ( s ) )
+			continue;
+
+		removed.push_back ( s );
+		dead.insert ( s->incoming().begin(), s->incoming().end() );
+		dead.insert ( s->outgoing().begin(), s->outgoing().end() );
+	}
+
+	for ( Transition * t : dead )
+		delete t;
+
+	for ( State * s : removed )
+	{
+		s->remove_from_parent();
+		delete s;
+	}
+
+	return removed.size();
+}
+
+unsigned int prune_states ( Nts & nts )
+{
+	unsigned int n_removed = 0;
+	for ( BasicNts * bn : nts.basic_ntses() )
+		n_removed += prune_states ( *bn );
+
+	return n_removed;
+}
+
+} // namespace nts
@@ -0,0 +1,23 @@
+#ifndef NTS_PRUNE_HPP_
+#define NTS_PRUNE_HPP_
+#pragma once
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Removes states, which are not reachable from initial states
+ * or from which no final or error state can be reached,
+ * together with their transitions.
+ * Runs in time linear in the number of states and transitions.
+ *
+ * @return number of removed states
+ */
+unsigned int prune_states ( BasicNts & bn );
+unsigned int prune_states ( Nts & nts );
+
+} // namespace nts
+
+#endif // NTS_PRUNE_HPP_
@@ -0,0 +1,729 @@
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "evaluator.hpp"
+#include "reachability.hpp"
+
+using std::vector;
+using std::deque;
+using std::unordered_map;
+using std::unique_ptr;
+using std::atomic;
+using std::mutex;
+using std::lock_guard;
+using std::unique_lock;
+using std::shared_lock;
+using std::shared_timed_mutex;
+using std::domain_error;
+using std::logic_error;
+using std::out_of_range;
+using std::move;
+
+namespace nts
+{
+
+//------------------------------------//
+// ReachabilityModel                  //
+//------------------------------------//
+
+/**
+ * @brief Compiled form of the explored program.
+ * State is stored as a tuple of control state ids (one per thread),
+ * followed by global variables and local variables of each thread.
+ */
+class ReachabilityModel
+{
+	public:
+		// Largest number of candidate successors of one transition is 2^this
+		static const unsigned int max_choice_bits = 20;
+
+		struct Procedure
+		{
+			const BasicNts & bn;
+			ValuationLayout layout;
+
+			vector < const State * > states;
+			unordered_map < const State *, unsigned int > ids;
+
+			vector < CompiledTransition > transitions;
+			// Target state id of each transition
+			vector < unsigned int > targets;
+			// Indices of outgoing transitions of each state
+			vector < vector < unsigned int > > outgoing;
+
+			Procedure ( const BasicNts & bn );
+		};
+
+		struct Thread
+		{
+			const Procedure * proc;
+			unsigned int local_offset;
+		};
+
+		vector < unique_ptr < Procedure > > procedures;
+		vector < Thread > threads;
+
+		unsigned int n_globals;
+		// Size of valuation part of a state
+		unsigned int n_values;
+
+		ReachabilityModel ( const BasicNts & bn );
+		ReachabilityModel ( const Nts & nts );
+
+		// Number of values in a state
+		unsigned int state_size() const { return threads.size() + n_values; }
+
+	private:
+		const Procedure & procedure ( const BasicNts & bn );
+		void set_globals ( const Nts * nts );
+		void add_thread ( const BasicNts & bn );
+};
+
+const unsigned int ReachabilityModel::max_choice_bits;
+
+ReachabilityModel::Procedure::Procedure ( const BasicNts & bn ) :
+	bn     ( bn ),
+	layout ( bn )
+{
+	for ( const State * s : bn.states() )
+	{
+		ids.emplace ( s, states.size() );
+		states.push_back ( s );
+	}
+
+	outgoing.resize ( states.size() );
+	for ( const Transition * t : bn.transitions() )
+	{
+		transitions.emplace_back ( *t, layout );
+
+		for ( const auto & c : transitions.back().choices() )
+		{
+			if ( c.width == 0 )
+				throw domain_error ( "Havocked integer variables can not be enumerated" );
+		}
+
+		unsigned int bits = 0;
+		for ( const auto & c : transitions.back().choices() )
+			bits += c.width;
+
+		if ( bits > max_choice_bits )
+			throw domain_error ( "Transition has too many successors to enumerate" );
+
+		outgoing [ ids.at ( &t->from() ) ].push_back ( targets.size() );
+		targets.push_back ( ids.at ( &t->to() ) );
+	}
+}
+
+ReachabilityModel::ReachabilityModel ( const BasicNts & bn )
+{
+	set_globals ( bn.parent() );
+	add_thread ( bn );
+}
+
+ReachabilityModel::ReachabilityModel ( const Nts & nts )
+{
+	set_globals ( &nts );
+	for ( const Instance * i : nts.instances() )
+	{
+		if ( i->basic_nts().parent() != &nts )
+			throw logic_error ( "Instantiated BasicNts must belong to the Nts" );
+
+		int n = i->num().evaluate();
+		for ( int k = 0; k < n; k++ )
+			add_thread ( i->basic_nts() );
+	}
+}
+
+void ReachabilityModel::set_globals ( const Nts * nts )
+{
+	ValuationLayout globals;
+	if ( nts )
+	{
+		for ( const Variable * v : nts->variables() )
+			globals.add ( *v );
+	}
+
+	n_globals = globals.size();
+	n_values = n_globals;
+}
+
+const ReachabilityModel::Procedure & ReachabilityModel::procedure ( const BasicNts & bn )
+{
+	for ( const auto & p : procedures )
+	{
+		if ( &p->bn == &bn )
+			return *p;
+	}
+
+	procedures.emplace_back ( new Procedure ( bn ) );
+	return *procedures.back();
+}
+
+void ReachabilityModel::add_thread ( const BasicNts & bn )
+{
+	const Procedure & p = procedure ( bn );
+	threads.push_back ( { &p, n_values } );
+	n_values += p.layout.size() - n_globals;
+}
+
+//------------------------------------//
+// Explorer                           //
+//------------------------------------//
+
+namespace
+{
+
+struct Record
+{
+	const Record     * parent;
+	const Transition * via;
+	const Value      * data;
+};
+
+// Storage of records created by one worker
+class RecordStore
+{
+	private:
+		static const unsigned int chunk_size = 1 << 16;
+
+		unsigned int _state_size;
+		deque < Record > _records;
+		vector < unique_ptr < Value[] > > _chunks;
+		unsigned int _used;
+
+	public:
+		explicit RecordStore ( unsigned int state_size ) :
+			_state_size ( state_size ),
+			_used       ( chunk_size )
+		{
+			;
+		}
+
+		const Record * add ( const Value * data, const Record * parent, const Transition * via )
+		{
+			if ( _used + _state_size > chunk_size )
+			{
+				_chunks.emplace_back ( new Value [ std::max ( chunk_size, _state_size ) ] );
+				_used = 0;
+			}
+
+			Value * d = _chunks.back().get() + _used;
+			_used += _state_size;
+			std::copy ( data, data + _state_size, d );
+
+			_records.push_back ( { parent, via, d } );
+			return &_records.back();
+		}
+
+		// Only the last record can be removed
+		void remove_last()
+		{
+			_records.pop_back();
+			_used -= _state_size;
+		}
+};
+
+const unsigned int RecordStore::chunk_size;
+
+class Explorer
+{
+	private:
+		const ReachabilityModel & _m;
+		const unsigned int _state_size;
+		const bool _breadth_first;
+		const std::size_t _max_states;
+
+		// Set of visited states (open addressing), a reader-writer-locked
+		// table: insertions hold the lock shared and claim slots by
+		// compare-and-swap, so they do not block each other; growing holds
+		// it exclusively. It is not lock-free, as moving entries to a new
+		// table while others insert would need cooperative migration and
+		// reclamation of the old table. The capacity doubles, so the
+		// exclusive lock is taken only a logarithmic number of times.
+		std::size_t _capacity;
+		std::size_t _max_capacity;
+		unique_ptr < atomic < const Record * > [] > _visited;
+		atomic < std::size_t > _occupied;
+		shared_timed_mutex _resize;
+
+		static const std::size_t initial_capacity = 1 << 10;
+
+		atomic < std::size_t > _n_states;
+		atomic < long >        _pending;
+		atomic < bool >        _stop;
+		atomic < bool >        _incomplete;
+		atomic < const Record * > _error;
+
+		struct Worker
+		{
+			mutex m;
+			deque < const Record * > work;
+			RecordStore store;
+
+			vector < Value > curr;
+			vector < Value > next;
+			vector < Value > succ;
+			vector < Value > choice;
+
+			explicit Worker ( unsigned int state_size ) :
+				store ( state_size )
+			{
+				;
+			}
+		};
+
+		vector < unique_ptr < Worker > > _workers;
+
+		std::size_t hash ( const Value * data ) const;
+		void grow();
+		const Record * insert ( Worker & w, const Value * data,
+				const Record * parent, const Transition * via, bool & inserted );
+
+		void push ( Worker & w, const Record * r );
+		const Record * take ( Worker & w );
+		const Record * steal ( unsigned int thief );
+
+		void found ( const Record * r );
+		void discovered ( Worker & w, const Record * r, bool error );
+		void expand ( Worker & w, const Record * r );
+		void work ( unsigned int id );
+
+	public:
+		Explorer ( const ReachabilityModel & m, unsigned int n_workers,
+				bool breadth_first, std::size_t max_states );
+
+		Reachability::Result run ( const vector < Valuation > & initial );
+};
+
+const std::size_t Explorer::initial_capacity;
+
+Explorer::Explorer ( const ReachabilityModel & m, unsigned int n_workers,
+		bool breadth_first, std::size_t max_states ) :
+	_m             ( m                ),
+	_state_size    ( m.state_size()   ),
+	_breadth_first ( breadth_first    ),
+	_max_states    ( max_states       ),
+	_occupied      ( 0                ),
+	_n_states      ( 0                ),
+	_pending       ( 0                ),
+	_stop          ( false            ),
+	_incomplete    ( false            ),
+	_error         ( nullptr          )
+{
+	// Load factor stays below 1/2 up to max_states. The table starts small
+	// and doubles, the largest power of two of size_t is left out.
+	const std::size_t largest = std::size_t ( 1 ) << ( std::numeric_limits < std::size_t >::digits - 2 );
+	const std::size_t target = max_states < largest / 2 - 1 ? 2 * max_states + 2 : largest;
+
+	_max_capacity = 1;
+	while ( _max_capacity < target )
+		_max_capacity *= 2;
+
+	_capacity = std::min ( _max_capacity, initial_capacity );
+	_visited.reset ( new atomic < const Record * > [ _capacity ] );
+	for ( std::size_t i = 0; i < _capacity; i++ )
+		_visited[i].store ( nullptr, std::memory_order_relaxed );
+
+	for ( unsigned int i = 0; i < n_workers; i++ )
+	{
+		_workers.emplace_back ( new Worker ( _state_size ) );
+		Worker & w = *_workers.back();
+		w.curr.resize ( _m.n_values );
+		w.next.resize ( _m.n_values );
+		w.succ.resize ( _state_size );
+		w.choice.resize ( ReachabilityModel::max_choice_bits );
+	}
+}
+
+std::size_t Explorer::hash ( const Value * data ) const
+{
+	std::size_t h = 0;
+	for ( unsigned int i = 0; i < _state_size; i++ )
+		h = hash_combine ( h, data[i] );
+	return h;
+}
+
+void Explorer::grow()
+{
+	unique_lock < shared_timed_mutex > lock ( _resize );
+	if ( 2 * _occupied.load() < _capacity || _capacity >= _max_capacity )
+		return;
+
+	const std::size_t capacity = 2 * _capacity;
+	unique_ptr < atomic < const Record * > [] > visited ( new atomic < const Record * > [ capacity ] );
+	for ( std::size_t i = 0; i < capacity; i++ )
+		visited[i].store ( nullptr, std::memory_order_relaxed );
+
+	for ( std::size_t j = 0; j < _capacity; j++ )
+	{
+		const Record * r = _visited[j].load ( std::memory_order_relaxed );
+		if ( !r )
+			continue;
+
+		std::size_t i = hash ( r->data ) & ( capacity - 1 );
+		while ( visited[i].load ( std::memory_order_relaxed ) )
+			i = ( i + 1 ) & ( capacity - 1 );
+		visited[i].store ( r, std::memory_order_relaxed );
+	}
+
+	_visited = move ( visited );
+	_capacity = capacity;
+}
+
+const Record * Explorer::insert ( Worker & w, const Value * data,
+		const Record * parent, const Transition * via, bool & inserted )
+{
+	shared_lock < shared_timed_mutex > lock ( _resize );
+	while ( 2 * _occupied.load() >= _capacity && _capacity < _max_capacity )
+	{
+		lock.unlock();
+		grow();
+		lock.lock();
+	}
+
+	std::size_t i = hash ( data ) & ( _capacity - 1 );
+	const Record * mine = nullptr;
+
+	for ( ;; )
+	{
+		const Record * cur = _visited[i].load ( std::memory_order_acquire );
+		if ( !cur )
+		{
+			if ( !mine )
+				mine = w.store.add ( data, parent, via );
+
+			if ( _visited[i].compare_exchange_strong ( cur, mine,
+						std::memory_order_acq_rel, std::memory_order_acquire ) )
+			{
+				_occupied.fetch_add ( 1 );
+				inserted = true;
+				return mine;
+			}
+			// Someone else was faster, 'cur' is his record
+		}
+
+		if ( std::equal ( data, data + _state_size, cur->data ) )
+		{
+			if ( mine )
+				w.store.remove_last();
+
+			inserted = false;
+			return cur;
+		}
+
+		i = ( i + 1 ) & ( _capacity - 1 );
+	}
+}
+
+void Explorer::push ( Worker & w, const Record * r )
+{
+	_pending.fetch_add ( 1 );
+	lock_guard < mutex > lock ( w.m );
+	w.work.push_back ( r );
+}
+
+const Record * Explorer::take ( Worker & w )
+{
+	lock_guard < mutex > lock ( w.m );
+	if ( w.work.empty() )
+		return nullptr;
+
+	const Record * r;
+	if ( _breadth_first )
+	{
+		r = w.work.front();
+		w.work.pop_front();
+	}
+	else
+	{
+		r = w.work.back();
+		w.work.pop_back();
+	}
+	return r;
+}
+
+const Record * Explorer::steal ( unsigned int thief )
+{
+	for ( unsigned int k = 1; k < _workers.size(); k++ )
+	{
+		Worker & victim = *_workers [ ( thief + k ) % _workers.size() ];
+		lock_guard < mutex > lock ( victim.m );
+		if ( !victim.work.empty() )
+		{
+			// Oldest states are the most promising ones
+			const Record * r = victim.work.front();
+			victim.work.pop_front();
+			return r;
+		}
+	}
+	return nullptr;
+}
+
+void Explorer::found ( const Record * r )
+{
+	const Record * none = nullptr;
+	_error.compare_exchange_strong ( none, r );
+	_stop.store ( true );
+}
+
+void Explorer::discovered ( Worker & w, const Record * r, bool error )
+{
+	if ( error )
+	{
+		found ( r );
+		return;
+	}
+
+	if ( _n_states.fetch_add ( 1 ) + 1 >= _max_states )
+	{
+		_incomplete.store ( true );
+		_stop.store ( true );
+	}
+
+	push ( w, r );
+}
+
+void Explorer::expand ( Worker & w, const Record * r )
+{
+	const unsigned int n_threads = _m.threads.size();
+	const unsigned int n_globals = _m.n_globals;
+	const Value * vals = r->data + n_threads;
+
+	for ( unsigned int t = 0; t < n_threads && !_stop.load ( std::memory_order_relaxed ); t++ )
+	{
+		const auto & th = _m.threads[t];
+		const auto & proc = *th.proc;
+		const unsigned int n_locals = proc.layout.size() - n_globals;
+
+		// View of the thread: globals followed by its locals
+		std::copy ( vals, vals + n_globals, w.curr.begin() );
+		std::copy ( vals + th.local_offset, vals + th.local_offset + n_locals,
+				w.curr.begin() + n_globals );
+
+		for ( unsigned int ti : proc.outgoing [ r->data[t] ] )
+		{
+			const CompiledTransition & ct = proc.transitions[ti];
+			if ( !ct.enabled ( w.curr.data(), t ) )
+				continue;
+
+			const auto & choices = ct.choices();
+			std::fill ( w.choice.begin(), w.choice.begin() + choices.size(), 0 );
+
+			for ( bool more = true; more && !_stop.load ( std::memory_order_relaxed ); )
+			{
+				bool ok;
+				try
+				{
+					ct.candidate ( w.curr.data(), w.next.data(), w.choice.data(), t );
+					ok = ct.check ( w.curr.data(), w.next.data(), t );
+				}
+				catch ( const domain_error & )
+				{
+					ok = false;
+				}
+				catch ( const out_of_range & )
+				{
+					ok = false;
+				}
+
+				if ( ok )
+				{
+					Value * s = w.succ.data();
+					std::copy ( r->data, r->data + _state_size, s );
+					s[t] = proc.targets[ti];
+					Value * svals = s + n_threads;
+					std::copy ( w.next.begin(), w.next.begin() + n_globals, svals );
+					std::copy ( w.next.begin() + n_globals, w.next.begin() + n_globals + n_locals,
+							svals + th.local_offset );
+
+					bool inserted;
+					const Record * sr = insert ( w, s, r, &ct.transition(), inserted );
+					if ( inserted )
+						discovered ( w, sr, proc.states [ proc.targets[ti] ]->is_error() );
+				}
+
+				// Next combination of choices
+				more = false;
+				for ( unsigned int c = 0; c < choices.size(); c++ )
+				{
+					if ( ++w.choice[c] < ( Value ( 1 ) << choices[c].width ) )
+					{
+						more = true;
+						break;
+					}
+					w.choice[c] = 0;
+				}
+			}
+		}
+	}
+}
+
+void Explorer::work ( unsigned int id )
+{
+	Worker & w = *_workers[id];
+	while ( !_stop.load() )
+	{
+		const Record * r = take ( w );
+		if ( !r )
+			r = steal ( id );
+
+		if ( !r )
+		{
+			// Nobody has work and nobody is expanding a state
+			if ( _pending.load() == 0 )
+				break;
+
+			std::this_thread::yield();
+			continue;
+		}
+
+		expand ( w, r );
+		_pending.fetch_sub ( 1 );
+	}
+}
+
+Reachability::Result Explorer::run ( const vector < Valuation > & initial )
+{
+	const unsigned int n_threads = _m.threads.size();
+
+	// Product of initial states of all threads
+	vector < vector < unsigned int > > init_states ( n_threads );
+	for ( unsigned int t = 0; t < n_threads; t++ )
+	{
+		const auto & states = _m.threads[t].proc->states;
+		for ( unsigned int s = 0; s < states.size(); s++ )
+		{
+			if ( states[s]->is_initial() )
+				init_states[t].push_back ( s );
+		}
+	}
+
+	vector < Value > data ( _state_size );
+	unsigned int next_worker = 0;
+	for ( const Valuation & val : initial )
+	{
+		if ( val.size() != _m.n_values )
+			throw logic_error ( "Initial valuation has wrong size" );
+
+		std::copy ( val.begin(), val.end(), data.begin() + n_threads );
+
+		vector < unsigned int > pos ( n_threads, 0 );
+		bool more = std::all_of ( init_states.begin(), init_states.end(),
+				[] ( const vector < unsigned int > & v ) { return !v.empty(); } );
+
+		while ( more && !_stop.load() )
+		{
+			bool error = false;
+			for ( unsigned int t = 0; t < n_threads; t++ )
+			{
+				data[t] = init_states[t][pos[t]];
+				error = error || _m.threads[t].proc->states[data[t]]->is_error();
+			}
+
+			Worker & w = *_workers [ next_worker++ % _workers.size() ];
+			bool inserted;
+			const Record * r = insert ( w, data.data(), nullptr, nullptr, inserted );
+			if ( inserted )
+				discovered ( w, r, error );
+
+			more = false;
+			for ( unsigned int t = 0; t < n_threads; t++ )
+			{
+				if ( ++pos[t] < init_states[t].size() )
+				{
+					more = true;
+					break;
+				}
+				pos[t] = 0;
+			}
+		}
+	}
+
+	if ( !_stop.load() )
+	{
+		vector < std::thread > threads;
+		for ( unsigned int i = 1; i < _workers.size(); i++ )
+			threads.emplace_back ( &Explorer::work, this, i );
+
+		work ( 0 );
+
+		for ( auto & t : threads )
+			t.join();
+	}
+
+	Reachability::Result res;
+	const Record * err = _error.load();
+	res.error_reached = err != nullptr;
+	res.complete = !err && !_incomplete.load();
+	res.n_states = _n_states.load() + ( err ? 1 : 0 );
+
+	for ( const Record * r = err; r; r = r->parent )
+	{
+		Reachability::Step step;
+		step.via = r->via;
+		for ( unsigned int t = 0; t < n_threads; t++ )
+			step.control.push_back ( _m.threads[t].proc->states [ r->data[t] ] );
+		step.valuation.assign ( r->data + n_threads, r->data + _state_size );
+		res.trace.push_back ( std::move ( step ) );
+	}
+	std::reverse ( res.trace.begin(), res.trace.end() );
+
+	return res;
+}
+
+} // anonymous namespace
+
+//------------------------------------//
+// Reachability                       //
+//------------------------------------//
+
+Reachability::Reachability ( const BasicNts & bn ) :
+	_model        ( new ReachabilityModel ( bn ) ),
+	n_threads     ( 0       ),
+	breadth_first ( false   ),
+	max_states    ( 1 << 20 )
+{
+	;
+}
+
+Reachability::Reachability ( const Nts & nts ) :
+	_model        ( new ReachabilityModel ( nts ) ),
+	n_threads     ( 0       ),
+	breadth_first ( false   ),
+	max_states    ( 1 << 20 )
+{
+	;
+}
+
+Reachability::~Reachability() = default;
+
+unsigned int Reachability::valuation_size() const
+{
+	return _model->n_values;
+}
+
+Reachability::Result Reachability::run()
+{
+	unsigned int n = n_threads;
+	if ( n == 0 )
+		n = std::max ( 1u, std::thread::hardware_concurrency() );
+
+	vector < Valuation > init = initial;
+	if ( init.empty() )
+		init.emplace_back ( _model->n_values, 0 );
+
+	Explorer e ( *_model, n, breadth_first, max_states );
+	return e.run ( init );
+}
+
+} // namespace nts
@@ -0,0 +1,88 @@
+#ifndef NTS_REACHABILITY_HPP_
+#define NTS_REACHABILITY_HPP_
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+#include "nts.hpp"
+#include "evaluator.hpp"
+
+namespace nts
+{
+
+class ReachabilityModel;
+
+/**
+ * @brief Explicit-state reachability of error states.
+ *
+ * Explores either one BasicNts, or the product of all instances of an Nts
+ * (interleaving semantics, thread ids are given by the order of instances).
+ * A state is a tuple of control states together with a packed valuation:
+ * global variables, followed by local variables (including parameters)
+ * of each thread.
+ *
+ * Successors are computed from the transition formula: variables updated
+ * by an equality x' = t are computed, other havocked variables
+ * are enumerated (bitvectors only), and each candidate is checked
+ * by the compiled formula. Call transitions are not supported.
+ *
+ * Visited states are kept in a shared hash set, whose slots are claimed
+ * by compare-and-swap under a reader-writer lock, and the work is distributed
+ * among threads, which steal from each other when they run out of states.
+ * Exploration stops on the first reached error state.
+ */
+class Reachability
+{
+	public:
+		struct Step
+		{
+			// Null for the initial state
+			const Transition * via;
+			// Control state of each thread
+			std::vector < const State * > control;
+			Valuation valuation;
+		};
+
+		struct Result
+		{
+			bool error_reached;
+			// Whole reachable state space was explored
+			bool complete;
+			std::size_t n_states;
+			// From an initial state to the error state
+			std::vector < Step > trace;
+		};
+
+	private:
+		std::unique_ptr < ReachabilityModel > _model;
+
+	public:
+		// Throws std::domain_error, if successors can not be enumerated
+		explicit Reachability ( const BasicNts & bn );
+		explicit Reachability ( const Nts & nts );
+		~Reachability();
+
+		// 0 means one thread per core
+		unsigned int n_threads;
+
+		// Otherwise each thread explores its states depth first
+		bool breadth_first;
+
+		// Exploration stops (incomplete) after this many states
+		std::size_t max_states;
+
+		// Initial valuations (in the order of the state valuation).
+		// If empty, all variables are initially zero.
+		std::vector < Valuation > initial;
+
+		// Size of the valuation part of a state
+		unsigned int valuation_size() const;
+
+		Result run();
+};
+
+} // namespace nts
+
+#endif // NTS_REACHABILITY_HPP_
@@ -0,0 +1,699 @@
+#include <memory>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdexcept>
+#include <utility>    // move()
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "conjuncts.hpp"
+#include "scalarize.hpp"
+
+using std::unique_ptr;
+using std::make_unique;
+using std::vector;
+using std::string;
+using std::to_string;
+using std::unordered_map;
+using std::unordered_set;
+using std::domain_error;
+using std::logic_error;
+using std::move;
+
+namespace nts
+{
+
+namespace
+{
+
+using p_Term    = unique_ptr < Term    >;
+using p_Formula = unique_ptr < Formula >;
+
+// Scalar variables of an array, in row-major order
+struct Cells
+{
+	vector < unsigned int > dims;
+	vector < Variable * >   vars;
+};
+
+using Arrays = unordered_map < const Variable *, Cells >;
+
+// Contains only constants and arithmetic?
+bool closed ( const Term & t )
+{
+	switch ( t.term_type() )
+	{
+		case Term::TermType::ArithmeticOperation:
+		{
+			auto & aop = static_cast < const ArithmeticOperation & > ( t );
+			return closed ( aop.term1() ) && closed ( aop.term2() );
+		}
+
+		case Term::TermType::MinusTerm:
+			return closed ( static_cast < const MinusTerm & > ( t ).term() );
+
+		case Term::TermType::ArrayTerm:
+			return false;
+
+		case Term::TermType::Leaf:
+			return static_cast < const Leaf & > ( t ).leaf_type() ==
+				Leaf::LeafType::IntConstant;
+	}
+
+	return false;
+}
+
+bool constant ( const Term & t, int & value )
+{
+	if ( !closed ( t ) )
+		return false;
+
+	try
+	{
+		value = t.evaluate();
+	}
+	catch ( const domain_error & )
+	{
+		return false;
+	}
+	return true;
+}
+
+// Sizes of all dimensions, if they are constant
+bool dimensions ( const DataType & t, vector < unsigned int > & dims )
+{
+	if ( t.ref_dimension() != 0 || t.arr_dimension() == 0 )
+		return false;
+
+	for ( const Term * s : t.idx_terms() )
+	{
+		int d = 0;
+		if ( !s || !constant ( *s, d ) || d <= 0 )
+			return false;
+		dims.push_back ( d );
+	}
+
+	return true;
+}
+
+bool in_transition_of ( const Formula & f, const BasicNts & bn )
+{
+	const Formula * g = &f;
+	while ( g->_parent_type == Formula::ParentType::Formula )
+		g = g->_parent_ptr.formula;
+
+	if ( g->_parent_type != Formula::ParentType::FormulaTransitionRule )
+		return false;
+
+	const Transition * t = g->_parent_ptr.ftr->transition();
+	return t && t->parent() == &bn;
+}
+
+// Is the proposition neither negated nor under an equivalence?
+// Out of bounds accesses are false there, which only disables the transition.
+bool positive ( const Formula & ap )
+{
+	bool negated = false;
+	for ( const Formula * g = &ap; g->_parent_type == Formula::ParentType::Formula; )
+	{
+		const Formula * p = g->_parent_ptr.formula;
+		if ( p->type() == Formula::Type::FormulaNot )
+		{
+			negated = !negated;
+		}
+		else if ( p->type() == Formula::Type::FormulaBop )
+		{
+			auto & bop = static_cast < const FormulaBop & > ( *p );
+			if ( bop.op() == BoolOp::Equiv )
+				return false;
+			if ( bop.op() == BoolOp::Imply && &bop.formula_1() == g )
+				negated = !negated;
+		}
+		g = p;
+	}
+
+	return !negated;
+}
+
+// Atomic proposition of a transition of bn, which contains the term
+const Formula * proposition_of ( const Term & t, const BasicNts & bn )
+{
+	const Term * u = &t;
+	while ( u->_parent_type == Term::ParentType::Term )
+		u = u->_parent_ptr.term;
+
+	if ( u->_parent_type != Term::ParentType::Formula )
+		return nullptr;
+
+	const Formula * ap = u->_parent_ptr.formula;
+	return in_transition_of ( *ap, bn ) ? ap : nullptr;
+}
+
+// Array term which reads the referenced array
+const ArrayTerm * read_of ( const VariableReference & r )
+{
+	if ( r._parent_type != Term::ParentType::Term )
+		return nullptr;
+
+	const Term & p = *r._parent_ptr.term;
+	if ( p.term_type() != Term::TermType::ArrayTerm )
+		return nullptr;
+
+	auto & at = static_cast < const ArrayTerm & > ( p );
+	return &at.array() == &r ? &at : nullptr;
+}
+
+// Reads of arrays with symbolic indices in each proposition,
+// together with the number of cells they may read
+using Reads = unordered_map < const Formula *, vector < std::pair < const Variable *, unsigned long > > >;
+
+bool scalarizable ( const Variable & a, const Cells & c, const BasicNts & bn, Reads & reads )
+{
+	for ( const VariableUse * u : a.uses() )
+	{
+		switch ( u->user_type )
+		{
+			case VariableUse::UserType::VariableReference:
+			{
+				const ArrayTerm * at = read_of ( *u->user_ptr.vref );
+				if ( !at || at->indices().size() != c.dims.size() )
+					return false;
+
+				const Formula * ap = proposition_of ( *at, bn );
+				if ( !ap )
+					return false;
+
+				unsigned long n = 1;
+				for ( unsigned int i = 0; i < c.dims.size(); i++ )
+				{
+					int k = 0;
+					if ( !constant ( *at->indices()[i], k ) )
+						n *= c.dims[i];
+					else if ( k < 0 || (unsigned int) k >= c.dims[i] )
+						return false;
+				}
+
+				if ( n > 1 && !positive ( *ap ) )
+					return false;
+
+				if ( n > 1 )
+					reads [ ap ].emplace_back ( &a, n );
+				break;
+			}
+
+			case VariableUse::UserType::ArrayWrite:
+			{
+				const ArrayWrite & aw = *u->user_ptr.arr_wr;
+				if ( aw.indices_1().size() + 1 != c.dims.size() || !in_transition_of ( aw, bn ) ||
+						!positive ( aw ) )
+					return false;
+				break;
+			}
+
+			case VariableUse::UserType::Havoc:
+				if ( !in_transition_of ( *u->user_ptr.hvc, bn ) )
+					return false;
+				break;
+
+			case VariableUse::UserType::CallTransitionRule:
+				return false;
+		}
+	}
+
+	return true;
+}
+
+//------------------------------------//
+// Formula construction               //
+//------------------------------------//
+
+p_Term ref ( Variable & v, bool primed )
+{
+	return make_unique < VariableReference > ( v, primed );
+}
+
+p_Term copy ( const Term & t )
+{
+	return p_Term ( t.clone() );
+}
+
+p_Formula relation ( RelationOp op, p_Term t1, p_Term t2 )
+{
+	return make_unique < Relation > ( op, move ( t1 ), move ( t2 ) );
+}
+
+p_Formula equals ( const Term & t, int value )
+{
+	return relation ( RelationOp::eq, copy ( t ), make_unique < IntConstant > ( value ) );
+}
+
+// Null stands for true
+p_Formula conj ( p_Formula f1, p_Formula f2 )
+{
+	if ( !f1 )
+		return f2;
+
+	if ( !f2 )
+		return f1;
+
+	return make_unique < FormulaBop > ( BoolOp::And, move ( f1 ), move ( f2 ) );
+}
+
+p_Formula disj ( p_Formula f1, p_Formula f2 )
+{
+	return make_unique < FormulaBop > ( BoolOp::Or, move ( f1 ), move ( f2 ) );
+}
+
+//------------------------------------//
+// Scalarizer                         //
+//------------------------------------//
+
+class Scalarizer
+{
+	private:
+		const Arrays & _arrays;
+
+		const Cells * cells_of ( const ArrayTerm & at ) const;
+
+		// Applies f to the first array read (with indices free of reads)
+		p_Term replace_read ( p_Term t, const Term::TransFunc & f, bool & done ) const;
+		bool replace_read ( Formula & ap, const Term::TransFunc & f ) const;
+
+		p_Formula proposition ( p_Formula ap ) const;
+		p_Formula split ( const Formula & ap, const ArrayTerm & read ) const;
+		p_Formula expand ( const ArrayWrite & aw, const Cells & c ) const;
+		p_Formula havoc ( p_Formula f ) const;
+
+	public:
+		explicit Scalarizer ( const Arrays & arrays ) :
+			_arrays ( arrays )
+		{ ; }
+
+		p_Formula rewrite ( p_Formula f ) const;
+};
+
+const Cells * Scalarizer::cells_of ( const ArrayTerm & at ) const
+{
+	const Term & a = at.array();
+	if ( a.term_type() != Term::TermType::Leaf ||
+			static_cast < const Leaf & > ( a ).leaf_type() != Leaf::LeafType::VariableReference )
+		return nullptr;
+
+	auto it = _arrays.find ( static_cast < const VariableReference & > ( a ).variable().get() );
+	return it == _arrays.end() ? nullptr : &it->second;
+}
+
+p_Term Scalarizer::replace_read ( p_Term t, const Term::TransFunc & f, bool & done ) const
+{
+	if ( done )
+		return t;
+
+	auto rec = [&] ( p_Term u ) { return replace_read ( move ( u ), f, done ); };
+
+	switch ( t->term_type() )
+	{
+		case Term::TermType::ArithmeticOperation:
+			static_cast < ArithmeticOperation & > ( *t ).transform_terms ( rec );
+			break;
+
+		case Term::TermType::MinusTerm:
+			static_cast < MinusTerm & > ( *t ).transform_term ( rec );
+			break;
+
+		case Term::TermType::ArrayTerm:
+		{
+			auto & at = static_cast < ArrayTerm & > ( *t );
+			at.transform_indices ( rec );
+			if ( !done && cells_of ( at ) )
+			{
+				done = true;
+				return f ( move ( t ) );
+			}
+			break;
+		}
+
+		case Term::TermType::Leaf:
+			break;
+	}
+
+	return t;
+}
+
+bool Scalarizer::replace_read ( Formula & ap, const Term::TransFunc & f ) const
+{
+	bool done = false;
+	auto rec = [&] ( p_Term u ) { return replace_read ( move ( u ), f, done ); };
+
+	switch ( static_cast < AtomicProposition & > ( ap ).aptype() )
+	{
+		case AtomicProposition::APType::Relation:
+			static_cast < Relation & > ( ap ).transform_terms ( rec );
+			break;
+
+		case AtomicProposition::APType::BooleanTerm:
+			static_cast < BooleanTerm & > ( ap ).transform_term ( rec );
+			break;
+
+		case AtomicProposition::APType::ArrayWrite:
+			static_cast < ArrayWrite & > ( ap ).transform_terms ( rec );
+			break;
+
+		case AtomicProposition::APType::Havoc:
+			break;
+	}
+
+	return done;
+}
+
+p_Formula Scalarizer::rewrite ( p_Formula f ) const
+{
+	auto rec = [this] ( p_Formula g ) { return rewrite ( move ( g ) ); };
+
+	switch ( f->type() )
+	{
+		case Formula::Type::FormulaBop:
+			static_cast < FormulaBop & > ( *f ).transform_formulas ( rec );
+			return f;
+
+		case Formula::Type::FormulaNot:
+			static_cast < FormulaNot & > ( *f ).transform_formula ( rec );
+			return f;
+
+		case Formula::Type::QuantifiedFormula:
+			static_cast < QuantifiedFormula & > ( *f ).transform_formula ( rec );
+			return f;
+
+		case Formula::Type::AtomicProposition:
+			break;
+	}
+
+	return proposition ( move ( f ) );
+}
+
+p_Formula Scalarizer::proposition ( p_Formula ap ) const
+{
+	auto & p = static_cast < AtomicProposition & > ( *ap );
+	if ( p.aptype() == AtomicProposition::APType::Havoc )
+		return havoc ( move ( ap ) );
+
+	// Reads first, so that written values are free of them
+	const ArrayTerm * read = nullptr;
+	replace_read ( *ap, [&] ( p_Term t )
+	{
+		read = static_cast < const ArrayTerm * > ( t.get() );
+		return t;
+	} );
+
+	if ( read )
+		return split ( *ap, *read );
+
+	if ( p.aptype() == AtomicProposition::APType::ArrayWrite )
+	{
+		auto & aw = static_cast < const ArrayWrite & > ( p );
+		auto it = _arrays.find ( aw.array() );
+		if ( it != _arrays.end() )
+			return expand ( aw, it->second );
+	}
+
+	return ap;
+}
+
+p_Formula Scalarizer::split ( const Formula & ap, const ArrayTerm & read ) const
+{
+	const Cells & c = *cells_of ( read );
+	const bool primed = static_cast < const VariableReference & > ( read.array() ).primed();
+	const auto & indices = read.indices();
+
+	// Constant indices stay, symbolic ones range over their dimension
+	vector < unsigned int > idx ( c.dims.size(), 0 );
+	vector < unsigned int > open;
+	for ( unsigned int i = 0; i < c.dims.size(); i++ )
+	{
+		int k = 0;
+		if ( !constant ( *indices[i], k ) )
+			open.push_back ( i );
+		else if ( k < 0 || (unsigned int) k >= c.dims[i] )
+			return truth ( false );
+		else
+			idx[i] = k;
+	}
+
+	p_Formula result;
+	while ( true )
+	{
+		unsigned int offset = 0;
+		for ( unsigned int i = 0; i < c.dims.size(); i++ )
+			offset = offset * c.dims[i] + idx[i];
+
+		p_Formula inst ( ap.clone() );
+		replace_read ( *inst, [&] ( p_Term ) { return ref ( *c.vars[offset], primed ); } );
+
+		p_Formula cond;
+		for ( unsigned int i : open )
+			cond = conj ( move ( cond ), equals ( *indices[i], idx[i] ) );
+
+		p_Formula g = conj ( move ( cond ), proposition ( move ( inst ) ) );
+		result = result ? disj ( move ( result ), move ( g ) ) : move ( g );
+
+		// Next combination of symbolic indices
+		int j = open.size() - 1;
+		for ( ; j >= 0 && ++idx [ open[j] ] == c.dims [ open[j] ]; j-- )
+			idx [ open[j] ] = 0;
+
+		if ( j < 0 )
+			return result;
+	}
+}
+
+p_Formula Scalarizer::expand ( const ArrayWrite & aw, const Cells & c ) const
+{
+	const auto & idx_1 = aw.indices_1();
+	const auto & idx_2 = aw.indices_2();
+	const auto & values = aw.values();
+	const unsigned int n1 = idx_1.size();
+	const unsigned int block = c.dims.back();
+
+	// Indices must be in bounds
+	p_Formula result;
+	auto bound = [&] ( const Term & t, unsigned int d )
+	{
+		int k = 0;
+		if ( constant ( t, k ) )
+			return k >= 0 && (unsigned int) k < d;
+
+		result = conj ( move ( result ), conj (
+				relation ( RelationOp::geq, copy ( t ), make_unique < IntConstant > ( 0 ) ),
+				relation ( RelationOp::lt,  copy ( t ), make_unique < IntConstant > ( d ) ) ) );
+		return true;
+	};
+
+	for ( unsigned int i = 0; i < n1; i++ )
+	{
+		if ( !bound ( *idx_1[i], c.dims[i] ) )
+			return truth ( false );
+	}
+
+	for ( const Term * t : idx_2 )
+	{
+		if ( !bound ( *t, block ) )
+			return truth ( false );
+	}
+
+	for ( unsigned int offset = 0; offset < c.vars.size(); offset++ )
+	{
+		Variable & cell = *c.vars[offset];
+		auto keep = [&] { return relation ( RelationOp::eq, ref ( cell, true ), ref ( cell, false ) ); };
+
+		// Position of the cell
+		vector < unsigned int > pos ( c.dims.size() );
+		for ( unsigned int i = c.dims.size(), o = offset; i-- > 0; o /= c.dims[i] )
+			pos[i] = o % c.dims[i];
+
+		// Is the block of the cell written?
+		p_Formula sel;
+		bool never = false;
+		for ( unsigned int i = 0; i < n1 && !never; i++ )
+		{
+			int k = 0;
+			if ( !constant ( *idx_1[i], k ) )
+				sel = conj ( move ( sel ), equals ( *idx_1[i], pos[i] ) );
+			else
+				never = (unsigned int) k != pos[i];
+		}
+
+		if ( never )
+		{
+			result = conj ( move ( result ), keep() );
+			continue;
+		}
+
+		// Later writes win
+		p_Formula e = keep();
+		for ( unsigned int j = 0; j < idx_2.size(); j++ )
+		{
+			p_Formula set = relation ( RelationOp::eq, ref ( cell, true ), copy ( *values[j] ) );
+
+			int k = 0;
+			if ( constant ( *idx_2[j], k ) )
+			{
+				if ( (unsigned int) k == pos[n1] )
+					e = move ( set );
+				continue;
+			}
+
+			p_Formula hit = equals ( *idx_2[j], pos[n1] );
+			p_Formula miss = relation ( RelationOp::neq, copy ( *idx_2[j] ),
+					make_unique < IntConstant > ( pos[n1] ) );
+			e = disj ( conj ( move ( hit ), move ( set ) ), conj ( move ( miss ), move ( e ) ) );
+		}
+
+		if ( sel )
+		{
+			p_Formula other = make_unique < FormulaNot > ( p_Formula ( sel->clone() ) );
+			e = disj ( conj ( move ( sel ), move ( e ) ), conj ( move ( other ), keep() ) );
+		}
+
+		result = conj ( move ( result ), move ( e ) );
+	}
+
+	return result ? move ( result ) : truth ( true );
+}
+
+p_Formula Scalarizer::havoc ( p_Formula f ) const
+{
+	auto & h = static_cast < const Havoc & > ( *f );
+	bool any = false;
+	for ( const VariableUse & u : h.variables )
+		any = any || _arrays.count ( u.get() );
+
+	if ( !any )
+		return f;
+
+	auto result = make_unique < Havoc > ();
+	for ( const VariableUse & u : h.variables )
+	{
+		auto it = _arrays.find ( u.get() );
+		if ( it == _arrays.end() )
+		{
+			result->variables.push_back ( u.get() );
+			continue;
+		}
+
+		for ( Variable * cell : it->second.vars )
+			result->variables.push_back ( cell );
+	}
+
+	return result;
+}
+
+} // anonymous namespace
+
+unsigned int scalarize_arrays ( BasicNts & bn, unsigned int max_cells )
+{
+	// Candidates, in the order of declaration
+	vector < std::pair < Variable *, Cells > > candidates;
+	unordered_set < const Variable * > accepted;
+	Reads reads;
+	for ( Variable * v : bn.variables() )
+	{
+		Cells c;
+		if ( !dimensions ( v->type(), c.dims ) )
+			continue;
+
+		unsigned long n = 1;
+		for ( unsigned int d : c.dims )
+			n = n > max_cells ? n : n * d;
+
+		if ( n > max_cells || !scalarizable ( *v, c, bn, reads ) )
+			continue;
+
+		candidates.emplace_back ( v, move ( c ) );
+		accepted.insert ( v );
+	}
+
+	// A proposition splits once for each read (including nested ones).
+	// Arrays read by a proposition with too many cases are kept.
+	for ( bool again = true; again; )
+	{
+		again = false;
+		for ( const auto & p : reads )
+		{
+			unsigned long n = 1;
+			for ( const auto & r : p.second )
+			{
+				if ( accepted.count ( r.first ) )
+					n = n > max_cells ? n : n * r.second;
+			}
+
+			if ( n <= max_cells )
+				continue;
+
+			for ( const auto & r : p.second )
+				again = accepted.erase ( r.first ) || again;
+		}
+	}
+
+	Arrays arrays;
+	for ( auto & a : candidates )
+	{
+		Variable * v = a.first;
+		Cells & c = a.second;
+		if ( !accepted.count ( v ) )
+			continue;
+
+		unsigned int n = 1;
+		for ( unsigned int d : c.dims )
+			n *= d;
+
+		for ( unsigned int offset = 0; offset < n; offset++ )
+		{
+			string suffix;
+			for ( unsigned int i = c.dims.size(), o = offset; i-- > 0; o /= c.dims[i] )
+				suffix = "_" + to_string ( o % c.dims[i] ) + suffix;
+
+			auto cell = new Variable ( DataType ( v->type().scalar_type() ), v->name + suffix );
+			cell->insert_before ( *v );
+			c.vars.push_back ( cell );
+		}
+
+		arrays.emplace ( v, move ( c ) );
+	}
+
+	if ( arrays.empty() )
+		return 0;
+
+	Scalarizer s ( arrays );
+	for ( Transition * t : bn.transitions() )
+	{
+		if ( t->rule().kind() != TransitionRule::Kind::Formula )
+			continue;
+
+		static_cast < FormulaTransitionRule & > ( t->rule() ).transform_formula (
+				[&] ( p_Formula f ) { return s.rewrite ( move ( f ) ); } );
+	}
+
+	for ( const auto & a : arrays )
+	{
+		Variable * v = const_cast < Variable * > ( a.first );
+		if ( !v->uses().empty() )
+			throw logic_error ( "Scalarized array is still used" );
+
+		v->remove_from_parent();
+		delete v;
+	}
+
+	return arrays.size();
+}
+
+unsigned int scalarize_arrays ( Nts & nts, unsigned int max_cells )
+{
+	unsigned int n = 0;
+	for ( BasicNts * bn : nts.basic_ntses() )
+		n += scalarize_arrays ( *bn, max_cells );
+
+	return n;
+}
+
+} // namespace nts
@@ -0,0 +1,43 @@
+#ifndef NTS_SCALARIZE_HPP_
+#define NTS_SCALARIZE_HPP_
+#pragma once
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Replaces local arrays of constant size by one scalar variable
+ * per cell (a[2][3] by a_0_0, .., a_1_2, in row-major order).
+ *
+ * Reads with constant indices become references to cells. A read with
+ * symbolic indices splits its atomic proposition into a disjunction
+ * over the cells it may read, guarded by equalities of the indices.
+ * An array write constrains every cell: the written ones get their
+ * values (later writes win), the others keep their value. Havocs of
+ * an array havoc all of its cells. Accesses out of bounds are false,
+ * so that they disable the transition, as they do in the evaluator.
+ * To keep it so, writes and reads with symbolic indices are scalarized
+ * only in positive positions (not negated, not in the premise of an
+ * implication and not under an equivalence).
+ *
+ * An array is kept, if it has more than max_cells cells, if a single
+ * proposition would split into more than max_cells cases (counting reads
+ * of all arrays, nested ones too), or if it is
+ * used in other way than by full reads, writes of scalar values and
+ * havocs of transition formulas (e.g. by a call or in a negative position).
+ *
+ * @return number of scalarized arrays
+ */
+unsigned int scalarize_arrays ( BasicNts & bn, unsigned int max_cells = 64 );
+
+/**
+ * @brief Scalarizes local arrays of all basic ntses.
+ * Global arrays are kept.
+ */
+unsigned int scalarize_arrays ( Nts & nts, unsigned int max_cells = 64 );
+
+} // namespace nts
+
+#endif // NTS_SCALARIZE_HPP_
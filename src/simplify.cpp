@@ -0,0 +1,603 @@
+#include <memory>
+#include <vector>
+#include <utility>    // move()
+#include <limits>
+#include <cstdint>
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "simplify.hpp"
+
+using std::unique_ptr;
+using std::make_unique;
+using std::vector;
+using std::move;
+
+namespace nts
+{
+
+namespace
+{
+
+using p_Term    = unique_ptr < Term    >;
+using p_Formula = unique_ptr < Formula >;
+
+p_Term    simplify_term    ( p_Term t, unsigned int ctx );
+p_Formula simplify_formula ( p_Formula f );
+
+//------------------------------------//
+// Constants                          //
+//------------------------------------//
+
+/**
+ * Sort of a term in given context, as in ExpressionCompiler:
+ * bitwidth of a bitvector, 0 for Int (and anything else).
+ * Integral terms (constants) take the sort of the context.
+ */
+unsigned int sort_of ( const DataType & type, unsigned int ctx )
+{
+	if ( !type.is_scalar() )
+		return 0;
+
+	const ScalarType & st = type.scalar_type();
+	if ( st.is_bitvector() )
+		return st.bitwidth();
+
+	return st == ScalarType::Integral() ? ctx : 0;
+}
+
+std::int64_t wrap ( std::int64_t v, unsigned int sort )
+{
+	if ( sort == 0 || sort >= 64 )
+		return v;
+
+	return v & ( ( std::int64_t ( 1 ) << sort ) - 1 );
+}
+
+bool fits_int ( std::int64_t v )
+{
+	return v >= std::numeric_limits < int >::min() &&
+		v <= std::numeric_limits < int >::max();
+}
+
+// Value of an integer constant in a context of given sort
+bool int_constant ( const Term & t, unsigned int sort, std::int64_t & value )
+{
+	if ( t.term_type() != Term::TermType::Leaf ||
+			static_cast < const Leaf & > ( t ).leaf_type() != Leaf::LeafType::IntConstant )
+		return false;
+
+	value = wrap ( static_cast < const IntConstant & > ( t ).value(), sort );
+	return true;
+}
+
+bool bool_constant ( const Formula & f, bool & value )
+{
+	if ( f.type() != Formula::Type::AtomicProposition ||
+			static_cast < const AtomicProposition & > ( f ).aptype() !=
+				AtomicProposition::APType::BooleanTerm )
+		return false;
+
+	const Term & t = static_cast < const BooleanTerm & > ( f ).term();
+	if ( t.term_type() != Term::TermType::Leaf ||
+			static_cast < const Leaf & > ( t ).leaf_type() != Leaf::LeafType::BoolConstant )
+		return false;
+
+	value = static_cast < const BoolConstant & > ( t ).value();
+	return true;
+}
+
+p_Formula bool_formula ( bool value )
+{
+	return make_unique < BooleanTerm > ( make_unique < BoolConstant > ( value ) );
+}
+
+//------------------------------------//
+// Terms                              //
+//------------------------------------//
+
+// Division and modulo as in CompiledFormula
+bool fold ( ArithOp op, std::int64_t a, std::int64_t b, unsigned int sort,
+		const DataType & type, std::int64_t & result )
+{
+	using U = std::uint64_t;
+
+	switch ( op )
+	{
+		case ArithOp::Add:
+			result = (std::int64_t) ( (U) a + (U) b );
+			break;
+
+		case ArithOp::Sub:
+			result = (std::int64_t) ( (U) a - (U) b );
+			break;
+
+		case ArithOp::Mul:
+			result = (std::int64_t) ( (U) a * (U) b );
+			break;
+
+		case ArithOp::Div:
+		case ArithOp::Mod:
+		{
+			// Integral division depends on the context
+			const bool bv = type.is_scalar() && type.scalar_type().is_bitvector();
+			const bool in = type.is_scalar() && type.scalar_type() == ScalarType::Integer();
+			if ( b == 0 || !( bv || in ) )
+				return false;
+
+			if ( bv )
+			{
+				result = op == ArithOp::Div ?
+					(std::int64_t) ( (U) a / (U) b ) :
+					(std::int64_t) ( (U) a % (U) b );
+				break;
+			}
+
+			std::int64_t q = a / b;
+			std::int64_t r = a % b;
+			if ( r < 0 )
+			{
+				q = b > 0 ? q - 1 : q + 1;
+				r += b > 0 ? b : -b;
+			}
+			result = op == ArithOp::Div ? q : r;
+			break;
+		}
+	}
+
+	result = wrap ( result, sort );
+	return fits_int ( result );
+}
+
+p_Term arithmetic ( p_Term t, unsigned int ctx )
+{
+	auto & aop = static_cast < ArithmeticOperation & > ( *t );
+	const unsigned int sort = sort_of ( aop.type(), ctx );
+	aop.transform_terms ( [ sort ] ( p_Term s ) {
+		return simplify_term ( move ( s ), sort );
+	} );
+
+	std::int64_t a, b;
+	const bool c1 = int_constant ( aop.term1(), sort, a );
+	const bool c2 = int_constant ( aop.term2(), sort, b );
+
+	if ( c1 && c2 )
+	{
+		std::int64_t v;
+		if ( fold ( aop.operation(), a, b, sort, aop.type(), v ) )
+			return make_unique < IntConstant > ( (int) v );
+		return t;
+	}
+
+	// Remaining operand must be of the same type as the operation
+	const bool keep_1 = aop.term1().type() == aop.type();
+	const bool keep_2 = aop.term2().type() == aop.type();
+
+	switch ( aop.operation() )
+	{
+		case ArithOp::Add:
+			if ( c1 && a == 0 && keep_2 )
+				return aop.release_term2();
+			if ( c2 && b == 0 && keep_1 )
+				return aop.release_term1();
+			break;
+
+		case ArithOp::Sub:
+			if ( c2 && b == 0 && keep_1 )
+				return aop.release_term1();
+			break;
+
+		case ArithOp::Mul:
+			if ( c1 && a == 1 && keep_2 )
+				return aop.release_term2();
+			if ( c2 && b == 1 && keep_1 )
+				return aop.release_term1();
+			break;
+
+		case ArithOp::Div:
+			if ( c2 && b == 1 && keep_1 )
+				return aop.release_term1();
+			break;
+
+		case ArithOp::Mod:
+			break;
+	}
+
+	return t;
+}
+
+p_Term minus ( p_Term t, unsigned int ctx )
+{
+	auto & mt = static_cast < MinusTerm & > ( *t );
+	const unsigned int sort = sort_of ( mt.type(), ctx );
+	mt.transform_term ( [ sort ] ( p_Term s ) {
+		return simplify_term ( move ( s ), sort );
+	} );
+
+	std::int64_t a;
+	if ( int_constant ( mt.term(), sort, a ) )
+	{
+		const std::int64_t v = wrap ( (std::int64_t) ( - (std::uint64_t) a ), sort );
+		if ( fits_int ( v ) )
+			return make_unique < IntConstant > ( (int) v );
+		return t;
+	}
+
+	if ( mt.term().term_type() == Term::TermType::MinusTerm )
+	{
+		auto & inner = static_cast < MinusTerm & > ( mt.term() );
+		if ( inner.term().type() == mt.type() )
+			return inner.release_term();
+	}
+
+	return t;
+}
+
+/**
+ * @param ctx Sort of the context, in which the term is evaluated.
+ *            Zero is always safe (folding is exact then).
+ */
+p_Term simplify_term ( p_Term t, unsigned int ctx )
+{
+	switch ( t->term_type() )
+	{
+		case Term::TermType::ArithmeticOperation:
+			return arithmetic ( move ( t ), ctx );
+
+		case Term::TermType::MinusTerm:
+			return minus ( move ( t ), ctx );
+
+		case Term::TermType::ArrayTerm:
+			static_cast < ArrayTerm & > ( *t ).transform_indices ( [] ( p_Term s ) {
+				return simplify_term ( move ( s ), 0 );
+			} );
+			return t;
+
+		case Term::TermType::Leaf:
+			return t;
+	}
+
+	return t;
+}
+
+//------------------------------------//
+// Formulas                           //
+//------------------------------------//
+
+RelationOp negated ( RelationOp op )
+{
+	switch ( op )
+	{
+		case RelationOp::eq:  return RelationOp::neq;
+		case RelationOp::neq: return RelationOp::eq;
+		case RelationOp::leq: return RelationOp::gt;
+		case RelationOp::lt:  return RelationOp::geq;
+		case RelationOp::geq: return RelationOp::lt;
+		case RelationOp::gt:  return RelationOp::leq;
+	}
+	return op;
+}
+
+// ( a op b ) is ( b mirrored ( op ) a )
+RelationOp mirrored ( RelationOp op )
+{
+	switch ( op )
+	{
+		case RelationOp::eq:  return RelationOp::eq;
+		case RelationOp::neq: return RelationOp::neq;
+		case RelationOp::leq: return RelationOp::geq;
+		case RelationOp::lt:  return RelationOp::gt;
+		case RelationOp::geq: return RelationOp::leq;
+		case RelationOp::gt:  return RelationOp::lt;
+	}
+	return op;
+}
+
+template < typename T >
+bool compare ( RelationOp op, T a, T b )
+{
+	switch ( op )
+	{
+		case RelationOp::eq:  return a == b;
+		case RelationOp::neq: return a != b;
+		case RelationOp::leq: return a <= b;
+		case RelationOp::lt:  return a <  b;
+		case RelationOp::geq: return a >= b;
+		case RelationOp::gt:  return a >  b;
+	}
+	return false;
+}
+
+bool is_scalar_relation ( const Formula & f )
+{
+	return f.type() == Formula::Type::AtomicProposition &&
+		static_cast < const AtomicProposition & > ( f ).aptype() ==
+			AtomicProposition::APType::Relation &&
+		static_cast < const Relation & > ( f ).type().is_scalar();
+}
+
+p_Formula relation ( p_Formula f )
+{
+	auto & r = static_cast < Relation & > ( *f );
+	const unsigned int sort = sort_of ( r.type(), 0 );
+	r.transform_terms ( [ sort ] ( p_Term t ) {
+		return simplify_term ( move ( t ), sort );
+	} );
+
+	if ( !r.type().is_scalar() )
+		return f;
+
+	std::int64_t a, b;
+	const bool c1 = int_constant ( r.term1(), sort, a );
+	const bool c2 = int_constant ( r.term2(), sort, b );
+	if ( c1 && c2 )
+	{
+		return bool_formula ( sort > 0 ?
+				compare < std::uint64_t > ( r.operation(), a, b ) :
+				compare < std::int64_t  > ( r.operation(), a, b ) );
+	}
+
+	if ( structurally_equal ( r.term1(), r.term2() ) )
+	{
+		const RelationOp op = r.operation();
+		return bool_formula ( op == RelationOp::eq || op == RelationOp::leq ||
+				op == RelationOp::geq );
+	}
+
+	if ( c1 )
+	{
+		p_Term t1 = r.release_term1();
+		p_Term t2 = r.release_term2();
+		return make_unique < Relation > ( mirrored ( r.operation() ), move ( t2 ), move ( t1 ) );
+	}
+
+	return f;
+}
+
+// Negation of a simplified formula
+p_Formula negate ( p_Formula g )
+{
+	bool v;
+	if ( bool_constant ( *g, v ) )
+		return bool_formula ( !v );
+
+	if ( g->type() == Formula::Type::FormulaNot )
+		return static_cast < FormulaNot & > ( *g ).release_formula();
+
+	if ( is_scalar_relation ( *g ) )
+	{
+		auto & r = static_cast < Relation & > ( *g );
+		p_Term t1 = r.release_term1();
+		p_Term t2 = r.release_term2();
+		return make_unique < Relation > ( negated ( r.operation() ), move ( t1 ), move ( t2 ) );
+	}
+
+	return make_unique < FormulaNot > ( move ( g ) );
+}
+
+bool is_and ( const Formula & f )
+{
+	return f.type() == Formula::Type::FormulaBop &&
+		static_cast < const FormulaBop & > ( f ).op() == BoolOp::And;
+}
+
+bool is_havoc ( const Formula & f )
+{
+	return f.type() == Formula::Type::AtomicProposition &&
+		static_cast < const AtomicProposition & > ( f ).aptype() ==
+			AtomicProposition::APType::Havoc;
+}
+
+// Flattens an And chain into simplified conjuncts
+void conjuncts ( p_Formula f, vector < p_Formula > & out, bool simplified )
+{
+	if ( is_and ( *f ) )
+	{
+		auto & bop = static_cast < FormulaBop & > ( *f );
+		conjuncts ( bop.release_formula_1(), out, simplified );
+		conjuncts ( bop.release_formula_2(), out, simplified );
+		return;
+	}
+
+	if ( simplified )
+		out.push_back ( move ( f ) );
+	else
+		conjuncts ( simplify_formula ( move ( f ) ), out, true );
+}
+
+// havoc ( A ) && havoc ( B ) is havoc ( A intersected with B )
+void merge_havocs ( Havoc & first, const vector < const Havoc * > & others )
+{
+	VariableSet common = first.variable_set();
+	for ( const Havoc * h : others )
+		common &= h->variable_set();
+
+	first.restrict_to ( common );
+}
+
+p_Formula conjunction ( p_Formula f )
+{
+	vector < p_Formula > parts;
+	conjuncts ( move ( f ), parts, false );
+
+	vector < p_Formula > kept;
+	Havoc * havoc = nullptr;
+	vector < const Havoc * > other_havocs;
+
+	for ( p_Formula & g : parts )
+	{
+		bool v;
+		if ( bool_constant ( *g, v ) )
+		{
+			if ( !v )
+				return bool_formula ( false );
+			continue;
+		}
+
+		if ( is_havoc ( *g ) )
+		{
+			if ( havoc )
+			{
+				other_havocs.push_back ( static_cast < const Havoc * > ( g.get() ) );
+				continue;
+			}
+			havoc = static_cast < Havoc * > ( g.get() );
+		}
+
+		kept.push_back ( move ( g ) );
+	}
+
+	if ( !other_havocs.empty() )
+		merge_havocs ( *havoc, other_havocs );
+
+	if ( kept.empty() )
+		return bool_formula ( true );
+
+	p_Formula result = move ( kept[0] );
+	for ( unsigned int i = 1; i < kept.size(); i++ )
+		result = make_unique < FormulaBop > ( BoolOp::And, move ( result ), move ( kept[i] ) );
+
+	return result;
+}
+
+p_Formula binary ( p_Formula f )
+{
+	auto & bop = static_cast < FormulaBop & > ( *f );
+	if ( bop.op() == BoolOp::And )
+		return conjunction ( move ( f ) );
+
+	bop.transform_formulas ( simplify_formula );
+
+	bool a, b;
+	const bool c1 = bool_constant ( bop.formula_1(), a );
+	const bool c2 = bool_constant ( bop.formula_2(), b );
+
+	switch ( bop.op() )
+	{
+		case BoolOp::Or:
+			if ( ( c1 && a ) || ( c2 && b ) )
+				return bool_formula ( true );
+			if ( c1 )
+				return bop.release_formula_2();
+			if ( c2 )
+				return bop.release_formula_1();
+			break;
+
+		case BoolOp::Imply:
+			if ( ( c1 && !a ) || ( c2 && b ) )
+				return bool_formula ( true );
+			if ( c1 )
+				return bop.release_formula_2();
+			if ( c2 )
+				return negate ( bop.release_formula_1() );
+			break;
+
+		case BoolOp::Equiv:
+			if ( c1 && c2 )
+				return bool_formula ( a == b );
+			if ( c1 )
+				return a ? bop.release_formula_2() : negate ( bop.release_formula_2() );
+			if ( c2 )
+				return b ? bop.release_formula_1() : negate ( bop.release_formula_1() );
+			break;
+
+		case BoolOp::And:
+			break;
+	}
+
+	return f;
+}
+
+p_Formula simplify_formula ( p_Formula f )
+{
+	switch ( f->type() )
+	{
+		case Formula::Type::FormulaBop:
+			return binary ( move ( f ) );
+
+		case Formula::Type::FormulaNot:
+			return negate ( simplify_formula (
+						static_cast < FormulaNot & > ( *f ).release_formula() ) );
+
+		case Formula::Type::QuantifiedFormula:
+		{
+			auto & qf = static_cast < QuantifiedFormula & > ( *f );
+			qf.transform_formula ( simplify_formula );
+
+			bool v;
+			if ( bool_constant ( qf.formula(), v ) &&
+					v == ( qf.list.quantifier == Quantifier::Forall ) )
+				return bool_formula ( v );
+			return f;
+		}
+
+		case Formula::Type::AtomicProposition:
+			break;
+	}
+
+	auto & ap = static_cast < AtomicProposition & > ( *f );
+	switch ( ap.aptype() )
+	{
+		case AtomicProposition::APType::Relation:
+			return relation ( move ( f ) );
+
+		case AtomicProposition::APType::BooleanTerm:
+			static_cast < BooleanTerm & > ( ap ).transform_term ( [] ( p_Term t ) {
+				return simplify_term ( move ( t ), 0 );
+			} );
+			break;
+
+		case AtomicProposition::APType::ArrayWrite:
+			static_cast < ArrayWrite & > ( ap ).transform_terms ( [] ( p_Term t ) {
+				return simplify_term ( move ( t ), 0 );
+			} );
+			break;
+
+		case AtomicProposition::APType::Havoc:
+			break;
+	}
+
+	return f;
+}
+
+} // anonymous namespace
+
+//------------------------------------//
+// Simplification                     //
+//------------------------------------//
+
+unique_ptr < Term > simplify ( unique_ptr < Term > t )
+{
+	return simplify_term ( move ( t ), 0 );
+}
+
+unique_ptr < Formula > simplify ( unique_ptr < Formula > f )
+{
+	return simplify_formula ( move ( f ) );
+}
+
+void simplify ( BasicNts & bn )
+{
+	for ( Transition * t : bn.transitions() )
+	{
+		TransitionRule & r = t->rule();
+		if ( r.kind() == TransitionRule::Kind::Formula )
+		{
+			static_cast < FormulaTransitionRule & > ( r ).transform_formula ( simplify_formula );
+			continue;
+		}
+
+		static_cast < CallTransitionRule & > ( r ).transform_terms_in ( [] ( p_Term s ) {
+			return simplify_term ( move ( s ), 0 );
+		} );
+	}
+}
+
+void simplify ( Nts & nts )
+{
+	nts.transform_initial_formula ( simplify_formula );
+	for ( BasicNts * bn : nts.basic_ntses() )
+		simplify ( *bn );
+}
+
+} // namespace nts
@@ -0,0 +1,48 @@
+#ifndef NTS_SIMPLIFY_HPP_
+#define NTS_SIMPLIFY_HPP_
+#pragma once
+
+#include <memory>
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Constant folding and algebraic simplification.
+ *
+ * Terms:
+ *  - +, -, * and unary minus of integer constants are folded.
+ *    In a bitvector context, the result is wrapped to the bitwidth
+ *    (as in CompiledFormula). Division and modulo are folded only
+ *    for Int and bitvector operations, and never by zero.
+ *  - x + 0, 0 + x, x - 0, x * 1, 1 * x, x / 1 and - - x become x.
+ * Formulas:
+ *  - conjunctions are flattened, 'true' conjuncts are dropped,
+ *    a 'false' conjunct makes the whole conjunction 'false',
+ *    and all havocs of a conjunction are merged into one,
+ *    since havoc(A) && havoc(B) is havoc(A intersected with B),
+ *  - ||, ->, <->, ! and quantifiers with a constant operand are reduced,
+ *  - negation of a scalar relation negates the relation operator,
+ *  - relations of two constants, and relations of structurally equal
+ *    terms (x = x, x < x, ...) are decided,
+ *  - a constant on the left side of a relation is moved to the right.
+ * Quantifier bounds and sizes of array types are not simplified.
+ *
+ * Each node is visited once, so the pass runs in linear time.
+ * Both functions take ownership of the argument and return
+ * the simplified version (which may be the argument itself).
+ */
+std::unique_ptr < Term    > simplify ( std::unique_ptr < Term    > t );
+std::unique_ptr < Formula > simplify ( std::unique_ptr < Formula > f );
+
+// Simplifies all transition rules (and call arguments) in place
+void simplify ( BasicNts & bn );
+
+// Simplifies the initial formula and all BasicNtses
+void simplify ( Nts & nts );
+
+} // namespace nts
+
+#endif // NTS_SIMPLIFY_HPP_
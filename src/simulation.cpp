@@ -0,0 +1,289 @@
+#include <stdexcept>
+#include <algorithm>
+#include <unordered_map>
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "evaluator.hpp"
+#include "simulation.hpp"
+
+using std::vector;
+using std::unordered_map;
+using std::domain_error;
+
+namespace nts
+{
+
+namespace
+{
+
+using BatchMask = CompiledExpression::BatchMask;
+const unsigned int B = CompiledExpression::batch_size;
+
+// SplitMix64, small and good enough for fuzzing
+class Random
+{
+	private:
+		std::uint64_t _state;
+
+	public:
+		explicit Random ( std::uint64_t seed ) :
+			_state ( seed )
+		{
+			;
+		}
+
+		std::uint64_t operator() ()
+		{
+			std::uint64_t z = ( _state += 0x9e3779b97f4a7c15ULL );
+			z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+			z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+			return z ^ ( z >> 31 );
+		}
+
+		// Uniform in [0, n)
+		std::uint64_t below ( std::uint64_t n )
+		{
+			return ( *this ) () % n;
+		}
+};
+
+unsigned int slot_width ( const Variable & v )
+{
+	const ScalarType & st = v.type().scalar_type();
+	if ( st.is_bitvector() )
+		return st.bitwidth();
+	return st == ScalarType::Bool() ? 1 : 0;
+}
+
+} // anonymous namespace
+
+//------------------------------------//
+// Simulation                         //
+//------------------------------------//
+
+Simulation::Simulation ( const BasicNts & bn ) :
+	_bn          ( bn     ),
+	_layout      ( bn     ),
+	_max_choices ( 0      ),
+	n_runs       ( 1024   ),
+	n_steps      ( 100    ),
+	seed         ( 0      ),
+	int_range    ( 1024   ),
+	restart      ( true   )
+{
+	unordered_map < const State *, unsigned int > ids;
+	for ( const State * s : bn.states() )
+	{
+		if ( s->is_initial() )
+			_initial.push_back ( _states.size() );
+		ids.emplace ( s, _states.size() );
+		_states.push_back ( s );
+	}
+
+	if ( _initial.empty() )
+		throw domain_error ( "BasicNts " + bn.name + " has no initial state" );
+
+	_outgoing.resize ( _states.size() );
+	for ( const Transition * t : bn.transitions() )
+	{
+		_transitions.emplace_back ( *t, _layout );
+		_max_choices = std::max < unsigned int > ( _max_choices,
+				_transitions.back().choices().size() );
+
+		_outgoing [ ids.at ( &t->from() ) ].push_back ( _targets.size() );
+		_targets.push_back ( ids.at ( &t->to() ) );
+	}
+
+	for ( const Variable * v : _layout.variables() )
+		_widths.resize ( _widths.size() + _layout.entry ( *v ).size, slot_width ( *v ) );
+}
+
+Simulation::~Simulation()
+{
+	;
+}
+
+//------------------------------------//
+// Simulation::Batch                  //
+//------------------------------------//
+
+/**
+ * @brief Runs simulated together. Slot s of run l is stored
+ * at [s * batch_size + l] (see CompiledExpression).
+ */
+class Simulation::Batch
+{
+	private:
+		const Simulation & _sim;
+		Simulation::Result & _result;
+		Random _random;
+
+		vector < Value > _curr;
+		vector < Value > _candidate;
+		vector < Value > _chosen;
+		vector < Value > _choice;
+
+		unsigned int _control [ B ];
+		BatchMask _alive;
+
+		Value random_value ( unsigned int width );
+		void start ( unsigned int l );
+		void copy_run ( const vector < Value > & from, vector < Value > & to, unsigned int l );
+
+	public:
+		Batch ( const Simulation & sim, Simulation::Result & result, std::uint64_t seed );
+
+		void step();
+};
+
+Simulation::Batch::Batch ( const Simulation & sim, Simulation::Result & result,
+		std::uint64_t seed ) :
+	_sim       ( sim                                          ),
+	_result    ( result                                       ),
+	_random    ( seed                                         ),
+	_curr      ( (std::size_t) sim._layout.size() * B         ),
+	_candidate ( (std::size_t) sim._layout.size() * B         ),
+	_chosen    ( (std::size_t) sim._layout.size() * B         ),
+	_choice    ( (std::size_t) std::max ( sim._max_choices, 1u ) * B ),
+	_alive     ( ~ BatchMask ( 0 )                            )
+{
+	for ( unsigned int l = 0; l < B; l++ )
+		start ( l );
+}
+
+Value Simulation::Batch::random_value ( unsigned int width )
+{
+	if ( width == 0 )
+		return (Value) _random.below ( 2 * (std::uint64_t) _sim.int_range + 1 ) - _sim.int_range;
+
+	std::uint64_t v = _random();
+	return (Value) ( width >= 64 ? v : v & ( ( std::uint64_t ( 1 ) << width ) - 1 ) );
+}
+
+void Simulation::Batch::start ( unsigned int l )
+{
+	_control[l] = _sim._initial [ _random.below ( _sim._initial.size() ) ];
+	for ( unsigned int s = 0; s < _sim._widths.size(); s++ )
+		_curr [ s * B + l ] = random_value ( _sim._widths[s] );
+
+	const State * st = _sim._states [ _control[l] ];
+	if ( st->is_error() )
+		_result.errors[st]++;
+}
+
+void Simulation::Batch::copy_run ( const vector < Value > & from, vector < Value > & to,
+		unsigned int l )
+{
+	for ( std::size_t i = l; i < from.size(); i += B )
+		to[i] = from[i];
+}
+
+void Simulation::Batch::step()
+{
+	// Runs grouped by their control state
+	vector < BatchMask > at ( _sim._states.size(), 0 );
+	vector < unsigned int > occupied;
+	for ( unsigned int l = 0; l < B; l++ )
+	{
+		if ( ! ( _alive >> l & 1 ) || _sim._states [ _control[l] ]->is_error() )
+			continue;
+
+		if ( at [ _control[l] ] == 0 )
+			occupied.push_back ( _control[l] );
+		at [ _control[l] ] |= BatchMask ( 1 ) << l;
+	}
+
+	// Uniform choice among successors by reservoir sampling
+	unsigned int n_successors [ B ] = {};
+	unsigned int via [ B ];
+
+	for ( unsigned int s : occupied )
+	{
+		for ( unsigned int t : _sim._outgoing[s] )
+		{
+			const CompiledTransition & ct = _sim._transitions[t];
+			BatchMask m = at[s] & ct.enabled_batch ( _curr.data() );
+			if ( m == 0 )
+				continue;
+
+			const auto & choices = ct.choices();
+			for ( unsigned int c = 0; c < choices.size(); c++ )
+			{
+				const unsigned int width = _sim._widths [ choices[c].slot ];
+				for ( unsigned int l = 0; l < B; l++ )
+				{
+					if ( m >> l & 1 )
+						_choice [ c * B + l ] = random_value ( width );
+				}
+			}
+
+			BatchMask valid = m;
+			ct.candidate_batch ( _curr.data(), _candidate.data(), _choice.data(), valid );
+			m &= valid & ct.check_batch ( _curr.data(), _candidate.data() );
+
+			for ( unsigned int l = 0; l < B; l++ )
+			{
+				if ( ! ( m >> l & 1 ) )
+					continue;
+
+				if ( _random.below ( ++n_successors[l] ) == 0 )
+				{
+					via[l] = t;
+					copy_run ( _candidate, _chosen, l );
+				}
+			}
+		}
+	}
+
+	for ( unsigned int l = 0; l < B; l++ )
+	{
+		if ( ! ( _alive >> l & 1 ) )
+			continue;
+
+		bool terminal = _sim._states [ _control[l] ]->is_error();
+		if ( !terminal && n_successors[l] == 0 )
+		{
+			_result.n_deadlocks++;
+			terminal = true;
+		}
+
+		if ( terminal )
+		{
+			if ( _sim.restart )
+				start ( l );
+			else
+				_alive &= ~ ( BatchMask ( 1 ) << l );
+			continue;
+		}
+
+		_control[l] = _sim._targets [ via[l] ];
+		copy_run ( _chosen, _curr, l );
+		_result.n_steps++;
+		_result.coverage [ &_sim._transitions [ via[l] ].transition() ]++;
+
+		const State * st = _sim._states [ _control[l] ];
+		if ( st->is_error() )
+			_result.errors[st]++;
+	}
+}
+
+Simulation::Result Simulation::run()
+{
+	Result result { 0, 0, {}, {} };
+	for ( const CompiledTransition & t : _transitions )
+		result.coverage [ &t.transition() ] = 0;
+
+	Random seeds ( seed );
+	const unsigned int n_batches = ( n_runs + B - 1 ) / B;
+	for ( unsigned int b = 0; b < n_batches; b++ )
+	{
+		Batch batch ( *this, result, seeds() );
+		for ( unsigned int k = 0; k < n_steps; k++ )
+			batch.step();
+	}
+
+	return result;
+}
+
+} // namespace nts
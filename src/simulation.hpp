@@ -0,0 +1,89 @@
+#ifndef NTS_SIMULATION_HPP_
+#define NTS_SIMULATION_HPP_
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+#include "nts.hpp"
+#include "evaluator.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Random simulation of many runs of a BasicNts in lockstep.
+ *
+ * Runs are grouped into batches of CompiledExpression::batch_size,
+ * whose valuations are stored as structure of arrays, so that every
+ * instruction of a compiled transition is evaluated for the whole batch
+ * at once. In each step, a run takes one of the enabled transitions
+ * uniformly at random. Havocked variables, which are not determined
+ * by equalities, get fresh random values. Initial values of all variables
+ * are random too.
+ *
+ * Error states are terminal: a run which reaches one (or gets stuck)
+ * starts again from an initial state, or stops, see restart.
+ * Call transitions are not supported.
+ */
+class Simulation
+{
+	public:
+		struct Result
+		{
+			// Transitions taken by all runs
+			std::size_t n_steps;
+			// Runs, which got stuck in a non-error state
+			std::size_t n_deadlocks;
+			// How many times each error state was reached
+			std::unordered_map < const State *, std::size_t > errors;
+			// How many times each transition was taken (zero for uncovered ones)
+			std::unordered_map < const Transition *, std::size_t > coverage;
+		};
+
+	private:
+		const BasicNts & _bn;
+		ValuationLayout _layout;
+
+		std::vector < const State * > _states;
+		std::vector < unsigned int > _initial;
+
+		std::vector < CompiledTransition > _transitions;
+		// Target state id of each transition
+		std::vector < unsigned int > _targets;
+		// Indices of outgoing transitions of each state
+		std::vector < std::vector < unsigned int > > _outgoing;
+
+		// Bitwidth of each slot, 0 for Int
+		std::vector < unsigned int > _widths;
+		unsigned int _max_choices;
+
+		class Batch;
+
+	public:
+		// Throws std::domain_error, if the BasicNts can not be compiled
+		explicit Simulation ( const BasicNts & bn );
+		~Simulation();
+
+		// Rounded up to a multiple of the batch size
+		unsigned int n_runs;
+
+		// Number of steps of each batch
+		unsigned int n_steps;
+
+		std::uint64_t seed;
+
+		// Random integers are taken from [-int_range, int_range]
+		Value int_range;
+
+		// Runs which reach an error state or get stuck start again
+		bool restart;
+
+		Result run();
+};
+
+} // namespace nts
+
+#endif // NTS_SIMULATION_HPP_
@@ -0,0 +1,278 @@
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>    // move()
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "inliner.hpp"
+#include "conjuncts.hpp"
+#include "slice.hpp"
+
+using std::unique_ptr;
+using std::vector;
+using std::unordered_map;
+using std::unordered_set;
+using std::move;
+
+namespace nts
+{
+
+namespace
+{
+
+using p_Formula = unique_ptr < Formula >;
+
+// A top-level conjunct of a formula transition
+struct Conjunct
+{
+	Transition * transition;
+	Formula    * formula;
+	bool         havoc;
+	// Local variable, whose next value is the only one constrained
+	// by the conjunct, or nullptr
+	Variable   * defines;
+	// Variables used by the conjunct
+	vector < Variable * > vars;
+};
+
+// States from which some target can be reached
+unordered_set < const State * > coreachable ( BasicNts & bn )
+{
+	bool called = false;
+	if ( bn.parent() )
+	{
+		auto callers = bn.callers();
+		called = callers.begin() != callers.end();
+	}
+
+	unordered_set < const State * > result;
+	vector < const State * > stack;
+	auto push = [&] ( const State & s )
+	{
+		if ( result.insert ( &s ).second )
+			stack.push_back ( &s );
+	};
+
+	for ( const State * s : bn.states() )
+	{
+		if ( s->is_error() || ( called && s->is_final() ) )
+			push ( *s );
+	}
+
+	for ( const Transition * t : bn.transitions() )
+	{
+		if ( t->rule().kind() == TransitionRule::Kind::Call )
+			push ( t->from() );
+	}
+
+	while ( !stack.empty() )
+	{
+		const State * s = stack.back();
+		stack.pop_back();
+
+		for ( const Transition * t : s->incoming() )
+			push ( t->from() );
+	}
+
+	return result;
+}
+
+} // anonymous namespace
+
+//------------------------------------//
+// Slicing                            //
+//------------------------------------//
+
+unsigned int slice ( BasicNts & bn )
+{
+	// Control: transitions, which can not lead to an error
+	const auto coreach = coreachable ( bn );
+	vector < Transition * > dead;
+	for ( Transition * t : bn.transitions() )
+	{
+		if ( t->rule().kind() == TransitionRule::Kind::Formula &&
+				!coreach.count ( &t->to() ) )
+			dead.push_back ( t );
+	}
+
+	for ( Transition * t : dead )
+		delete t;
+
+	// Data: uses of variables in the remaining transitions
+	const unordered_set < const Variable * > local (
+			bn.variables().begin(), bn.variables().end() );
+
+	unordered_set < const Variable * > relevant;
+	vector < const Variable * > work;
+	auto mark = [&] ( const Variable * v )
+	{
+		if ( local.count ( v ) && relevant.insert ( v ).second )
+			work.push_back ( v );
+	};
+
+	unordered_map < const Variable *, unsigned int > n_uses;
+	vector < Conjunct > conjs;
+
+	for ( Transition * t : bn.transitions() )
+	{
+		if ( t->rule().kind() == TransitionRule::Kind::Call )
+		{
+			visit_variable_uses ( [&] ( VariableUse & u )
+			{
+				n_uses [ u.get() ]++;
+				mark ( u.get() );
+			} ).visit ( t->rule() );
+			continue;
+		}
+
+		vector < Formula * > parts;
+		conjuncts ( static_cast < FormulaTransitionRule & > ( t->rule() ).formula(), parts );
+
+		// Intersection of top-level havocs, see definition of v' = t below
+		const unsigned int first = conjs.size();
+		unordered_map < const Variable *, unsigned int > n_havocs;
+		unsigned int havocs = 0;
+
+		// Further definitions of a variable are guards
+		const vector < Variable * > defs = definitions ( parts );
+
+		for ( unsigned int k = 0; k < parts.size(); k++ )
+		{
+			Formula * f = parts[k];
+			Conjunct c { t, f, false, defs[k], { } };
+			visit_variable_uses ( [&] ( VariableUse & u )
+			{
+				n_uses [ u.get() ]++;
+				c.vars.push_back ( u.get() );
+			} ).visit ( *f );
+
+			if ( atomic ( *f, AtomicProposition::APType::Havoc ) )
+			{
+				c.havoc = true;
+				havocs++;
+				for ( const Variable * v : unordered_set < const Variable * > (
+							c.vars.begin(), c.vars.end() ) )
+					n_havocs [ v ]++;
+			}
+
+			if ( atomic ( *f, AtomicProposition::APType::ArrayWrite ) )
+			{
+				Variable * a = static_cast < ArrayWrite & > ( *f ).array();
+				n_uses [ a ]++;
+				c.vars.push_back ( a );
+			}
+
+			conjs.push_back ( move ( c ) );
+		}
+
+		// If v keeps its value, v' = t is a guard v = t
+		for ( unsigned int k = first; havocs > 0 && k < conjs.size(); k++ )
+		{
+			Variable * v = conjs[k].defines;
+			if ( v && n_havocs [ v ] != havocs )
+				conjs[k].defines = nullptr;
+		}
+	}
+
+	// Variables used outside of transitions (e.g. in types)
+	for ( const Variable * v : bn.variables() )
+	{
+		if ( n_uses [ v ] != v->uses().size() )
+			mark ( v );
+	}
+
+	unordered_map < const Variable *, vector < const Conjunct * > > definitions;
+	for ( const Conjunct & c : conjs )
+	{
+		if ( c.defines && local.count ( c.defines ) )
+		{
+			definitions [ c.defines ].push_back ( &c );
+		}
+		else if ( !c.havoc )
+		{
+			for ( const Variable * v : c.vars )
+				mark ( v );
+		}
+	}
+
+	while ( !work.empty() )
+	{
+		const Variable * v = work.back();
+		work.pop_back();
+
+		for ( const Conjunct * c : definitions [ v ] )
+		{
+			for ( const Variable * w : c->vars )
+				mark ( w );
+		}
+	}
+
+	// Drop definitions of irrelevant variables and shrink havocs
+	unordered_set < const Formula * > dropped;
+	unordered_set < Transition * > changed;
+	for ( Conjunct & c : conjs )
+	{
+		if ( c.havoc )
+		{
+			auto & vars = static_cast < Havoc & > ( *c.formula ).variables;
+			for ( auto it = vars.begin(); it != vars.end(); )
+			{
+				if ( local.count ( it->get() ) && !relevant.count ( it->get() ) )
+					it = vars.erase ( it );
+				else
+					++it;
+			}
+		}
+		else if ( c.defines && local.count ( c.defines ) && !relevant.count ( c.defines ) )
+		{
+			dropped.insert ( c.formula );
+			changed.insert ( c.transition );
+		}
+	}
+
+	for ( Transition * t : changed )
+	{
+		static_cast < FormulaTransitionRule & > ( t->rule() ).transform_formula (
+				[&] ( p_Formula f )
+		{
+			vector < p_Formula > parts;
+			vector < p_Formula > kept;
+			split ( move ( f ), parts );
+			for ( p_Formula & g : parts )
+			{
+				if ( !dropped.count ( g.get() ) )
+					kept.push_back ( move ( g ) );
+			}
+			return conjunction ( move ( kept ) );
+		} );
+	}
+
+	// Irrelevant variables are not used anymore
+	vector < Variable * > removed;
+	for ( Variable * v : bn.variables() )
+	{
+		if ( !relevant.count ( v ) )
+			removed.push_back ( v );
+	}
+
+	for ( Variable * v : removed )
+	{
+		v->remove_from_parent();
+		delete v;
+	}
+
+	return removed.size();
+}
+
+unsigned int slice ( Nts & nts )
+{
+	unsigned int n_removed = 0;
+	for ( BasicNts * bn : nts.basic_ntses() )
+		n_removed += slice ( *bn );
+
+	return n_removed;
+}
+
+} // namespace nts
@@ -0,0 +1,38 @@
+#ifndef NTS_SLICE_HPP_
+#define NTS_SLICE_HPP_
+#pragma once
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Cone-of-influence slicing with respect to error states.
+ *
+ * Formula transitions, from whose target no error state can be reached,
+ * are deleted. States with an outgoing call (the callee may fail) and,
+ * if the BasicNts is called, final states count as error states.
+ *
+ * A local variable is relevant, if it is read by a guard (a top-level
+ * conjunct, which is neither a havoc nor a definition v' = t
+ * or a write to array v of a transition changing v), by a call,
+ * or by a definition of another relevant variable. Variables of the Nts and parameters are
+ * always relevant, as are variables used outside of transitions.
+ * Definitions of irrelevant variables are dropped, the variables
+ * are removed from havocs and deleted.
+ *
+ * Only the first definition of a variable in a transition counts,
+ * further ones are guards; t must not refer to next values.
+ *
+ * Reachability of error states is preserved, as long as definitions
+ * of irrelevant variables can always be satisfied.
+ *
+ * @return number of removed variables
+ */
+unsigned int slice ( BasicNts & bn );
+unsigned int slice ( Nts & nts );
+
+} // namespace nts
+
+#endif // NTS_SLICE_HPP_
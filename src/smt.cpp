@@ -0,0 +1,853 @@
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <algorithm>
+#include <utility>
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "smt.hpp"
+
+using std::ostream;
+using std::string;
+using std::vector;
+using std::unordered_map;
+using std::domain_error;
+using std::logic_error;
+using std::to_string;
+
+namespace nts
+{
+
+namespace
+{
+
+// Sorts which are distinguished when printing a term
+const std::intptr_t sort_integer  =  0;
+const std::intptr_t sort_integral = -1;
+const std::intptr_t sort_real     = -2;
+const std::intptr_t sort_array    = -3;
+
+// Bitvectors are encoded by their (positive) bitwidth
+std::intptr_t sort_code ( const ScalarType & t )
+{
+	if ( t.is_bitvector() )
+		return t.bitwidth();
+
+	if ( t == ScalarType::Integral() )
+		return sort_integral;
+
+	if ( t == ScalarType::Real() )
+		return sort_real;
+
+	return sort_integer;
+}
+
+std::intptr_t sort_code ( const DataType & t )
+{
+	if ( !t.is_scalar() )
+		return sort_array;
+
+	return sort_code ( t.scalar_type() );
+}
+
+const char * to_smt ( BoolOp op )
+{
+	switch ( op )
+	{
+		case BoolOp::And:   return "and";
+		case BoolOp::Or:    return "or";
+		case BoolOp::Imply: return "=>";
+		case BoolOp::Equiv: return "=";
+	}
+
+	throw domain_error ( "Unknown value of BoolOp" );
+}
+
+const char * to_smt ( ArithOp op, bool bitvector )
+{
+	switch ( op )
+	{
+		case ArithOp::Add: return bitvector ? "bvadd"  : "+";
+		case ArithOp::Sub: return bitvector ? "bvsub"  : "-";
+		case ArithOp::Mul: return bitvector ? "bvmul"  : "*";
+		case ArithOp::Div: return bitvector ? "bvudiv" : "div";
+		case ArithOp::Mod: return bitvector ? "bvurem" : "mod";
+	}
+
+	throw domain_error ( "Unknown ArithOp" );
+}
+
+const char * to_smt ( RelationOp op, bool bitvector )
+{
+	switch ( op )
+	{
+		case RelationOp::eq:  return "=";
+		case RelationOp::neq: return "distinct";
+		case RelationOp::leq: return bitvector ? "bvule" : "<=";
+		case RelationOp::lt:  return bitvector ? "bvult" : "<";
+		case RelationOp::geq: return bitvector ? "bvuge" : ">=";
+		case RelationOp::gt:  return bitvector ? "bvugt" : ">";
+	}
+
+	throw domain_error ( "Unknown RelationOp" );
+}
+
+// Prints integer constant as a value of sort with given code
+void print_int_constant ( ostream & o, long long value, std::intptr_t sort )
+{
+	if ( sort <= 0 )
+	{
+		if ( value < 0 )
+			o << "(- " << -value << ")";
+		else
+			o << value;
+		return;
+	}
+
+	if ( value >= 0 && ( sort >= 64 || ( value >> sort ) == 0 ) )
+	{
+		o << "(_ bv" << value << " " << sort << ")";
+		return;
+	}
+
+	// Two's complement, wrapped to the bitwidth
+	o << "#b";
+	for ( std::intptr_t i = sort - 1; i >= 0; i-- )
+	{
+		const int bit = i >= 63 ? 63 : i;
+		o << ( ( ( value >> bit ) & 1 ) ? '1' : '0' );
+	}
+}
+
+struct SignatureHash
+{
+	std::size_t operator() ( const vector < std::intptr_t > & s ) const
+	{
+		std::size_t h = s.size();
+		for ( std::intptr_t x : s )
+			h ^= std::hash < std::intptr_t > () ( x ) + 0x9e3779b9 + ( h << 6 ) + ( h >> 2 );
+		return h;
+	}
+};
+
+enum NodeTag
+{
+	TagBop,
+	TagNot,
+	TagQuantified,
+	TagHavoc,
+	TagBooleanTerm,
+	TagRelation,
+	TagArrayWrite,
+	TagArithmetic,
+	TagArrayTerm,
+	TagMinus,
+	TagThreadID,
+	TagIntConstant,
+	TagBoolConstant,
+	TagUserConstant,
+	TagVariable
+};
+
+} // anonymous namespace
+
+/**
+ * @brief Hash-consed DAG of one formula.
+ * Each node is a class of structurally equal subterms (or subformulas),
+ * printed in a given sort. Children of a node are always created
+ * before the node itself, so node ids form a topological order.
+ */
+class SmtDag
+{
+	private:
+		struct Node
+		{
+			const Formula * formula;
+			const Term    * term;
+			// Sort in which the term is printed (see sort_code)
+			std::intptr_t   sort;
+			vector < unsigned int > children;
+			unsigned int    n_parents;
+			bool            leaf;
+			string          name;
+		};
+
+		SmtPrinter & _p;
+		ostream    & _o;
+
+		vector < Node > _nodes;
+		unordered_map < vector < std::intptr_t >, unsigned int, SignatureHash > _classes;
+
+		unsigned int node ( vector < std::intptr_t > sig, Node n );
+
+		unsigned int add ( const Formula & f );
+		unsigned int add ( const Term & t, std::intptr_t sort );
+
+		void print_ref  ( unsigned int id );
+		void print_node ( unsigned int id );
+		void print_term ( const Node & n );
+		void print_formula ( const Node & n );
+		void print_havoc ( const Havoc & h );
+		void print_quantified ( const QuantifiedFormula & qf );
+		void print_array_write ( const Node & n, const ArrayWrite & aw );
+		void print_root ( unsigned int root );
+
+	public:
+		SmtDag ( SmtPrinter & p ) :
+			_p ( p ),
+			_o ( p._o )
+		{
+			;
+		}
+
+		void print ( const Formula & f );
+		void print ( const Term & t, std::intptr_t sort );
+};
+
+unsigned int SmtDag::node ( vector < std::intptr_t > sig, Node n )
+{
+	auto it = _classes.find ( sig );
+	if ( it != _classes.end() )
+		return it->second;
+
+	for ( unsigned int c : n.children )
+		_nodes[c].n_parents++;
+
+	n.n_parents = 0;
+	_nodes.push_back ( std::move ( n ) );
+	unsigned int id = _nodes.size() - 1;
+	_classes.emplace ( std::move ( sig ), id );
+	return id;
+}
+
+unsigned int SmtDag::add ( const Term & t, std::intptr_t sort )
+{
+	Node n { nullptr, &t, sort, {}, 0, false, "" };
+	vector < std::intptr_t > sig;
+
+	// Sort in which the operation itself is computed.
+	// Constants adapt to sort of their context.
+	std::intptr_t own = sort_code ( t.type() );
+	if ( own == sort_integral )
+		own = sort;
+
+	switch ( t.term_type() )
+	{
+		case Term::TermType::ArithmeticOperation:
+		{
+			auto & aop = static_cast < const ArithmeticOperation & > ( t );
+			n.children.push_back ( add ( aop.term1(), own ) );
+			n.children.push_back ( add ( aop.term2(), own ) );
+			sig = { TagArithmetic, (std::intptr_t) aop.operation() };
+			break;
+		}
+
+		case Term::TermType::MinusTerm:
+		{
+			auto & mt = static_cast < const MinusTerm & > ( t );
+			n.children.push_back ( add ( mt.term(), own ) );
+			sig = { TagMinus };
+			break;
+		}
+
+		case Term::TermType::ArrayTerm:
+		{
+			auto & at = static_cast < const ArrayTerm & > ( t );
+			if ( at.indices().empty() )
+				throw domain_error ( "Array size term is not supported in SMT-LIB2" );
+
+			n.children.push_back ( add ( at.array(), sort_array ) );
+			for ( const Term * i : at.indices() )
+				n.children.push_back ( add ( *i, sort_integer ) );
+			sig = { TagArrayTerm };
+			break;
+		}
+
+		case Term::TermType::Leaf:
+		{
+			n.leaf = true;
+			auto & lf = static_cast < const Leaf & > ( t );
+			switch ( lf.leaf_type() )
+			{
+				case Leaf::LeafType::ThreadID:
+					sig = { TagThreadID };
+					break;
+
+				case Leaf::LeafType::IntConstant:
+					sig = { TagIntConstant,
+						static_cast < const IntConstant & > ( lf ).value() };
+					break;
+
+				case Leaf::LeafType::BoolConstant:
+					sig = { TagBoolConstant,
+						static_cast < const BoolConstant & > ( lf ).value() };
+					break;
+
+				case Leaf::LeafType::UserConstant:
+					// Compared by identity
+					sig = { TagUserConstant, (std::intptr_t) &lf };
+					break;
+
+				case Leaf::LeafType::VariableReference:
+				{
+					auto & vr = static_cast < const VariableReference & > ( lf );
+					sig = { TagVariable,
+						(std::intptr_t) vr.variable().get(),
+						vr.primed() };
+					break;
+				}
+			}
+			break;
+		}
+	}
+
+	sig.push_back ( sort );
+	for ( unsigned int c : n.children )
+		sig.push_back ( c );
+
+	return node ( std::move ( sig ), std::move ( n ) );
+}
+
+unsigned int SmtDag::add ( const Formula & f )
+{
+	Node n { &f, nullptr, sort_integer, {}, 0, false, "" };
+	vector < std::intptr_t > sig;
+
+	switch ( f.type() )
+	{
+		case Formula::Type::FormulaBop:
+		{
+			auto & fb = static_cast < const FormulaBop & > ( f );
+			n.children.push_back ( add ( fb.formula_1() ) );
+			n.children.push_back ( add ( fb.formula_2() ) );
+			sig = { TagBop, (std::intptr_t) fb.op() };
+			break;
+		}
+
+		case Formula::Type::FormulaNot:
+		{
+			auto & fn = static_cast < const FormulaNot & > ( f );
+			n.children.push_back ( add ( fn.formula() ) );
+			sig = { TagNot };
+			break;
+		}
+
+		case Formula::Type::QuantifiedFormula:
+			// Body is printed in its own scope (it uses bound variables).
+			n.leaf = true;
+			sig = { TagQuantified, (std::intptr_t) &f };
+			break;
+
+		case Formula::Type::AtomicProposition:
+		{
+			auto & ap = static_cast < const AtomicProposition & > ( f );
+			switch ( ap.aptype() )
+			{
+				case AtomicProposition::APType::Havoc:
+				{
+					auto & h = static_cast < const Havoc & > ( ap );
+					sig = { TagHavoc };
+					for ( const VariableUse & u : h.variables )
+						sig.push_back ( (std::intptr_t) u.get() );
+					std::sort ( sig.begin() + 1, sig.end() );
+					break;
+				}
+
+				case AtomicProposition::APType::BooleanTerm:
+				{
+					auto & bt = static_cast < const BooleanTerm & > ( ap );
+					n.children.push_back ( add ( bt.term(), 1 ) );
+					sig = { TagBooleanTerm };
+					break;
+				}
+
+				case AtomicProposition::APType::Relation:
+				{
+					auto & r = static_cast < const Relation & > ( ap );
+					std::intptr_t sort = sort_code ( r.type() );
+					if ( sort == sort_integral )
+						sort = sort_integer;
+					n.children.push_back ( add ( r.term1(), sort ) );
+					n.children.push_back ( add ( r.term2(), sort ) );
+					sig = { TagRelation, (std::intptr_t) r.operation() };
+					break;
+				}
+
+				case AtomicProposition::APType::ArrayWrite:
+				{
+					auto & aw = static_cast < const ArrayWrite & > ( ap );
+					DataType vt = array_type_apply_terms (
+							aw.array()->type(), aw.indices_1().size() + 1 );
+					std::intptr_t vsort = sort_code ( vt );
+					if ( vsort == sort_integral )
+						vsort = sort_integer;
+
+					for ( const Term * t : aw.indices_1() )
+						n.children.push_back ( add ( *t, sort_integer ) );
+					for ( const Term * t : aw.indices_2() )
+						n.children.push_back ( add ( *t, sort_integer ) );
+					for ( const Term * t : aw.values() )
+						n.children.push_back ( add ( *t, vsort ) );
+
+					sig = { TagArrayWrite,
+						(std::intptr_t) aw.array(),
+						(std::intptr_t) aw.indices_1().size() };
+					break;
+				}
+			}
+			break;
+		}
+	}
+
+	for ( unsigned int c : n.children )
+		sig.push_back ( c );
+
+	return node ( std::move ( sig ), std::move ( n ) );
+}
+
+void SmtDag::print_ref ( unsigned int id )
+{
+	if ( _nodes[id].name.empty() )
+		print_node ( id );
+	else
+		_o << _nodes[id].name;
+}
+
+void SmtDag::print_node ( unsigned int id )
+{
+	const Node & n = _nodes[id];
+	if ( n.formula )
+		print_formula ( n );
+	else
+		print_term ( n );
+}
+
+void SmtDag::print_term ( const Node & n )
+{
+	const Term & t = *n.term;
+
+	std::intptr_t own = sort_code ( t.type() );
+	if ( own == sort_integral )
+		own = n.sort;
+
+	// Coercion to sort of context
+	unsigned int closing = 0;
+	if ( n.sort > 0 && own > 0 && own < n.sort )
+	{
+		_o << "((_ zero_extend " << n.sort - own << ") ";
+		closing = 1;
+	}
+	else if ( n.sort == sort_integer && own > 0 )
+	{
+		// Bitvector used as an array index
+		_o << "(bv2nat ";
+		closing = 1;
+	}
+
+	switch ( t.term_type() )
+	{
+		case Term::TermType::ArithmeticOperation:
+		{
+			auto & aop = static_cast < const ArithmeticOperation & > ( t );
+			_o << "(" << to_smt ( aop.operation(), own > 0 ) << " ";
+			print_ref ( n.children[0] );
+			_o << " ";
+			print_ref ( n.children[1] );
+			_o << ")";
+			break;
+		}
+
+		case Term::TermType::MinusTerm:
+			_o << ( own > 0 ? "(bvneg " : "(- " );
+			print_ref ( n.children[0] );
+			_o << ")";
+			break;
+
+		case Term::TermType::ArrayTerm:
+		{
+			for ( unsigned int i = 1; i < n.children.size(); i++ )
+				_o << "(select ";
+			print_ref ( n.children[0] );
+			for ( unsigned int i = 1; i < n.children.size(); i++ )
+			{
+				_o << " ";
+				print_ref ( n.children[i] );
+				_o << ")";
+			}
+			break;
+		}
+
+		case Term::TermType::Leaf:
+		{
+			auto & lf = static_cast < const Leaf & > ( t );
+			switch ( lf.leaf_type() )
+			{
+				case Leaf::LeafType::ThreadID:
+					_o << "tid";
+					break;
+
+				case Leaf::LeafType::IntConstant:
+					print_int_constant ( _o,
+							static_cast < const IntConstant & > ( lf ).value(), own );
+					break;
+
+				case Leaf::LeafType::BoolConstant:
+					_o << ( static_cast < const BoolConstant & > ( lf ).value() ?
+							"#b1" : "#b0" );
+					break;
+
+				case Leaf::LeafType::UserConstant:
+					_o << lf;
+					break;
+
+				case Leaf::LeafType::VariableReference:
+				{
+					auto & vr = static_cast < const VariableReference & > ( lf );
+					_p.print_symbol ( *vr.variable(), vr.primed() );
+					break;
+				}
+			}
+			break;
+		}
+	}
+
+	for ( ; closing > 0; closing-- )
+		_o << ")";
+}
+
+void SmtDag::print_havoc ( const Havoc & h )
+{
+	vector < const Variable * > kept;
+	for ( const Variable * v : _p.frame )
+	{
+		if ( !h.havocs ( *v ) )
+			kept.push_back ( v );
+	}
+
+	if ( kept.empty() )
+	{
+		_o << "true";
+		return;
+	}
+
+	if ( kept.size() > 1 )
+		_o << "(and";
+
+	for ( const Variable * v : kept )
+	{
+		if ( kept.size() > 1 )
+			_o << " ";
+		_o << "(= ";
+		_p.print_symbol ( *v, true );
+		_o << " ";
+		_p.print_symbol ( *v, false );
+		_o << ")";
+	}
+
+	if ( kept.size() > 1 )
+		_o << ")";
+}
+
+void SmtDag::print_quantified ( const QuantifiedFormula & qf )
+{
+	const QuantifiedType & qt = qf.list.qtype();
+
+	_o << "(" << ( qf.list.quantifier == Quantifier::Forall ? "forall" : "exists" ) << " (";
+	bool first = true;
+	for ( const Variable * v : qf.list.variables() )
+	{
+		_p._bound.insert ( v );
+		_o << ( first ? "(" : " (" );
+		_p.print_symbol ( *v, false );
+		_o << " ";
+		_p.print_sort ( qt.type() );
+		_o << ")";
+		first = false;
+	}
+	_o << ") ";
+
+	bool bounded = qt.from() && qt.to();
+	if ( bounded )
+	{
+		std::intptr_t sort = sort_code ( qt.type() );
+		if ( sort == sort_integral )
+			sort = sort_integer;
+		const char * leq = to_smt ( RelationOp::leq, sort > 0 );
+
+		_o << ( qf.list.quantifier == Quantifier::Forall ? "(=> " : "(and " );
+		_o << "(and";
+		for ( const Variable * v : qf.list.variables() )
+		{
+			_o << " (" << leq << " ";
+			SmtDag ( _p ).print ( *qt.from(), sort );
+			_o << " ";
+			_p.print_symbol ( *v, false );
+			_o << ") (" << leq << " ";
+			_p.print_symbol ( *v, false );
+			_o << " ";
+			SmtDag ( _p ).print ( *qt.to(), sort );
+			_o << ")";
+		}
+		_o << ") ";
+	}
+
+	SmtDag ( _p ).print ( qf.formula() );
+
+	if ( bounded )
+		_o << ")";
+	_o << ")";
+
+	for ( const Variable * v : qf.list.variables() )
+		_p._bound.erase ( v );
+}
+
+void SmtDag::print_array_write ( const Node & n, const ArrayWrite & aw )
+{
+	const unsigned int n1 = aw.indices_1().size();
+	const unsigned int n2 = aw.indices_2().size();
+
+	_o << "(= ";
+	_p.print_symbol ( *aw.array(), true );
+	_o << " ";
+
+	// a'[i_1]..[i_k][j_1, .., j_m] = [v_1, .., v_m] is
+	// a' = store ( a, i_1, store ( a[i_1], i_2, .. store ( a[i_1]..[i_k], j_1, v_1 ) .. ) )
+	auto print_select = [&] ( unsigned int depth )
+	{
+		for ( unsigned int i = 0; i < depth; i++ )
+			_o << "(select ";
+		_p.print_symbol ( *aw.array(), false );
+		for ( unsigned int i = 0; i < depth; i++ )
+		{
+			_o << " ";
+			print_ref ( n.children[i] );
+			_o << ")";
+		}
+	};
+
+	for ( unsigned int i = 0; i < n1; i++ )
+	{
+		_o << "(store ";
+		print_select ( i );
+		_o << " ";
+		print_ref ( n.children[i] );
+		_o << " ";
+	}
+
+	for ( unsigned int j = 0; j < n2; j++ )
+		_o << "(store ";
+	print_select ( n1 );
+	for ( unsigned int j = 0; j < n2; j++ )
+	{
+		_o << " ";
+		print_ref ( n.children[n1 + j] );
+		_o << " ";
+		print_ref ( n.children[n1 + n2 + j] );
+		_o << ")";
+	}
+
+	for ( unsigned int i = 0; i < n1; i++ )
+		_o << ")";
+	_o << ")";
+}
+
+void SmtDag::print_formula ( const Node & n )
+{
+	const Formula & f = *n.formula;
+
+	switch ( f.type() )
+	{
+		case Formula::Type::FormulaBop:
+		{
+			auto & fb = static_cast < const FormulaBop & > ( f );
+			_o << "(" << to_smt ( fb.op() ) << " ";
+			print_ref ( n.children[0] );
+			_o << " ";
+			print_ref ( n.children[1] );
+			_o << ")";
+			return;
+		}
+
+		case Formula::Type::FormulaNot:
+			_o << "(not ";
+			print_ref ( n.children[0] );
+			_o << ")";
+			return;
+
+		case Formula::Type::QuantifiedFormula:
+			print_quantified ( static_cast < const QuantifiedFormula & > ( f ) );
+			return;
+
+		case Formula::Type::AtomicProposition:
+			break;
+	}
+
+	auto & ap = static_cast < const AtomicProposition & > ( f );
+	switch ( ap.aptype() )
+	{
+		case AtomicProposition::APType::Havoc:
+			print_havoc ( static_cast < const Havoc & > ( ap ) );
+			return;
+
+		case AtomicProposition::APType::BooleanTerm:
+			_o << "(= ";
+			print_ref ( n.children[0] );
+			_o << " #b1)";
+			return;
+
+		case AtomicProposition::APType::Relation:
+		{
+			auto & r = static_cast < const Relation & > ( ap );
+			std::intptr_t sort = _nodes[n.children[0]].sort;
+			_o << "(" << to_smt ( r.operation(), sort > 0 ) << " ";
+			print_ref ( n.children[0] );
+			_o << " ";
+			print_ref ( n.children[1] );
+			_o << ")";
+			return;
+		}
+
+		case AtomicProposition::APType::ArrayWrite:
+			print_array_write ( n, static_cast < const ArrayWrite & > ( ap ) );
+			return;
+	}
+
+	throw logic_error ( "Unknown APType" );
+}
+
+void SmtDag::print_root ( unsigned int root )
+{
+	// Shared inner nodes become let-bindings, children first
+	unsigned int n_lets = 0;
+	for ( unsigned int id = 0; id < root; id++ )
+	{
+		Node & n = _nodes[id];
+		if ( n.n_parents < 2 || n.leaf )
+			continue;
+
+		string name = "?s" + to_string ( _p._n_lets++ );
+		_o << "(let ((" << name << " ";
+		print_node ( id );
+		_o << ")) ";
+		n.name = name;
+		n_lets++;
+	}
+
+	print_node ( root );
+
+	for ( ; n_lets > 0; n_lets-- )
+		_o << ")";
+}
+
+void SmtDag::print ( const Formula & f )
+{
+	print_root ( add ( f ) );
+}
+
+void SmtDag::print ( const Term & t, std::intptr_t sort )
+{
+	print_root ( add ( t, sort ) );
+}
+
+//------------------------------------//
+// SmtPrinter                         //
+//------------------------------------//
+
+SmtPrinter::SmtPrinter ( ostream & o ) :
+	_o           ( o ),
+	_n_lets      ( 0 ),
+	curr_version ( 0 ),
+	next_version ( 1 )
+{
+	;
+}
+
+void SmtPrinter::set_frame ( const BasicNts & bn )
+{
+	frame.clear();
+
+	if ( bn.parent() )
+	{
+		for ( const Variable * v : bn.parent()->variables() )
+			frame.push_back ( v );
+	}
+
+	for ( const auto * vars : { &bn.params_in(), &bn.params_out(), &bn.variables() } )
+	{
+		for ( const Variable * v : *vars )
+			frame.push_back ( v );
+	}
+}
+
+void SmtPrinter::print_sort ( const ScalarType & t )
+{
+	if ( t.is_bitvector() )
+		_o << "(_ BitVec " << t.bitwidth() << ")";
+	else if ( t == ScalarType::Real() )
+		_o << "Real";
+	else
+		_o << "Int";
+}
+
+void SmtPrinter::print_sort ( const DataType & t )
+{
+	const unsigned int dim = t.arr_dimension() + t.ref_dimension();
+	for ( unsigned int i = 0; i < dim; i++ )
+		_o << "(Array Int ";
+
+	print_sort ( t.scalar_type() );
+
+	for ( unsigned int i = 0; i < dim; i++ )
+		_o << ")";
+}
+
+void SmtPrinter::print_symbol ( const Variable & v, bool primed )
+{
+	// Quoted symbols can not contain '|' and '\'
+	string name = v.name;
+	std::replace ( name.begin(), name.end(), '|', '_' );
+	std::replace ( name.begin(), name.end(), '\\', '_' );
+
+	_o << "|" << name;
+	if ( _bound.find ( &v ) == _bound.end() )
+		_o << "@" << ( primed ? next_version : curr_version );
+	_o << "|";
+}
+
+void SmtPrinter::print_declaration ( const Variable & v, unsigned int version )
+{
+	unsigned int curr = curr_version;
+	curr_version = version;
+
+	_o << "(declare-fun ";
+	print_symbol ( v, false );
+	_o << " () ";
+	print_sort ( v.type() );
+	_o << ")\n";
+
+	curr_version = curr;
+}
+
+void SmtPrinter::print_frame_declarations()
+{
+	for ( const Variable * v : frame )
+	{
+		print_declaration ( *v, curr_version );
+		print_declaration ( *v, next_version );
+	}
+}
+
+void SmtPrinter::print ( const Formula & f )
+{
+	SmtDag ( *this ).print ( f );
+}
+
+void SmtPrinter::print_assert ( const Formula & f )
+{
+	_o << "(assert ";
+	print ( f );
+	_o << ")\n";
+}
+
+} // namespace nts
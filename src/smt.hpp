@@ -0,0 +1,73 @@
+#ifndef NTS_SMT_HPP_
+#define NTS_SMT_HPP_
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <unordered_set>
+
+#include "data_types.hpp"
+#include "logic.hpp"
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Prints formulas in SMT-LIB2 format.
+ *
+ * Unprimed variables are mapped to constants |name@curr_version|,
+ * primed variables to constants |name@next_version|.
+ * BitVector<N> is mapped to (_ BitVec N), Int to Int,
+ * and arrays to (nested) arrays indexed by Int.
+ * Bitvectors are treated as unsigned numbers.
+ *
+ * Structurally equal subterms and subformulas are printed only once,
+ * as let-bindings. Size of output is linear in number of distinct
+ * subterms, not in size of the formula tree.
+ */
+class SmtPrinter
+{
+	private:
+		std::ostream & _o;
+
+		// Quantified variables which are currently in scope
+		std::unordered_set < const Variable * > _bound;
+
+		unsigned int _n_lets;
+
+		friend class SmtDag;
+
+	public:
+		explicit SmtPrinter ( std::ostream & o );
+		SmtPrinter ( const SmtPrinter & ) = delete;
+
+		unsigned int curr_version;
+		unsigned int next_version;
+
+		// Variables which keep their values unless havocked.
+		// If the frame is empty, havoc is printed as 'true'.
+		std::vector < const Variable * > frame;
+
+		// Frame consists of all variables visible from given BasicNts
+		// (local variables, in/out parameters and global variables)
+		void set_frame ( const BasicNts & bn );
+
+		void print_sort ( const DataType & t );
+		void print_sort ( const ScalarType & t );
+		void print_symbol ( const Variable & v, bool primed );
+
+		// (declare-fun |name@version| () sort)
+		void print_declaration ( const Variable & v, unsigned int version );
+
+		// Declares both current and next version of each frame variable
+		void print_frame_declarations();
+
+		void print ( const Formula & f );
+		void print_assert ( const Formula & f );
+};
+
+} // namespace nts
+
+#endif // NTS_SMT_HPP_
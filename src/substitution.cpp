@@ -0,0 +1,276 @@
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include <utility>    // pair, move()
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "substitution.hpp"
+
+using std::unique_ptr;
+using std::vector;
+using std::pair;
+using std::move;
+using std::domain_error;
+
+namespace nts
+{
+
+namespace
+{
+
+using p_Term = unique_ptr < Term >;
+
+const BasicNts * owner_of ( const TransitionRule * r )
+{
+	return r && r->transition() ? r->transition()->parent() : nullptr;
+}
+
+const BasicNts * owner_of ( const Formula & f )
+{
+	const Formula * g = &f;
+	while ( g->_parent_type == Formula::ParentType::Formula )
+		g = g->_parent_ptr.formula;
+
+	if ( g->_parent_type != Formula::ParentType::FormulaTransitionRule )
+		return nullptr;
+
+	return owner_of ( g->_parent_ptr.ftr );
+}
+
+const BasicNts * owner_of ( const Term & t )
+{
+	const Term * u = &t;
+	while ( u->_parent_type == Term::ParentType::Term )
+		u = u->_parent_ptr.term;
+
+	switch ( u->_parent_type )
+	{
+		case Term::ParentType::Formula:
+			return owner_of ( *u->_parent_ptr.formula );
+
+		case Term::ParentType::QuantifiedType:
+		{
+			const QuantifiedVariableList * l = u->_parent_ptr.qtype->parent();
+			if ( !l || !l->parent() )
+				return nullptr;
+			return owner_of ( *l->parent() );
+		}
+
+		case Term::ParentType::CallTransitionRule:
+			return owner_of ( u->_parent_ptr.crule );
+
+		// Owner of a DataType is not known
+		case Term::ParentType::DataType:
+		case Term::ParentType::None:
+		case Term::ParentType::Term:
+			break;
+	}
+
+	return nullptr;
+}
+
+const BasicNts * owner_of ( const VariableUse & u )
+{
+	switch ( u.user_type )
+	{
+		case VariableUse::UserType::VariableReference:
+			return owner_of ( *u.user_ptr.vref );
+
+		case VariableUse::UserType::ArrayWrite:
+			return owner_of ( *u.user_ptr.arr_wr );
+
+		case VariableUse::UserType::Havoc:
+			return owner_of ( *u.user_ptr.hvc );
+
+		case VariableUse::UserType::CallTransitionRule:
+			return owner_of ( u.user_ptr.ctr );
+	}
+
+	return nullptr;
+}
+
+// Uses of the variable inside bn
+vector < VariableUse * > uses_in ( const Variable & v, const BasicNts & bn )
+{
+	vector < VariableUse * > result;
+	for ( VariableUse * u : v.uses() )
+	{
+		if ( owner_of ( *u ) == &bn )
+			result.push_back ( u );
+	}
+
+	return result;
+}
+
+// Can the reference be replaced by a term?
+bool replaceable ( const VariableUse & u )
+{
+	if ( u.user_type != VariableUse::UserType::VariableReference || u.modifying )
+		return false;
+
+	const VariableReference & vr = *u.user_ptr.vref;
+	switch ( vr._parent_type )
+	{
+		case Term::ParentType::Term:
+		{
+			const Term & p = *vr._parent_ptr.term;
+			return p.term_type() != Term::TermType::ArrayTerm ||
+				&static_cast < const ArrayTerm & > ( p ).array() != &vr;
+		}
+
+		case Term::ParentType::Formula:
+		case Term::ParentType::QuantifiedType:
+		case Term::ParentType::CallTransitionRule:
+			return true;
+
+		case Term::ParentType::DataType:
+		case Term::ParentType::None:
+			break;
+	}
+
+	return false;
+}
+
+// Replaces vr with a clone of t in the parent of vr, which deletes vr
+void replace ( VariableReference & vr, const Term & t )
+{
+	const Term * old = &vr;
+	auto swap = [&] ( p_Term u )
+	{
+		return u.get() == old ? p_Term ( t.clone() ) : move ( u );
+	};
+
+	switch ( vr._parent_type )
+	{
+		case Term::ParentType::Term:
+		{
+			Term & p = *vr._parent_ptr.term;
+			switch ( p.term_type() )
+			{
+				case Term::TermType::ArithmeticOperation:
+					static_cast < ArithmeticOperation & > ( p ).transform_terms ( swap );
+					break;
+
+				case Term::TermType::MinusTerm:
+					static_cast < MinusTerm & > ( p ).transform_term ( swap );
+					break;
+
+				case Term::TermType::ArrayTerm:
+					static_cast < ArrayTerm & > ( p ).transform_indices ( swap );
+					break;
+
+				case Term::TermType::Leaf:
+					break;
+			}
+			break;
+		}
+
+		case Term::ParentType::Formula:
+		{
+			auto & ap = static_cast < AtomicProposition & > ( *vr._parent_ptr.formula );
+			switch ( ap.aptype() )
+			{
+				case AtomicProposition::APType::BooleanTerm:
+					static_cast < BooleanTerm & > ( ap ).transform_term ( swap );
+					break;
+
+				case AtomicProposition::APType::Relation:
+					static_cast < Relation & > ( ap ).transform_terms ( swap );
+					break;
+
+				case AtomicProposition::APType::ArrayWrite:
+					static_cast < ArrayWrite & > ( ap ).transform_terms ( swap );
+					break;
+
+				case AtomicProposition::APType::Havoc:
+					break;
+			}
+			break;
+		}
+
+		case Term::ParentType::QuantifiedType:
+			vr._parent_ptr.qtype->transform_bounds ( swap );
+			break;
+
+		case Term::ParentType::CallTransitionRule:
+			vr._parent_ptr.crule->transform_terms_in ( swap );
+			break;
+
+		case Term::ParentType::DataType:
+		case Term::ParentType::None:
+			break;
+	}
+}
+
+// Can a term of type t replace the variable of type vt?
+bool assignable ( const DataType & vt, const DataType & t )
+{
+	if ( t == vt )
+		return true;
+
+	// Integral constants take the sort of the context
+	return vt.is_scalar() && !vt.scalar_type().is_bitvector() &&
+		t.is_scalar() && t.scalar_type() == ScalarType::Integral();
+}
+
+} // anonymous namespace
+
+//------------------------------------//
+// Substitution                       //
+//------------------------------------//
+
+unsigned int substitute ( BasicNts & bn, const VariableMap & map )
+{
+	// All uses are collected first, so that the substitution is simultaneous
+	vector < pair < vector < VariableUse * >, Variable * > > work;
+	for ( const auto & m : map )
+	{
+		if ( m.first->type() != m.second->type() )
+			throw TypeError();
+
+		if ( m.first != m.second )
+			work.emplace_back ( uses_in ( *m.first, bn ), m.second );
+	}
+
+	unsigned int n = 0;
+	for ( const auto & w : work )
+	{
+		for ( VariableUse * u : w.first )
+			*u = w.second;
+		n += w.first.size();
+	}
+
+	return n;
+}
+
+unsigned int substitute ( BasicNts & bn, const TermMap & map )
+{
+	vector < pair < vector < VariableUse * >, const Term * > > work;
+	for ( const auto & m : map )
+	{
+		if ( !assignable ( m.first->type(), m.second->type() ) )
+			throw TypeError();
+
+		vector < VariableUse * > uses = uses_in ( *m.first, bn );
+		for ( const VariableUse * u : uses )
+		{
+			if ( !replaceable ( *u ) )
+				throw domain_error ( "Variable " + m.first->name + " can not be replaced by a term" );
+		}
+
+		work.emplace_back ( move ( uses ), m.second );
+	}
+
+	unsigned int n = 0;
+	for ( const auto & w : work )
+	{
+		for ( VariableUse * u : w.first )
+			replace ( *u->user_ptr.vref, *w.second );
+		n += w.first.size();
+	}
+
+	return n;
+}
+
+} // namespace nts
@@ -0,0 +1,47 @@
+#ifndef NTS_SUBSTITUTION_HPP_
+#define NTS_SUBSTITUTION_HPP_
+#pragma once
+
+#include <unordered_map>
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+using VariableMap = std::unordered_map < const Variable *, Variable * >;
+using TermMap     = std::unordered_map < const Variable *, const Term * >;
+
+/**
+ * @brief Simultaneously retargets uses of the mapped variables inside bn
+ * (references, array writes, havocs and return variables of calls)
+ * to their images. Unlike substitute_variables(), no user_data is needed.
+ *
+ * Uses are found through Variable::uses(), so the time is linear in the
+ * number of uses of the mapped variables (times the depth of formulas,
+ * which are climbed to find the owner of a use). Uses outside of bn
+ * (other BasicNtses, the initial formula of Nts, declared types) are kept.
+ *
+ * Throws TypeError, if a variable and its image have different types;
+ * nothing is changed then.
+ *
+ * @return number of rewritten uses
+ */
+unsigned int substitute ( BasicNts & bn, const VariableMap & map );
+
+/**
+ * @brief Simultaneously replaces references to the mapped variables
+ * inside bn with clones of their terms, see above.
+ *
+ * Throws TypeError, if a variable and its term have different types
+ * (integral constants are accepted for non-bitvector scalars),
+ * and std::domain_error, if a mapped variable has a use inside bn,
+ * which is not an unprimed reference in an expression (primed reference,
+ * havoc, array write, array of an array access, return variable of a call);
+ * nothing is changed then.
+ */
+unsigned int substitute ( BasicNts & bn, const TermMap & map );
+
+} // namespace nts
+
+#endif // NTS_SUBSTITUTION_HPP_
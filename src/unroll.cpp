@@ -0,0 +1,486 @@
+#include <functional>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+#include <utility>    // move()
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "conjuncts.hpp"
+#include "unroll.hpp"
+
+using std::function;
+using std::unique_ptr;
+using std::make_unique;
+using std::vector;
+using std::unordered_map;
+using std::unordered_multimap;
+using std::domain_error;
+using std::move;
+
+namespace nts
+{
+
+namespace
+{
+
+using p_Term    = unique_ptr < Term    >;
+using p_Formula = unique_ptr < Formula >;
+using Values    = unordered_map < const Variable *, int >;
+
+// Number of nodes
+unsigned long size ( const Term & t )
+{
+	switch ( t.term_type() )
+	{
+		case Term::TermType::ArithmeticOperation:
+		{
+			auto & aop = static_cast < const ArithmeticOperation & > ( t );
+			return 1 + size ( aop.term1() ) + size ( aop.term2() );
+		}
+
+		case Term::TermType::MinusTerm:
+			return 1 + size ( static_cast < const MinusTerm & > ( t ).term() );
+
+		case Term::TermType::ArrayTerm:
+		{
+			auto & at = static_cast < const ArrayTerm & > ( t );
+			unsigned long n = 1 + size ( at.array() );
+			for ( const Term * i : at.indices() )
+				n += size ( *i );
+			return n;
+		}
+
+		case Term::TermType::Leaf:
+			break;
+	}
+
+	return 1;
+}
+
+unsigned long size ( const Formula & f )
+{
+	switch ( f.type() )
+	{
+		case Formula::Type::FormulaBop:
+		{
+			auto & fb = static_cast < const FormulaBop & > ( f );
+			return 1 + size ( fb.formula_1() ) + size ( fb.formula_2() );
+		}
+
+		case Formula::Type::FormulaNot:
+			return 1 + size ( static_cast < const FormulaNot & > ( f ).formula() );
+
+		case Formula::Type::QuantifiedFormula:
+			return 1 + size ( static_cast < const QuantifiedFormula & > ( f ).formula() );
+
+		case Formula::Type::AtomicProposition:
+			break;
+	}
+
+	auto & ap = static_cast < const AtomicProposition & > ( f );
+	switch ( ap.aptype() )
+	{
+		case AtomicProposition::APType::Relation:
+		{
+			auto & r = static_cast < const Relation & > ( ap );
+			return 1 + size ( r.term1() ) + size ( r.term2() );
+		}
+
+		case AtomicProposition::APType::BooleanTerm:
+			return 1 + size ( static_cast < const BooleanTerm & > ( ap ).term() );
+
+		case AtomicProposition::APType::ArrayWrite:
+		{
+			auto & aw = static_cast < const ArrayWrite & > ( ap );
+			unsigned long n = 1;
+			for ( const auto * terms : { &aw.indices_1(), &aw.indices_2(), &aw.values() } )
+			{
+				for ( const Term * i : *terms )
+					n += size ( *i );
+			}
+			return n;
+		}
+
+		case AtomicProposition::APType::Havoc:
+			break;
+	}
+
+	return 1;
+}
+
+// Contains only constants and arithmetic?
+bool closed ( const Term & t )
+{
+	switch ( t.term_type() )
+	{
+		case Term::TermType::ArithmeticOperation:
+		{
+			auto & aop = static_cast < const ArithmeticOperation & > ( t );
+			return closed ( aop.term1() ) && closed ( aop.term2() );
+		}
+
+		case Term::TermType::MinusTerm:
+			return closed ( static_cast < const MinusTerm & > ( t ).term() );
+
+		case Term::TermType::ArrayTerm:
+			return false;
+
+		case Term::TermType::Leaf:
+			return static_cast < const Leaf & > ( t ).leaf_type() ==
+				Leaf::LeafType::IntConstant;
+	}
+
+	return false;
+}
+
+bool constant ( const Term * t, int & value )
+{
+	if ( !t || !closed ( *t ) )
+		return false;
+
+	try
+	{
+		value = t->evaluate();
+	}
+	catch ( const domain_error & )
+	{
+		return false;
+	}
+	return true;
+}
+
+// Range of a quantified variable
+bool bounds ( const QuantifiedType & qt, int & from, int & to )
+{
+	if ( qt.from() || qt.to() )
+		return constant ( qt.from(), from ) && constant ( qt.to(), to );
+
+	const DataType & t = qt.type();
+	if ( !t.is_scalar() || !t.scalar_type().is_bitvector() ||
+			t.scalar_type().bitwidth() > 16 )
+		return false;
+
+	from = 0;
+	to = ( 1 << t.scalar_type().bitwidth() ) - 1;
+	return true;
+}
+
+//------------------------------------//
+// Instantiation                      //
+//------------------------------------//
+
+// Replacement of a variable reference, null keeps it
+using RefFunc = function < p_Term ( const VariableReference & ) >;
+
+p_Term replace_references ( p_Term t, const RefFunc & rf );
+
+void replace_references ( Formula & f, const RefFunc & rf );
+
+p_Term replace_references ( p_Term t, const RefFunc & rf )
+{
+	auto inst = [&] ( p_Term u ) { return replace_references ( move ( u ), rf ); };
+
+	switch ( t->term_type() )
+	{
+		case Term::TermType::ArithmeticOperation:
+			static_cast < ArithmeticOperation & > ( *t ).transform_terms ( inst );
+			break;
+
+		case Term::TermType::MinusTerm:
+			static_cast < MinusTerm & > ( *t ).transform_term ( inst );
+			break;
+
+		case Term::TermType::ArrayTerm:
+			static_cast < ArrayTerm & > ( *t ).transform_indices ( inst );
+			break;
+
+		case Term::TermType::Leaf:
+		{
+			auto & l = static_cast < Leaf & > ( *t );
+			if ( l.leaf_type() != Leaf::LeafType::VariableReference )
+				break;
+
+			p_Term r = rf ( static_cast < const VariableReference & > ( l ) );
+			if ( r )
+				return r;
+			break;
+		}
+	}
+
+	return t;
+}
+
+void replace_references ( Formula & f, const RefFunc & rf )
+{
+	auto inst = [&] ( p_Term u ) { return replace_references ( move ( u ), rf ); };
+
+	switch ( f.type() )
+	{
+		case Formula::Type::FormulaBop:
+		{
+			auto & fb = static_cast < FormulaBop & > ( f );
+			replace_references ( fb.formula_1(), rf );
+			replace_references ( fb.formula_2(), rf );
+			return;
+		}
+
+		case Formula::Type::FormulaNot:
+			replace_references ( static_cast < FormulaNot & > ( f ).formula(), rf );
+			return;
+
+		case Formula::Type::QuantifiedFormula:
+		{
+			auto & qf = static_cast < QuantifiedFormula & > ( f );
+			qf.list.qtype().transform_bounds ( inst );
+			replace_references ( qf.formula(), rf );
+			return;
+		}
+
+		case Formula::Type::AtomicProposition:
+			break;
+	}
+
+	auto & ap = static_cast < AtomicProposition & > ( f );
+	switch ( ap.aptype() )
+	{
+		case AtomicProposition::APType::Relation:
+			static_cast < Relation & > ( ap ).transform_terms ( inst );
+			break;
+
+		case AtomicProposition::APType::BooleanTerm:
+			static_cast < BooleanTerm & > ( ap ).transform_term ( inst );
+			break;
+
+		case AtomicProposition::APType::ArrayWrite:
+			static_cast < ArrayWrite & > ( ap ).transform_terms ( inst );
+			break;
+
+		case AtomicProposition::APType::Havoc:
+			break;
+	}
+}
+
+void instantiate ( Formula & f, const Values & values )
+{
+	replace_references ( f, [&] ( const VariableReference & r ) -> p_Term
+	{
+		auto it = values.find ( r.variable().get() );
+		return it == values.end() ? nullptr : make_unique < IntConstant > ( it->second );
+	} );
+}
+
+// A clone of a quantified formula refers to the variables of the original,
+// makes quantified formulas inside copy refer to their own variables
+void bind_quantified ( const Formula & orig, Formula & copy )
+{
+	switch ( orig.type() )
+	{
+		case Formula::Type::FormulaBop:
+		{
+			auto & o = static_cast < const FormulaBop & > ( orig );
+			auto & c = static_cast < FormulaBop & > ( copy );
+			bind_quantified ( o.formula_1(), c.formula_1() );
+			bind_quantified ( o.formula_2(), c.formula_2() );
+			return;
+		}
+
+		case Formula::Type::FormulaNot:
+			bind_quantified ( static_cast < const FormulaNot & > ( orig ).formula(),
+					static_cast < FormulaNot & > ( copy ).formula() );
+			return;
+
+		case Formula::Type::QuantifiedFormula:
+		{
+			auto & o = static_cast < const QuantifiedFormula & > ( orig );
+			auto & c = static_cast < QuantifiedFormula & > ( copy );
+
+			unordered_map < const Variable *, Variable * > own;
+			auto cv = c.list.variables().begin();
+			for ( const Variable * v : o.list.variables() )
+				own [ v ] = *cv++;
+
+			replace_references ( c.formula(), [&] ( const VariableReference & r ) -> p_Term
+			{
+				auto it = own.find ( r.variable().get() );
+				if ( it == own.end() )
+					return nullptr;
+				return make_unique < VariableReference > ( *it->second, r.primed() );
+			} );
+
+			bind_quantified ( o.formula(), c.formula() );
+			return;
+		}
+
+		case Formula::Type::AtomicProposition:
+			return;
+	}
+}
+
+//------------------------------------//
+// Unrolling                          //
+//------------------------------------//
+
+class Unroller
+{
+	private:
+		const unsigned long _max_size;
+
+		p_Formula expand ( unique_ptr < QuantifiedFormula > qf );
+
+	public:
+		unsigned int n_unrolled;
+
+		explicit Unroller ( unsigned long max_size ) :
+			_max_size  ( max_size ),
+			n_unrolled ( 0        )
+		{ ; }
+
+		p_Formula unroll ( p_Formula f );
+};
+
+p_Formula Unroller::unroll ( p_Formula f )
+{
+	auto rec = [this] ( p_Formula g ) { return unroll ( move ( g ) ); };
+
+	switch ( f->type() )
+	{
+		case Formula::Type::FormulaBop:
+			static_cast < FormulaBop & > ( *f ).transform_formulas ( rec );
+			return f;
+
+		case Formula::Type::FormulaNot:
+			static_cast < FormulaNot & > ( *f ).transform_formula ( rec );
+			return f;
+
+		case Formula::Type::QuantifiedFormula:
+		{
+			unique_ptr < QuantifiedFormula > qf ( static_cast < QuantifiedFormula * > ( f.release() ) );
+			qf->transform_formula ( rec );
+			return expand ( move ( qf ) );
+		}
+
+		case Formula::Type::AtomicProposition:
+			break;
+	}
+
+	return f;
+}
+
+p_Formula Unroller::expand ( unique_ptr < QuantifiedFormula > qf )
+{
+	int from = 0;
+	int to = 0;
+	if ( !bounds ( qf->list.qtype(), from, to ) )
+		return qf;
+
+	const bool forall = qf->list.quantifier == Quantifier::Forall;
+	if ( from > to )
+	{
+		n_unrolled++;
+		return truth ( forall );
+	}
+
+	// Number of instances, capped by the size limit
+	const vector < const Variable * > vars ( qf->list.variables().begin(), qf->list.variables().end() );
+	const unsigned long range = (unsigned long) ( (long) to - from ) + 1;
+	const unsigned long body = size ( qf->formula() );
+	unsigned long n = 1;
+	for ( unsigned int i = 0; i < vars.size(); i++ )
+	{
+		if ( range > _max_size || n * range * body > _max_size )
+			return qf;
+		n *= range;
+	}
+
+	// Instances in lexicographic order of values, equal ones only once
+	vector < p_Formula > instances;
+	unordered_multimap < std::size_t, const Formula * > seen;
+	Values values;
+	vector < int > tuple ( vars.size(), from );
+	const unsigned int n_before = n_unrolled;
+	unsigned long total = 0;
+	for ( unsigned long k = 0; k < n; k++ )
+	{
+		for ( unsigned int i = 0; i < vars.size(); i++ )
+			values [ vars[i] ] = tuple[i];
+
+		// Inner quantifiers, whose bounds depend on vars, become closed
+		p_Formula inst ( qf->formula().clone() );
+		bind_quantified ( qf->formula(), *inst );
+		instantiate ( *inst, values );
+		inst = unroll ( move ( inst ) );
+
+		const std::size_t h = inst->hash();
+		bool duplicate = false;
+		auto range = seen.equal_range ( h );
+		for ( auto it = range.first; it != range.second && !duplicate; ++it )
+			duplicate = structurally_equal ( *it->second, *inst );
+
+		if ( !duplicate )
+		{
+			total += size ( *inst );
+			if ( total > _max_size )
+			{
+				n_unrolled = n_before;
+				return qf;
+			}
+
+			seen.emplace ( h, inst.get() );
+			instances.push_back ( move ( inst ) );
+		}
+
+		for ( int i = vars.size() - 1; i >= 0 && ++tuple[i] > to; i-- )
+			tuple[i] = from;
+	}
+
+	p_Formula result = move ( instances[0] );
+	for ( unsigned int i = 1; i < instances.size(); i++ )
+	{
+		result = make_unique < FormulaBop > ( forall ? BoolOp::And : BoolOp::Or,
+				move ( result ), move ( instances[i] ) );
+	}
+
+	n_unrolled++;
+	return result;
+}
+
+} // anonymous namespace
+
+p_Formula unroll_quantifiers ( p_Formula f, unsigned int max_size, unsigned int & n_unrolled )
+{
+	Unroller u ( max_size );
+	f = u.unroll ( move ( f ) );
+	n_unrolled += u.n_unrolled;
+	return f;
+}
+
+unsigned int unroll_quantifiers ( BasicNts & bn, unsigned int max_size )
+{
+	unsigned int n = 0;
+	for ( Transition * t : bn.transitions() )
+	{
+		if ( t->rule().kind() != TransitionRule::Kind::Formula )
+			continue;
+
+		static_cast < FormulaTransitionRule & > ( t->rule() ).transform_formula (
+				[&] ( p_Formula f ) { return unroll_quantifiers ( move ( f ), max_size, n ); } );
+	}
+
+	return n;
+}
+
+unsigned int unroll_quantifiers ( Nts & nts, unsigned int max_size )
+{
+	unsigned int n = 0;
+	nts.transform_initial_formula (
+			[&] ( p_Formula f ) { return unroll_quantifiers ( move ( f ), max_size, n ); } );
+
+	for ( BasicNts * bn : nts.basic_ntses() )
+		n += unroll_quantifiers ( *bn, max_size );
+
+	return n;
+}
+
+} // namespace nts
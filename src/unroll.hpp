@@ -0,0 +1,42 @@
+#ifndef NTS_UNROLL_HPP_
+#define NTS_UNROLL_HPP_
+#pragma once
+
+#include <memory>
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Expands bounded quantifiers into finite conjunctions (forall)
+ * or disjunctions (exists) of instances of their bodies.
+ *
+ * A quantifier is expanded, if its bounds are closed terms (or it ranges
+ * over a bitvector type of at most 16 bits without bounds), and if the
+ * expansion has at most max_size nodes. Each variable of the quantifier
+ * ranges over [from, to], including both bounds; an empty range gives
+ * true (forall) or false (exists). Inner quantifiers are expanded first;
+ * those with bounds depending on outer variables are expanded in each
+ * instance. Structurally equal instances are kept only once.
+ *
+ * @return the expanded formula; n_unrolled is increased by the number
+ * of expanded quantifiers
+ */
+std::unique_ptr < Formula > unroll_quantifiers (
+		std::unique_ptr < Formula > f,
+		unsigned int max_size,
+		unsigned int & n_unrolled );
+
+/**
+ * @brief Expands quantifiers in formulas of all transitions (see above).
+ * The Nts variant expands the initial formula too.
+ * @return number of expanded quantifiers
+ */
+unsigned int unroll_quantifiers ( BasicNts & bn, unsigned int max_size = 4096 );
+unsigned int unroll_quantifiers ( Nts & nts, unsigned int max_size = 4096 );
+
+} // namespace nts
+
+#endif // NTS_UNROLL_HPP_
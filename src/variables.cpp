@@ -1,7 +1,9 @@
 #include <stdexcept>
 #include <utility>
+#include <algorithm>  // min()
 
 #include "nts.hpp"
+#include "logic.hpp"
 #include "variables.hpp"
 
 using std::logic_error;
@@ -11,6 +13,32 @@ using std::unique_ptr;
 namespace nts
 {
 
+// Cached hash (and havoc bitset) of the user depends on used variables
+static void invalidate_user_hash ( VariableUse::UserType type, VariableUse::UserPtr ptr )
+{
+	if ( !ptr.raw )
+		return;
+
+	switch ( type )
+	{
+		case VariableUse::UserType::VariableReference:
+			ptr.vref->invalidate_hash();
+			break;
+
+		case VariableUse::UserType::ArrayWrite:
+			ptr.arr_wr->invalidate_hash();
+			break;
+
+		case VariableUse::UserType::Havoc:
+			ptr.hvc->variables_changed();
+			break;
+
+		case VariableUse::UserType::CallTransitionRule:
+			ptr.ctr->invalidate_hash();
+			break;
+	}
+}
+
 //------------------------------------//
 // VariableUse                        //
 //------------------------------------//
@@ -82,6 +110,13 @@ void VariableUse::set ( Variable * v )
 		_pos = v->_uses.insert ( v->_uses.cend(), this );
 		_var = v;
 	}
+
+	invalidate_user_hash ( user_type, user_ptr );
+}
+
+void VariableUse::notify_user()
+{
+	invalidate_user_hash ( user_type, user_ptr );
 }
 
 Variable * VariableUse::release()
@@ -146,6 +181,28 @@ VariableUseContainer :: VariableUseContainer ( Havoc & hvc ) :
 	_ptr.hvc = & hvc;
 }
 
+VariableUseContainer::iterator VariableUseContainer :: erase ( const_iterator pos )
+{
+	auto it = std::vector < VariableUse > :: erase ( pos );
+	invalidate_user_hash ( _type, _ptr );
+	return it;
+}
+
+VariableUseContainer::iterator VariableUseContainer :: erase (
+		const_iterator first,
+		const_iterator last )
+{
+	auto it = std::vector < VariableUse > :: erase ( first, last );
+	invalidate_user_hash ( _type, _ptr );
+	return it;
+}
+
+void VariableUseContainer :: clear()
+{
+	std::vector < VariableUse > :: clear();
+	invalidate_user_hash ( _type, _ptr );
+}
+
 void VariableUseContainer :: push_back ( Variable * v )
 {
 	std::vector < VariableUse > :: push_back ( VariableUse ( _type, _ptr, modifying ) );
@@ -175,12 +232,115 @@ VariableUseContainer & VariableUseContainer::operator= (
 	return *this;
 }
 
+//------------------------------------//
+// VariableSet                        //
+//------------------------------------//
+
+// Trailing zero words are dropped, so that equal sets are equal vectors
+void VariableSet::trim()
+{
+	while ( !_words.empty() && _words.back() == 0 )
+		_words.pop_back();
+}
+
+bool VariableSet::contains ( const Variable & v ) const
+{
+	const unsigned int w = v.id() / 64;
+	return w < _words.size() && ( _words[w] >> ( v.id() % 64 ) & 1 );
+}
+
+void VariableSet::insert ( const Variable & v )
+{
+	const unsigned int w = v.id() / 64;
+	if ( w >= _words.size() )
+		_words.resize ( w + 1, 0 );
+
+	_words[w] |= std::uint64_t ( 1 ) << ( v.id() % 64 );
+}
+
+void VariableSet::erase ( const Variable & v )
+{
+	const unsigned int w = v.id() / 64;
+	if ( w >= _words.size() )
+		return;
+
+	_words[w] &= ~ ( std::uint64_t ( 1 ) << ( v.id() % 64 ) );
+	trim();
+}
+
+void VariableSet::clear()
+{
+	_words.clear();
+}
+
+std::size_t VariableSet::size() const
+{
+	std::size_t n = 0;
+	for ( std::uint64_t w : _words )
+		n += __builtin_popcountll ( w );
+
+	return n;
+}
+
+bool VariableSet::intersects ( const VariableSet & other ) const
+{
+	const std::size_t n = std::min ( _words.size(), other._words.size() );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		if ( _words[i] & other._words[i] )
+			return true;
+	}
+	return false;
+}
+
+VariableSet & VariableSet::operator|= ( const VariableSet & other )
+{
+	if ( other._words.size() > _words.size() )
+		_words.resize ( other._words.size(), 0 );
+
+	for ( std::size_t i = 0; i < other._words.size(); i++ )
+		_words[i] |= other._words[i];
+
+	return *this;
+}
+
+VariableSet & VariableSet::operator&= ( const VariableSet & other )
+{
+	if ( _words.size() > other._words.size() )
+		_words.resize ( other._words.size() );
+
+	for ( std::size_t i = 0; i < _words.size(); i++ )
+		_words[i] &= other._words[i];
+
+	trim();
+	return *this;
+}
+
+VariableSet & VariableSet::operator-= ( const VariableSet & other )
+{
+	const std::size_t n = std::min ( _words.size(), other._words.size() );
+	for ( std::size_t i = 0; i < n; i++ )
+		_words[i] &= ~other._words[i];
+
+	trim();
+	return *this;
+}
+
 //------------------------------------//
 // VariableContainer                  //
 //------------------------------------//
 
+VariableContainer::VariableContainer() :
+	_owner_nts ( nullptr ),
+	_owner_bn  ( nullptr )
+{
+	;
+}
+
 VariableContainer::VariableContainer ( list < Variable * > l ) :
-	list < Variable * > ( l )
+	list < Variable * > ( l ),
+	_owner_nts ( nullptr ),
+	_owner_bn  ( nullptr )
 {
 	;
 }
@@ -207,8 +367,30 @@ VariableContainer & VariableContainer::operator+= ( unique_ptr < Variable > v )
 
 	v->_container = this;
 	v->_pos = insert ( cend(), v.release() );
+	invalidate_owner_hash();
 
 	return *this;
 }
 
+void VariableContainer::set_owner ( Nts & n )
+{
+	_owner_nts = &n;
+	_owner_bn  = nullptr;
+}
+
+void VariableContainer::set_owner ( BasicNts & bn )
+{
+	_owner_nts = nullptr;
+	_owner_bn  = &bn;
+}
+
+void VariableContainer::invalidate_owner_hash()
+{
+	if ( _owner_nts )
+		_owner_nts->invalidate_hash();
+
+	if ( _owner_bn )
+		_owner_bn->invalidate_hash();
+}
+
 }; // namespace nts;
@@ -6,6 +6,8 @@
 #include <functional>
 #include <vector>
 #include <list>
+#include <cstddef>
+#include <cstdint>
 
 namespace nts
 {
@@ -48,6 +50,10 @@ class VariableUse
 		VariableUsesList::iterator _pos;
 		Variable * _var;
 
+		// Variable::replace_all_uses_with() moves whole use lists
+		friend class Variable;
+		void notify_user();
+
 	public:
 		// Does this usage modify its value?
 		const bool     modifying;
@@ -141,24 +147,74 @@ class VariableUseContainer : private std::vector < VariableUse >
 		using std::vector < VariableUse > :: operator[];
 		using std::vector < VariableUse > :: at;
 
-		using std::vector < VariableUse > :: erase;
-		using std::vector < VariableUse > :: clear;
-
 		using std::vector < VariableUse > :: size;
 
+		using typename std::vector < VariableUse > :: iterator;
+		using typename std::vector < VariableUse > :: const_iterator;
+
+		// These notify the user, that its variables have changed
+		iterator erase ( const_iterator pos );
+		iterator erase ( const_iterator first, const_iterator last );
+		void clear();
+
 		void push_back ( Variable * v );
 };
 
 
+/**
+ * @brief Set of variables, stored as a bitset over their ids
+ * (see Variable::id()). Membership is a constant-time query,
+ * union and intersection process a machine word at a time.
+ * The set does not own nor track its variables; it must not be
+ * used after a member is destroyed, because its id may be reused.
+ */
+class VariableSet
+{
+	private:
+		std::vector < std::uint64_t > _words;
+
+		void trim();
+
+	public:
+		VariableSet() = default;
+
+		bool contains ( const Variable & v ) const;
+		void insert   ( const Variable & v );
+		void erase    ( const Variable & v );
+		void clear();
+
+		bool empty() const { return _words.empty(); }
+		std::size_t size() const;
+
+		// Do the sets have a common member?
+		bool intersects ( const VariableSet & other ) const;
+
+		VariableSet & operator|= ( const VariableSet & other );
+		VariableSet & operator&= ( const VariableSet & other );
+		VariableSet & operator-= ( const VariableSet & other );
+
+		bool operator== ( const VariableSet & other ) const { return _words == other._words; }
+		bool operator!= ( const VariableSet & other ) const { return _words != other._words; }
+};
+
 /**
  * @brief Owns all inserted variables.
  * This class is used by Nts, BasicNts and QuantifiedVariableList
  * to hold all variables it owns.
  */
+class Nts;
+class BasicNts;
+
 class VariableContainer : public std::list < Variable * >
 {
+	private:
+		// Declarations are part of the content hash of the owner
+		// (if any), which must be notified about changes.
+		Nts      * _owner_nts;
+		BasicNts * _owner_bn;
+
 	public:
-		VariableContainer() = default;
+		VariableContainer();
 		explicit VariableContainer ( std::list < Variable * > );
 		VariableContainer ( const VariableContainer & ) = delete;
 		VariableContainer ( VariableContainer && ) = delete;
@@ -169,6 +225,11 @@ class VariableContainer : public std::list < Variable * >
 		VariableContainer & operator= ( VariableContainer && old );
 
 		VariableContainer & operator+= ( std::unique_ptr < Variable > v );
+
+		void set_owner ( Nts & n );
+		void set_owner ( BasicNts & bn );
+
+		void invalidate_owner_hash();
 };
 
 
@@ -0,0 +1,93 @@
+#include <stdexcept>
+#include <utility>
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "writer.hpp"
+
+using std::move;
+using std::string;
+using std::logic_error;
+using std::unique_ptr;
+
+namespace nts
+{
+
+NtsWriter::NtsWriter ( std::ostream & o, const Nts & header ) :
+	_o              ( o      ),
+	_header         ( header ),
+	_header_written ( false  ),
+	_finished       ( false  ),
+	_n_written      ( 0      )
+{
+	;
+}
+
+void NtsWriter::write_header()
+{
+	if ( _header_written )
+		throw logic_error ( "Header already written" );
+
+	_header.print_header ( _o );
+
+	for ( const Instance * i : _header.instances() )
+		_referenced.insert ( i->basic_nts().name );
+
+	_header_written = true;
+}
+
+void NtsWriter::write ( unique_ptr < BasicNts > bn )
+{
+	if ( !_header_written )
+		write_header();
+
+	if ( _finished )
+		throw logic_error ( "Writer already finished" );
+
+	if ( bn->parent() )
+		throw logic_error ( "BasicNts must not have a parent" );
+
+	if ( ! _written.insert ( bn->name ).second )
+		throw logic_error ( "BasicNts '" + bn->name + "' already written" );
+
+	for ( const Transition * t : bn->transitions() )
+	{
+		if ( t->rule().kind() != TransitionRule::Kind::Call )
+			continue;
+
+		auto & ctr = static_cast < const CallTransitionRule & > ( t->rule() );
+		_referenced.insert ( ctr.dest().name );
+	}
+
+	// operator<< ( Nts ) separates BasicNtses by an empty line
+	if ( _n_written > 0 )
+		_o << "\n";
+
+	_o << *bn;
+	_n_written++;
+
+	// Release memory before the next one is generated
+	bn.reset();
+}
+
+void NtsWriter::finish()
+{
+	if ( !_header_written )
+		write_header();
+
+	if ( _finished )
+		return;
+
+	if ( _n_written > 0 )
+		_o << "\n";
+
+	_finished = true;
+
+	for ( const string & name : _referenced )
+	{
+		if ( _written.find ( name ) == _written.end() )
+			throw logic_error ( "BasicNts '" + name + "' is referenced, but not written" );
+	}
+}
+
+} // namespace nts
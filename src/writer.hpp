@@ -0,0 +1,64 @@
+#ifndef NTS_WRITER_HPP_
+#define NTS_WRITER_HPP_
+#pragma once
+
+#include <ostream>
+#include <memory>
+#include <string>
+#include <unordered_set>
+
+#include "nts.hpp"
+
+namespace nts
+{
+
+/**
+ * @brief Emits an Nts one BasicNts at a time.
+ *
+ * The header (name, global variables, initial formula and instances)
+ * is taken from an Nts, which should not own any BasicNts.
+ * BasicNtses are then passed to write() one by one. Each of them
+ * is printed and destroyed right away, so only one of them
+ * has to be held in memory.
+ *
+ * Transitions may refer to global variables of the header.
+ * Callees and instantiated BasicNtses are referred to only by name,
+ * so they may be lightweight declarations (name and in/out parameters).
+ * Once everything is written, finish() checks that each referenced
+ * name was written.
+ *
+ * Concatenated output is the same as output of operator<< ( Nts ).
+ */
+class NtsWriter
+{
+	private:
+		std::ostream & _o;
+		const Nts    & _header;
+
+		bool _header_written;
+		bool _finished;
+		unsigned int _n_written;
+
+		std::unordered_set < std::string > _written;
+		std::unordered_set < std::string > _referenced;
+
+	public:
+		// Header must outlive the writer
+		NtsWriter ( std::ostream & o, const Nts & header );
+		NtsWriter ( const NtsWriter & ) = delete;
+
+		void write_header();
+
+		// Writes and destroys given BasicNts.
+		// It must not have a parent.
+		void write ( std::unique_ptr < BasicNts > bn );
+
+		// Throws std::logic_error if some referenced BasicNts was not written
+		void finish();
+
+		unsigned int n_written() const { return _n_written; }
+};
+
+} // namespace nts
+
+#endif // NTS_WRITER_HPP_
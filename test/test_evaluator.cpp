@@ -0,0 +1,266 @@
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <limits>
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "sugar.hpp"
+
+#include "evaluator.hpp"
+#include "reachability.hpp"
+#include "simulation.hpp"
+
+using namespace nts;
+using namespace nts::sugar;
+
+using std::cout;
+using std::unique_ptr;
+
+const DataType dt_int = DataType ( ScalarType::Integer() );
+
+void test_evaluator()
+{
+	BasicNts bn ( "eval" );
+	auto x = new Variable ( dt_int, "x" );
+	auto b = new BitVectorVariable ( "b", 8 );
+	auto a = new Variable ( DataType ( ScalarType::Integer(), 0, { new IntConstant ( 3 ) } ), "a" );
+	for ( Variable * v : { x, (Variable *) b, a } )
+		v->insert_to ( bn );
+
+	ValuationLayout layout ( bn );
+	cout << "layout size: " << layout.size() << "\n";
+
+	// x' = x + 1 && b' = b + 255 && a'[x] = 7 && havoc ( x, b, a )
+	auto & f = ( NEXT ( x ) == ( CURR ( x ) + 1 ) )
+		&& ( NEXT ( b ) == ( CURR ( b ) + 255 ) )
+		&& ( ArrWrite ( *a ) [ CURR ( x ) ] == 7 )
+		&& havoc ( { x, b, a } );
+
+	CompiledFormula cf ( f, layout );
+	cout << "instructions: " << cf.size() << "\n";
+
+	//                x  b   a[0..2]
+	Valuation curr { 1, 0,   4, 5, 6 };
+	Valuation next { 2, 255, 4, 7, 6 };
+	cout << "wraps around: " << cf.evaluate ( curr, next ) << "\n";
+
+	next[4] = 0;
+	cout << "other element changed: " << cf.evaluate ( curr, next ) << "\n";
+	next[4] = 6;
+
+	curr[0] = 3;
+	next[0] = 4;
+	try
+	{
+		cf.evaluate ( curr, next );
+	}
+	catch ( const std::out_of_range & e )
+	{
+		cout << "out of bounds: " << e.what() << "\n";
+	}
+
+	// forall i in [0, 2] . a[i] > x
+	auto i = new Variable ( dt_int, "i" );
+	ArrRead ar ( *a );
+	auto & body = * new Relation ( RelationOp::gt,
+			unique_ptr < Term > ( &ar [ CURR ( i ) ] ),
+			unique_ptr < Term > ( &CURR ( x ) ) );
+	QuantifiedFormula qf ( Quantifier::Forall,
+			QuantifiedType ( dt_int,
+				unique_ptr < Term > ( new IntConstant ( 0 ) ),
+				unique_ptr < Term > ( new IntConstant ( 2 ) ) ),
+			unique_ptr < Formula > ( &body ) );
+	i->insert_to ( qf.list );
+
+	CompiledFormula cq ( qf, layout );
+	curr = { 3, 0, 4, 5, 6 };
+	cout << "forall holds: " << cq.evaluate ( curr, curr ) << "\n";
+	curr[0] = 4;
+	cout << "forall fails: " << cq.evaluate ( curr, curr ) << "\n";
+
+	// Throughput of the interpreter
+	curr = { 1, 0, 4, 5, 6 };
+	next = { 2, 255, 4, 7, 6 };
+	unsigned int n_true = 0;
+	for ( unsigned int k = 0; k < 1000000; k++ )
+		n_true += cf.evaluate ( curr, next );
+	cout << "evaluated 1000000 times, true: " << n_true << "\n";
+
+	// Batch evaluation agrees with evaluation one by one,
+	// out of bounds accesses count as false
+	const unsigned int B = CompiledExpression::batch_size;
+	Valuation bcurr ( layout.size() * B );
+	Valuation bnext ( layout.size() * B );
+	for ( unsigned int l = 0; l < B; l++ )
+	{
+		Valuation c { Value ( l % 5 ), Value ( l % 3 ), 4, 5, 6 };
+		Valuation n { Value ( l % 5 + 1 ), Value ( ( l + 255 ) % 3 ), 4, 7, 6 };
+		for ( unsigned int s = 0; s < layout.size(); s++ )
+		{
+			bcurr [ s * B + l ] = c[s];
+			bnext [ s * B + l ] = n[s];
+		}
+	}
+	auto holds = cf.evaluate_batch ( bcurr.data(), bnext.data() );
+	unsigned int agree = 0;
+	for ( unsigned int l = 0; l < B; l++ )
+	{
+		Valuation c ( layout.size() ), n ( layout.size() );
+		for ( unsigned int s = 0; s < layout.size(); s++ )
+		{
+			c[s] = bcurr [ s * B + l ];
+			n[s] = bnext [ s * B + l ];
+		}
+
+		bool expected = false;
+		try
+		{
+			expected = cf.evaluate ( c, n );
+		}
+		catch ( const std::out_of_range & )
+		{
+			;
+		}
+		agree += expected == bool ( holds >> l & 1 );
+	}
+	cout << "batch agrees: " << agree << " of " << B << "\n";
+	cout << "batch forall: " << __builtin_popcountll ( cq.evaluate_batch ( bcurr.data(), bcurr.data() ) ) << "\n";
+
+	// Closed terms
+	auto & t = ( * new IntConstant ( 20 ) ) + -7;
+	cout << "closed term: " << t.evaluate() << "\n";
+	delete &t;
+
+	delete &f;
+}
+
+// Counter, which reaches an error state when it is 9
+void counter_nts ( BasicNts & bn, bool with_error )
+{
+	auto c = new BitVectorVariable ( "c", 4 );
+	auto b = new BitVectorVariable ( "b", 2 );
+	c->insert_to ( bn );
+	b->insert_to ( bn );
+
+	auto s0 = new State ( "s0" );
+	auto se = new State ( "se" );
+	s0->is_initial() = true;
+	se->is_error() = true;
+	s0->insert_to ( bn );
+	se->insert_to ( bn );
+
+	// Counter increments, b is arbitrary
+	auto & inc = ( NEXT ( c ) == ( CURR ( c ) + 1 ) ) && havoc ( { c, b } );
+	( *s0 ->* *s0 ) ( inc ).insert_to ( bn );
+
+	if ( with_error )
+	{
+		auto & err = ( CURR ( c ) == 9 ) && havoc();
+		( *s0 ->* *se ) ( err ).insert_to ( bn );
+	}
+}
+
+void test_reachability()
+{
+	BasicNts bn ( "counter" );
+	counter_nts ( bn, true );
+
+	Reachability r ( bn );
+	r.n_threads = 1;
+	r.breadth_first = true;
+	auto res = r.run();
+	cout << "error reached: " << res.error_reached << ", trace length: " << res.trace.size() << "\n";
+	for ( const auto & step : res.trace )
+	{
+		cout << "  " << step.control[0]->name << " c=" << step.valuation[0]
+			<< " b=" << step.valuation[1] << "\n";
+	}
+
+	Reachability r4 ( bn );
+	r4.n_threads = 4;
+	res = r4.run();
+	cout << "4 threads, error reached: " << res.error_reached
+		<< ", ends in " << res.trace.back().control[0]->name
+		<< " with c=" << res.trace.back().valuation[0] << "\n";
+
+	// Without the error transition, all 16 * 4 states are explored
+	BasicNts safe ( "safe" );
+	counter_nts ( safe, false );
+	Reachability rs ( safe );
+	rs.n_threads = 4;
+	res = rs.run();
+	cout << "safe: error reached " << res.error_reached << ", complete " << res.complete
+		<< ", states " << res.n_states << "\n";
+
+	// Visited states outgrow the initial table, the limit does not overflow
+	BasicNts wide ( "wide" );
+	auto w = new BitVectorVariable ( "w", 12 );
+	w->insert_to ( wide );
+	auto w0 = new State ( "w0" );
+	w0->is_initial() = true;
+	w0->insert_to ( wide );
+	( *w0 ->* *w0 ) ( ( NEXT ( w ) == ( CURR ( w ) + 1 ) ) && havoc ( { w } ) ).insert_to ( wide );
+	Reachability rw ( wide );
+	rw.n_threads = 4;
+	rw.max_states = std::numeric_limits < std::size_t >::max();
+	res = rw.run();
+	cout << "wide: complete " << res.complete << ", states " << res.n_states << "\n";
+
+	// Two threads increment a shared global
+	Nts n ( "threads" );
+	auto g = new BitVectorVariable ( "g", 3 );
+	g->insert_to ( n );
+	auto * th = new BasicNts ( "th" );
+	th->insert_to ( n );
+	auto t0 = new State ( "t0" );
+	auto t1 = new State ( "t1" );
+	t0->is_initial() = true;
+	t0->insert_to ( *th );
+	t1->insert_to ( *th );
+	auto & upd = ( NEXT ( g ) == ( CURR ( g ) + 1 ) ) && havoc ( { g } );
+	( *t0 ->* *t1 ) ( upd ).insert_to ( *th );
+	( new Instance ( th, new IntConstant ( 2 ) ) )->insert_to ( n );
+
+	Reachability rp ( n );
+	res = rp.run();
+	cout << "product: valuation size " << rp.valuation_size() << ", complete "
+		<< res.complete << ", states " << res.n_states << "\n";
+}
+
+void test_simulation()
+{
+	BasicNts bn ( "counter" );
+	counter_nts ( bn, true );
+
+	Simulation sim ( bn );
+	sim.n_runs = 1000;
+	sim.n_steps = 50;
+	auto res = sim.run();
+
+	unsigned int covered = 0;
+	for ( const auto & c : res.coverage )
+		covered += c.second > 0;
+	cout << "simulation: covered " << covered << " of " << res.coverage.size()
+		<< " transitions, error states reached " << res.errors.size()
+		<< ", deadlocks " << res.n_deadlocks << "\n";
+
+	// Without the error, runs never stop
+	BasicNts safe ( "safe" );
+	counter_nts ( safe, false );
+	Simulation ss ( safe );
+	ss.n_runs = 100;
+	ss.n_steps = 1000;
+	ss.restart = false;
+	res = ss.run();
+	cout << "safe: steps " << res.n_steps << ", errors " << res.errors.size()
+		<< ", deadlocks " << res.n_deadlocks << "\n";
+}
+
+int main()
+{
+	test_evaluator();
+	test_reachability();
+	test_simulation();
+	return 0;
+}
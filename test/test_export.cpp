@@ -0,0 +1,253 @@
+#include <iostream>
+#include <sstream>
+#include <memory>
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "sugar.hpp"
+#include "writer.hpp"
+#include "smt.hpp"
+#include "inliner.hpp"
+#include "codegen.hpp"
+
+using namespace nts;
+using namespace nts::sugar;
+
+using std::cout;
+using std::unique_ptr;
+using std::stringstream;
+
+const DataType dt_int = DataType ( ScalarType::Integer() );
+
+// Declaration of a callee: only name and parameters
+unique_ptr < BasicNts > callee_decl()
+{
+	auto bn = unique_ptr < BasicNts > ( new BasicNts ( "callee" ) );
+	( new Variable ( dt_int, "var_in"  ) )->insert_param_in_to  ( *bn );
+	( new Variable ( dt_int, "var_out" ) )->insert_param_out_to ( *bn );
+	return bn;
+}
+
+unique_ptr < BasicNts > callee_body ( Variable & global )
+{
+	auto bn = callee_decl();
+	Variable * in  = bn->params_in().front();
+	Variable * out = bn->params_out().front();
+
+	auto si = new State ( "si" );
+	auto sf = new State ( "sf" );
+	si->is_initial() = true;
+	sf->is_final() = true;
+	si->insert_to ( *bn );
+	sf->insert_to ( *bn );
+
+	auto & f = ( NEXT ( out ) == ( CURR ( in ) + CURR ( global ) ) )
+		&& havoc ( { out } );
+	( *si ->* *sf ) ( f ).insert_to ( *bn );
+	return bn;
+}
+
+unique_ptr < BasicNts > caller_body ( BasicNts & callee )
+{
+	auto bn = unique_ptr < BasicNts > ( new BasicNts ( "caller" ) );
+	auto result = new Variable ( dt_int, "result" );
+	result->insert_to ( *bn );
+
+	auto si = new State ( "c_si" );
+	auto sf = new State ( "c_sf" );
+	si->is_initial() = true;
+	sf->is_final() = true;
+	si->insert_to ( *bn );
+	sf->insert_to ( *bn );
+
+	auto * ctr = new CallTransitionRule ( callee, { new IntConstant ( 5 ) }, { result } );
+	( *si ->* *sf ) ( *ctr ).insert_to ( *bn );
+	return bn;
+}
+
+void test_writer()
+{
+	Nts header ( "streamed" );
+	auto global = new Variable ( dt_int, "g" );
+	global->insert_to ( header );
+
+	// Instances and calls refer to declarations only
+	unique_ptr < BasicNts > caller_decl ( new BasicNts ( "caller" ) );
+	unique_ptr < BasicNts > callee ( callee_decl() );
+	( new Instance ( caller_decl.get(), new IntConstant ( 1 ) ) )->insert_to ( header );
+
+	stringstream streamed;
+	NtsWriter w ( streamed, header );
+	w.write_header();
+	w.write ( callee_body ( *global ) );
+	w.write ( caller_body ( *callee ) );
+	w.finish();
+
+	// The same model, built in memory
+	Nts whole ( "streamed" );
+	auto g2 = new Variable ( dt_int, "g" );
+	g2->insert_to ( whole );
+	auto b_callee = callee_body ( *g2 ).release();
+	b_callee->insert_to ( whole );
+	auto b_caller = caller_body ( *b_callee ).release();
+	b_caller->insert_to ( whole );
+	( new Instance ( b_caller, new IntConstant ( 1 ) ) )->insert_to ( whole );
+
+	stringstream in_memory;
+	in_memory << whole;
+
+	cout << "** Streamed **\n" << streamed.str();
+	cout << "same as in-memory: "
+		<< ( streamed.str() == in_memory.str() ? "yes" : "no" ) << "\n";
+
+	// Missing callee body is reported
+	stringstream missing;
+	NtsWriter w2 ( missing, header );
+	w2.write ( caller_body ( *callee ) );
+	try
+	{
+		w2.finish();
+		cout << "missing callee: not reported\n";
+	}
+	catch ( const std::logic_error & e )
+	{
+		cout << "missing callee: " << e.what() << "\n";
+	}
+}
+
+void test_smt()
+{
+	BasicNts bn ( "smt" );
+	auto x = new Variable ( dt_int, "x" );
+	auto y = new Variable ( dt_int, "y" );
+	auto b = new BitVectorVariable ( "b", 8 );
+	for ( Variable * v : { x, y, (Variable *) b } )
+		v->insert_to ( bn );
+
+	// ( x + y ) * ( x + y ) is shared
+	auto & sum = CURR ( x ) + CURR ( y );
+	auto & sq = * new ArithmeticOperation ( ArithOp::Mul,
+			unique_ptr < Term > ( &sum ),
+			unique_ptr < Term > ( sum.clone() ) );
+
+	// Constant -1 wraps to 255 in an 8-bit context
+	auto & f = ( ( NEXT ( y ) == sq ) && ( NEXT ( b ) == ( CURR ( b ) + -1 ) ) )
+		&& havoc ( { y, b } );
+
+	SmtPrinter p ( cout );
+	p.set_frame ( bn );
+	p.print_frame_declarations();
+	p.print_assert ( f );
+
+	delete &f;
+}
+
+void test_hash()
+{
+	BasicNts bn ( "hash" );
+	auto x = new Variable ( dt_int, "x" );
+	auto y = new Variable ( dt_int, "y" );
+	x->insert_to ( bn );
+	y->insert_to ( bn );
+
+	auto & f = ( NEXT ( x ) == ( CURR ( x ) + CURR ( y ) ) ) && havoc ( { x, y } );
+	auto & g = ( NEXT ( x ) == ( CURR ( x ) + CURR ( y ) ) ) && havoc ( { y, x } );
+	Formula * c = f.clone();
+
+	cout << "clone equal: " << ( structurally_equal ( f, *c ) ? "yes" : "no" )
+		<< ", same hash: " << ( f.hash() == c->hash() ? "yes" : "no" ) << "\n";
+	cout << "havoc order ignored: " << ( structurally_equal ( f, g ) ? "yes" : "no" ) << "\n";
+
+	// Hash follows substitution of variables
+	std::size_t before = c->hash();
+	visit_variable_uses sub ( [&] ( VariableUse & u )
+		{ if ( u.get() == y ) u.set ( x ); } );
+	sub.visit ( *c );
+	cout << "after substitution: equal "
+		<< ( structurally_equal ( f, *c ) ? "yes" : "no" )
+		<< ", hash changed " << ( before != c->hash() ? "yes" : "no" ) << "\n";
+
+	delete &f;
+	delete &g;
+	delete c;
+
+	// Content hash of the whole model
+	Nts n ( "hashed" );
+	auto gl = new Variable ( dt_int, "g" );
+	gl->insert_to ( n );
+	auto b_callee = callee_body ( *gl ).release();
+	b_callee->insert_to ( n );
+	auto b_caller = caller_body ( *b_callee ).release();
+	b_caller->insert_to ( n );
+
+	std::size_t h_nts    = n.hash();
+	std::size_t h_callee = b_callee->hash();
+	std::size_t h_caller = b_caller->hash();
+
+	// Callee reads 'out' instead of 'g'
+	Variable * out = b_callee->params_out().front();
+	visit_variable_uses sub_g ( [&] ( VariableUse & u )
+		{ if ( u.get() == gl ) u.set ( out ); } );
+	sub_g.visit ( b_callee->transitions().front()->rule() );
+
+	cout << "modified callee: nts hash changed " << ( h_nts != n.hash() ? "yes" : "no" )
+		<< ", callee changed " << ( h_callee != b_callee->hash() ? "yes" : "no" )
+		<< ", caller kept " << ( h_caller == b_caller->hash() ? "yes" : "no" ) << "\n";
+
+	auto t = b_caller->transitions().front();
+	t->remove_from_parent();
+	cout << "removed transition: caller changed "
+		<< ( h_caller != b_caller->hash() ? "yes" : "no" );
+	t->insert_to ( *b_caller );
+	cout << ", reinserted restores " << ( h_caller == b_caller->hash() ? "yes" : "no" ) << "\n";
+}
+
+void test_codegen()
+{
+	BasicNts bn ( "gen" );
+	auto c = new BitVectorVariable ( "c", 4 );
+	auto x = new Variable ( dt_int, "x" );
+	auto a = new Variable ( DataType ( ScalarType::Integer(), 0, { new IntConstant ( 16 ) } ), "a" );
+	for ( Variable * v : { (Variable *) c, x, a } )
+		v->insert_to ( bn );
+
+	auto s0 = new State ( "s0" );
+	auto se = new State ( "se" );
+	s0->is_initial() = true;
+	se->is_error() = true;
+	s0->insert_to ( bn );
+	se->insert_to ( bn );
+
+	// c' = c + 1 && a'[c] = x && havoc ( c, x, a ), x is a free choice
+	auto & step = ( NEXT ( c ) == ( CURR ( c ) + 1 ) )
+		&& ( ArrWrite ( *a ) [ CURR ( c ) ] == CURR ( x ) )
+		&& havoc ( { c, x, a } );
+	( *s0 ->* *s0 ) ( step ).insert_to ( bn );
+
+	// c = 15 && ( forall i in [0, 1] . a[x + i] > 1000 ) && havoc()
+	auto i = new Variable ( dt_int, "i" );
+	ArrRead ar ( *a );
+	auto & body = * new Relation ( RelationOp::gt,
+			unique_ptr < Term > ( &ar [ CURR ( x ) + CURR ( i ) ] ),
+			unique_ptr < Term > ( new IntConstant ( 1000 ) ) );
+	auto qf = new QuantifiedFormula ( Quantifier::Forall,
+			QuantifiedType ( dt_int,
+				unique_ptr < Term > ( new IntConstant ( 0 ) ),
+				unique_ptr < Term > ( new IntConstant ( 1 ) ) ),
+			unique_ptr < Formula > ( &body ) );
+	i->insert_to ( qf->list );
+	auto & err = ( CURR ( c ) == 15 ) && *qf && havoc();
+	( *s0 ->* *se ) ( err ).insert_to ( bn );
+
+	CGenerator g ( cout );
+	g.generate ( bn );
+}
+
+int main()
+{
+	test_writer();
+	test_smt();
+	test_hash();
+	test_codegen();
+	return 0;
+}
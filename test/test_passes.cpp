@@ -0,0 +1,865 @@
+#include <iostream>
+
+#include "nts.hpp"
+#include "logic.hpp"
+#include "sugar.hpp"
+
+#include "dedup.hpp"
+#include "simplify.hpp"
+#include "compose.hpp"
+#include "lbe.hpp"
+#include "slice.hpp"
+#include "liveness.hpp"
+#include "prune.hpp"
+#include "cfg.hpp"
+#include "bisim.hpp"
+#include "accel.hpp"
+#include "intervals.hpp"
+#include "decomposition.hpp"
+#include "substitution.hpp"
+#include "unroll.hpp"
+#include "scalarize.hpp"
+
+using namespace nts;
+using namespace nts::sugar;
+
+using std::cout;
+using std::unique_ptr;
+using std::make_unique;
+
+const DataType dt_int = DataType ( ScalarType::Integer() );
+
+void test_dedup()
+{
+	BasicNts bn ( "dedup" );
+	auto x = new Variable ( dt_int, "x" );
+	x->insert_to ( bn );
+
+	auto s1 = new State ( "s1" );
+	auto s2 = new State ( "s2" );
+	s1->is_initial() = true;
+	s2->is_final() = true;
+	s1->insert_to ( bn );
+	s2->insert_to ( bn );
+
+	// Two copies of the same path, and one different
+	for ( int i = 0; i < 2; i++ )
+	{
+		auto & f = ( NEXT ( x ) == ( CURR ( x ) + 1 ) ) && havoc ( { x } );
+		( *s1 ->* *s2 ) ( f ).insert_to ( bn );
+	}
+	auto & g = ( NEXT ( x ) == 0 ) && havoc ( { x } );
+	( *s1 ->* *s2 ) ( g ).insert_to ( bn );
+
+	cout << "** Before **\n" << bn;
+	unsigned int n = remove_duplicate_transitions ( bn );
+	cout << "removed duplicates: " << n << "\n";
+	n = remove_duplicate_transitions ( bn, true );
+	cout << "merged: " << n << "\n";
+	cout << "** After **\n" << bn;
+}
+
+// Operations which are not covered by sugar
+Term & op ( ArithOp o, Term & t1, Term & t2 )
+{
+	return * new ArithmeticOperation ( o, unique_ptr < Term > ( &t1 ),
+			unique_ptr < Term > ( &t2 ) );
+}
+
+Term & num ( int value )
+{
+	return * new IntConstant ( value );
+}
+
+Formula & rel ( RelationOp o, Term & t1, Term & t2 )
+{
+	return * new Relation ( o, unique_ptr < Term > ( &t1 ), unique_ptr < Term > ( &t2 ) );
+}
+
+Formula & bop ( BoolOp o, Formula & f1, Formula & f2 )
+{
+	return * new FormulaBop ( o, unique_ptr < Formula > ( &f1 ),
+			unique_ptr < Formula > ( &f2 ) );
+}
+
+Formula & truth ( bool value )
+{
+	return boolterm ( make_unique < BoolConstant > ( value ) );
+}
+
+void test_simplify()
+{
+	Nts n ( "simplify" );
+	auto bn = new BasicNts ( "main" );
+	bn->insert_to ( n );
+
+	auto x = new Variable ( dt_int, "x" );
+	auto y = new Variable ( dt_int, "y" );
+	auto c = new Variable ( DataType ( ScalarType::BitVector ( 4 ) ), "c" );
+	x->insert_to ( *bn );
+	y->insert_to ( *bn );
+	c->insert_to ( *bn );
+
+	auto s1 = new State ( "s1" );
+	auto s2 = new State ( "s2" );
+	s1->is_initial() = true;
+	s1->insert_to ( *bn );
+	s2->insert_to ( *bn );
+
+	n.initial_add_conjunct ( unique_ptr < Formula > (
+			& ( !! ( CURR ( x ) > op ( ArithOp::Sub, num ( 7 ), num ( 2 ) ) ) ) ) );
+
+	// Folding, identities and merging of havocs
+	auto & f1 = ( NEXT ( x ) == op ( ArithOp::Mul,
+				CURR ( x ) + op ( ArithOp::Mul, num ( 2 ), num ( 3 ) ), num ( 1 ) ) )
+		&& ( truth ( true ) && havoc ( { x, y } ) ) && havoc ( { y, x, c } );
+	( *s1 ->* *s2 ) ( f1 ).insert_to ( *bn );
+
+	// Negated relation, constant on the left, bitvector wrap
+	auto & f2 = ! ( CURR ( x ) < 5 ) && rel ( RelationOp::lt, num ( 3 ), CURR ( y ) )
+		&& ( NEXT ( c ) == op ( ArithOp::Add, num ( 15 ), num ( 1 ) ) ) && havoc ( { c } );
+	( *s1 ->* *s2 ) ( f2 ).insert_to ( *bn );
+
+	// Decided relations; division of Integral constants depends on context
+	auto & f3 = bop ( BoolOp::Or, CURR ( y ) > 0,
+			rel ( RelationOp::leq, CURR ( x ), op ( ArithOp::Sub, CURR ( x ), num ( 0 ) ) ) );
+	( *s2 ->* *s1 ) ( f3 ).insert_to ( *bn );
+
+	auto & f4 = bop ( BoolOp::Imply, CURR ( c ) == CURR ( c ),
+			rel ( RelationOp::eq, op ( ArithOp::Div, CURR ( x ), num ( 1 ) ),
+				op ( ArithOp::Div, num ( -7 ), num ( 2 ) ) ) );
+	( *s2 ->* *s1 ) ( f4 ).insert_to ( *bn );
+
+	cout << "** Before **\n" << n;
+	simplify ( n );
+	cout << "** After **\n" << n;
+}
+
+void test_collapse_chains()
+{
+	BasicNts bn ( "chains" );
+	auto x = new Variable ( dt_int, "x" );
+	auto y = new Variable ( dt_int, "y" );
+	x->insert_to ( bn );
+	y->insert_to ( bn );
+
+	State * s[6];
+	for ( int i = 0; i < 6; i++ )
+	{
+		s[i] = new State ( "s" + std::to_string ( i ) );
+		s[i]->insert_to ( bn );
+	}
+	s[0]->is_initial() = true;
+	s[3]->is_final() = true;
+	s[5]->is_error() = true;
+
+	// Intermediate values are substituted
+	auto & f1 = ( NEXT ( x ) == CURR ( x ) + 1 ) && havoc ( { x } );
+	auto & f2 = ( NEXT ( y ) == CURR ( x ) + CURR ( x ) ) && havoc ( { y } );
+	auto & f3 = ( NEXT ( x ) == CURR ( x ) + CURR ( y ) ) && havoc ( { x } );
+	( *s[0] ->* *s[1] ) ( f1 ).insert_to ( bn );
+	( *s[1] ->* *s[2] ) ( f2 ).insert_to ( bn );
+	( *s[2] ->* *s[3] ) ( f3 ).insert_to ( bn );
+
+	// Without havoc, everything may change
+	auto & f4 = ( CURR ( x ) > 0 ) && ( NEXT ( x ) > CURR ( x ) );
+	auto & f5 = CURR ( x ) < 10;
+	( *s[3] ->* *s[4] ) ( f4 ).insert_to ( bn );
+	( *s[4] ->* *s[5] ) ( f5 ).insert_to ( bn );
+
+	cout << "** Before **\n" << bn;
+	unsigned int n = collapse_chains ( bn );
+	cout << "removed states: " << n << "\n";
+	cout << "** After **\n" << bn;
+}
+
+void test_compose()
+{
+	BasicNts bn ( "compose" );
+	auto x = new Variable ( dt_int, "x" );
+	auto y = new Variable ( dt_int, "y" );
+	x->insert_to ( bn );
+	y->insert_to ( bn );
+
+	// Small definition is copied
+	FormulaTransitionRule r1 ( unique_ptr < Formula > (
+			& ( ( NEXT ( x ) == CURR ( x ) + 1 ) && havoc ( { x } ) ) ) );
+	FormulaTransitionRule r2 ( unique_ptr < Formula > (
+			& ( ( NEXT ( y ) == CURR ( x ) + CURR ( x ) ) && havoc ( { y } ) ) ) );
+	cout << *compose ( r1, r2 ) << "\n";
+
+	// Large definition used more than once gets a fresh variable
+	Term * big = & CURR ( x );
+	for ( int i = 1; i < 10; i++ )
+		big = & ( *big + i );
+	FormulaTransitionRule r3 ( unique_ptr < Formula > (
+			& ( ( NEXT ( x ) == *big ) && havoc ( { x } ) ) ) );
+	FormulaTransitionRule r4 ( unique_ptr < Formula > (
+			& ( ( NEXT ( y ) == CURR ( x ) + CURR ( x ) ) && ( NEXT ( x ) == CURR ( x ) + 1 )
+				&& havoc ( { x, y } ) ) ) );
+	cout << *compose ( r3, r4 ) << "\n";
+}
+
+void test_slice()
+{
+	BasicNts bn ( "slice" );
+	auto i = new Variable ( dt_int, "i" );
+	auto x = new Variable ( dt_int, "x" );
+	auto y = new Variable ( dt_int, "y" );
+	auto z = new Variable ( dt_int, "z" );
+	for ( Variable * v : { i, x, y, z } )
+		v->insert_to ( bn );
+
+	State * s[5];
+	for ( int k = 0; k < 5; k++ )
+	{
+		s[k] = new State ( "s" + std::to_string ( k ) );
+		s[k]->insert_to ( bn );
+	}
+	s[0]->is_initial() = true;
+	s[3]->is_final() = true;
+	s[4]->is_error() = true;
+
+	auto & f1 = ( NEXT ( i ) == 0 ) && ( NEXT ( x ) == 5 ) && ( NEXT ( z ) == 7 )
+		&& havoc ( { i, x, z } );
+	auto & f2 = ( CURR ( i ) < 10 ) && ( NEXT ( i ) == CURR ( i ) + 1 )
+		&& ( NEXT ( z ) == CURR ( z ) + CURR ( i ) ) && havoc ( { i, z } );
+	// z keeps its value, so z' = 3 is a guard
+	auto & f3 = ( CURR ( i ) >= 10 ) && ( NEXT ( z ) == 3 ) && havoc();
+	auto & f4 = CURR ( x ) < 0;
+	auto & f5 = ( NEXT ( y ) == CURR ( z ) ) && havoc ( { y } );
+	( *s[0] ->* *s[1] ) ( f1 ).insert_to ( bn );
+	( *s[1] ->* *s[1] ) ( f2 ).insert_to ( bn );
+	( *s[1] ->* *s[2] ) ( f3 ).insert_to ( bn );
+	( *s[2] ->* *s[4] ) ( f4 ).insert_to ( bn );
+	// Final state does not lead to the error
+	( *s[1] ->* *s[3] ) ( f5 ).insert_to ( bn );
+
+	cout << "** Before **\n" << bn;
+	unsigned int n = slice ( bn );
+	cout << "removed variables: " << n << "\n";
+	cout << "** After **\n" << bn;
+}
+
+void test_slice_definitions()
+{
+	BasicNts bn ( "slice_definitions" );
+	auto x = new Variable ( dt_int, "x" );
+	auto y = new Variable ( dt_int, "y" );
+	auto z = new Variable ( dt_int, "z" );
+	auto w = new Variable ( dt_int, "w" );
+	for ( Variable * v : { x, y, z, w } )
+		v->insert_to ( bn );
+
+	auto s0 = new State ( "s0" );
+	auto s1 = new State ( "s1" );
+	auto se = new State ( "se" );
+	s0->is_initial() = true;
+	se->is_error() = true;
+	for ( State * s : { s0, s1, se } )
+		s->insert_to ( bn );
+
+	// Second definition of x is a guard y + 1 = z
+	( *s0 ->* *s1 ) ( ( NEXT ( x ) == CURR ( y ) + 1 ) && ( NEXT ( x ) == CURR ( z ) )
+			&& havoc ( { x } ) ).insert_to ( bn );
+	// w' = y' is no definition, it keeps y' = 5
+	( *s1 ->* *s0 ) ( ( NEXT ( w ) == NEXT ( y ) ) && ( NEXT ( w ) == 5 )
+			&& havoc ( { w, y } ) ).insert_to ( bn );
+	( *s0 ->* *se ) ( ( CURR ( y ) > CURR ( z ) ) && havoc() ).insert_to ( bn );
+
+	unsigned int n = slice ( bn );
+	cout << "removed variables: " << n << "\n";
+	cout << bn;
+}
+
+void test_liveness()
+{
+	BasicNts bn ( "liveness" );
+	auto a  = new Variable ( dt_int, "a" );
+	auto b  = new Variable ( dt_int, "b" );
+	auto d  = new Variable ( dt_int, "d" );
+	auto t1 = new Variable ( dt_int, "t1" );
+	auto t2 = new Variable ( dt_int, "t2" );
+	for ( Variable * v : { a, b, d, t1, t2 } )
+		v->insert_to ( bn );
+
+	State * s[6];
+	for ( int k = 0; k < 6; k++ )
+	{
+		s[k] = new State ( "s" + std::to_string ( k ) );
+		s[k]->insert_to ( bn );
+	}
+	s[0]->is_initial() = true;
+	s[5]->is_error() = true;
+
+	// d is never read, the rest have disjoint live ranges
+	auto & f1 = ( NEXT ( a ) == 1 ) && ( NEXT ( d ) == 5 ) && havoc ( { a, d } );
+	auto & f2 = ( NEXT ( t1 ) == CURR ( a ) + 1 ) && havoc ( { t1 } );
+	auto & f3 = ( NEXT ( b ) == op ( ArithOp::Mul, CURR ( t1 ), num ( 2 ) ) ) && havoc ( { b } );
+	auto & f4 = ( NEXT ( t2 ) == CURR ( b ) + 3 ) && havoc ( { t2 } );
+	auto & f5 = ( CURR ( t2 ) > 10 ) && havoc();
+	( *s[0] ->* *s[1] ) ( f1 ).insert_to ( bn );
+	( *s[1] ->* *s[2] ) ( f2 ).insert_to ( bn );
+	( *s[2] ->* *s[3] ) ( f3 ).insert_to ( bn );
+	( *s[3] ->* *s[4] ) ( f4 ).insert_to ( bn );
+	( *s[4] ->* *s[5] ) ( f5 ).insert_to ( bn );
+
+	cout << "** Before **\n" << bn;
+	auto live = live_variables ( bn );
+	for ( State * st : { s[0], s[2], s[4] } )
+	{
+		cout << "live at " << st->name << ":";
+		for ( Variable * v : live [ st ] )
+			cout << " " << v->name;
+		cout << "\n";
+	}
+
+	unsigned int n = eliminate_dead_variables ( bn );
+	cout << "removed variables: " << n << "\n";
+	cout << "** After **\n" << bn;
+}
+
+void test_liveness_definitions()
+{
+	BasicNts bn ( "liveness_definitions" );
+	auto x = new Variable ( dt_int, "x" );
+	auto y = new Variable ( dt_int, "y" );
+	auto z = new Variable ( dt_int, "z" );
+	for ( Variable * v : { x, y, z } )
+		v->insert_to ( bn );
+
+	auto s0 = new State ( "s0" );
+	auto s1 = new State ( "s1" );
+	auto se = new State ( "se" );
+	s0->is_initial() = true;
+	se->is_error() = true;
+	for ( State * s : { s0, s1, se } )
+		s->insert_to ( bn );
+
+	// x is dead, but x' = y' is no definition and x' = 5 then keeps y' = 5
+	( *s0 ->* *s1 ) ( ( NEXT ( x ) == NEXT ( y ) ) && ( NEXT ( x ) == 5 )
+			&& ( NEXT ( z ) == CURR ( z ) ) && havoc ( { x, y, z } ) ).insert_to ( bn );
+	// Second definition of x is a guard y + 1 = z
+	( *s1 ->* *s0 ) ( ( NEXT ( x ) == CURR ( y ) + 1 ) && ( NEXT ( x ) == CURR ( z ) )
+			&& havoc ( { x } ) ).insert_to ( bn );
+	( *s1 ->* *se ) ( ( CURR ( y ) < 3 ) && havoc() ).insert_to ( bn );
+
+	unsigned int n = eliminate_dead_variables ( bn, false );
+	cout << "eliminated: " << n << "\n";
+	cout << bn;
+}
+
+void test_prune()
+{
+	BasicNts bn ( "prune" );
+	auto x = new Variable ( dt_int, "x" );
+	x->insert_to ( bn );
+
+	State * s[6];
+	for ( int k = 0; k < 6; k++ )
+	{
+		s[k] = new State ( "s" + std::to_string ( k ) );
+		s[k]->insert_to ( bn );
+	}
+	s[0]->is_initial() = true;
+	s[2]->is_final() = true;
+	// s3 is a dead end, s4 and s5 are not reachable
+	s[5]->is_error() = true;
+
+	( *s[0] ->* *s[1] ) ( CURR ( x ) > 0 ).insert_to ( bn );
+	( *s[1] ->* *s[2] ) ( CURR ( x ) > 1 ).insert_to ( bn );
+	( *s[1] ->* *s[3] ) ( CURR ( x ) > 2 ).insert_to ( bn );
+	( *s[3] ->* *s[3] ) ( CURR ( x ) > 3 ).insert_to ( bn );
+	( *s[4] ->* *s[5] ) ( CURR ( x ) > 4 ).insert_to ( bn );
+
+	unsigned int n = prune_states ( bn );
+	cout << "removed states: " << n << "\n";
+	cout << bn;
+}
+
+void print_states ( const char * label, const ControlFlow::States & states )
+{
+	cout << label << ":";
+	for ( const State * s : states )
+		cout << " " << s->name;
+	cout << "\n";
+}
+
+void test_cfg()
+{
+	BasicNts bn ( "cfg" );
+	auto x = new Variable ( dt_int, "x" );
+	x->insert_to ( bn );
+
+	State * s[6];
+	for ( int k = 0; k < 6; k++ )
+	{
+		s[k] = new State ( "s" + std::to_string ( k ) );
+		s[k]->insert_to ( bn );
+	}
+	s[0]->is_initial() = true;
+
+	// Loop s1 <-> s2, self-loop on s3, s5 is not reachable
+	for ( auto e : { std::make_pair ( 0, 1 ), { 1, 2 }, { 2, 1 }, { 1, 3 },
+			{ 3, 3 }, { 3, 4 }, { 5, 4 } } )
+		( *s [ e.first ] ->* *s [ e.second ] ) ( CURR ( x ) > e.first ).insert_to ( bn );
+
+	const ControlFlow & cfg = bn.cfg();
+	print_states ( "rpo", cfg.reverse_postorder() );
+	for ( const auto & scc : cfg.sccs() )
+		print_states ( "scc", scc );
+	print_states ( "loop heads", cfg.loop_heads() );
+	for ( State * st : s )
+	{
+		const State * d = cfg.idom ( *st );
+		cout << "idom " << st->name << " = " << ( d ? d->name : "-" )
+			<< ( cfg.on_cycle ( *st ) ? ", on cycle" : "" ) << "\n";
+	}
+	cout << "s1 dominates s4: " << cfg.dominates ( *s[1], *s[4] ) << "\n";
+
+	// Analyses are recomputed after a change
+	( *s[0] ->* *s[4] ) ( CURR ( x ) > 6 ).insert_to ( bn );
+	cout << "s1 dominates s4: " << bn.cfg().dominates ( *s[1], *s[4] ) << "\n";
+	cout << "idom s4 = " << bn.cfg().idom ( *s[4] )->name << "\n";
+}
+
+void test_bisim()
+{
+	BasicNts bn ( "bisim" );
+	auto x = new Variable ( dt_int, "x" );
+	x->insert_to ( bn );
+
+	State * s[7];
+	for ( int k = 0; k < 7; k++ )
+	{
+		s[k] = new State ( "s" + std::to_string ( k ) );
+		s[k]->insert_to ( bn );
+	}
+	s[0]->is_initial() = true;
+	s[3]->is_final() = true;
+	s[4]->is_final() = true;
+	s[6]->is_error() = true;
+
+	// Two copies of the same path; s5 leads to an error instead
+	for ( int k : { 1, 2, 5 } )
+		( *s[0] ->* *s[k] ) ( CURR ( x ) > 0 ).insert_to ( bn );
+	( *s[1] ->* *s[3] ) ( ( NEXT ( x ) == CURR ( x ) + 1 ) && havoc ( { x } ) ).insert_to ( bn );
+	( *s[2] ->* *s[4] ) ( ( NEXT ( x ) == CURR ( x ) + 1 ) && havoc ( { x } ) ).insert_to ( bn );
+	( *s[5] ->* *s[6] ) ( ( NEXT ( x ) == CURR ( x ) + 1 ) && havoc ( { x } ) ).insert_to ( bn );
+
+	unsigned int n = merge_bisimilar_states ( bn );
+	cout << "merged states: " << n << "\n";
+	cout << bn;
+}
+
+void test_accelerate()
+{
+	BasicNts bn ( "accel" );
+	auto i = new Variable ( dt_int, "i" );
+	auto j = new Variable ( dt_int, "j" );
+	auto k = new Variable ( dt_int, "k" );
+	auto n = new Variable ( dt_int, "n" );
+	for ( Variable * v : { i, j, k, n } )
+		v->insert_to ( bn );
+
+	auto s0 = new State ( "s0" );
+	auto s1 = new State ( "s1" );
+	s0->is_initial() = true;
+	s0->insert_to ( bn );
+	s1->insert_to ( bn );
+
+	// Counter, difference bound, kept bound
+	auto & f1 = ( CURR ( i ) < CURR ( n ) ) && ( NEXT ( i ) == CURR ( i ) + 1 )
+		&& ( NEXT ( j ) == op ( ArithOp::Sub, CURR ( j ), num ( 2 ) ) )
+		&& ( NEXT ( k ) <= CURR ( k ) + 3 ) && havoc ( { i, j, k } );
+	( *s0 ->* *s0 ) ( f1 ).insert_to ( bn );
+
+	// Not accelerated: non-linear guard
+	auto & f2 = ( op ( ArithOp::Mul, CURR ( i ), CURR ( i ) ) < 10 )
+		&& ( NEXT ( i ) == CURR ( i ) + 1 ) && havoc ( { i } );
+	( *s1 ->* *s1 ) ( f2 ).insert_to ( bn );
+
+	unsigned int m = accelerate_loops ( bn );
+	cout << "accelerated loops: " << m << "\n";
+	cout << bn;
+}
+
+void test_intervals()
+{
+	BasicNts bn ( "intervals" );
+	auto i = new Variable ( dt_int, "i" );
+	auto n = new Variable ( dt_int, "n" );
+	for ( Variable * v : { i, n } )
+		v->insert_to ( bn );
+
+	auto s0 = new State ( "s0" );
+	auto s1 = new State ( "s1" );
+	auto s2 = new State ( "s2" );
+	auto s3 = new State ( "s3" );
+	for ( State * s : { s0, s1, s2, s3 } )
+		s->insert_to ( bn );
+	s0->is_initial() = true;
+	s2->is_final() = true;
+	s3->is_error() = true;
+
+	// for ( i = 0; i < 10; i++ ), n is not changed
+	( *s0 ->* *s1 ) ( ( NEXT ( i ) == 0 ) && havoc ( { i } ) ).insert_to ( bn );
+	( *s1 ->* *s1 ) ( ( CURR ( i ) < 10 ) && ( NEXT ( i ) == CURR ( i ) + 1 ) && havoc ( { i } ) ).insert_to ( bn );
+	( *s1 ->* *s2 ) ( ( CURR ( i ) >= 10 ) && havoc() ).insert_to ( bn );
+	// Infeasible
+	( *s1 ->* *s3 ) ( ( CURR ( i ) > 20 ) && havoc() ).insert_to ( bn );
+
+	IntervalAnalysis a ( bn );
+	for ( State * s : { s0, s1, s2, s3 } )
+		cout << s->name << ": i in " << a.bounds ( *s, *i )
+			<< ", n in " << a.bounds ( *s, *n ) << "\n";
+
+	annotate_invariants ( bn );
+	unsigned int m = strengthen_guards ( bn );
+	cout << "infeasible transitions: " << m << "\n";
+	cout << bn;
+}
+
+void test_intervals_wrapping()
+{
+	BasicNts bn ( "intervals_wrapping" );
+	auto x = new Variable ( dt_int, "x" );
+	auto y = new Variable ( dt_int, "y" );
+	auto z = new Variable ( dt_int, "z" );
+	Variable * c = new BitVectorVariable ( "c", 4 );
+	Variable * d = new BitVectorVariable ( "d", 4 );
+	for ( Variable * v : { x, y, z, c, d } )
+		v->insert_to ( bn );
+
+	auto s0 = new State ( "s0" );
+	auto s1 = new State ( "s1" );
+	auto s2 = new State ( "s2" );
+	auto s3 = new State ( "s3" );
+	auto se = new State ( "se" );
+	for ( State * s : { s0, s1, s2, s3, se } )
+		s->insert_to ( bn );
+	s0->is_initial() = true;
+	se->is_error() = true;
+
+	// Euclidean division and remainder of a negative dividend
+	( *s0 ->* *s1 ) ( ( NEXT ( x ) == -7 ) && havoc ( { x } ) ).insert_to ( bn );
+	( *s1 ->* *s2 ) ( ( NEXT ( y ) == op ( ArithOp::Div, CURR ( x ), num ( 2 ) ) )
+			&& ( NEXT ( z ) == op ( ArithOp::Mod, CURR ( x ), num ( 2 ) ) )
+			&& havoc ( { y, z } ) ).insert_to ( bn );
+	( *s2 ->* *se ) ( ( CURR ( y ) == -4 ) && havoc() ).insert_to ( bn );
+	( *s2 ->* *se ) ( ( CURR ( z ) == 1 ) && havoc() ).insert_to ( bn );
+
+	// Constants wrap in the sort of the bitvector
+	( *s0 ->* *s3 ) ( ( NEXT ( c ) == op ( ArithOp::Add, num ( 15 ), num ( 1 ) ) )
+			&& ( NEXT ( d ) == num ( -1 ) ) && havoc ( { c, d } ) ).insert_to ( bn );
+	( *s3 ->* *se ) ( ( CURR ( c ) == 0 ) && ( CURR ( d ) == 15 ) && havoc() ).insert_to ( bn );
+
+	IntervalAnalysis a ( bn );
+	for ( Variable * v : { y, z } )
+		cout << v->name << " in " << a.bounds ( *s2, *v ) << "\n";
+	for ( Variable * v : { c, d } )
+		cout << v->name << " in " << a.bounds ( *s3, *v ) << "\n";
+
+	unsigned int m = strengthen_guards ( bn );
+	cout << "infeasible transitions: " << m << "\n";
+}
+
+void print_decomposition ( const FormulaTransitionRule & r, const Variable * const ( & vars ) [3] )
+{
+	const RuleDecomposition & d = r.decomposition();
+	for ( const Formula * g : d.guards() )
+		cout << "guard " << *g << "\n";
+	for ( const auto & u : d.updates() )
+		cout << "update " << u.variable->name << "' = " << *u.term << "\n";
+	for ( const Formula * o : d.others() )
+		cout << "other " << *o << "\n";
+
+	for ( const Variable * v : vars )
+	{
+		cout << v->name << ": changes " << d.changes ( *v )
+			<< ", read " << d.reads().contains ( *v )
+			<< ", written " << d.writes().contains ( *v ) << "\n";
+	}
+}
+
+void test_decomposition()
+{
+	BasicNts bn ( "decomposition" );
+	auto x = new Variable ( dt_int, "x" );
+	auto y = new Variable ( dt_int, "y" );
+	auto n = new Variable ( dt_int, "n" );
+	for ( Variable * v : { x, y, n } )
+		v->insert_to ( bn );
+
+	auto s0 = new State ( "s0" );
+	s0->insert_to ( bn );
+
+	auto & t = ( *s0 ->* *s0 ) ( ( CURR ( x ) < CURR ( n ) ) && ( NEXT ( x ) == CURR ( x ) + 1 )
+			&& ( NEXT ( y ) > NEXT ( x ) ) && havoc ( { x, y } ) );
+	t.insert_to ( bn );
+
+	auto & r = static_cast < FormulaTransitionRule & > ( t.rule() );
+	const Variable * vars[3] = { x, y, n };
+	print_decomposition ( r, vars );
+
+	// Cached until the formula changes
+	cout << "cached: " << ( &r.decomposition() == &r.decomposition() ) << "\n";
+	r.transform_formula ( [&] ( unique_ptr < Formula > f )
+	{
+		return unique_ptr < Formula > ( &( *f.release() && havoc ( { x } ) ) );
+	} );
+	print_decomposition ( r, vars );
+
+	VariableSet xy, yn;
+	xy.insert ( *x );
+	xy.insert ( *y );
+	yn.insert ( *y );
+	yn.insert ( *n );
+	xy &= yn;
+	cout << "intersection: " << xy.size() << " " << xy.contains ( *y ) << "\n";
+	xy |= yn;
+	xy -= yn;
+	cout << "difference empty: " << xy.empty() << "\n";
+}
+
+void test_havoc()
+{
+	Variable x ( dt_int, "x" );
+	Variable y ( dt_int, "y" );
+	Variable z ( dt_int, "z" );
+
+	Havoc h1 { &x, &y, &x };
+	Havoc h2 { &y, &z };
+	cout << h1 << ": x " << h1.havocs ( x ) << ", z " << h1.havocs ( z ) << "\n";
+
+	// Bitset follows changes of the variables
+	h1.variables.erase ( h1.variables.begin() );
+	h1.variables.erase ( h1.variables.begin() + 1 );
+	cout << h1 << ": x " << h1.havocs ( x ) << ", y " << h1.havocs ( y ) << "\n";
+
+	h1.unite ( h2 );
+	cout << "union " << h1 << "\n";
+	h1.restrict_to ( h2.variable_set() );
+	cout << "intersection " << h1 << "\n";
+
+	// Repeated uses are erased as well
+	Havoc h3 { &z, &x, &z, &y };
+	h3.restrict_to ( h2.variable_set() );
+	cout << "intersection " << h3 << ": x " << h3.havocs ( x ) << ", z " << h3.havocs ( z ) << "\n";
+}
+
+void test_substitute()
+{
+	Nts nts ( "substitute" );
+	auto g = new Variable ( dt_int, "g" );
+	g->insert_to ( nts );
+
+	BasicNts * bn[2];
+	Variable * x[2];
+	Variable * y[2];
+	for ( int k = 0; k < 2; k++ )
+	{
+		bn[k] = new BasicNts ( "bn" + std::to_string ( k ) );
+		bn[k]->insert_to ( nts );
+		x[k] = new Variable ( dt_int, "x" );
+		y[k] = new Variable ( dt_int, "y" );
+		x[k]->insert_to ( *bn[k] );
+		y[k]->insert_to ( *bn[k] );
+
+		auto s0 = new State ( "s0" );
+		s0->insert_to ( *bn[k] );
+		( *s0 ->* *s0 ) ( ( CURR ( g ) < CURR ( x[k] ) ) && ( NEXT ( x[k] ) == CURR ( y[k] ) + 1 )
+				&& havoc ( { x[k] } ) ).insert_to ( *bn[k] );
+	}
+
+	// Swap, uses of g in bn1 are kept
+	unsigned int n = substitute ( *bn[0], VariableMap { { x[0], y[0] }, { y[0], x[0] }, { g, y[0] } } );
+	cout << "substituted: " << n << "\n";
+
+	unique_ptr < Term > t ( &op ( ArithOp::Mul, CURR ( x[1] ), num ( 2 ) ) );
+	n = substitute ( *bn[1], TermMap { { g, t.get() } } );
+	cout << "substituted: " << n << "\n";
+
+	// Integral constants take the type of the variable
+	unique_ptr < Term > c ( &num ( 5 ) );
+	n = substitute ( *bn[1], TermMap { { y[1], c.get() } } );
+	cout << "substituted: " << n << "\n";
+
+	// x is havocked
+	try
+	{
+		substitute ( *bn[1], TermMap { { x[1], t.get() } } );
+	}
+	catch ( const std::domain_error & e )
+	{
+		cout << e.what() << "\n";
+	}
+	cout << nts;
+}
+
+void test_replace_all_uses()
+{
+	BasicNts bn ( "replace" );
+	auto a = new Variable ( dt_int, "a" );
+	auto b = new Variable ( dt_int, "b" );
+	auto c = new BitVectorVariable ( "c", 8 );
+	for ( Variable * v : { a, b, static_cast < Variable * > ( c ) } )
+		v->insert_to ( bn );
+
+	auto s0 = new State ( "s0" );
+	s0->insert_to ( bn );
+	( *s0 ->* *s0 ) ( ( CURR ( a ) < CURR ( b ) ) && ( NEXT ( a ) == CURR ( a ) + 1 )
+			&& havoc ( { a } ) ).insert_to ( bn );
+
+	a->replace_all_uses_with ( *b );
+	cout << "uses of a: " << a->uses().size() << ", of b: " << b->uses().size() << "\n";
+	a->remove_from_parent();
+	delete a;
+
+	try
+	{
+		b->replace_all_uses_with ( *c );
+	}
+	catch ( const TypeError & e )
+	{
+		cout << e.what() << "\n";
+	}
+	cout << bn;
+}
+
+Formula & quant ( Quantifier q, Variable * v, int from, Term & to, Formula & body )
+{
+	auto qf = new QuantifiedFormula ( q,
+			QuantifiedType ( dt_int,
+				unique_ptr < Term > ( &num ( from ) ),
+				unique_ptr < Term > ( &to ) ),
+			unique_ptr < Formula > ( &body ) );
+	v->insert_to ( qf->list );
+	return *qf;
+}
+
+Formula & quant ( Quantifier q, Variable * v, int from, int to, Formula & body )
+{
+	return quant ( q, v, from, num ( to ), body );
+}
+
+void test_unroll()
+{
+	BasicNts bn ( "unroll" );
+	auto x = new Variable ( dt_int, "x" );
+	x->insert_to ( bn );
+
+	auto s0 = new State ( "s0" );
+	s0->insert_to ( bn );
+
+	// forall i in [0, 2] . x' > x + i
+	auto i = new Variable ( dt_int, "i" );
+	auto & f1 = quant ( Quantifier::Forall, i, 0, 2,
+			NEXT ( x ) > ( CURR ( x ) + CURR ( i ) ) );
+
+	// exists j in [1, 3] . x > 0, all instances are equal
+	auto j = new Variable ( dt_int, "j" );
+	auto & f2 = quant ( Quantifier::Exists, j, 1, 3, CURR ( x ) > 0 );
+
+	// forall k in [0, 100000] . x > k, too large
+	auto k = new Variable ( dt_int, "k" );
+	auto & f3 = quant ( Quantifier::Forall, k, 0, 100000, CURR ( x ) > CURR ( k ) );
+
+	// forall l in [1, 0] . false, empty range
+	auto l = new Variable ( dt_int, "l" );
+	auto & f4 = quant ( Quantifier::Forall, l, 1, 0, CURR ( x ) < 0 );
+
+	( *s0 ->* *s0 ) ( f1 && f2 && f3 && f4 && havoc ( { x } ) ).insert_to ( bn );
+
+	// forall p in [0, 2] . forall q in [0, p] . x' > p + q, inner bound depends on p
+	auto p = new Variable ( dt_int, "p" );
+	auto q = new Variable ( dt_int, "q" );
+	auto & f5 = quant ( Quantifier::Forall, p, 0, 2, quant ( Quantifier::Forall, q, 0, CURR ( p ),
+			NEXT ( x ) > ( CURR ( p ) + CURR ( q ) ) ) );
+
+	( *s0 ->* *s0 ) ( f5 && havoc ( { x } ) ).insert_to ( bn );
+
+	unsigned int n = unroll_quantifiers ( bn );
+	cout << "unrolled: " << n << "\n";
+	cout << bn;
+}
+
+void test_scalarize()
+{
+	BasicNts bn ( "scalarize" );
+	auto x = new Variable ( dt_int, "x" );
+	auto a = new Variable ( DataType ( ScalarType::Integer(), 0, { new IntConstant ( 3 ) } ), "a" );
+	auto b = new Variable ( DataType ( ScalarType::Integer(), 0, { new IntConstant ( 1000 ) } ), "b" );
+	auto c = new Variable ( DataType ( ScalarType::Integer(), 0, { new IntConstant ( 2 ) } ), "c" );
+	for ( Variable * v : { x, a, b, c } )
+		v->insert_to ( bn );
+
+	auto s0 = new State ( "s0" );
+	auto s1 = new State ( "s1" );
+	s0->insert_to ( bn );
+	s1->insert_to ( bn );
+
+	// a'[1] = x, constant index
+	( *s0 ->* *s1 ) ( ( ArrWrite ( *a ) [ num ( 1 ) ] == CURR ( x ) ) && havoc ( { a } ) ).insert_to ( bn );
+
+	// a'[x] = a[0], symbolic index
+	ArrRead ar ( *a );
+	( *s1 ->* *s0 ) ( ( ArrWrite ( *a ) [ CURR ( x ) ] == ar [ num ( 0 ) ] ) && havoc ( { a } ) ).insert_to ( bn );
+
+	// a[x] > 0 && x' = b[x], b is too large
+	ArrRead br ( *b );
+	( *s0 ->* *s0 ) ( ( ar [ CURR ( x ) ] > 0 ) && ( NEXT ( x ) == br [ CURR ( x ) ] )
+			&& havoc ( { x } ) ).insert_to ( bn );
+
+	// !( c[x] > 0 ), out of bounds x must not enable it, c is kept
+	ArrRead cr ( *c );
+	( *s1 ->* *s1 ) ( ! ( cr [ CURR ( x ) ] > 0 ) && havoc() ).insert_to ( bn );
+
+	unsigned int n = scalarize_arrays ( bn );
+	cout << "scalarized: " << n << "\n";
+	cout << bn;
+
+	// p[x] + q[x] > r[x] would split into 8 * 8 * 8 cases, s[t[x]] into 8 * 8
+	BasicNts bn2 ( "scalarize_cases" );
+	const DataType dt_arr ( ScalarType::Integer(), 0, { new IntConstant ( 8 ) } );
+	Variable * arr[5];
+	for ( int k = 0; k < 5; k++ )
+	{
+		arr[k] = new Variable ( dt_arr, std::string ( 1, "pqrst"[k] ) );
+		arr[k]->insert_to ( bn2 );
+	}
+	auto y = new Variable ( dt_int, "y" );
+	y->insert_to ( bn2 );
+	auto s2 = new State ( "s2" );
+	s2->insert_to ( bn2 );
+
+	ArrRead p ( *arr[0] ), q ( *arr[1] ), r ( *arr[2] ), s ( *arr[3] ), t ( *arr[4] );
+	( *s2 ->* *s2 ) ( ( p [ CURR ( y ) ] + q [ CURR ( y ) ] > r [ CURR ( y ) ] ) && havoc() ).insert_to ( bn2 );
+	( *s2 ->* *s2 ) ( ( s [ t [ CURR ( y ) ] ] == 0 ) && havoc() ).insert_to ( bn2 );
+	cout << "scalarized: " << scalarize_arrays ( bn2 ) << "\n";
+}
+
+int main()
+{
+	test_dedup();
+	test_simplify();
+	test_collapse_chains();
+	test_compose();
+	test_slice();
+	test_slice_definitions();
+	test_liveness();
+	test_liveness_definitions();
+	test_prune();
+	test_cfg();
+	test_bisim();
+	test_accelerate();
+	test_intervals();
+	test_intervals_wrapping();
+	test_decomposition();
+	test_havoc();
+	test_substitute();
+	test_replace_all_uses();
+	test_unroll();
+	test_scalarize();
+	return 0;
+}